@@ -0,0 +1,96 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Benchmark of darray_parallel_reduce and darray_parallel_transform with
+ * an increasing number of threads.
+ *
+ * usage: darray-parallel-bench [n_elements [max_threads]]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../src/darray.h"
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+sum_int(void* acc, const void* element, void* arg)
+{
+    *(int64_t*) acc += *(const int*) element;
+}
+
+static void
+sum_int64(void* acc, const void* other, void* arg)
+{
+    *(int64_t*) acc += *(const int64_t*) other;
+}
+
+static void
+square(void* dest, const void* src, void* arg)
+{
+    int64_t v = *(const int*) src;
+    *(int64_t*) dest = v * v;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 50000000;
+    size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 16;
+    DArray_t src = darray_create_capacity(sizeof(int), NULL, NULL, n);
+    DArray_t dest = darray_create(sizeof(int64_t), NULL, NULL);
+
+    for (size_t i = 0; i < n; i++) {
+        int v = (int) (i & 0xffff);
+        darray_append(src, &v);
+    }
+
+    for (size_t t = 1; t <= max_threads; t *= 2) {
+        ThreadPool_t pool = threadpool_create(t);
+        int64_t sum = 0;
+        double start = now();
+        darray_parallel_reduce(src, pool, &sum, sizeof(sum),
+                               sum_int, sum_int64, NULL);
+        double reduced = now();
+        darray_parallel_transform(dest, src, pool, square, NULL);
+        double transformed = now();
+
+        printf("threads %2zu: reduce %8.1f M/s, transform %8.1f M/s (%lld)\n",
+               threadpool_size(pool),
+               n / (reduced - start) * 1e-6,
+               n / (transformed - reduced) * 1e-6,
+               (long long) sum
+               );
+        threadpool_destroy(pool);
+    }
+
+    darray_destroy(dest);
+    darray_destroy(src);
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Benchmark of a sequential scan, list_find without a match, over a list
+ * and an unrolled list. Other allocations are interleaved with the
+ * insertions, so the nodes of the list are spread over the heap.
+ *
+ * usage: list-bench [n_elements [repeats]]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/list.h"
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int
+cmp_int(const void* a, const void* b)
+{
+    return *(const int*) a - *(const int*) b;
+}
+
+static double
+scan(List_t list, int repeats)
+{
+    int missing = -1;
+    double start = now();
+    for (int r = 0; r < repeats; r++)
+        if (list_find(list, &missing, cmp_int))
+            fprintf(stderr, "unexpected match\n");
+    return (now() - start) / repeats;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    int repeats = argc > 2 ? atoi(argv[2]) : 20;
+    void** junk = malloc(n * sizeof(void*));
+    List_t plain = list_create(sizeof(int), NULL, NULL);
+    List_t unrolled = list_create_unrolled(sizeof(int), NULL, NULL);
+
+    srand(1);
+    for (size_t i = 0; i < n; i++) {
+        int v = (int) i;
+        list_prepend(plain, &v);
+        list_prepend(unrolled, &v);
+        junk[i] = malloc(16 + rand() % 256);
+    }
+    for (size_t i = 0; i < n; i++)
+        free(junk[i]);
+    free(junk);
+
+    double tp = scan(plain, repeats);
+    double tu = scan(unrolled, repeats);
+    printf("%zu elements\n", n);
+    printf("list          %8.3f ms  %6.2f ns/element\n", tp * 1e3, tp * 1e9 / n);
+    printf("unrolled list %8.3f ms  %6.2f ns/element  %.1fx\n",
+           tu * 1e3, tu * 1e9 / n, tp / tu);
+
+    list_destroy(plain);
+    list_destroy(unrolled);
+    return 0;
+}
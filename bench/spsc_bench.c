@@ -0,0 +1,193 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Two thread benchmark of the SpscQueue_t.
+ *
+ * throughput: a producer pushes n elements in batches, the consumer pops
+ *             them in batches.
+ * latency:    an element is bounced between two threads over two queues,
+ *             the round trip time is reported.
+ *
+ * usage: spsc-bench [n_elements [batch_size]]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../src/spscqueue.h"
+
+static size_t g_n     = 50000000;
+static size_t g_batch = 64;
+
+struct PingPong {
+    SpscQueue_t ping;
+    SpscQueue_t pong;
+};
+
+/*
+ * Spin a while before yielding, so the benchmark also completes when both
+ * threads share a core.
+ */
+static void
+backoff(unsigned* spins)
+{
+    if (++*spins > 1000) {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void*
+producer(void* arg)
+{
+    SpscQueue_t q = arg;
+    uint64_t* batch = malloc(g_batch * sizeof(uint64_t));
+    uint64_t next = 0;
+    unsigned spins = 0;
+
+    while (next < g_n) {
+        size_t n = 0, pushed;
+        while (n < g_batch && next + n < g_n) {
+            batch[n] = next + n;
+            n++;
+        }
+        pushed = spsc_queue_push_n(q, batch, n);
+        if (!pushed)
+            backoff(&spins);
+        next += pushed;
+    }
+    free(batch);
+    return NULL;
+}
+
+static void*
+echo(void* arg)
+{
+    struct PingPong* pp = arg;
+    uint64_t v;
+    unsigned spins = 0;
+
+    for (size_t i = 0; i < g_n / 100; i++) {
+        while (spsc_queue_pop(pp->ping, &v) != SPSC_QUEUE_OK)
+            backoff(&spins);
+        while (spsc_queue_push(pp->pong, &v) != SPSC_QUEUE_OK)
+            backoff(&spins);
+    }
+    return NULL;
+}
+
+static int
+throughput(void)
+{
+    SpscQueue_t q = spsc_queue_create(sizeof(uint64_t), NULL, NULL, 4096);
+    uint64_t* batch = malloc(g_batch * sizeof(uint64_t));
+    uint64_t expected = 0;
+    pthread_t thread;
+    int errors = 0;
+    unsigned spins = 0;
+
+    double start = now();
+    pthread_create(&thread, NULL, producer, q);
+    while (expected < g_n) {
+        size_t n = spsc_queue_pop_n(q, batch, g_batch);
+        if (!n)
+            backoff(&spins);
+        for (size_t i = 0; i < n; i++)
+            if (batch[i] != expected++)
+                errors++;
+    }
+    pthread_join(thread, NULL);
+    double elapsed = now() - start;
+
+    printf("throughput: %zu elements in %.3f s, %.1f M elements/s "
+           "(batch %zu)\n",
+           g_n, elapsed, g_n / elapsed / 1e6, g_batch
+           );
+
+    free(batch);
+    spsc_queue_destroy(q);
+    return errors;
+}
+
+static void
+latency(void)
+{
+    struct PingPong pp = {
+        spsc_queue_create(sizeof(uint64_t), NULL, NULL, 64),
+        spsc_queue_create(sizeof(uint64_t), NULL, NULL, 64)
+    };
+    size_t rounds = g_n / 100;
+    pthread_t thread;
+    uint64_t v;
+    unsigned spins = 0;
+
+    pthread_create(&thread, NULL, echo, &pp);
+    double start = now();
+    for (size_t i = 0; i < rounds; i++) {
+        v = i;
+        while (spsc_queue_push(pp.ping, &v) != SPSC_QUEUE_OK)
+            backoff(&spins);
+        while (spsc_queue_pop(pp.pong, &v) != SPSC_QUEUE_OK)
+            backoff(&spins);
+    }
+    double elapsed = now() - start;
+    pthread_join(thread, NULL);
+
+    printf("latency: %zu round trips, %.1f ns per round trip\n",
+           rounds, elapsed / rounds * 1e9
+           );
+
+    spsc_queue_destroy(pp.ping);
+    spsc_queue_destroy(pp.pong);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+        g_n = strtoull(argv[1], NULL, 10);
+    if (argc > 2)
+        g_batch = strtoull(argv[2], NULL, 10);
+    if (g_n < 100 || g_batch == 0) {
+        fprintf(stderr, "usage: %s [n_elements >= 100 [batch_size]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int errors = throughput();
+    latency();
+
+    if (errors) {
+        fprintf(stderr, "%d elements arrived out of order\n", errors);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,941 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "art.h"
+#include "priv/memtracepriv.h"
+#include "priv/simdpriv.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * The number of prefix bytes stored in a node. Longer prefixes are
+ * skipped during a lookup and verified at the leaf.
+ */
+#define ART_MAX_PREFIX 10
+
+enum ArtNodeType {
+    NODE4,
+    NODE16,
+    NODE48,
+    NODE256
+};
+
+/**
+ * \brief A key value pair, the key is stored behind it.
+ *
+ * Pointers to leaves are tagged with the lowest bit.
+ *
+ * \private
+ */
+struct ArtLeaf {
+    void*           value;
+    size_t          len;
+    unsigned char   key[];
+};
+
+typedef struct ArtLeaf ArtLeaf;
+
+/**
+ * \brief The header of the inner nodes.
+ *
+ * All keys below a node at depth d share prefix_len bytes from d on, the
+ * first ART_MAX_PREFIX of them are in prefix. The node branches on the
+ * byte after the prefix. A key that ends after the prefix is in term.
+ *
+ * \private
+ */
+struct ArtNode {
+    uint8_t         type;
+    uint16_t        n;      ///< the number of children.
+    size_t          prefix_len;
+    unsigned char   prefix[ART_MAX_PREFIX];
+    ArtLeaf*        term;
+};
+
+typedef struct ArtNode ArtNode;
+
+/* keys are sorted, children[i] belongs to keys[i]. */
+typedef struct ArtNode4 {
+    ArtNode         hdr;
+    unsigned char   keys[4];
+    void*           children[4];
+} ArtNode4;
+
+typedef struct ArtNode16 {
+    ArtNode         hdr;
+    unsigned char   keys[16];
+    void*           children[16];
+} ArtNode16;
+
+/* index[byte] is 1 + the slot of the child, 0 when there is none. */
+typedef struct ArtNode48 {
+    ArtNode         hdr;
+    unsigned char   index[256];
+    void*           children[48];
+} ArtNode48;
+
+typedef struct ArtNode256 {
+    ArtNode         hdr;
+    void*           children[256];
+} ArtNode256;
+
+/**
+ * \brief the private implementation of an Art_t.
+ *
+ * \private
+ */
+struct Art {
+    void*           root;
+    size_t          size;
+    clib_free_func  ff;
+    unsigned        site;   ///< creation site for memory accounting.
+};
+
+typedef struct Art Art;
+
+static inline size_t
+min_size(size_t a, size_t b)
+{
+    return a < b ? a : b;
+}
+
+/* * leaves * */
+
+static inline int
+is_leaf(const void* p)
+{
+    return (uintptr_t) p & 1;
+}
+
+static inline ArtLeaf*
+as_leaf(const void* p)
+{
+    return (ArtLeaf*) ((uintptr_t) p & ~(uintptr_t) 1);
+}
+
+static inline void*
+tag_leaf(ArtLeaf* leaf)
+{
+    return (void*) ((uintptr_t) leaf | 1);
+}
+
+static ArtLeaf*
+leaf_alloc(const Art* t, const void* key, size_t len, void* value)
+{
+    ArtLeaf* leaf = clib_malloc(CLIB_MEM_ART, t->site, sizeof(ArtLeaf) + len);
+    if (!leaf)
+        return NULL;
+    leaf->value = value;
+    leaf->len = len;
+    if (len)
+        memcpy(leaf->key, key, len);
+    return leaf;
+}
+
+static void
+leaf_free(const Art* t, ArtLeaf* leaf)
+{
+    clib_free(CLIB_MEM_ART, t->site, leaf, sizeof(ArtLeaf) + leaf->len);
+}
+
+static inline int
+leaf_matches(const ArtLeaf* leaf, const void* key, size_t len)
+{
+    return leaf->len == len && memcmp(leaf->key, key, len) == 0;
+}
+
+static inline int
+leaf_is_prefix_of(const ArtLeaf* leaf, const void* key, size_t len)
+{
+    return leaf->len <= len && memcmp(leaf->key, key, leaf->len) == 0;
+}
+
+/* * inner nodes * */
+
+static size_t
+node_size(uint8_t type)
+{
+    switch (type) {
+        case NODE4:  return sizeof(ArtNode4);
+        case NODE16: return sizeof(ArtNode16);
+        case NODE48: return sizeof(ArtNode48);
+        default:     return sizeof(ArtNode256);
+    }
+}
+
+static ArtNode*
+node_alloc(const Art* t, uint8_t type)
+{
+    ArtNode* n = clib_calloc(CLIB_MEM_ART, t->site, 1, node_size(type));
+    if (n)
+        n->type = type;
+    return n;
+}
+
+static void
+node_free(const Art* t, ArtNode* n)
+{
+    clib_free(CLIB_MEM_ART, t->site, n, node_size(n->type));
+}
+
+static void
+copy_header(ArtNode* dest, const ArtNode* src)
+{
+    dest->n = src->n;
+    dest->prefix_len = src->prefix_len;
+    dest->term = src->term;
+    memcpy(dest->prefix, src->prefix, min_size(src->prefix_len, ART_MAX_PREFIX));
+}
+
+/*
+ * Returns the slot of the child for byte c or NULL.
+ */
+static void**
+find_child(const ArtNode* n, unsigned char c)
+{
+    switch (n->type) {
+        case NODE4: {
+            ArtNode4* p = (ArtNode4*) n;
+            for (unsigned i = 0; i < n->n; i++)
+                if (p->keys[i] == c)
+                    return &p->children[i];
+            return NULL;
+        }
+        case NODE16: {
+            ArtNode16* p = (ArtNode16*) n;
+#if defined(CLIB_SIMD_X86)
+            __m128i eq = _mm_cmpeq_epi8(_mm_set1_epi8((char) c),
+                                        _mm_loadu_si128((__m128i*) p->keys)
+                                        );
+            unsigned mask = (unsigned) _mm_movemask_epi8(eq) &
+                            ((1u << n->n) - 1);
+            return mask ? &p->children[__builtin_ctz(mask)] : NULL;
+#else
+            for (unsigned i = 0; i < n->n; i++)
+                if (p->keys[i] == c)
+                    return &p->children[i];
+            return NULL;
+#endif
+        }
+        case NODE48: {
+            ArtNode48* p = (ArtNode48*) n;
+            return p->index[c] ? &p->children[p->index[c] - 1] : NULL;
+        }
+        default: {
+            ArtNode256* p = (ArtNode256*) n;
+            return p->children[c] ? &p->children[c] : NULL;
+        }
+    }
+}
+
+/*
+ * Returns a leaf below n, all of them share the prefix of n.
+ */
+static ArtLeaf*
+any_leaf(const ArtNode* n)
+{
+    while (1) {
+        const void* child = NULL;
+        if (n->term)
+            return n->term;
+        switch (n->type) {
+            case NODE4:  child = ((ArtNode4*) n)->children[0];  break;
+            case NODE16: child = ((ArtNode16*) n)->children[0]; break;
+            case NODE48: {
+                const ArtNode48* p = (const ArtNode48*) n;
+                for (unsigned i = 0; !child; i++)
+                    if (p->index[i])
+                        child = p->children[p->index[i] - 1];
+                break;
+            }
+            default: {
+                const ArtNode256* p = (const ArtNode256*) n;
+                for (unsigned i = 0; !child; i++)
+                    child = p->children[i];
+            }
+        }
+        if (is_leaf(child))
+            return as_leaf(child);
+        n = child;
+    }
+}
+
+/*
+ * Returns the number of stored prefix bytes of n that match key at
+ * depth, the bytes beyond ART_MAX_PREFIX are not checked.
+ */
+static size_t
+check_prefix(const ArtNode* n, const unsigned char* key, size_t len, size_t depth)
+{
+    size_t max = min_size(min_size(n->prefix_len, ART_MAX_PREFIX), len - depth);
+    size_t i;
+    for (i = 0; i < max; i++)
+        if (n->prefix[i] != key[depth + i])
+            break;
+    return i;
+}
+
+/*
+ * Returns the index of the first byte where key differs from the whole
+ * prefix of n.
+ */
+static size_t
+prefix_mismatch(const ArtNode* n,
+                const unsigned char* key,
+                size_t len,
+                size_t depth
+                )
+{
+    size_t i = check_prefix(n, key, len, depth);
+    if (i < ART_MAX_PREFIX || n->prefix_len <= ART_MAX_PREFIX)
+        return i;
+
+    const ArtLeaf* leaf = any_leaf(n);
+    size_t max = min_size(n->prefix_len, len - depth);
+    for (; i < max; i++)
+        if (leaf->key[depth + i] != key[depth + i])
+            break;
+    return i;
+}
+
+/*
+ * Adds child under byte c to n, which must have room.
+ */
+static void
+add_child_room(ArtNode* n, unsigned char c, void* child)
+{
+    switch (n->type) {
+        case NODE4:
+        case NODE16: {
+            unsigned char* keys = n->type == NODE4 ? ((ArtNode4*) n)->keys
+                                                   : ((ArtNode16*) n)->keys;
+            void** children = n->type == NODE4 ? ((ArtNode4*) n)->children
+                                               : ((ArtNode16*) n)->children;
+            unsigned i = 0;
+            while (i < n->n && keys[i] < c)
+                i++;
+            memmove(keys + i + 1, keys + i, n->n - i);
+            memmove(children + i + 1, children + i, (n->n - i) * sizeof(void*));
+            keys[i] = c;
+            children[i] = child;
+            break;
+        }
+        case NODE48: {
+            ArtNode48* p = (ArtNode48*) n;
+            unsigned slot = 0;
+            while (p->children[slot])
+                slot++;
+            p->children[slot] = child;
+            p->index[c] = (unsigned char) (slot + 1);
+            break;
+        }
+        default:
+            ((ArtNode256*) n)->children[c] = child;
+    }
+    n->n++;
+}
+
+static const uint16_t g_capacity[] = {4, 16, 48, 256};
+
+/*
+ * Moves the children of src to dest, which has another type.
+ */
+static void
+move_children(ArtNode* dest, const ArtNode* src)
+{
+    copy_header(dest, src);
+    dest->n = 0;
+    switch (src->type) {
+        case NODE4:
+        case NODE16: {
+            const unsigned char* keys =
+                src->type == NODE4 ? ((ArtNode4*) src)->keys
+                                   : ((ArtNode16*) src)->keys;
+            void* const* children =
+                src->type == NODE4 ? ((ArtNode4*) src)->children
+                                   : ((ArtNode16*) src)->children;
+            for (unsigned i = 0; i < src->n; i++)
+                add_child_room(dest, keys[i], children[i]);
+            break;
+        }
+        case NODE48: {
+            const ArtNode48* p = (const ArtNode48*) src;
+            for (unsigned c = 0; c < 256; c++)
+                if (p->index[c])
+                    add_child_room(dest, c, p->children[p->index[c] - 1]);
+            break;
+        }
+        default: {
+            const ArtNode256* p = (const ArtNode256*) src;
+            for (unsigned c = 0; c < 256; c++)
+                if (p->children[c])
+                    add_child_room(dest, c, p->children[c]);
+        }
+    }
+}
+
+/*
+ * Adds child under byte c to the node at *ref, a full node is replaced
+ * by a larger one.
+ */
+static int
+add_child(Art* t, void** ref, unsigned char c, void* child)
+{
+    ArtNode* n = *ref;
+
+    if (n->n == g_capacity[n->type]) {
+        ArtNode* bigger = node_alloc(t, n->type + 1);
+        if (!bigger)
+            return ART_OUT_OF_MEM;
+        move_children(bigger, n);
+        node_free(t, n);
+        *ref = n = bigger;
+    }
+    add_child_room(n, c, child);
+    return ART_OK;
+}
+
+/*
+ * Replaces the node at *ref by a smaller one when it has few children,
+ * a node with one child and no term merges with the child.
+ */
+static void
+shrink(Art* t, void** ref)
+{
+    ArtNode* n = *ref;
+
+    if (n->type == NODE4) {
+        ArtNode4* p = (ArtNode4*) n;
+        if (n->n == 0) {
+            *ref = n->term ? tag_leaf(n->term) : NULL;
+            node_free(t, n);
+        }
+        else if (n->n == 1 && !n->term) {
+            void* child = p->children[0];
+            if (!is_leaf(child)) {
+                // the prefix of the child becomes n's prefix + key + its own.
+                ArtNode* c = child;
+                unsigned char buf[ART_MAX_PREFIX];
+                size_t k = min_size(n->prefix_len, ART_MAX_PREFIX);
+                memcpy(buf, n->prefix, k);
+                if (k < ART_MAX_PREFIX)
+                    buf[k++] = p->keys[0];
+                if (k < ART_MAX_PREFIX) {
+                    size_t m = min_size(c->prefix_len, ART_MAX_PREFIX - k);
+                    memcpy(buf + k, c->prefix, m);
+                    k += m;
+                }
+                c->prefix_len += n->prefix_len + 1;
+                memcpy(c->prefix, buf, k);
+            }
+            *ref = child;
+            node_free(t, n);
+        }
+        return;
+    }
+
+    // shrink with some hysteresis, so a node doesn't flip between sizes.
+    if (n->n <= g_capacity[n->type - 1] * 3 / 4) {
+        ArtNode* smaller = node_alloc(t, n->type - 1);
+        if (!smaller)
+            return; // a node that is too large is still valid.
+        move_children(smaller, n);
+        node_free(t, n);
+        *ref = smaller;
+    }
+}
+
+/*
+ * Removes the child in slot of the node at *ref.
+ */
+static void
+remove_child(Art* t, void** ref, unsigned char c, void** slot)
+{
+    ArtNode* n = *ref;
+
+    switch (n->type) {
+        case NODE4:
+        case NODE16: {
+            unsigned char* keys = n->type == NODE4 ? ((ArtNode4*) n)->keys
+                                                   : ((ArtNode16*) n)->keys;
+            void** children = n->type == NODE4 ? ((ArtNode4*) n)->children
+                                               : ((ArtNode16*) n)->children;
+            size_t i = slot - children;
+            memmove(keys + i, keys + i + 1, n->n - i - 1);
+            memmove(children + i, children + i + 1, (n->n - i - 1) * sizeof(void*));
+            break;
+        }
+        case NODE48:
+            ((ArtNode48*) n)->index[c] = 0;
+            *slot = NULL;
+            break;
+        default:
+            *slot = NULL;
+    }
+    n->n--;
+    shrink(t, ref);
+}
+
+static void
+free_subtree(Art* t, void* p)
+{
+    if (!p)
+        return;
+    if (is_leaf(p)) {
+        ArtLeaf* leaf = as_leaf(p);
+        if (t->ff)
+            t->ff(leaf->value);
+        leaf_free(t, leaf);
+        return;
+    }
+
+    ArtNode* n = p;
+    if (n->term)
+        free_subtree(t, tag_leaf(n->term));
+    switch (n->type) {
+        case NODE4:
+            for (unsigned i = 0; i < n->n; i++)
+                free_subtree(t, ((ArtNode4*) n)->children[i]);
+            break;
+        case NODE16:
+            for (unsigned i = 0; i < n->n; i++)
+                free_subtree(t, ((ArtNode16*) n)->children[i]);
+            break;
+        case NODE48:
+            for (unsigned i = 0; i < 48; i++)
+                free_subtree(t, ((ArtNode48*) n)->children[i]);
+            break;
+        default:
+            for (unsigned i = 0; i < 256; i++)
+                free_subtree(t, ((ArtNode256*) n)->children[i]);
+    }
+    node_free(t, n);
+}
+
+/* * insertion * */
+
+/*
+ * Puts leaf in n, which branches at depth.
+ */
+static void
+place_leaf(ArtNode* n, ArtLeaf* leaf, size_t depth)
+{
+    if (leaf->len == depth)
+        n->term = leaf;
+    else
+        add_child_room(n, leaf->key[depth], tag_leaf(leaf));
+}
+
+static int
+insert_at(Art*                  t,
+          void**                ref,
+          const unsigned char*  key,
+          size_t                len,
+          size_t                depth,
+          void*                 value
+          )
+{
+    while (1) {
+        void* p = *ref;
+        ArtLeaf* leaf;
+        ArtNode* split;
+
+        if (!p) {
+            if (!(leaf = leaf_alloc(t, key, len, value)))
+                return ART_OUT_OF_MEM;
+            *ref = tag_leaf(leaf);
+            t->size++;
+            return ART_OK;
+        }
+
+        if (is_leaf(p)) {
+            ArtLeaf* old = as_leaf(p);
+            if (leaf_matches(old, key, len)) {
+                if (t->ff && old->value != value)
+                    t->ff(old->value);
+                old->value = value;
+                return ART_OK;
+            }
+
+            // a node4 with the common prefix holds both leaves.
+            size_t common = 0;
+            size_t max = min_size(old->len, len) - depth;
+            while (common < max && old->key[depth + common] == key[depth + common])
+                common++;
+
+            leaf = leaf_alloc(t, key, len, value);
+            split = node_alloc(t, NODE4);
+            if (!leaf || !split) {
+                if (leaf)
+                    leaf_free(t, leaf);
+                if (split)
+                    node_free(t, split);
+                return ART_OUT_OF_MEM;
+            }
+            split->prefix_len = common;
+            memcpy(split->prefix, key + depth, min_size(common, ART_MAX_PREFIX));
+            place_leaf(split, old, depth + common);
+            place_leaf(split, leaf, depth + common);
+            *ref = split;
+            t->size++;
+            return ART_OK;
+        }
+
+        ArtNode* n = p;
+        if (n->prefix_len) {
+            size_t diff = prefix_mismatch(n, key, len, depth);
+            if (diff < n->prefix_len) {
+                // split the prefix at diff.
+                leaf = leaf_alloc(t, key, len, value);
+                split = node_alloc(t, NODE4);
+                if (!leaf || !split) {
+                    if (leaf)
+                        leaf_free(t, leaf);
+                    if (split)
+                        node_free(t, split);
+                    return ART_OUT_OF_MEM;
+                }
+                split->prefix_len = diff;
+                memcpy(split->prefix, n->prefix, min_size(diff, ART_MAX_PREFIX));
+
+                if (n->prefix_len <= ART_MAX_PREFIX) {
+                    add_child_room(split, n->prefix[diff], n);
+                    n->prefix_len -= diff + 1;
+                    memmove(n->prefix,
+                            n->prefix + diff + 1,
+                            min_size(n->prefix_len, ART_MAX_PREFIX)
+                            );
+                }
+                else {
+                    // the stored prefix is incomplete, restore it from a leaf.
+                    const ArtLeaf* any = any_leaf(n);
+                    add_child_room(split, any->key[depth + diff], n);
+                    n->prefix_len -= diff + 1;
+                    memcpy(n->prefix,
+                           any->key + depth + diff + 1,
+                           min_size(n->prefix_len, ART_MAX_PREFIX)
+                           );
+                }
+                place_leaf(split, leaf, depth + diff);
+                *ref = split;
+                t->size++;
+                return ART_OK;
+            }
+            depth += n->prefix_len;
+        }
+
+        if (depth == len) {
+            if (n->term) {
+                if (t->ff && n->term->value != value)
+                    t->ff(n->term->value);
+                n->term->value = value;
+                return ART_OK;
+            }
+            if (!(n->term = leaf_alloc(t, key, len, value)))
+                return ART_OUT_OF_MEM;
+            t->size++;
+            return ART_OK;
+        }
+
+        void** child = find_child(n, key[depth]);
+        if (child) {
+            ref = child;
+            depth++;
+            continue;
+        }
+
+        if (!(leaf = leaf_alloc(t, key, len, value)))
+            return ART_OUT_OF_MEM;
+        if (add_child(t, ref, key[depth], tag_leaf(leaf))) {
+            leaf_free(t, leaf);
+            return ART_OUT_OF_MEM;
+        }
+        t->size++;
+        return ART_OK;
+    }
+}
+
+/* * removal * */
+
+static int
+remove_at(Art* t, void** ref, const unsigned char* key, size_t len, size_t depth)
+{
+    void* p = *ref;
+    ArtNode* n;
+    ArtLeaf* leaf;
+
+    if (!p)
+        return ART_NOT_FOUND;
+    if (is_leaf(p)) {
+        // only the root can be a leaf that is not found via its parent.
+        leaf = as_leaf(p);
+        if (!leaf_matches(leaf, key, len))
+            return ART_NOT_FOUND;
+        *ref = NULL;
+        goto found;
+    }
+
+    n = p;
+    if (n->prefix_len) {
+        if (check_prefix(n, key, len, depth) !=
+            min_size(n->prefix_len, ART_MAX_PREFIX))
+            return ART_NOT_FOUND;
+        depth += n->prefix_len;
+        if (depth > len)
+            return ART_NOT_FOUND;
+    }
+
+    if (depth == len) {
+        leaf = n->term;
+        if (!leaf || !leaf_matches(leaf, key, len))
+            return ART_NOT_FOUND;
+        n->term = NULL;
+        shrink(t, ref);
+        goto found;
+    }
+
+    void** child = find_child(n, key[depth]);
+    if (!child)
+        return ART_NOT_FOUND;
+    if (!is_leaf(*child))
+        return remove_at(t, child, key, len, depth + 1);
+
+    leaf = as_leaf(*child);
+    if (!leaf_matches(leaf, key, len))
+        return ART_NOT_FOUND;
+    remove_child(t, ref, key[depth], child);
+
+found:
+    if (t->ff)
+        t->ff(leaf->value);
+    leaf_free(t, leaf);
+    t->size--;
+    return ART_OK;
+}
+
+/* * iteration * */
+
+static int
+visit(const void* p, art_visit_func func, void* arg)
+{
+    int ret = 0;
+
+    if (is_leaf(p)) {
+        const ArtLeaf* leaf = as_leaf(p);
+        return func(leaf->key, leaf->len, leaf->value, arg);
+    }
+
+    const ArtNode* n = p;
+    if (n->term && (ret = func(n->term->key, n->term->len, n->term->value, arg)))
+        return ret;
+
+    switch (n->type) {
+        case NODE4:
+            for (unsigned i = 0; !ret && i < n->n; i++)
+                ret = visit(((ArtNode4*) n)->children[i], func, arg);
+            break;
+        case NODE16:
+            for (unsigned i = 0; !ret && i < n->n; i++)
+                ret = visit(((ArtNode16*) n)->children[i], func, arg);
+            break;
+        case NODE48: {
+            const ArtNode48* q = (const ArtNode48*) n;
+            for (unsigned c = 0; !ret && c < 256; c++)
+                if (q->index[c])
+                    ret = visit(q->children[q->index[c] - 1], func, arg);
+            break;
+        }
+        default: {
+            const ArtNode256* q = (const ArtNode256*) n;
+            for (unsigned c = 0; !ret && c < 256; c++)
+                if (q->children[c])
+                    ret = visit(q->children[c], func, arg);
+        }
+    }
+    return ret;
+}
+
+/* * public functions * */
+
+Art_t
+art_create(clib_free_func ff)
+{
+    unsigned site = clib_mem_current_site();
+    Art* t = clib_calloc(CLIB_MEM_ART, site, 1, sizeof(Art));
+    if (!t)
+        return NULL;
+    t->ff = ff;
+    t->site = site;
+    return t;
+}
+
+void
+art_destroy(Art_t tree)
+{
+    Art* t = tree;
+    if (!t)
+        return;
+    free_subtree(t, t->root);
+    clib_free(CLIB_MEM_ART, t->site, t, sizeof(Art));
+}
+
+size_t
+art_size(const Art_t tree)
+{
+    const Art* t = tree;
+    return t->size;
+}
+
+int
+art_insert(Art_t tree, const void* key, size_t len, void* value)
+{
+    Art* t = tree;
+    return insert_at(t, &t->root, key, len, 0, value);
+}
+
+void*
+art_find(const Art_t tree, const void* key, size_t len)
+{
+    const Art* t = tree;
+    const unsigned char* k = key;
+    const void* p = t->root;
+    size_t depth = 0;
+
+    while (p) {
+        if (is_leaf(p)) {
+            const ArtLeaf* leaf = as_leaf(p);
+            return leaf_matches(leaf, key, len) ? leaf->value : NULL;
+        }
+
+        const ArtNode* n = p;
+        if (n->prefix_len) {
+            // optimistic: skipped prefix bytes are checked at the leaf.
+            if (check_prefix(n, k, len, depth) !=
+                min_size(n->prefix_len, ART_MAX_PREFIX))
+                return NULL;
+            depth += n->prefix_len;
+            if (depth > len)
+                return NULL;
+        }
+        if (depth == len)
+            return n->term && leaf_matches(n->term, key, len) ? n->term->value
+                                                              : NULL;
+
+        void** child = find_child(n, k[depth]);
+        p = child ? *child : NULL;
+        depth++;
+    }
+    return NULL;
+}
+
+int
+art_remove(Art_t tree, const void* key, size_t len)
+{
+    Art* t = tree;
+    return remove_at(t, &t->root, key, len, 0);
+}
+
+void*
+art_longest_prefix(const Art_t tree,
+                   const void* key,
+                   size_t      len,
+                   size_t*     match_len
+                   )
+{
+    const Art* t = tree;
+    const unsigned char* k = key;
+    const void* p = t->root;
+    const ArtLeaf* best = NULL;
+    size_t depth = 0;
+
+    while (p) {
+        if (is_leaf(p)) {
+            if (leaf_is_prefix_of(as_leaf(p), key, len))
+                best = as_leaf(p);
+            break;
+        }
+
+        const ArtNode* n = p;
+        if (n->prefix_len) {
+            if (check_prefix(n, k, len, depth) !=
+                min_size(n->prefix_len, ART_MAX_PREFIX))
+                break;
+            depth += n->prefix_len;
+            if (depth > len)
+                break;
+        }
+        if (n->term && leaf_is_prefix_of(n->term, key, len))
+            best = n->term;
+        if (depth == len)
+            break;
+
+        void** child = find_child(n, k[depth]);
+        p = child ? *child : NULL;
+        depth++;
+    }
+
+    if (!best)
+        return NULL;
+    if (match_len)
+        *match_len = best->len;
+    return best->value;
+}
+
+int
+art_iter_prefix(const Art_t    tree,
+                const void*    prefix,
+                size_t         len,
+                art_visit_func func,
+                void*          arg
+                )
+{
+    const Art* t = tree;
+    const unsigned char* k = prefix;
+    const void* p = t->root;
+    size_t depth = 0;
+
+    while (p) {
+        if (is_leaf(p)) {
+            const ArtLeaf* leaf = as_leaf(p);
+            if (leaf->len >= len && memcmp(leaf->key, prefix, len) == 0)
+                return visit(p, func, arg);
+            return 0;
+        }
+        if (depth == len)
+            return visit(p, func, arg);
+
+        const ArtNode* n = p;
+        if (n->prefix_len) {
+            // compare with a leaf, the stored prefix may be incomplete.
+            const ArtLeaf* leaf = any_leaf(n);
+            size_t m = min_size(n->prefix_len, len - depth);
+            if (memcmp(leaf->key + depth, k + depth, m) != 0)
+                return 0;
+            depth += n->prefix_len;
+            if (depth >= len)
+                return visit(p, func, arg);
+        }
+
+        void** child = find_child(n, k[depth]);
+        p = child ? *child : NULL;
+        depth++;
+    }
+    return 0;
+}
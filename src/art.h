@@ -0,0 +1,128 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef ART_H
+#define ART_H
+
+#include <stdlib.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An adaptive radix tree that maps byte string keys to values.
+ *
+ * The tree branches on one byte of the key per level, so a lookup costs
+ * at most one step per key byte and never compares whole keys until the
+ * leaf. Inner nodes grow from 4 to 16, 48 and 256 children and chains of
+ * nodes with one child are compressed into a prefix. The keys are
+ * ordered bytewise, a key comes before the keys it is a prefix of.
+ */
+typedef void* Art_t;
+
+enum ArtResult {
+    ART_OK = 0,
+    ART_OUT_OF_MEM,
+    ART_NOT_FOUND
+};
+
+/**
+ * Called for every key by art_iter_prefix().
+ *
+ * @return 0 to continue, !0 to stop the iteration.
+ */
+typedef int (*art_visit_func)(const void* key,
+                              size_t      len,
+                              void*       value,
+                              void*       arg
+                              );
+
+/**
+ * Create an empty tree.
+ *
+ * @param ff [in] called with a value when it is replaced, removed or when
+ *                the tree is destroyed, may be NULL.
+ *
+ * @return the tree or NULL when out of memory.
+ */
+Art_t art_create(clib_free_func ff);
+
+/**
+ * Destroys the tree.
+ */
+void art_destroy(Art_t tree);
+
+/**
+ * Returns the number of keys.
+ */
+size_t art_size(const Art_t tree);
+
+/**
+ * Store value under key, the tree copies the key.
+ *
+ * @return ART_OK or ART_OUT_OF_MEM, then the tree is unchanged.
+ */
+int art_insert(Art_t tree, const void* key, size_t len, void* value);
+
+/**
+ * Returns the value of key or NULL when key isn't present.
+ */
+void* art_find(const Art_t tree, const void* key, size_t len);
+
+/**
+ * Remove key and its value.
+ *
+ * @return ART_OK or ART_NOT_FOUND.
+ */
+int art_remove(Art_t tree, const void* key, size_t len);
+
+/**
+ * Find the longest key in the tree that is a prefix of key.
+ *
+ * @param match_len [out] receives the length of the found key, may be NULL.
+ *
+ * @return the value of the found key or NULL when no key is a prefix of
+ *         key.
+ */
+void* art_longest_prefix(const Art_t tree,
+                         const void* key,
+                         size_t      len,
+                         size_t*     match_len
+                         );
+
+/**
+ * Call func for the keys that start with prefix in ascending order, an
+ * empty prefix visits all keys. The tree must not be modified by func.
+ *
+ * @return 0 or the value returned by func when it stopped the iteration.
+ */
+int art_iter_prefix(const Art_t    tree,
+                    const void*    prefix,
+                    size_t         len,
+                    art_visit_func func,
+                    void*          arg
+                    );
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef ART_H*/
@@ -0,0 +1,378 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "bitset.h"
+#include "darray.h"
+#include "priv/memtracepriv.h"
+#include "priv/cachelinepriv.h"
+#include "priv/simdpriv.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * \brief the private implementation of a bitset.
+ *
+ * The bits beyond nbits in the last word are always zero, so counting
+ * and searching need not mask them.
+ *
+ * \private
+ */
+struct Bitset {
+    size_t      nbits;  ///< the number of bits.
+    size_t      cap;    ///< the number of allocated words.
+    uint64_t*   words;  ///< the bits, aligned on a cache line.
+    unsigned    site;   ///< creation site for memory accounting.
+};
+
+typedef struct Bitset Bitset;
+
+#define WORD_BITS 64
+#define BITSET_INC 2
+
+static inline size_t
+nwords(size_t nbits)
+{
+    return (nbits + WORD_BITS - 1) / WORD_BITS;
+}
+
+static inline size_t
+words_bytes(size_t nwords)
+{
+    return CLIB_CACHE_ROUND(nwords * sizeof(uint64_t));
+}
+
+/*
+ * Clears the bits beyond nbits in the last word.
+ */
+static inline void
+mask_tail(Bitset* b)
+{
+    if (b->nbits % WORD_BITS)
+        b->words[b->nbits / WORD_BITS] &=
+            (UINT64_C(1) << (b->nbits % WORD_BITS)) - 1;
+}
+
+/* * kernels * */
+
+/*
+ * Defines the bulk operation NAME for one instruction set, EXPR combines
+ * a word a of dest with a word b of src.
+ */
+#define DEFINE_BITOP(ISA, VB, NAME, EXPR)                                   \
+ATTR_##ISA static void                                                      \
+NAME##_##ISA(uint64_t* dest, const uint64_t* src, size_t n)                 \
+{                                                                           \
+    typedef uint64_t vec __attribute__((vector_size(VB)));                  \
+    enum { L = VB / sizeof(uint64_t) };                                     \
+    size_t i = 0;                                                           \
+    for (; i + L <= n; i += L) {                                            \
+        vec a, b;                                                           \
+        memcpy(&a, dest + i, VB);                                           \
+        memcpy(&b, src + i, VB);                                            \
+        a = EXPR;                                                           \
+        memcpy(dest + i, &a, VB);                                           \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+        uint64_t a = dest[i], b = src[i];                                   \
+        dest[i] = EXPR;                                                     \
+    }                                                                       \
+}
+
+#define DEFINE_BITOPS(ISA, VB)                                              \
+    DEFINE_BITOP(ISA, VB, and, a & b)                                       \
+    DEFINE_BITOP(ISA, VB, or, a | b)                                        \
+    DEFINE_BITOP(ISA, VB, xor, a ^ b)                                       \
+    DEFINE_BITOP(ISA, VB, andnot, a & ~b)
+
+typedef void (*bitop_func)(uint64_t* dest, const uint64_t* src, size_t n);
+
+#define ATTR_SCALAR
+
+#if defined(CLIB_SIMD_X86)
+
+DEFINE_BITOPS(SSE2, 16)
+DEFINE_BITOPS(AVX2, 32)
+DEFINE_BITOPS(AVX512, 64)
+
+/*
+ * Processors with AVX2 also have the popcnt instruction.
+ */
+__attribute__((target("popcnt"))) static size_t
+count_popcnt(const uint64_t* words, size_t n)
+{
+    size_t c0 = 0, c1 = 0, c2 = 0, c3 = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        c0 += (size_t) __builtin_popcountll(words[i]);
+        c1 += (size_t) __builtin_popcountll(words[i + 1]);
+        c2 += (size_t) __builtin_popcountll(words[i + 2]);
+        c3 += (size_t) __builtin_popcountll(words[i + 3]);
+    }
+    for (; i < n; i++)
+        c0 += (size_t) __builtin_popcountll(words[i]);
+    return c0 + c1 + c2 + c3;
+}
+
+#endif /*defined(CLIB_SIMD_X86)*/
+
+/* the scalar versions operate on one word at a time. */
+DEFINE_BITOPS(SCALAR, 8)
+
+/*
+ * Counts with the bit tricks of "Hacker's Delight", without a popcount
+ * instruction.
+ */
+static size_t
+count_scalar(const uint64_t* words, size_t n)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t x = words[i];
+        x = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+        x = (x & UINT64_C(0x3333333333333333)) +
+            ((x >> 2) & UINT64_C(0x3333333333333333));
+        x = (x + (x >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+        count += (size_t) ((x * UINT64_C(0x0101010101010101)) >> 56);
+    }
+    return count;
+}
+
+/* * bitset * */
+
+Bitset_t
+bitset_create(size_t nbits)
+{
+    unsigned site = clib_mem_current_site();
+    Bitset* b = clib_calloc(CLIB_MEM_BITSET, site, 1, sizeof(Bitset));
+    if (!b)
+        return NULL;
+
+    b->site = site;
+    if (bitset_resize(b, nbits)) {
+        clib_free(CLIB_MEM_BITSET, site, b, sizeof(Bitset));
+        return NULL;
+    }
+    return b;
+}
+
+void
+bitset_destroy(Bitset_t bitset)
+{
+    Bitset* b = bitset;
+    if (b->words)
+        clib_free(CLIB_MEM_BITSET, b->site, b->words, words_bytes(b->cap));
+    clib_free(CLIB_MEM_BITSET, b->site, b, sizeof(Bitset));
+}
+
+size_t
+bitset_size(const Bitset_t bitset)
+{
+    const Bitset* b = bitset;
+    return b->nbits;
+}
+
+int
+bitset_resize(Bitset_t bitset, size_t nbits)
+{
+    Bitset* b = bitset;
+    size_t old = nwords(b->nbits), needed = nwords(nbits);
+
+    if (needed > b->cap) {
+        size_t cap = b->cap ? b->cap : 1;
+        uint64_t* words;
+        while (cap < needed)
+            cap *= BITSET_INC;
+        // round up to whole cache lines, they are allocated anyway.
+        cap = words_bytes(cap) / sizeof(uint64_t);
+        words = clib_aligned_alloc(CLIB_MEM_BITSET,
+                                   b->site,
+                                   CLIB_CACHE_LINE,
+                                   words_bytes(cap)
+                                   );
+        if (!words)
+            return BITSET_OUT_OF_MEM;
+        if (old)
+            memcpy(words, b->words, old * sizeof(uint64_t));
+        if (b->words)
+            clib_free(CLIB_MEM_BITSET, b->site, b->words, words_bytes(b->cap));
+        b->words = words;
+        b->cap = cap;
+    }
+
+    if (needed > old)
+        memset(b->words + old, 0, (needed - old) * sizeof(uint64_t));
+    b->nbits = nbits;
+    if (nbits)
+        mask_tail(b);
+    return BITSET_OK;
+}
+
+void
+bitset_set(Bitset_t bitset, size_t i)
+{
+    Bitset* b = bitset;
+    assert(i < b->nbits);
+    b->words[i / WORD_BITS] |= UINT64_C(1) << (i % WORD_BITS);
+}
+
+void
+bitset_clear(Bitset_t bitset, size_t i)
+{
+    Bitset* b = bitset;
+    assert(i < b->nbits);
+    b->words[i / WORD_BITS] &= ~(UINT64_C(1) << (i % WORD_BITS));
+}
+
+int
+bitset_test(const Bitset_t bitset, size_t i)
+{
+    const Bitset* b = bitset;
+    assert(i < b->nbits);
+    return (b->words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+void
+bitset_set_all(Bitset_t bitset)
+{
+    Bitset* b = bitset;
+    if (!b->nbits)
+        return;
+    memset(b->words, 0xff, nwords(b->nbits) * sizeof(uint64_t));
+    mask_tail(b);
+}
+
+void
+bitset_clear_all(Bitset_t bitset)
+{
+    Bitset* b = bitset;
+    if (b->nbits)
+        memset(b->words, 0, nwords(b->nbits) * sizeof(uint64_t));
+}
+
+size_t
+bitset_count(const Bitset_t bitset)
+{
+    const Bitset* b = bitset;
+    size_t n = nwords(b->nbits);
+
+#if defined(CLIB_SIMD_X86)
+    if (darray_simd_level() >= DARRAY_SIMD_AVX2)
+        return count_popcnt(b->words, n);
+#endif
+    return count_scalar(b->words, n);
+}
+
+size_t
+bitset_find_first(const Bitset_t bitset)
+{
+    return bitset_find_next(bitset, 0);
+}
+
+size_t
+bitset_find_next(const Bitset_t bitset, size_t from)
+{
+    const Bitset* b = bitset;
+    size_t w = from / WORD_BITS, n = nwords(b->nbits);
+    uint64_t word;
+
+    if (from >= b->nbits)
+        return b->nbits;
+
+    // ignore the bits before from in the first word.
+    word = b->words[w] & (~UINT64_C(0) << (from % WORD_BITS));
+    for (;;) {
+        if (word)
+            return w * WORD_BITS + (size_t) __builtin_ctzll(word);
+        if (++w == n)
+            return b->nbits;
+        word = b->words[w];
+    }
+}
+
+static bitop_func
+select_op(bitop_func scalar,
+          bitop_func sse2,
+          bitop_func avx2,
+          bitop_func avx512
+          )
+{
+    switch (darray_simd_level()) {
+        case DARRAY_SIMD_AVX512:
+            return avx512;
+        case DARRAY_SIMD_AVX2:
+            return avx2;
+        case DARRAY_SIMD_SSE2:
+            return sse2;
+        default:
+            return scalar;
+    }
+}
+
+#if defined(CLIB_SIMD_X86)
+#define SELECT_OP(NAME) select_op(NAME##_SCALAR, NAME##_SSE2, NAME##_AVX2, \
+                                  NAME##_AVX512)
+#else
+#define SELECT_OP(NAME) select_op(NAME##_SCALAR, NAME##_SCALAR,             \
+                                  NAME##_SCALAR, NAME##_SCALAR)
+#endif
+
+/*
+ * Applies op to the words that both bitsets have.
+ *
+ * @return the number of words of dest that were not combined.
+ */
+static size_t
+apply(Bitset* dest, const Bitset* src, bitop_func op)
+{
+    size_t nd = nwords(dest->nbits), ns = nwords(src->nbits);
+    size_t n = nd < ns ? nd : ns;
+
+    if (n)
+        op(dest->words, src->words, n);
+    if (dest->nbits)
+        mask_tail(dest);
+    return nd - n;
+}
+
+void
+bitset_and(Bitset_t dest, const Bitset_t src)
+{
+    Bitset* d = dest;
+    size_t rest = apply(d, src, SELECT_OP(and));
+    if (rest)
+        memset(d->words + nwords(d->nbits) - rest, 0, rest * sizeof(uint64_t));
+}
+
+void
+bitset_or(Bitset_t dest, const Bitset_t src)
+{
+    apply(dest, src, SELECT_OP(or));
+}
+
+void
+bitset_xor(Bitset_t dest, const Bitset_t src)
+{
+    apply(dest, src, SELECT_OP(xor));
+}
+
+void
+bitset_andnot(Bitset_t dest, const Bitset_t src)
+{
+    apply(dest, src, SELECT_OP(andnot));
+}
@@ -0,0 +1,134 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A growable set of bits, stored in 64 bit words.
+ *
+ * The bulk operations and bitset_count() use the vector instructions
+ * selected by darray_simd_level().
+ */
+typedef void* Bitset_t;
+
+enum BitsetResult {
+    BITSET_OK = 0,
+    BITSET_OUT_OF_MEM
+};
+
+/**
+ * Create a bitset with nbits bits that are all cleared.
+ *
+ * @return the bitset or NULL when out of memory.
+ */
+Bitset_t bitset_create(size_t nbits);
+
+/**
+ * Destroys the bitset.
+ */
+void bitset_destroy(Bitset_t bitset);
+
+/**
+ * Returns the number of bits.
+ */
+size_t bitset_size(const Bitset_t bitset);
+
+/**
+ * Change the number of bits, new bits are cleared.
+ *
+ * @return BITSET_OK or BITSET_OUT_OF_MEM
+ */
+int bitset_resize(Bitset_t bitset, size_t nbits);
+
+/**
+ * Set bit i, i must be smaller than bitset_size().
+ */
+void bitset_set(Bitset_t bitset, size_t i);
+
+/**
+ * Clear bit i.
+ */
+void bitset_clear(Bitset_t bitset, size_t i);
+
+/**
+ * Returns !0 when bit i is set.
+ */
+int bitset_test(const Bitset_t bitset, size_t i);
+
+/**
+ * Set all bits.
+ */
+void bitset_set_all(Bitset_t bitset);
+
+/**
+ * Clear all bits.
+ */
+void bitset_clear_all(Bitset_t bitset);
+
+/**
+ * Returns the number of set bits.
+ */
+size_t bitset_count(const Bitset_t bitset);
+
+/**
+ * Returns the index of the first set bit or bitset_size() when no bit is
+ * set.
+ */
+size_t bitset_find_first(const Bitset_t bitset);
+
+/**
+ * Returns the index of the first set bit at or after from, or
+ * bitset_size() when there is none. Iterate over the set bits with:
+ *
+ *     for (i = bitset_find_first(b); i < n; i = bitset_find_next(b, i + 1))
+ */
+size_t bitset_find_next(const Bitset_t bitset, size_t from);
+
+/**
+ * dest &= src, bits that src doesn't have count as cleared.
+ */
+void bitset_and(Bitset_t dest, const Bitset_t src);
+
+/**
+ * dest |= src, bits of src beyond the size of dest are ignored.
+ */
+void bitset_or(Bitset_t dest, const Bitset_t src);
+
+/**
+ * dest ^= src, bits of src beyond the size of dest are ignored.
+ */
+void bitset_xor(Bitset_t dest, const Bitset_t src);
+
+/**
+ * dest &= ~src, clears the bits of dest that are set in src.
+ */
+void bitset_andnot(Bitset_t dest, const Bitset_t src);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef BITSET_H*/
@@ -0,0 +1,532 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "bloom.h"
+#include "priv/memtracepriv.h"
+#include "priv/cachelinepriv.h"
+#include "priv/hashpriv.h"
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+/**
+ * \brief the private implementation of both Bloom filters.
+ *
+ * The filter is an array of blocks of one cache line. A key selects a
+ * block with the high half of its hash and k positions in the block by
+ * double hashing. A plain filter has 512 bits per block, a counting
+ * filter 128 counters of 4 bits.
+ *
+ * \private
+ */
+struct Bloom {
+    size_t      nblocks;    ///< the number of blocks.
+    size_t      count;      ///< the number of inserted keys.
+    uint64_t*   blocks;     ///< BLOCK_WORDS words per block.
+    unsigned    k;          ///< the number of positions per key.
+    unsigned    counting;   ///< !0 for a counting filter.
+    unsigned    site;       ///< creation site for memory accounting.
+};
+
+typedef struct Bloom Bloom;
+
+#define BLOCK_WORDS     (CLIB_CACHE_LINE / sizeof(uint64_t))
+#define BLOCK_BITS      (CLIB_CACHE_LINE * 8)
+#define BLOCK_COUNTERS  (CLIB_CACHE_LINE * 2)
+#define COUNTER_MAX     15
+#define MAX_HASHES      16
+
+#define LN2             0.69314718055994530942
+
+#define HASH_SEED       UINT64_C(0x9e3779b97f4a7c15)
+
+/* The number of keys that are hashed and prefetched at once. */
+#define BATCH 16
+
+#define HEADER_SIZE     24
+#define FORMAT_VERSION  1
+
+static const unsigned char g_magic[4] = {'C', 'L', 'B', 'F'};
+
+static inline size_t
+blocks_bytes(size_t nblocks)
+{
+    return nblocks * CLIB_CACHE_LINE;
+}
+
+/*
+ * Computes the number of blocks and hashes. The bits per key of an
+ * unblocked filter are raised by a quarter to make up for the uneven
+ * load of the blocks.
+ */
+static Bloom*
+bloom_alloc(size_t expected, double fp_rate, unsigned counting)
+{
+    unsigned site = clib_mem_current_site();
+    Bloom* b;
+
+    if (expected == 0)
+        expected = 1;
+    if (!(fp_rate > 1e-9))
+        fp_rate = 1e-9;
+    if (fp_rate > 0.5)
+        fp_rate = 0.5;
+
+    double bits_per_key = -log(fp_rate) / (LN2 * LN2) * 1.25;
+    double k = round(bits_per_key * LN2 / 1.25);
+    double positions = ceil(bits_per_key * (double) expected);
+    size_t per_block = counting ? BLOCK_COUNTERS : BLOCK_BITS;
+
+    b = clib_malloc(CLIB_MEM_BLOOM, site, sizeof(Bloom));
+    if (!b)
+        return NULL;
+
+    b->nblocks  = (size_t) ceil(positions / (double) per_block);
+    b->count    = 0;
+    b->k        = k < 1 ? 1 : k > MAX_HASHES ? MAX_HASHES : (unsigned) k;
+    b->counting = counting;
+    b->site     = site;
+    b->blocks   = clib_aligned_alloc(CLIB_MEM_BLOOM,
+                                     site,
+                                     CLIB_CACHE_LINE,
+                                     blocks_bytes(b->nblocks)
+                                     );
+    if (!b->blocks) {
+        clib_free(CLIB_MEM_BLOOM, site, b, sizeof(Bloom));
+        return NULL;
+    }
+    memset(b->blocks, 0, blocks_bytes(b->nblocks));
+    return b;
+}
+
+static void
+bloom_free(Bloom* b)
+{
+    if (!b)
+        return;
+    clib_free(CLIB_MEM_BLOOM, b->site, b->blocks, blocks_bytes(b->nblocks));
+    clib_free(CLIB_MEM_BLOOM, b->site, b, sizeof(Bloom));
+}
+
+/* * hashing * */
+
+static inline uint64_t
+key_hash(const void* key, size_t len)
+{
+    return clib_hash_bytes(key, len, HASH_SEED);
+}
+
+static inline uint64_t*
+hash_block(const Bloom* b, uint64_t h)
+{
+    // maps the high half of h on [0, nblocks) without a division.
+    size_t i = (size_t) (((h >> 32) * (uint64_t) b->nblocks) >> 32);
+    return b->blocks + i * BLOCK_WORDS;
+}
+
+/*
+ * The positions in the block are a + i * b, b is odd so the first k
+ * positions are distinct.
+ */
+#define FOR_POSITIONS(BLOOM, H, MASK, POS)                                  \
+    for (uint32_t pa_ = (uint32_t) (H),                                     \
+                  pb_ = (uint32_t) clib_hash_mix(H) | 1,                    \
+                  pi_ = 0,                                                  \
+                  POS = pa_ & (MASK);                                       \
+         pi_ < (BLOOM)->k;                                                  \
+         pi_++, pa_ += pb_, POS = pa_ & (MASK))
+
+/* * bits * */
+
+static inline void
+bits_insert(Bloom* b, uint64_t h)
+{
+    uint64_t* block = hash_block(b, h);
+    FOR_POSITIONS(b, h, BLOCK_BITS - 1, pos)
+        block[pos / 64] |= UINT64_C(1) << (pos % 64);
+    b->count++;
+}
+
+static inline int
+bits_query(const Bloom* b, uint64_t h)
+{
+    const uint64_t* block = hash_block(b, h);
+    FOR_POSITIONS(b, h, BLOCK_BITS - 1, pos) {
+        if (!(block[pos / 64] & (UINT64_C(1) << (pos % 64))))
+            return 0;
+    }
+    return 1;
+}
+
+/* * counters * */
+
+static inline unsigned
+counter_get(const uint64_t* block, unsigned pos)
+{
+    return (block[pos / 16] >> (pos % 16 * 4)) & 0xF;
+}
+
+static inline void
+counter_add(uint64_t* block, unsigned pos, int delta)
+{
+    block[pos / 16] += (uint64_t) (int64_t) delta << (pos % 16 * 4);
+}
+
+static inline void
+counters_insert(Bloom* b, uint64_t h)
+{
+    uint64_t* block = hash_block(b, h);
+    FOR_POSITIONS(b, h, BLOCK_COUNTERS - 1, pos) {
+        if (counter_get(block, pos) < COUNTER_MAX)
+            counter_add(block, pos, 1);
+    }
+    b->count++;
+}
+
+static inline int
+counters_query(const Bloom* b, uint64_t h)
+{
+    const uint64_t* block = hash_block(b, h);
+    FOR_POSITIONS(b, h, BLOCK_COUNTERS - 1, pos) {
+        if (!counter_get(block, pos))
+            return 0;
+    }
+    return 1;
+}
+
+static inline int
+counters_remove(Bloom* b, uint64_t h)
+{
+    uint64_t* block = hash_block(b, h);
+
+    if (!counters_query(b, h))
+        return BLOOM_NOT_FOUND;
+    FOR_POSITIONS(b, h, BLOCK_COUNTERS - 1, pos) {
+        // a saturated counter may count more keys than it shows.
+        if (counter_get(block, pos) < COUNTER_MAX)
+            counter_add(block, pos, -1);
+    }
+    if (b->count)
+        b->count--;
+    return BLOOM_OK;
+}
+
+/* * batches * */
+
+/*
+ * Hashes a batch of keys and prefetches their blocks, so the cache misses
+ * of the batch overlap.
+ */
+static inline size_t
+hash_batch(const Bloom*         b,
+           const unsigned char* keys,
+           size_t               key_size,
+           size_t               n,
+           uint64_t*            hashes
+           )
+{
+    size_t m = n < BATCH ? n : BATCH;
+    for (size_t i = 0; i < m; i++) {
+        hashes[i] = key_hash(keys + i * key_size, key_size);
+#if defined(__GNUC__)
+        __builtin_prefetch(hash_block(b, hashes[i]));
+#endif
+    }
+    return m;
+}
+
+static void
+insert_batch(Bloom* b, const void* keys, size_t key_size, size_t n)
+{
+    const unsigned char* p = keys;
+    uint64_t hashes[BATCH];
+
+    while (n) {
+        size_t m = hash_batch(b, p, key_size, n, hashes);
+        for (size_t i = 0; i < m; i++) {
+            if (b->counting)
+                counters_insert(b, hashes[i]);
+            else
+                bits_insert(b, hashes[i]);
+        }
+        p += m * key_size;
+        n -= m;
+    }
+}
+
+static size_t
+query_batch(const Bloom*    b,
+            const void*     keys,
+            size_t          key_size,
+            size_t          n,
+            unsigned char*  found
+            )
+{
+    const unsigned char* p = keys;
+    uint64_t hashes[BATCH];
+    size_t nfound = 0;
+
+    while (n) {
+        size_t m = hash_batch(b, p, key_size, n, hashes);
+        for (size_t i = 0; i < m; i++) {
+            int f = b->counting ? counters_query(b, hashes[i])
+                                : bits_query(b, hashes[i]);
+            found[i] = (unsigned char) f;
+            nfound += f;
+        }
+        p += m * key_size;
+        found += m;
+        n -= m;
+    }
+    return nfound;
+}
+
+/* * serialization * */
+
+static size_t
+serialized_size(const Bloom* b)
+{
+    return HEADER_SIZE + blocks_bytes(b->nblocks);
+}
+
+static size_t
+serialize(const Bloom* b, void* buf, size_t size)
+{
+    unsigned char* p = buf;
+    size_t nwords = b->nblocks * BLOCK_WORDS;
+
+    if (size < serialized_size(b))
+        return 0;
+
+    memcpy(p, g_magic, sizeof(g_magic));
+    p[4] = FORMAT_VERSION;
+    p[5] = (unsigned char) b->counting;
+    p[6] = (unsigned char) b->k;
+    p[7] = 0;
+    clib_store_le64(p + 8, b->nblocks);
+    clib_store_le64(p + 16, b->count);
+    p += HEADER_SIZE;
+
+    for (size_t i = 0; i < nwords; i++, p += sizeof(uint64_t))
+        clib_store_le64(p, b->blocks[i]);
+
+    return serialized_size(b);
+}
+
+static Bloom*
+deserialize(const void* buf, size_t size, unsigned counting)
+{
+    unsigned site = clib_mem_current_site();
+    const unsigned char* p = buf;
+    uint64_t nblocks;
+    Bloom* b;
+
+    if (size < HEADER_SIZE                          ||
+        memcmp(p, g_magic, sizeof(g_magic)) != 0    ||
+        p[4] != FORMAT_VERSION                      ||
+        p[5] != counting                            ||
+        p[6] < 1 || p[6] > MAX_HASHES)
+        return NULL;
+
+    nblocks = clib_load_le64(p + 8);
+    if (nblocks == 0 || nblocks != (size - HEADER_SIZE) / CLIB_CACHE_LINE ||
+        (size - HEADER_SIZE) % CLIB_CACHE_LINE)
+        return NULL;
+
+    b = clib_malloc(CLIB_MEM_BLOOM, site, sizeof(Bloom));
+    if (!b)
+        return NULL;
+    b->nblocks  = (size_t) nblocks;
+    b->count    = (size_t) clib_load_le64(p + 16);
+    b->k        = p[6];
+    b->counting = counting;
+    b->site     = site;
+    b->blocks   = clib_aligned_alloc(CLIB_MEM_BLOOM,
+                                     site,
+                                     CLIB_CACHE_LINE,
+                                     blocks_bytes(b->nblocks)
+                                     );
+    if (!b->blocks) {
+        clib_free(CLIB_MEM_BLOOM, site, b, sizeof(Bloom));
+        return NULL;
+    }
+
+    p += HEADER_SIZE;
+    for (size_t i = 0; i < b->nblocks * BLOCK_WORDS; i++, p += 8)
+        b->blocks[i] = clib_load_le64(p);
+
+    return b;
+}
+
+/* * BloomFilter_t * */
+
+BloomFilter_t
+bloom_create(size_t expected, double fp_rate)
+{
+    return bloom_alloc(expected, fp_rate, 0);
+}
+
+void
+bloom_destroy(BloomFilter_t filter)
+{
+    bloom_free(filter);
+}
+
+size_t
+bloom_nbits(const BloomFilter_t filter)
+{
+    const Bloom* b = filter;
+    return b->nblocks * BLOCK_BITS;
+}
+
+unsigned
+bloom_nhashes(const BloomFilter_t filter)
+{
+    const Bloom* b = filter;
+    return b->k;
+}
+
+void
+bloom_insert(BloomFilter_t filter, const void* key, size_t len)
+{
+    bits_insert(filter, key_hash(key, len));
+}
+
+int
+bloom_query(const BloomFilter_t filter, const void* key, size_t len)
+{
+    return bits_query(filter, key_hash(key, len));
+}
+
+void
+bloom_insert_batch(BloomFilter_t filter,
+                   const void*   keys,
+                   size_t        key_size,
+                   size_t        n
+                   )
+{
+    insert_batch(filter, keys, key_size, n);
+}
+
+size_t
+bloom_query_batch(const BloomFilter_t filter,
+                  const void*         keys,
+                  size_t              key_size,
+                  size_t              n,
+                  unsigned char*      found
+                  )
+{
+    return query_batch(filter, keys, key_size, n, found);
+}
+
+size_t
+bloom_serialized_size(const BloomFilter_t filter)
+{
+    return serialized_size(filter);
+}
+
+size_t
+bloom_serialize(const BloomFilter_t filter, void* buf, size_t size)
+{
+    return serialize(filter, buf, size);
+}
+
+BloomFilter_t
+bloom_deserialize(const void* buf, size_t size)
+{
+    return deserialize(buf, size, 0);
+}
+
+/* * CountingBloom_t * */
+
+CountingBloom_t
+counting_bloom_create(size_t expected, double fp_rate)
+{
+    return bloom_alloc(expected, fp_rate, 1);
+}
+
+void
+counting_bloom_destroy(CountingBloom_t filter)
+{
+    bloom_free(filter);
+}
+
+void
+counting_bloom_insert(CountingBloom_t filter, const void* key, size_t len)
+{
+    counters_insert(filter, key_hash(key, len));
+}
+
+int
+counting_bloom_remove(CountingBloom_t filter, const void* key, size_t len)
+{
+    return counters_remove(filter, key_hash(key, len));
+}
+
+int
+counting_bloom_query(const CountingBloom_t filter,
+                     const void*           key,
+                     size_t                len
+                     )
+{
+    return counters_query(filter, key_hash(key, len));
+}
+
+void
+counting_bloom_insert_batch(CountingBloom_t filter,
+                            const void*     keys,
+                            size_t          key_size,
+                            size_t          n
+                            )
+{
+    insert_batch(filter, keys, key_size, n);
+}
+
+size_t
+counting_bloom_query_batch(const CountingBloom_t filter,
+                           const void*           keys,
+                           size_t                key_size,
+                           size_t                n,
+                           unsigned char*        found
+                           )
+{
+    return query_batch(filter, keys, key_size, n, found);
+}
+
+size_t
+counting_bloom_serialized_size(const CountingBloom_t filter)
+{
+    return serialized_size(filter);
+}
+
+size_t
+counting_bloom_serialize(const CountingBloom_t filter,
+                         void*                 buf,
+                         size_t                size
+                         )
+{
+    return serialize(filter, buf, size);
+}
+
+CountingBloom_t
+counting_bloom_deserialize(const void* buf, size_t size)
+{
+    return deserialize(buf, size, 1);
+}
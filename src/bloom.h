@@ -0,0 +1,214 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A blocked Bloom filter.
+ *
+ * All bits of a key are in one block of a cache line, so a query costs one
+ * cache miss. Keys are byte strings.
+ */
+typedef void* BloomFilter_t;
+
+/**
+ * A blocked Bloom filter with 4 bit counters that supports removal.
+ *
+ * It uses 4 times the memory of a BloomFilter_t with the same error rate.
+ * Counters saturate at 15, a saturated counter is never decremented.
+ */
+typedef void* CountingBloom_t;
+
+enum BloomResult {
+    BLOOM_OK = 0,
+    BLOOM_NOT_FOUND     ///< a key to remove is not in the filter.
+};
+
+/**
+ * Create a filter.
+ *
+ * @param expected [in] the number of keys that will be inserted.
+ * @param fp_rate  [in] the desired false positive rate, between 0 and 1.
+ *
+ * @return the filter or NULL when out of memory.
+ */
+BloomFilter_t bloom_create(size_t expected, double fp_rate);
+
+/**
+ * Destroys the filter.
+ */
+void bloom_destroy(BloomFilter_t filter);
+
+/**
+ * Returns the number of bits of the filter.
+ */
+size_t bloom_nbits(const BloomFilter_t filter);
+
+/**
+ * Returns the number of bits that are set for a key.
+ */
+unsigned bloom_nhashes(const BloomFilter_t filter);
+
+/**
+ * Add a key to the filter.
+ */
+void bloom_insert(BloomFilter_t filter, const void* key, size_t len);
+
+/**
+ * Returns 0 when the key is certainly not in the filter, !0 when it
+ * probably is.
+ */
+int bloom_query(const BloomFilter_t filter, const void* key, size_t len);
+
+/**
+ * Add n keys of key_size bytes that are stored next to each other.
+ *
+ * The blocks of a batch of keys are prefetched before they are updated,
+ * so the cache misses overlap.
+ */
+void bloom_insert_batch(BloomFilter_t filter,
+                        const void*   keys,
+                        size_t        key_size,
+                        size_t        n
+                        );
+
+/**
+ * Query n keys of key_size bytes, see bloom_insert_batch().
+ *
+ * @param found [out] n results, !0 when the key is probably present.
+ *
+ * @return the number of keys that are probably present.
+ */
+size_t bloom_query_batch(const BloomFilter_t filter,
+                         const void*         keys,
+                         size_t              key_size,
+                         size_t              n,
+                         unsigned char*      found
+                         );
+
+/**
+ * Returns the number of bytes bloom_serialize() writes.
+ */
+size_t bloom_serialized_size(const BloomFilter_t filter);
+
+/**
+ * Write the filter in a portable binary form.
+ *
+ * The form starts with a header of 24 bytes: "CLBF", a version byte, a
+ * type byte, the number of hashes, a reserved byte, the number of blocks
+ * and the number of inserted keys as little endian 64 bit integers. The
+ * blocks of 64 bytes follow.
+ *
+ * @param buf  [out] receives the filter.
+ * @param size [in]  the size of buf.
+ *
+ * @return the number of bytes written, 0 when buf is too small.
+ */
+size_t bloom_serialize(const BloomFilter_t filter, void* buf, size_t size);
+
+/**
+ * Create a filter from the output of bloom_serialize().
+ *
+ * @return the filter or NULL when buf doesn't hold a filter or when out
+ *         of memory.
+ */
+BloomFilter_t bloom_deserialize(const void* buf, size_t size);
+
+/**
+ * Create a counting filter, see bloom_create().
+ */
+CountingBloom_t counting_bloom_create(size_t expected, double fp_rate);
+
+/**
+ * Destroys the counting filter.
+ */
+void counting_bloom_destroy(CountingBloom_t filter);
+
+/**
+ * Add a key to the filter.
+ */
+void counting_bloom_insert(CountingBloom_t filter, const void* key, size_t len);
+
+/**
+ * Remove a key that was inserted before.
+ *
+ * @return BLOOM_OK or BLOOM_NOT_FOUND when the key is certainly not in
+ *         the filter, then the filter is unchanged.
+ */
+int counting_bloom_remove(CountingBloom_t filter, const void* key, size_t len);
+
+/**
+ * Returns 0 when the key is certainly not in the filter, !0 when it
+ * probably is.
+ */
+int counting_bloom_query(const CountingBloom_t filter,
+                         const void*           key,
+                         size_t                len
+                         );
+
+/**
+ * Add n keys of key_size bytes, see bloom_insert_batch().
+ */
+void counting_bloom_insert_batch(CountingBloom_t filter,
+                                 const void*     keys,
+                                 size_t          key_size,
+                                 size_t          n
+                                 );
+
+/**
+ * Query n keys of key_size bytes, see bloom_query_batch().
+ */
+size_t counting_bloom_query_batch(const CountingBloom_t filter,
+                                  const void*           keys,
+                                  size_t                key_size,
+                                  size_t                n,
+                                  unsigned char*        found
+                                  );
+
+/**
+ * Returns the number of bytes counting_bloom_serialize() writes.
+ */
+size_t counting_bloom_serialized_size(const CountingBloom_t filter);
+
+/**
+ * Write the filter in the form of bloom_serialize(), the blocks hold
+ * the counters.
+ */
+size_t counting_bloom_serialize(const CountingBloom_t filter,
+                                void*                 buf,
+                                size_t                size
+                                );
+
+/**
+ * Create a counting filter from the output of counting_bloom_serialize().
+ */
+CountingBloom_t counting_bloom_deserialize(const void* buf, size_t size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef BLOOM_H*/
@@ -0,0 +1,759 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "btree.h"
+#include "priv/memtracepriv.h"
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * The targeted size of a node in bytes, eight cache lines. Nodes hold at
+ * least BTREE_MIN_CAP keys, so with large keys they are larger.
+ */
+#define BTREE_NODE_SIZE 512
+#define BTREE_MIN_CAP   4
+
+/**
+ * \brief A node of a B+ tree.
+ *
+ * A leaf holds n keys followed by n values, an internal node n keys
+ * followed by n + 1 children. Key i of an internal node separates child
+ * i from child i + 1: it is greater than the keys of child i and not
+ * greater than those of child i + 1. Only leaves use prev and next.
+ *
+ * \private
+ */
+struct BTreeNode {
+    unsigned            n;      ///< the number of keys.
+    unsigned            leaf;   ///< !0 for a leaf.
+    struct BTreeNode*   prev;   ///< the previous leaf.
+    struct BTreeNode*   next;   ///< the next leaf.
+    max_align_t         data[];
+};
+
+typedef struct BTreeNode BTreeNode;
+
+/**
+ * \brief the private implementation of a BTree_t.
+ *
+ * All nodes have node_bytes bytes, so a leaf root can become internal.
+ *
+ * \private
+ */
+struct BTree {
+    BTreeNode*          root;
+    BTreeNode*          first;      ///< the leftmost leaf.
+    BTreeNode*          last;       ///< the rightmost leaf.
+    size_t              size;
+    size_t              ks;         ///< key size.
+    size_t              vs;         ///< value size.
+    size_t              leaf_cap;   ///< the number of keys of a leaf.
+    size_t              int_cap;    ///< the number of keys of an internal node.
+    size_t              voff;       ///< offset of the values in a leaf.
+    size_t              coff;       ///< offset of the children.
+    size_t              node_bytes;
+    clib_compare_func   cmp;
+    unsigned            site;       ///< creation site for memory accounting.
+};
+
+typedef struct BTree BTree;
+
+#define ROUND_UP(n, a) (((n) + (a) - 1) / (a) * (a))
+
+/* * node access * */
+
+static inline char*
+node_key(const BTree* t, const BTreeNode* node, size_t i)
+{
+    return (char*) node->data + i * t->ks;
+}
+
+static inline char*
+node_value(const BTree* t, const BTreeNode* node, size_t i)
+{
+    return (char*) node->data + t->voff + i * t->vs;
+}
+
+static inline BTreeNode**
+node_children(const BTree* t, const BTreeNode* node)
+{
+    return (BTreeNode**) ((char*) node->data + t->coff);
+}
+
+static inline size_t
+node_cap(const BTree* t, const BTreeNode* node)
+{
+    return node->leaf ? t->leaf_cap : t->int_cap;
+}
+
+/*
+ * The fewest keys of a node other than the root. Two siblings with one
+ * key less than the minimum fit in one node.
+ */
+static inline size_t
+node_min(const BTree* t, const BTreeNode* node)
+{
+    return node->leaf ? t->leaf_cap / 2 : (t->int_cap - 1) / 2;
+}
+
+static inline int
+compare(const BTree* t, const void* a, const void* b)
+{
+    return t->cmp((void*) a, (void*) b);
+}
+
+/*
+ * Returns the index of the first key that is not less than key.
+ */
+static size_t
+node_lower(const BTree* t, const BTreeNode* node, const void* key)
+{
+    size_t lo = 0, hi = node->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare(t, node_key(t, node, mid), key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Returns the index of the first key that is greater than key, for an
+ * internal node that is the child that may hold key.
+ */
+static size_t
+node_upper(const BTree* t, const BTreeNode* node, const void* key)
+{
+    size_t lo = 0, hi = node->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare(t, node_key(t, node, mid), key) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* moves count keys (and values or children) within a node. */
+
+static inline void
+move_keys(const BTree* t, BTreeNode* node, size_t dest, size_t src, size_t n)
+{
+    memmove(node_key(t, node, dest), node_key(t, node, src), n * t->ks);
+}
+
+static inline void
+move_values(const BTree* t, BTreeNode* node, size_t dest, size_t src, size_t n)
+{
+    memmove(node_value(t, node, dest), node_value(t, node, src), n * t->vs);
+}
+
+static inline void
+move_children(const BTree* t, BTreeNode* node, size_t dest, size_t src, size_t n)
+{
+    BTreeNode** c = node_children(t, node);
+    memmove(c + dest, c + src, n * sizeof(BTreeNode*));
+}
+
+static BTreeNode*
+node_alloc(const BTree* t, unsigned leaf)
+{
+    BTreeNode* node = clib_malloc(CLIB_MEM_BTREE, t->site, t->node_bytes);
+    if (!node)
+        return NULL;
+    node->n = 0;
+    node->leaf = leaf;
+    node->prev = node->next = NULL;
+    return node;
+}
+
+static void
+node_free(const BTree* t, BTreeNode* node)
+{
+    clib_free(CLIB_MEM_BTREE, t->site, node, t->node_bytes);
+}
+
+static void
+free_children(const BTree* t, BTreeNode* node)
+{
+    if (node->leaf)
+        return;
+    for (size_t i = 0; i <= node->n; i++) {
+        BTreeNode* child = node_children(t, node)[i];
+        free_children(t, child);
+        node_free(t, child);
+    }
+}
+
+static BTreeNode*
+find_leaf(const BTree* t, const void* key)
+{
+    BTreeNode* node = t->root;
+    while (!node->leaf)
+        node = node_children(t, node)[node_upper(t, node, key)];
+    return node;
+}
+
+/* * insertion * */
+
+/*
+ * Splits the full child ci of parent, parent is not full.
+ */
+static int
+split_child(BTree* t, BTreeNode* parent, size_t ci)
+{
+    BTreeNode* child = node_children(t, parent)[ci];
+    BTreeNode* right = node_alloc(t, child->leaf);
+    const char* sep;
+    size_t mid = child->n / 2;
+
+    if (!right)
+        return BTREE_OUT_OF_MEM;
+
+    if (child->leaf) {
+        right->n = child->n - mid;
+        memcpy(node_key(t, right, 0), node_key(t, child, mid), right->n * t->ks);
+        memcpy(node_value(t, right, 0),
+               node_value(t, child, mid),
+               right->n * t->vs
+               );
+        child->n = mid;
+
+        right->prev = child;
+        right->next = child->next;
+        if (child->next)
+            child->next->prev = right;
+        else
+            t->last = right;
+        child->next = right;
+        sep = node_key(t, right, 0);
+    }
+    else {
+        // key mid moves up to the parent.
+        right->n = child->n - mid - 1;
+        memcpy(node_key(t, right, 0),
+               node_key(t, child, mid + 1),
+               right->n * t->ks
+               );
+        memcpy(node_children(t, right),
+               node_children(t, child) + mid + 1,
+               (right->n + 1) * sizeof(BTreeNode*)
+               );
+        child->n = mid;
+        sep = node_key(t, child, mid);
+    }
+
+    move_keys(t, parent, ci + 1, ci, parent->n - ci);
+    move_children(t, parent, ci + 2, ci + 1, parent->n - ci);
+    memcpy(node_key(t, parent, ci), sep, t->ks);
+    node_children(t, parent)[ci + 1] = right;
+    parent->n++;
+    return BTREE_OK;
+}
+
+/* * removal * */
+
+static void
+borrow_left(BTree* t, BTreeNode* parent, size_t ci)
+{
+    BTreeNode* child = node_children(t, parent)[ci];
+    BTreeNode* left  = node_children(t, parent)[ci - 1];
+
+    move_keys(t, child, 1, 0, child->n);
+    if (child->leaf) {
+        move_values(t, child, 1, 0, child->n);
+        memcpy(node_key(t, child, 0), node_key(t, left, left->n - 1), t->ks);
+        memcpy(node_value(t, child, 0), node_value(t, left, left->n - 1), t->vs);
+        memcpy(node_key(t, parent, ci - 1), node_key(t, child, 0), t->ks);
+    }
+    else {
+        move_children(t, child, 1, 0, child->n + 1);
+        memcpy(node_key(t, child, 0), node_key(t, parent, ci - 1), t->ks);
+        node_children(t, child)[0] = node_children(t, left)[left->n];
+        memcpy(node_key(t, parent, ci - 1), node_key(t, left, left->n - 1), t->ks);
+    }
+    left->n--;
+    child->n++;
+}
+
+static void
+borrow_right(BTree* t, BTreeNode* parent, size_t ci)
+{
+    BTreeNode* child = node_children(t, parent)[ci];
+    BTreeNode* right = node_children(t, parent)[ci + 1];
+
+    if (child->leaf) {
+        memcpy(node_key(t, child, child->n), node_key(t, right, 0), t->ks);
+        memcpy(node_value(t, child, child->n), node_value(t, right, 0), t->vs);
+        move_keys(t, right, 0, 1, right->n - 1);
+        move_values(t, right, 0, 1, right->n - 1);
+        memcpy(node_key(t, parent, ci), node_key(t, right, 0), t->ks);
+    }
+    else {
+        memcpy(node_key(t, child, child->n), node_key(t, parent, ci), t->ks);
+        node_children(t, child)[child->n + 1] = node_children(t, right)[0];
+        memcpy(node_key(t, parent, ci), node_key(t, right, 0), t->ks);
+        move_keys(t, right, 0, 1, right->n - 1);
+        move_children(t, right, 0, 1, right->n);
+    }
+    right->n--;
+    child->n++;
+}
+
+/*
+ * Merges child i + 1 of parent into child i.
+ */
+static void
+merge_children(BTree* t, BTreeNode* parent, size_t i)
+{
+    BTreeNode* left  = node_children(t, parent)[i];
+    BTreeNode* right = node_children(t, parent)[i + 1];
+
+    if (left->leaf) {
+        memcpy(node_key(t, left, left->n), node_key(t, right, 0), right->n * t->ks);
+        memcpy(node_value(t, left, left->n),
+               node_value(t, right, 0),
+               right->n * t->vs
+               );
+        left->n += right->n;
+        left->next = right->next;
+        if (right->next)
+            right->next->prev = left;
+        else
+            t->last = left;
+    }
+    else {
+        memcpy(node_key(t, left, left->n), node_key(t, parent, i), t->ks);
+        memcpy(node_key(t, left, left->n + 1),
+               node_key(t, right, 0),
+               right->n * t->ks
+               );
+        memcpy(node_children(t, left) + left->n + 1,
+               node_children(t, right),
+               (right->n + 1) * sizeof(BTreeNode*)
+               );
+        left->n += right->n + 1;
+    }
+    node_free(t, right);
+
+    move_keys(t, parent, i, i + 1, parent->n - i - 1);
+    move_children(t, parent, i + 1, i + 2, parent->n - i - 1);
+    parent->n--;
+}
+
+/*
+ * Restores the minimum number of keys of child ci of parent.
+ */
+static void
+fix_child(BTree* t, BTreeNode* parent, size_t ci)
+{
+    BTreeNode** c = node_children(t, parent);
+
+    if (ci > 0 && c[ci - 1]->n > node_min(t, c[ci - 1]))
+        borrow_left(t, parent, ci);
+    else if (ci < parent->n && c[ci + 1]->n > node_min(t, c[ci + 1]))
+        borrow_right(t, parent, ci);
+    else if (ci > 0)
+        merge_children(t, parent, ci - 1);
+    else
+        merge_children(t, parent, ci);
+}
+
+static int
+remove_from(BTree* t, BTreeNode* node, const void* key)
+{
+    if (node->leaf) {
+        size_t pos = node_lower(t, node, key);
+        if (pos == node->n || compare(t, node_key(t, node, pos), key) != 0)
+            return BTREE_NOT_FOUND;
+        move_keys(t, node, pos, pos + 1, node->n - pos - 1);
+        move_values(t, node, pos, pos + 1, node->n - pos - 1);
+        node->n--;
+        return BTREE_OK;
+    }
+
+    size_t ci = node_upper(t, node, key);
+    BTreeNode* child = node_children(t, node)[ci];
+    int ret = remove_from(t, child, key);
+    if (ret == BTREE_OK && child->n < node_min(t, child))
+        fix_child(t, node, ci);
+    return ret;
+}
+
+/* * public functions * */
+
+BTree_t
+btree_create(size_t key_size, size_t value_size, clib_compare_func cmp)
+{
+    unsigned site = clib_mem_current_site();
+    const size_t hdr = offsetof(BTreeNode, data);
+    const size_t align = _Alignof(max_align_t);
+    const size_t space = BTREE_NODE_SIZE - hdr - align;
+    BTree* t;
+
+    assert(key_size > 0);
+
+    t = clib_calloc(CLIB_MEM_BTREE, site, 1, sizeof(BTree));
+    if (!t)
+        return NULL;
+
+    t->ks = key_size;
+    t->vs = value_size;
+    t->cmp = cmp;
+    t->site = site;
+
+    t->leaf_cap = space / (key_size + value_size);
+    if (t->leaf_cap < BTREE_MIN_CAP)
+        t->leaf_cap = BTREE_MIN_CAP;
+    t->int_cap = (space - sizeof(BTreeNode*)) / (key_size + sizeof(BTreeNode*));
+    if (t->int_cap < BTREE_MIN_CAP)
+        t->int_cap = BTREE_MIN_CAP;
+
+    t->voff = ROUND_UP(t->leaf_cap * key_size, align);
+    t->coff = ROUND_UP(t->int_cap * key_size, align);
+    t->node_bytes = hdr + t->voff + t->leaf_cap * value_size;
+    if (t->node_bytes < hdr + t->coff + (t->int_cap + 1) * sizeof(BTreeNode*))
+        t->node_bytes = hdr + t->coff + (t->int_cap + 1) * sizeof(BTreeNode*);
+
+    t->root = node_alloc(t, 1);
+    if (!t->root) {
+        clib_free(CLIB_MEM_BTREE, site, t, sizeof(BTree));
+        return NULL;
+    }
+    t->first = t->last = t->root;
+    return t;
+}
+
+void
+btree_destroy(BTree_t tree)
+{
+    BTree* t = tree;
+    if (!t)
+        return;
+    free_children(t, t->root);
+    node_free(t, t->root);
+    clib_free(CLIB_MEM_BTREE, t->site, t, sizeof(BTree));
+}
+
+size_t
+btree_size(const BTree_t tree)
+{
+    const BTree* t = tree;
+    return t->size;
+}
+
+int
+btree_insert(BTree_t tree, const void* key, const void* value)
+{
+    BTree* t = tree;
+    BTreeNode* node = t->root;
+    size_t pos;
+
+    // splits full nodes on the way down, so a split never propagates up.
+    if (node->n == node_cap(t, node)) {
+        BTreeNode* root = node_alloc(t, 0);
+        if (!root)
+            return BTREE_OUT_OF_MEM;
+        node_children(t, root)[0] = node;
+        if (split_child(t, root, 0)) {
+            node_free(t, root);
+            return BTREE_OUT_OF_MEM;
+        }
+        t->root = node = root;
+    }
+
+    while (!node->leaf) {
+        size_t ci = node_upper(t, node, key);
+        BTreeNode* child = node_children(t, node)[ci];
+        if (child->n == node_cap(t, child)) {
+            if (split_child(t, node, ci))
+                return BTREE_OUT_OF_MEM;
+            if (compare(t, key, node_key(t, node, ci)) >= 0)
+                ci++;
+            child = node_children(t, node)[ci];
+        }
+        node = child;
+    }
+
+    pos = node_lower(t, node, key);
+    if (pos < node->n && compare(t, node_key(t, node, pos), key) == 0) {
+        if (t->vs)
+            memcpy(node_value(t, node, pos), value, t->vs);
+        return BTREE_OK;
+    }
+    move_keys(t, node, pos + 1, pos, node->n - pos);
+    move_values(t, node, pos + 1, pos, node->n - pos);
+    memcpy(node_key(t, node, pos), key, t->ks);
+    if (t->vs)
+        memcpy(node_value(t, node, pos), value, t->vs);
+    node->n++;
+    t->size++;
+    return BTREE_OK;
+}
+
+void*
+btree_find(const BTree_t tree, const void* key)
+{
+    const BTree* t = tree;
+    BTreeNode* leaf = find_leaf(t, key);
+    size_t pos = node_lower(t, leaf, key);
+
+    if (pos < leaf->n && compare(t, node_key(t, leaf, pos), key) == 0)
+        return node_value(t, leaf, pos);
+    return NULL;
+}
+
+int
+btree_contains(const BTree_t tree, const void* key)
+{
+    return btree_find(tree, key) != NULL;
+}
+
+int
+btree_remove(BTree_t tree, const void* key)
+{
+    BTree* t = tree;
+    int ret = remove_from(t, t->root, key);
+
+    if (ret != BTREE_OK)
+        return ret;
+    t->size--;
+    if (!t->root->leaf && t->root->n == 0) {
+        BTreeNode* old = t->root;
+        t->root = node_children(t, old)[0];
+        node_free(t, old);
+    }
+    return BTREE_OK;
+}
+
+void
+btree_clear(BTree_t tree)
+{
+    BTree* t = tree;
+
+    free_children(t, t->root);
+    t->root->n = 0;
+    t->root->leaf = 1;
+    t->root->prev = t->root->next = NULL;
+    t->first = t->last = t->root;
+    t->size = 0;
+}
+
+static const char*
+subtree_min(const BTree* t, const BTreeNode* node)
+{
+    while (!node->leaf)
+        node = node_children(t, node)[0];
+    return node_key(t, node, 0);
+}
+
+/*
+ * Spreads n items over the fewest groups of at most cap, the first
+ * n % groups groups get one more.
+ */
+static inline size_t
+ngroups(size_t n, size_t cap)
+{
+    return (n + cap - 1) / cap;
+}
+
+int
+btree_bulk_load(BTree_t tree, const DArray_t keys, const DArray_t values)
+{
+    BTree* t = tree;
+    DArraySlice ks = darray_slice_all(keys);
+    DArraySlice vs = {0};
+    size_t n = ks.n;
+    size_t nleaves, total, level, next;
+    BTreeNode** nodes;
+
+    if (t->size || ks.esize != t->ks)
+        return BTREE_INVALID;
+    if (t->vs) {
+        if (!values)
+            return BTREE_INVALID;
+        vs = darray_slice_all(values);
+        if (vs.esize != t->vs || vs.n != n)
+            return BTREE_INVALID;
+    }
+    for (size_t i = 1; i < n; i++)
+        if (compare(t, ks.data + (i - 1) * t->ks, ks.data + i * t->ks) >= 0)
+            return BTREE_INVALID;
+    if (n == 0)
+        return BTREE_OK;
+
+    // allocate all nodes first, so a failure leaves the tree empty.
+    nleaves = ngroups(n, t->leaf_cap);
+    total = nleaves;
+    for (size_t m = nleaves; m > 1; ) {
+        m = ngroups(m, t->int_cap + 1);
+        total += m;
+    }
+    nodes = clib_malloc(CLIB_MEM_BTREE, t->site, total * sizeof(BTreeNode*));
+    if (!nodes)
+        return BTREE_OUT_OF_MEM;
+    for (size_t i = 0; i < total; i++) {
+        nodes[i] = node_alloc(t, i < nleaves);
+        if (!nodes[i]) {
+            while (i--)
+                node_free(t, nodes[i]);
+            clib_free(CLIB_MEM_BTREE, t->site, nodes, total * sizeof(BTreeNode*));
+            return BTREE_OUT_OF_MEM;
+        }
+    }
+
+    for (size_t i = 0, k = 0; i < nleaves; i++) {
+        BTreeNode* leaf = nodes[i];
+        leaf->n = n / nleaves + (i < n % nleaves);
+        memcpy(node_key(t, leaf, 0), ks.data + k * t->ks, leaf->n * t->ks);
+        if (t->vs)
+            memcpy(node_value(t, leaf, 0), vs.data + k * t->vs, leaf->n * t->vs);
+        leaf->prev = i ? nodes[i - 1] : NULL;
+        leaf->next = i + 1 < nleaves ? nodes[i + 1] : NULL;
+        k += leaf->n;
+    }
+
+    // every level takes its children from the level below.
+    for (level = 0, next = nleaves; next - level > 1; ) {
+        size_t m = next - level;
+        size_t g = ngroups(m, t->int_cap + 1);
+        for (size_t j = 0, c = level; j < g; j++) {
+            BTreeNode* node = nodes[next + j];
+            size_t nc = m / g + (j < m % g);
+            memcpy(node_children(t, node), nodes + c, nc * sizeof(BTreeNode*));
+            for (size_t i = 1; i < nc; i++)
+                memcpy(node_key(t, node, i - 1), subtree_min(t, nodes[c + i]), t->ks);
+            node->n = nc - 1;
+            c += nc;
+        }
+        level = next;
+        next += g;
+    }
+
+    node_free(t, t->root);
+    t->root  = nodes[total - 1];
+    t->first = nodes[0];
+    t->last  = nodes[nleaves - 1];
+    t->size  = n;
+    clib_free(CLIB_MEM_BTREE, t->site, nodes, total * sizeof(BTreeNode*));
+    return BTREE_OK;
+}
+
+/* * iteration * */
+
+static void
+iter_set(const BTree* t, BTreeNode* node, size_t pos, BTreeIter* iter)
+{
+    // the position after the last key of a leaf is the next leaf.
+    if (node && pos >= node->n) {
+        node = node->next;
+        pos = 0;
+    }
+    iter->tree = t;
+    iter->node = node && node->n ? node : NULL;
+    iter->pos = pos;
+}
+
+void
+btree_first(const BTree_t tree, BTreeIter* iter)
+{
+    const BTree* t = tree;
+    iter_set(t, t->first, 0, iter);
+}
+
+void
+btree_last(const BTree_t tree, BTreeIter* iter)
+{
+    const BTree* t = tree;
+    iter_set(t, t->last, t->last->n ? t->last->n - 1 : 0, iter);
+}
+
+void
+btree_lower_bound(const BTree_t tree, const void* key, BTreeIter* iter)
+{
+    const BTree* t = tree;
+    BTreeNode* leaf = find_leaf(t, key);
+    iter_set(t, leaf, node_lower(t, leaf, key), iter);
+}
+
+void
+btree_successor(const BTree_t tree, const void* key, BTreeIter* iter)
+{
+    const BTree* t = tree;
+    BTreeNode* leaf = find_leaf(t, key);
+    iter_set(t, leaf, node_upper(t, leaf, key), iter);
+}
+
+void
+btree_predecessor(const BTree_t tree, const void* key, BTreeIter* iter)
+{
+    btree_lower_bound(tree, key, iter);
+    if (btree_iter_valid(iter))
+        btree_iter_prev(iter);
+    else
+        btree_last(tree, iter);
+}
+
+int
+btree_iter_valid(const BTreeIter* iter)
+{
+    return iter->node != NULL;
+}
+
+void*
+btree_iter_key(const BTreeIter* iter)
+{
+    assert(iter->node);
+    return node_key(iter->tree, iter->node, iter->pos);
+}
+
+void*
+btree_iter_value(const BTreeIter* iter)
+{
+    assert(iter->node);
+    return node_value(iter->tree, iter->node, iter->pos);
+}
+
+void
+btree_iter_next(BTreeIter* iter)
+{
+    BTreeNode* node = iter->node;
+    if (!node)
+        return;
+    iter_set(iter->tree, node, iter->pos + 1, iter);
+}
+
+void
+btree_iter_prev(BTreeIter* iter)
+{
+    BTreeNode* node = iter->node;
+    if (!node)
+        return;
+    if (iter->pos > 0) {
+        iter->pos--;
+        return;
+    }
+    node = node->prev;
+    iter->node = node;
+    iter->pos = node ? node->n - 1 : 0;
+}
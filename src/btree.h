@@ -0,0 +1,183 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <stdlib.h>
+#include "function-types.h"
+#include "darray.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An ordered map, a B+ tree.
+ *
+ * Keys and values have a fixed size and are copied into the tree. The
+ * nodes span a few cache lines and keep their keys next to each other,
+ * so a search visits few cache lines per level. All key value pairs are
+ * in the leaves, which are linked for range scans.
+ */
+typedef void* BTree_t;
+
+/**
+ * A position in a BTree_t, it is invalid after the end of the tree.
+ *
+ * An iterator is invalidated by an insertion or removal.
+ */
+typedef struct BTreeIter {
+    const void* tree;
+    void*       node;   ///< the leaf, NULL when the iterator is invalid.
+    size_t      pos;    ///< the index in the leaf.
+} BTreeIter;
+
+enum BTreeResult {
+    BTREE_OK = 0,
+    BTREE_OUT_OF_MEM,
+    BTREE_NOT_FOUND,
+    BTREE_INVALID   ///< the input of btree_bulk_load isn't valid.
+};
+
+/**
+ * Create an empty tree.
+ *
+ * @param key_size   [in] the size of a key in bytes, not 0.
+ * @param value_size [in] the size of a value in bytes, 0 for a set.
+ * @param cmp        [in] orders the keys.
+ *
+ * @return the tree or NULL when out of memory.
+ */
+BTree_t btree_create(size_t key_size, size_t value_size, clib_compare_func cmp);
+
+/**
+ * Destroys the tree.
+ */
+void btree_destroy(BTree_t tree);
+
+/**
+ * Returns the number of keys in the tree.
+ */
+size_t btree_size(const BTree_t tree);
+
+/**
+ * Add a key with a value, the value of a key that is present is replaced.
+ *
+ * @return BTREE_OK or BTREE_OUT_OF_MEM, then the tree is unchanged.
+ */
+int btree_insert(BTree_t tree, const void* key, const void* value);
+
+/**
+ * Returns a pointer to the value of key or NULL when key isn't present.
+ *
+ * The pointer is invalidated by an insertion or removal.
+ */
+void* btree_find(const BTree_t tree, const void* key);
+
+/**
+ * Returns !0 when key is in the tree.
+ */
+int btree_contains(const BTree_t tree, const void* key);
+
+/**
+ * Remove key and its value.
+ *
+ * @return BTREE_OK or BTREE_NOT_FOUND.
+ */
+int btree_remove(BTree_t tree, const void* key);
+
+/**
+ * Remove all keys.
+ */
+void btree_clear(BTree_t tree);
+
+/**
+ * Fill an empty tree from sorted arrays in O(n).
+ *
+ * The leaves are filled almost completely, so a loaded tree is smaller
+ * than one built by insertion.
+ *
+ * @param keys   [in] keys of key_size bytes in strictly ascending order.
+ * @param values [in] the values, elements of value_size bytes, may be NULL
+ *                    when value_size is 0.
+ *
+ * @return BTREE_OK, BTREE_OUT_OF_MEM or BTREE_INVALID when the tree isn't
+ *         empty or the arrays don't match the tree or each other.
+ */
+int btree_bulk_load(BTree_t tree, const DArray_t keys, const DArray_t values);
+
+/**
+ * Set iter on the smallest key.
+ */
+void btree_first(const BTree_t tree, BTreeIter* iter);
+
+/**
+ * Set iter on the largest key.
+ */
+void btree_last(const BTree_t tree, BTreeIter* iter);
+
+/**
+ * Set iter on the smallest key that is not less than key.
+ *
+ * A range scan over [lo, hi) starts at btree_lower_bound(lo) and stops
+ * at the first key that is not less than hi.
+ */
+void btree_lower_bound(const BTree_t tree, const void* key, BTreeIter* iter);
+
+/**
+ * Set iter on the smallest key that is greater than key.
+ */
+void btree_successor(const BTree_t tree, const void* key, BTreeIter* iter);
+
+/**
+ * Set iter on the largest key that is less than key.
+ */
+void btree_predecessor(const BTree_t tree, const void* key, BTreeIter* iter);
+
+/**
+ * Returns !0 when iter is on a key.
+ */
+int btree_iter_valid(const BTreeIter* iter);
+
+/**
+ * Returns the key at iter, iter must be valid.
+ */
+void* btree_iter_key(const BTreeIter* iter);
+
+/**
+ * Returns the value at iter, iter must be valid.
+ */
+void* btree_iter_value(const BTreeIter* iter);
+
+/**
+ * Move iter to the next key, it becomes invalid after the last.
+ */
+void btree_iter_next(BTreeIter* iter);
+
+/**
+ * Move iter to the previous key, it becomes invalid before the first.
+ */
+void btree_iter_prev(BTreeIter* iter);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef BTREE_H*/
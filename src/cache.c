@@ -0,0 +1,444 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "cache.h"
+#include "priv/memtracepriv.h"
+#include "priv/hashpriv.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * \brief An entry of the cache, the key is stored behind it.
+ *
+ * \private
+ */
+struct CacheEntry {
+    struct CacheEntry*  prev;
+    struct CacheEntry*  next;
+    uint64_t            hash;
+    void*               value;
+    size_t              cost;
+    size_t              len;    ///< the length of key.
+    unsigned char       ref;    ///< used since the clock hand passed.
+    unsigned char       key[];
+};
+
+typedef struct CacheEntry CacheEntry;
+
+/**
+ * \brief the private implementation of a cache.
+ *
+ * The entries form a circular list in the order of eviction: hand is the
+ * next candidate and hand->prev was inserted or used most recently. The
+ * LRU policy moves an entry before the hand on a hit. The CLOCK policy
+ * sets its ref flag instead, the hand skips and clears flagged entries
+ * when it looks for a victim.
+ *
+ * The index is an open addressing hash table with linear probing that is
+ * at most half full.
+ *
+ * \private
+ */
+struct Cache {
+    CacheEntry**        index;      ///< index_cap slots.
+    size_t              index_cap;  ///< a power of two.
+    CacheEntry*         hand;       ///< the next candidate for eviction.
+    size_t              size;
+    size_t              bytes;
+    size_t              max_entries;
+    size_t              max_bytes;
+    clib_free_func      evict;
+    CacheStats          stats;
+    enum CachePolicy    policy;
+    unsigned            site;       ///< creation site for memory accounting.
+};
+
+typedef struct Cache Cache;
+
+#define CACHE_MIN_INDEX 16
+#define HASH_SEED UINT64_C(0x2545f4914f6cdd1d)
+
+/* * index * */
+
+static inline uint64_t
+key_hash(const void* key, size_t len)
+{
+    return clib_hash_bytes(key, len, HASH_SEED);
+}
+
+static inline int
+entry_matches(const CacheEntry* e, uint64_t h, const void* key, size_t len)
+{
+    return e->hash == h && e->len == len && memcmp(e->key, key, len) == 0;
+}
+
+/*
+ * Returns the slot of key or the empty slot where it belongs.
+ */
+static size_t
+index_find(const Cache* c, uint64_t h, const void* key, size_t len)
+{
+    size_t mask = c->index_cap - 1;
+    size_t i = h & mask;
+
+    while (c->index[i] && !entry_matches(c->index[i], h, key, len))
+        i = (i + 1) & mask;
+    return i;
+}
+
+static size_t
+index_slot_of(const Cache* c, const CacheEntry* e)
+{
+    size_t mask = c->index_cap - 1;
+    size_t i = e->hash & mask;
+
+    while (c->index[i] != e)
+        i = (i + 1) & mask;
+    return i;
+}
+
+/*
+ * Empties slot i, the entries behind it that would no longer be found
+ * are shifted back.
+ */
+static void
+index_erase(Cache* c, size_t i)
+{
+    size_t mask = c->index_cap - 1;
+    size_t j = i;
+
+    for (;;) {
+        j = (j + 1) & mask;
+        if (!c->index[j])
+            break;
+        size_t home = c->index[j]->hash & mask;
+        // move the entry when its home is not cyclically in (i, j].
+        int stays = i <= j ? (home > i && home <= j)
+                           : (home > i || home <= j);
+        if (!stays) {
+            c->index[i] = c->index[j];
+            i = j;
+        }
+    }
+    c->index[i] = NULL;
+}
+
+static int
+index_reserve(Cache* c, size_t n)
+{
+    size_t cap = c->index_cap;
+    CacheEntry** index;
+
+    if (n * 2 <= cap)
+        return CACHE_OK;
+    while (n * 2 > cap)
+        cap *= 2;
+
+    index = clib_calloc(CLIB_MEM_CACHE, c->site, cap, sizeof(CacheEntry*));
+    if (!index)
+        return CACHE_OUT_OF_MEM;
+
+    for (size_t i = 0; i < c->index_cap; i++) {
+        CacheEntry* e = c->index[i];
+        if (!e)
+            continue;
+        size_t j = e->hash & (cap - 1);
+        while (index[j])
+            j = (j + 1) & (cap - 1);
+        index[j] = e;
+    }
+    clib_free(CLIB_MEM_CACHE,
+              c->site,
+              c->index,
+              c->index_cap * sizeof(CacheEntry*)
+              );
+    c->index = index;
+    c->index_cap = cap;
+    return CACHE_OK;
+}
+
+/* * eviction order * */
+
+/*
+ * Inserts e before the hand, it will be the last candidate.
+ */
+static void
+order_insert(Cache* c, CacheEntry* e)
+{
+    if (!c->hand) {
+        e->prev = e->next = e;
+        c->hand = e;
+        return;
+    }
+    e->next = c->hand;
+    e->prev = c->hand->prev;
+    e->prev->next = e;
+    c->hand->prev = e;
+}
+
+static void
+order_unlink(Cache* c, CacheEntry* e)
+{
+    if (e->next == e) {
+        c->hand = NULL;
+        return;
+    }
+    if (c->hand == e)
+        c->hand = e->next;
+    e->prev->next = e->next;
+    e->next->prev = e->prev;
+}
+
+static void
+touch(Cache* c, CacheEntry* e)
+{
+    if (c->policy == CACHE_CLOCK) {
+        e->ref = 1;
+        return;
+    }
+    if (c->hand == e) {
+        // in a circle, e is now the most recent entry.
+        c->hand = e->next;
+        return;
+    }
+    order_unlink(c, e);
+    order_insert(c, e);
+}
+
+static void
+entry_free(Cache* c, CacheEntry* e)
+{
+    if (c->evict)
+        c->evict(e->value);
+    clib_free(CLIB_MEM_CACHE, c->site, e, sizeof(CacheEntry) + e->len);
+}
+
+static void
+remove_entry(Cache* c, CacheEntry* e)
+{
+    index_erase(c, index_slot_of(c, e));
+    order_unlink(c, e);
+    c->size--;
+    c->bytes -= e->cost;
+    entry_free(c, e);
+}
+
+/*
+ * Evicts one entry other than keep, there must be one.
+ */
+static void
+evict_one(Cache* c, const CacheEntry* keep)
+{
+    CacheEntry* e = c->hand;
+
+    assert(c->size > (keep ? 1u : 0u));
+    while (e == keep || e->ref) {
+        e->ref = 0;
+        e = e->next;
+    }
+    c->hand = e;
+    remove_entry(c, e);
+    c->stats.evictions++;
+}
+
+static inline int
+over_limits(const Cache* c, size_t entries, size_t bytes)
+{
+    return (c->max_entries && entries > c->max_entries) ||
+           (c->max_bytes && bytes > c->max_bytes);
+}
+
+/* * public functions * */
+
+Cache_t
+cache_create(enum CachePolicy policy,
+             size_t           max_entries,
+             size_t           max_bytes,
+             clib_free_func   evict
+             )
+{
+    unsigned site = clib_mem_current_site();
+    Cache* c = clib_calloc(CLIB_MEM_CACHE, site, 1, sizeof(Cache));
+    if (!c)
+        return NULL;
+
+    c->index = clib_calloc(CLIB_MEM_CACHE,
+                           site,
+                           CACHE_MIN_INDEX,
+                           sizeof(CacheEntry*)
+                           );
+    if (!c->index) {
+        clib_free(CLIB_MEM_CACHE, site, c, sizeof(Cache));
+        return NULL;
+    }
+    c->index_cap    = CACHE_MIN_INDEX;
+    c->max_entries  = max_entries;
+    c->max_bytes    = max_bytes;
+    c->evict        = evict;
+    c->policy       = policy;
+    c->site         = site;
+    return c;
+}
+
+void
+cache_destroy(Cache_t cache)
+{
+    Cache* c = cache;
+    if (!c)
+        return;
+    cache_clear(c);
+    clib_free(CLIB_MEM_CACHE,
+              c->site,
+              c->index,
+              c->index_cap * sizeof(CacheEntry*)
+              );
+    clib_free(CLIB_MEM_CACHE, c->site, c, sizeof(Cache));
+}
+
+void*
+cache_get(Cache_t cache, const void* key, size_t len)
+{
+    Cache* c = cache;
+    CacheEntry* e = c->index[index_find(c, key_hash(key, len), key, len)];
+
+    if (!e) {
+        c->stats.misses++;
+        return NULL;
+    }
+    c->stats.hits++;
+    touch(c, e);
+    return e->value;
+}
+
+int
+cache_contains(const Cache_t cache, const void* key, size_t len)
+{
+    const Cache* c = cache;
+    return c->index[index_find(c, key_hash(key, len), key, len)] != NULL;
+}
+
+int
+cache_put(Cache_t     cache,
+          const void* key,
+          size_t      len,
+          void*       value,
+          size_t      cost
+          )
+{
+    Cache* c = cache;
+    uint64_t h = key_hash(key, len);
+    CacheEntry* e;
+    size_t slot;
+
+    if (c->max_bytes && cost > c->max_bytes)
+        return CACHE_TOO_LARGE;
+
+    e = c->index[index_find(c, h, key, len)];
+    if (e) {
+        if (c->evict && e->value != value)
+            c->evict(e->value);
+        c->bytes = c->bytes - e->cost + cost;
+        e->value = value;
+        e->cost = cost;
+        touch(c, e);
+        while (over_limits(c, c->size, c->bytes))
+            evict_one(c, e);
+        return CACHE_OK;
+    }
+
+    if (index_reserve(c, c->size + 1))
+        return CACHE_OUT_OF_MEM;
+    e = clib_malloc(CLIB_MEM_CACHE, c->site, sizeof(CacheEntry) + len);
+    if (!e)
+        return CACHE_OUT_OF_MEM;
+
+    while (c->size && over_limits(c, c->size + 1, c->bytes + cost))
+        evict_one(c, NULL);
+
+    e->hash = h;
+    e->value = value;
+    e->cost = cost;
+    e->len = len;
+    e->ref = 0;
+    memcpy(e->key, key, len);
+
+    // evictions may have shifted the slots, so search again.
+    slot = index_find(c, h, key, len);
+    c->index[slot] = e;
+    order_insert(c, e);
+    c->size++;
+    c->bytes += cost;
+    return CACHE_OK;
+}
+
+int
+cache_remove(Cache_t cache, const void* key, size_t len)
+{
+    Cache* c = cache;
+    CacheEntry* e = c->index[index_find(c, key_hash(key, len), key, len)];
+
+    if (!e)
+        return CACHE_NOT_FOUND;
+    remove_entry(c, e);
+    return CACHE_OK;
+}
+
+void
+cache_clear(Cache_t cache)
+{
+    Cache* c = cache;
+
+    while (c->hand) {
+        CacheEntry* e = c->hand;
+        order_unlink(c, e);
+        entry_free(c, e);
+    }
+    memset(c->index, 0, c->index_cap * sizeof(CacheEntry*));
+    c->size = 0;
+    c->bytes = 0;
+}
+
+size_t
+cache_size(const Cache_t cache)
+{
+    const Cache* c = cache;
+    return c->size;
+}
+
+size_t
+cache_bytes(const Cache_t cache)
+{
+    const Cache* c = cache;
+    return c->bytes;
+}
+
+void
+cache_stats(const Cache_t cache, CacheStats* stats)
+{
+    const Cache* c = cache;
+    *stats = c->stats;
+}
+
+void
+cache_reset_stats(Cache_t cache)
+{
+    Cache* c = cache;
+    memset(&c->stats, 0, sizeof(c->stats));
+}
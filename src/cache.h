@@ -0,0 +1,158 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdlib.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A cache that maps byte string keys to values, with a bounded number of
+ * entries or bytes.
+ *
+ * Lookup, insertion and eviction are O(1): a hash index finds an entry
+ * and the eviction policy keeps the entries in a list. The cache copies
+ * the keys, the values are owned by the cache until they are evicted or
+ * removed.
+ */
+typedef void* Cache_t;
+
+enum CachePolicy {
+    /**
+     * Evicts the least recently used entry, a hit moves the entry to the
+     * front of the list.
+     */
+    CACHE_LRU,
+    /**
+     * Evicts an entry that was not used since the clock hand passed it.
+     * A hit only sets a flag, so hits don't write the list.
+     */
+    CACHE_CLOCK
+};
+
+enum CacheResult {
+    CACHE_OK = 0,
+    CACHE_OUT_OF_MEM,
+    CACHE_NOT_FOUND,
+    CACHE_TOO_LARGE     ///< the cost of a value exceeds max_bytes.
+};
+
+/**
+ * The counters of a cache.
+ */
+typedef struct CacheStats {
+    size_t hits;        ///< cache_get() calls that found the key.
+    size_t misses;      ///< cache_get() calls that didn't.
+    size_t evictions;   ///< entries evicted to respect the limits.
+} CacheStats;
+
+/**
+ * Create a cache.
+ *
+ * @param policy      [in] the eviction policy.
+ * @param max_entries [in] the largest number of entries, 0 for no limit.
+ * @param max_bytes   [in] the largest sum of the costs of the values, 0
+ *                         for no limit.
+ * @param evict       [in] called with a value when it leaves the cache,
+ *                         may be NULL.
+ *
+ * @return the cache or NULL when out of memory.
+ */
+Cache_t cache_create(enum CachePolicy policy,
+                     size_t           max_entries,
+                     size_t           max_bytes,
+                     clib_free_func   evict
+                     );
+
+/**
+ * Destroys the cache, evict is called for the values in the cache.
+ */
+void cache_destroy(Cache_t cache);
+
+/**
+ * Returns the value of key or NULL when key isn't cached.
+ */
+void* cache_get(Cache_t cache, const void* key, size_t len);
+
+/**
+ * Returns !0 when key is cached, the counters and the order of eviction
+ * are not changed.
+ */
+int cache_contains(const Cache_t cache, const void* key, size_t len);
+
+/**
+ * Store a value in the cache.
+ *
+ * A value that is already stored under key is replaced and passed to
+ * evict. Other entries are evicted until the limits are met.
+ *
+ * @param cost [in] the number of bytes accounted for value.
+ *
+ * @return CACHE_OK, CACHE_OUT_OF_MEM or CACHE_TOO_LARGE, then the value
+ *         isn't stored and the cache is unchanged.
+ */
+int cache_put(Cache_t     cache,
+              const void* key,
+              size_t      len,
+              void*       value,
+              size_t      cost
+              );
+
+/**
+ * Remove key from the cache, its value is passed to evict.
+ *
+ * @return CACHE_OK or CACHE_NOT_FOUND.
+ */
+int cache_remove(Cache_t cache, const void* key, size_t len);
+
+/**
+ * Remove all entries, their values are passed to evict.
+ */
+void cache_clear(Cache_t cache);
+
+/**
+ * Returns the number of entries.
+ */
+size_t cache_size(const Cache_t cache);
+
+/**
+ * Returns the sum of the costs of the values.
+ */
+size_t cache_bytes(const Cache_t cache);
+
+/**
+ * Copies the counters to stats.
+ */
+void cache_stats(const Cache_t cache, CacheStats* stats);
+
+/**
+ * Sets the counters to zero.
+ */
+void cache_reset_stats(Cache_t cache);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef CACHE_H*/
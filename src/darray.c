@@ -18,26 +18,10 @@
  */
 
 #include "darray.h"
+#include "priv/darraypriv.h"
 #include <string.h>
 #include <assert.h>
 
-/**
- * \brief the private implementation of an array.
- *
- * \private
- */
-struct DArray {
-    size_t  esize;   ///< Element size;
-    size_t  size;    ///< number of elements contained
-    size_t  cap;     ///< capacity of the buffer (in number of elements).
-    char*   elems;   ///< pointer to the elements.
-
-    da_free_func ff; ///< function called when erasing element from the array
-    da_copy_func cf; ///< This function is called when a new member is inserted.
-};
-
-typedef struct DArray DArray;
-
 const size_t DARRAY_SIZE    = sizeof(DArray);
 const size_t DARRAY_INC     = 2;
 
@@ -48,8 +32,10 @@ const size_t DARRAY_INC     = 2;
 DArray_t
 darray_create(size_t element_size, da_free_func ff, da_copy_func cf)
 {
-    DArray*  ret = calloc(1, DARRAY_SIZE);
+    unsigned site = clib_mem_current_site();
+    DArray*  ret = clib_calloc(CLIB_MEM_DARRAY, site, 1, DARRAY_SIZE);
     if (ret) {
+        ret->site   = site;
         ret->esize  = element_size;
         ret->ff     = ff;
         if (cf)
@@ -83,8 +69,8 @@ darray_destroy(DArray_t array)
         for (size_t i = 0; i < darray_size(ar); ++i)
             ar->ff(darray_get(ar, i));
     }
-    free(ar->elems);
-    free(ar);
+    clib_free(CLIB_MEM_DARRAY, ar->site, ar->elems, ar->esize * ar->cap);
+    clib_free(CLIB_MEM_DARRAY, ar->site, ar, DARRAY_SIZE);
 }
 
 size_t
@@ -153,7 +139,19 @@ darray_reserve_capacity(DArray_t array, size_t capacity)
     DArray* ar = array;
     assert(capacity >= darray_size(array));
 
-    void* newbytes = realloc(ar->elems, ar->esize * capacity);
+    if (capacity == 0) { // realloc(p, 0) need not return a pointer
+        clib_free(CLIB_MEM_DARRAY, ar->site, ar->elems, ar->esize * ar->cap);
+        ar->elems = NULL;
+        ar->cap = 0;
+        return 0;
+    }
+
+    void* newbytes = clib_realloc(CLIB_MEM_DARRAY,
+                                  ar->site,
+                                  ar->elems,
+                                  ar->esize * ar->cap,
+                                  ar->esize * capacity
+                                  );
     if (newbytes)
         ar->elems = newbytes;
     else
@@ -25,6 +25,8 @@ extern "C"{
 #endif
 
 #include <stdlib.h>
+#include "threadpool.h"
+#include "function-types.h"
 
 typedef void* DArray_t;
 
@@ -156,6 +158,368 @@ int darray_resize(DArray_t array, size_t size, da_init_func init_func);
  */
 int darray_insert(DArray_t array, void* src, size_t i, size_t nelems);
 
+/**
+ * \brief A view on elements of an array, it does not own them.
+ *
+ * The elements are stride bytes apart, a slice of an array has a stride
+ * of the element size, a strided view a multiple of it. A slice remains
+ * valid as long as the buffer of the array is not reallocated.
+ */
+typedef struct DArraySlice {
+    char*   data;   ///< the first element.
+    size_t  esize;  ///< the size of an element.
+    size_t  n;      ///< the number of elements.
+    size_t  stride; ///< the distance between elements in bytes.
+} DArraySlice;
+
+/**
+ * \brief Iterates over the elements of a slice, see darray_slice_next().
+ */
+typedef struct DArraySliceIter {
+    DArraySlice slice;  ///< the slice that is visited.
+    size_t      next;   ///< the index of the next element.
+} DArraySliceIter;
+
+/**
+ * Returns a view on the elements [begin, end) of the array.
+ *
+ * @param end [in] at most darray_size(array), begin <= end.
+ */
+DArraySlice darray_slice(DArray_t array, size_t begin, size_t end);
+
+/**
+ * Returns a view on all elements of the array.
+ */
+DArraySlice darray_slice_all(DArray_t array);
+
+/**
+ * Returns a pointer to the n-th element of the slice.
+ */
+void* darray_slice_get(const DArraySlice* slice, size_t n);
+
+/**
+ * Returns a view on the elements [begin, end) of a slice.
+ */
+DArraySlice darray_slice_sub(const DArraySlice* slice, size_t begin, size_t end);
+
+/**
+ * Returns a view on every step-th element of a slice, starting with the
+ * first one.
+ *
+ * @param step [in] larger than 0.
+ */
+DArraySlice darray_slice_strided(const DArraySlice* slice, size_t step);
+
+/**
+ * Returns !0 when the elements of the slice are adjacent.
+ */
+int darray_slice_contiguous(const DArraySlice* slice);
+
+/**
+ * Copies the elements of the slice next to each other into dest, which
+ * must have room for slice->n * slice->esize bytes.
+ */
+void darray_slice_copy(const DArraySlice* slice, void* dest);
+
+/**
+ * Returns an iterator positioned before the first element.
+ */
+DArraySliceIter darray_slice_iter(const DArraySlice* slice);
+
+/**
+ * Advances the iterator.
+ *
+ * @return the next element or NULL when all elements are visited.
+ */
+void* darray_slice_next(DArraySliceIter* iter);
+
+/**
+ * Arrays with fewer elements than this are processed serially by the
+ * darray_parallel_* functions.
+ */
+#define DARRAY_PARALLEL_THRESHOLD 4096
+
+/**
+ * Called for every element by darray_parallel_for_each.
+ */
+typedef void (*da_for_each_func)(void* element, void* arg);
+
+/**
+ * Folds element into the accumulator acc.
+ */
+typedef void (*da_reduce_func)(void* acc, const void* element, void* arg);
+
+/**
+ * Combines the accumulator other into acc, it must be associative.
+ */
+typedef void (*da_combine_func)(void* acc, const void* other, void* arg);
+
+/**
+ * Computes dest from src for darray_parallel_transform.
+ */
+typedef void (*da_transform_func)(void* dest, const void* src, void* arg);
+
+/**
+ * Calls func on every element of the array in parallel.
+ *
+ * The elements are split in chunks that start on a cache line, the chunks
+ * are distributed over the threads of the pool. Small arrays are processed
+ * on the calling thread.
+ *
+ * @param pool [in] the threads to use, NULL uses threadpool_default(). Use
+ *                  threadpool_create() to choose the number of threads.
+ * @param func [in] called with every element and arg, it may be called
+ *                  from several threads at once.
+ */
+void darray_parallel_for_each(DArray_t         array,
+                              ThreadPool_t     pool,
+                              da_for_each_func func,
+                              void*            arg
+                              );
+
+/**
+ * darray_parallel_for_each() for the elements of a slice.
+ */
+void darray_slice_parallel_for_each(const DArraySlice* slice,
+                                    ThreadPool_t       pool,
+                                    da_for_each_func   func,
+                                    void*              arg
+                                    );
+
+/**
+ * Reduces the array to a single value in parallel.
+ *
+ * Every chunk of the array starts with a copy of the value in result and
+ * folds its elements into it with reduce. The results of the chunks are
+ * combined into result in the order of the array, so combine must be
+ * associative but need not be commutative.
+ *
+ * @param pool        [in] the threads to use, NULL uses threadpool_default().
+ * @param result      [in,out] the identity of the reduction on input,
+ *                             the reduced value on output.
+ * @param result_size [in] the size of the value in result.
+ * @param reduce      [in] folds an element into an accumulator.
+ * @param combine     [in] combines two accumulators.
+ */
+void darray_parallel_reduce(DArray_t        array,
+                            ThreadPool_t    pool,
+                            void*           result,
+                            size_t          result_size,
+                            da_reduce_func  reduce,
+                            da_combine_func combine,
+                            void*           arg
+                            );
+
+/**
+ * darray_parallel_reduce() for the elements of a slice.
+ */
+void darray_slice_parallel_reduce(const DArraySlice* slice,
+                                  ThreadPool_t       pool,
+                                  void*              result,
+                                  size_t             result_size,
+                                  da_reduce_func     reduce,
+                                  da_combine_func    combine,
+                                  void*              arg
+                                  );
+
+/**
+ * Computes every element of dest from the element of src at the same index
+ * in parallel.
+ *
+ * The elements in dest are erased first, afterwards dest has the same size
+ * as src. The new elements of dest are written by func only, so func must
+ * initialize them completely.
+ *
+ * @param dest [out] the array that receives the results, it must not be src.
+ * @param src  [in]  the input array.
+ * @param pool [in]  the threads to use, NULL uses threadpool_default().
+ *
+ * @return 0 when successful, !0 when dest cannot grow to the size of src.
+ */
+int darray_parallel_transform(DArray_t          dest,
+                              const DArray_t    src,
+                              ThreadPool_t      pool,
+                              da_transform_func func,
+                              void*             arg
+                              );
+
+/**
+ * darray_parallel_transform() with the elements of a slice as input.
+ *
+ * @param src [in] must not view the elements of dest.
+ */
+int darray_slice_parallel_transform(DArray_t           dest,
+                                    const DArraySlice* src,
+                                    ThreadPool_t       pool,
+                                    da_transform_func  func,
+                                    void*              arg
+                                    );
+
+/**
+ * Sorts the array in parallel.
+ *
+ * The array is split in runs that are sorted by the threads of the pool,
+ * the runs are merged in parallel as well. Small arrays are sorted on the
+ * calling thread. The elements are moved with memcpy.
+ *
+ * @param pool   [in] the threads to use, NULL uses threadpool_default().
+ * @param cmp    [in] defines the order of the elements.
+ * @param stable [in] when !0 equal elements keep their relative order.
+ *
+ * @return 0 when successful, !0 when the buffer for merging cannot be
+ *         allocated, the array is unchanged then.
+ */
+int darray_parallel_sort(DArray_t          array,
+                         ThreadPool_t      pool,
+                         clib_compare_func cmp,
+                         int               stable
+                         );
+
+/**
+ * Sorts the elements of a slice in place, see darray_parallel_sort().
+ *
+ * The elements of a strided slice are gathered in a buffer, sorted and
+ * written back.
+ */
+int darray_slice_sort(const DArraySlice* slice,
+                      ThreadPool_t       pool,
+                      clib_compare_func  cmp,
+                      int                stable
+                      );
+
+/**
+ * Merges k sorted arrays into dest.
+ *
+ * The elements in dest are erased first, afterwards dest contains copies
+ * of all elements of the runs in sorted order. The smallest element is
+ * selected with a loser tree, so every element costs about log2(k)
+ * comparisons. Equal elements keep the order of the runs they came from.
+ *
+ * @param dest  [out] receives the copies, its copy function is used.
+ * @param runs  [in]  k arrays with the element size of dest, sorted by cmp.
+ * @param k     [in]  the number of runs.
+ *
+ * @return 0 when successful, !0 when out of memory, then dest is
+ *         unchanged.
+ */
+int darray_kway_merge(DArray_t          dest,
+                      DArray_t*         runs,
+                      size_t            k,
+                      clib_compare_func cmp
+                      );
+
+/**
+ * The instruction sets used by the byte and numeric kernels below.
+ */
+enum DArraySimdLevel {
+    DARRAY_SIMD_SCALAR = 0,
+    DARRAY_SIMD_SSE2,
+    DARRAY_SIMD_AVX2,
+    DARRAY_SIMD_AVX512
+};
+
+/**
+ * Returns the DArraySimdLevel that is used, by default the best one that
+ * the processor supports.
+ */
+int darray_simd_level(void);
+
+/**
+ * Limit the instruction set of the kernels, mainly for testing and
+ * benchmarking.
+ *
+ * @param level [in] a DArraySimdLevel, a level that the processor doesn't
+ *                   support is lowered to one it does.
+ *
+ * @return the level that is used from now on.
+ */
+int darray_set_simd_level(int level);
+
+/**
+ * Find an element by comparing its bytes with value.
+ *
+ * Elements are treated as blobs of element_size bytes, so this is
+ * only meaningful for elements without padding or pointers to compare.
+ * Element sizes of 1, 2, 4, 8 and 16 bytes use vector instructions.
+ *
+ * @param value [in] points to the bytes of the element to look for.
+ *
+ * @return the index of the first match or darray_size(array) when there
+ *         is none.
+ */
+size_t darray_find_bytes(const DArray_t array, const void* value);
+
+/**
+ * darray_find_bytes() for the elements of a slice, strided slices are
+ * searched without vector instructions.
+ *
+ * @return the index in the slice or slice->n when not found.
+ */
+size_t darray_slice_find_bytes(const DArraySlice* slice, const void* value);
+
+/**
+ * Count the elements whose bytes equal value, see darray_find_bytes.
+ */
+size_t darray_count_bytes(const DArray_t array, const void* value);
+
+/**
+ * darray_count_bytes() for the elements of a slice.
+ */
+size_t darray_slice_count_bytes(const DArraySlice* slice, const void* value);
+
+/**
+ * Overwrite all elements with a copy of the bytes of value.
+ *
+ * The free and copy functions of the array are not called, so only use
+ * this with elements that can be copied with memcpy.
+ */
+void darray_fill(DArray_t array, const void* value);
+
+/**
+ * Returns !0 when the arrays have the same element size, the same size
+ * and the same bytes, 0 otherwise.
+ */
+int darray_equal(const DArray_t a, const DArray_t b);
+
+/**
+ * The element types of the numeric kernels.
+ */
+enum DArrayNumType {
+    DARRAY_INT32,   ///< int32_t
+    DARRAY_INT64,   ///< int64_t
+    DARRAY_FLOAT,   ///< float
+    DARRAY_DOUBLE   ///< double
+};
+
+/**
+ * Find the smallest element of an array of numbers.
+ *
+ * @param type [in]  a DArrayNumType that matches the element size.
+ * @param min  [out] receives the smallest element, a value of type.
+ *                   The result is unspecified when there are NaNs.
+ *
+ * @return 0 when successful, !0 when the array is empty.
+ */
+int darray_min(const DArray_t array, int type, void* min);
+
+/**
+ * Find the largest element of an array of numbers, see darray_min.
+ */
+int darray_max(const DArray_t array, int type, void* max);
+
+/**
+ * Sum an array of numbers.
+ *
+ * The elements are added in several lanes, so the rounding of floating
+ * point sums differs from adding them one by one.
+ *
+ * @param type [in]  a DArrayNumType that matches the element size.
+ * @param sum  [out] receives the sum, an int64_t for the integer types
+ *                   and a double for float and double. int64_t sums wrap
+ *                   around on overflow.
+ */
+void darray_sum(const DArray_t array, int type, void* sum);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,358 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * The parallel algorithms of DArray_t, they run on a ThreadPool_t.
+ */
+
+#include "darray.h"
+#include "priv/darraypriv.h"
+#include "priv/cachelinepriv.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * The number of chunks per thread, more chunks even out differences in
+ * the cost of the elements, fewer reduce the overhead.
+ */
+#define DARRAY_CHUNKS_PER_THREAD 4
+
+/*
+ * The smallest number of elements in a chunk.
+ */
+#define DARRAY_MIN_CHUNK 1024
+
+/**
+ * \brief The partitioning of an array in chunks.
+ *
+ * All chunks except the first start on a cache line, so threads don't
+ * write to the same cache line. The first chunk absorbs the elements
+ * before the first aligned element.
+ *
+ * \private
+ */
+struct Chunks {
+    size_t n;       ///< number of elements
+    size_t skew;    ///< elements before the first aligned element.
+    size_t step;    ///< elements in a chunk, a whole number of cache lines.
+    size_t count;   ///< the number of chunks.
+};
+
+typedef struct Chunks Chunks;
+
+static size_t
+gcd(size_t a, size_t b)
+{
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static void
+chunks_init(Chunks*     chunks,
+            const char* base,
+            size_t      stride,
+            size_t      n,
+            size_t      nthreads
+            )
+{
+    // the number of elements in which the address pattern repeats.
+    size_t period = CLIB_CACHE_LINE / gcd(stride, CLIB_CACHE_LINE);
+    size_t step = n / (nthreads * DARRAY_CHUNKS_PER_THREAD);
+
+    chunks->n = n;
+    chunks->skew = 0;
+    for (size_t i = 0; i < period; i++) {
+        if ((uintptr_t) (base + i * stride) % CLIB_CACHE_LINE == 0) {
+            chunks->skew = i;
+            break;
+        }
+    }
+
+    if (step < DARRAY_MIN_CHUNK)
+        step = DARRAY_MIN_CHUNK;
+    step = (step + period - 1) / period * period;
+    chunks->step = step;
+    chunks->count = n > chunks->skew ? (n - chunks->skew + step - 1) / step
+                                     : 1;
+}
+
+static inline size_t
+chunk_begin(const Chunks* chunks, size_t c)
+{
+    return c ? chunks->skew + c * chunks->step : 0;
+}
+
+static inline size_t
+chunk_end(const Chunks* chunks, size_t c)
+{
+    size_t end = chunks->skew + (c + 1) * chunks->step;
+    return end < chunks->n ? end : chunks->n;
+}
+
+static ThreadPool_t
+pool_or_default(ThreadPool_t pool)
+{
+    return pool ? pool : threadpool_default();
+}
+
+/* * for each * */
+
+struct ForEachJob {
+    DArraySlice         slice;
+    Chunks              chunks;
+    da_for_each_func    func;
+    void*               arg;
+};
+
+static void
+for_each_chunks(size_t begin, size_t end, void* arg)
+{
+    struct ForEachJob* job = arg;
+    const DArraySlice* s = &job->slice;
+
+    for (size_t c = begin; c < end; c++) {
+        char* p = s->data + chunk_begin(&job->chunks, c) * s->stride;
+        for (size_t i = chunk_begin(&job->chunks, c);
+             i < chunk_end(&job->chunks, c);
+             i++, p += s->stride)
+            job->func(p, job->arg);
+    }
+}
+
+void
+darray_slice_parallel_for_each(const DArraySlice* slice,
+                               ThreadPool_t       pool,
+                               da_for_each_func   func,
+                               void*              arg
+                               )
+{
+    struct ForEachJob job = {*slice, {0}, func, arg};
+
+    if (slice->n < DARRAY_PARALLEL_THRESHOLD) {
+        for (size_t i = 0; i < slice->n; i++)
+            func(slice->data + i * slice->stride, arg);
+        return;
+    }
+
+    pool = pool_or_default(pool);
+    chunks_init(&job.chunks,
+                slice->data,
+                slice->stride,
+                slice->n,
+                threadpool_size(pool) + 1
+                );
+    threadpool_parallel_for(pool, 0, job.chunks.count, 1, for_each_chunks, &job);
+}
+
+void
+darray_parallel_for_each(DArray_t         array,
+                         ThreadPool_t     pool,
+                         da_for_each_func func,
+                         void*            arg
+                         )
+{
+    DArraySlice slice = darray_slice_all(array);
+    darray_slice_parallel_for_each(&slice, pool, func, arg);
+}
+
+/* * reduce * */
+
+struct ReduceJob {
+    DArraySlice     slice;
+    Chunks          chunks;
+    char*           accs;   ///< one accumulator per chunk.
+    size_t          stride; ///< distance between accumulators.
+    da_reduce_func  reduce;
+    void*           arg;
+};
+
+static void
+reduce_chunks(size_t begin, size_t end, void* arg)
+{
+    struct ReduceJob* job = arg;
+    const DArraySlice* s = &job->slice;
+
+    for (size_t c = begin; c < end; c++) {
+        char* acc = job->accs + c * job->stride;
+        char* p   = s->data + chunk_begin(&job->chunks, c) * s->stride;
+        for (size_t i = chunk_begin(&job->chunks, c);
+             i < chunk_end(&job->chunks, c);
+             i++, p += s->stride)
+            job->reduce(acc, p, job->arg);
+    }
+}
+
+void
+darray_slice_parallel_reduce(const DArraySlice* slice,
+                             ThreadPool_t       pool,
+                             void*              result,
+                             size_t             result_size,
+                             da_reduce_func     reduce,
+                             da_combine_func    combine,
+                             void*              arg
+                             )
+{
+    struct ReduceJob job = {*slice, {0}, NULL, 0, reduce, arg};
+    unsigned site = clib_mem_current_site();
+
+    if (slice->n >= DARRAY_PARALLEL_THRESHOLD) {
+        pool = pool_or_default(pool);
+        chunks_init(&job.chunks,
+                    slice->data,
+                    slice->stride,
+                    slice->n,
+                    threadpool_size(pool) + 1
+                    );
+        // keep the accumulators on their own cache lines.
+        job.stride = CLIB_CACHE_ROUND(result_size);
+        job.accs = clib_aligned_alloc(CLIB_MEM_DARRAY,
+                                      site,
+                                      CLIB_CACHE_LINE,
+                                      job.chunks.count * job.stride
+                                      );
+    }
+
+    if (!job.accs) { // small array or out of memory.
+        for (size_t i = 0; i < slice->n; i++)
+            reduce(result, slice->data + i * slice->stride, arg);
+        return;
+    }
+
+    for (size_t c = 0; c < job.chunks.count; c++)
+        memcpy(job.accs + c * job.stride, result, result_size);
+    threadpool_parallel_for(pool, 0, job.chunks.count, 1, reduce_chunks, &job);
+    for (size_t c = 0; c < job.chunks.count; c++)
+        combine(result, job.accs + c * job.stride, arg);
+
+    clib_free(CLIB_MEM_DARRAY, site, job.accs, job.chunks.count * job.stride);
+}
+
+void
+darray_parallel_reduce(DArray_t        array,
+                       ThreadPool_t    pool,
+                       void*           result,
+                       size_t          result_size,
+                       da_reduce_func  reduce,
+                       da_combine_func combine,
+                       void*           arg
+                       )
+{
+    DArraySlice slice = darray_slice_all(array);
+    darray_slice_parallel_reduce(&slice,
+                                 pool,
+                                 result,
+                                 result_size,
+                                 reduce,
+                                 combine,
+                                 arg
+                                 );
+}
+
+/* * transform * */
+
+struct TransformJob {
+    DArray*             dest;
+    DArraySlice         src;
+    Chunks              chunks;
+    da_transform_func   func;
+    void*               arg;
+};
+
+static void
+transform_chunks(size_t begin, size_t end, void* arg)
+{
+    struct TransformJob* job = arg;
+    DArray* dest = job->dest;
+    const DArraySlice* src = &job->src;
+
+    for (size_t c = begin; c < end; c++) {
+        size_t first = chunk_begin(&job->chunks, c);
+        size_t last  = chunk_end(&job->chunks, c);
+        char* d = dest->elems + first * dest->esize;
+        const char* s = src->data + first * src->stride;
+        for (size_t i = first; i < last; i++) {
+            job->func(d, s, job->arg);
+            d += dest->esize;
+            s += src->stride;
+        }
+    }
+}
+
+int
+darray_slice_parallel_transform(DArray_t           dest,
+                                const DArraySlice* src,
+                                ThreadPool_t       pool,
+                                da_transform_func  func,
+                                void*              arg
+                                )
+{
+    struct TransformJob job = {dest, *src, {0}, func, arg};
+    DArray* d = dest;
+
+    if (d->ff) {
+        for (size_t i = 0; i < d->size; i++)
+            d->ff(d->elems + i * d->esize);
+    }
+    d->size = 0;
+    if (d->cap < src->n && darray_reserve_capacity(d, src->n))
+        return 1;
+
+    if (src->n < DARRAY_PARALLEL_THRESHOLD) {
+        for (size_t i = 0; i < src->n; i++)
+            func(d->elems + i * d->esize, src->data + i * src->stride, arg);
+    }
+    else {
+        pool = pool_or_default(pool);
+        // align the chunks on the destination, that is written to.
+        chunks_init(&job.chunks,
+                    d->elems,
+                    d->esize,
+                    src->n,
+                    threadpool_size(pool) + 1
+                    );
+        threadpool_parallel_for(pool,
+                                0,
+                                job.chunks.count,
+                                1,
+                                transform_chunks,
+                                &job
+                                );
+    }
+
+    d->size = src->n;
+    return 0;
+}
+
+int
+darray_parallel_transform(DArray_t          dest,
+                          const DArray_t    src,
+                          ThreadPool_t      pool,
+                          da_transform_func func,
+                          void*             arg
+                          )
+{
+    DArraySlice slice = darray_slice_all(src);
+    assert(dest != src);
+    return darray_slice_parallel_transform(dest, &slice, pool, func, arg);
+}
@@ -0,0 +1,213 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * A DArray_t that is published to readers that don't lock, the versions
+ * are reclaimed with epoch based reclamation.
+ */
+
+#include "darrayrcu.h"
+#include "ebr.h"
+#include "priv/darraypriv.h"
+#include "priv/cachelinepriv.h"
+#include <stdatomic.h>
+#include <pthread.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * \brief A published array.
+ *
+ * current is read by every reader and is on a cache line of its own, so
+ * the writers don't disturb it when they don't publish.
+ *
+ * \private
+ */
+struct DArrayRcu {
+    _Alignas(CLIB_CACHE_LINE) _Atomic(DArray*) current;
+    _Alignas(CLIB_CACHE_LINE) pthread_mutex_t lock; ///< serializes writers.
+    Ebr_t           ebr;
+    EbrThread_t     writer;     ///< retires versions, used with lock held.
+    unsigned        site;
+};
+
+typedef struct DArrayRcu DArrayRcu;
+
+/**
+ * \brief A reader thread.
+ * \private
+ */
+struct DArrayRcuReader {
+    DArrayRcu*      rcu;
+    EbrThread_t     thread;
+};
+
+typedef struct DArrayRcuReader DArrayRcuReader;
+
+DArrayRcu_t
+darray_rcu_create(DArray_t array)
+{
+    unsigned site = clib_mem_current_site();
+    DArrayRcu* rcu = clib_aligned_alloc(CLIB_MEM_DARRAY,
+                                        site,
+                                        CLIB_CACHE_LINE,
+                                        sizeof(DArrayRcu)
+                                        );
+    if (!rcu)
+        return NULL;
+
+    rcu->ebr = ebr_create();
+    rcu->writer = rcu->ebr ? ebr_register(rcu->ebr) : NULL;
+    if (!rcu->writer) {
+        if (rcu->ebr)
+            ebr_destroy(rcu->ebr);
+        clib_free(CLIB_MEM_DARRAY,
+                  site,
+                  rcu,
+                  CLIB_CACHE_ROUND(sizeof(DArrayRcu))
+                  );
+        return NULL;
+    }
+    atomic_init(&rcu->current, array);
+    pthread_mutex_init(&rcu->lock, NULL);
+    rcu->site = site;
+    return rcu;
+}
+
+void
+darray_rcu_destroy(DArrayRcu_t self)
+{
+    DArrayRcu* rcu = self;
+
+    darray_destroy(atomic_load(&rcu->current));
+    ebr_unregister(rcu->writer);
+    ebr_destroy(rcu->ebr);  // frees the retired versions.
+    pthread_mutex_destroy(&rcu->lock);
+    clib_free(CLIB_MEM_DARRAY,
+              rcu->site,
+              rcu,
+              CLIB_CACHE_ROUND(sizeof(DArrayRcu))
+              );
+}
+
+DArrayRcuReader_t
+darray_rcu_reader_create(DArrayRcu_t self)
+{
+    DArrayRcu* rcu = self;
+    DArrayRcuReader* reader = clib_malloc(CLIB_MEM_DARRAY,
+                                          rcu->site,
+                                          sizeof(DArrayRcuReader)
+                                          );
+    if (!reader)
+        return NULL;
+
+    reader->rcu = rcu;
+    if (!(reader->thread = ebr_register(rcu->ebr))) {
+        clib_free(CLIB_MEM_DARRAY, rcu->site, reader, sizeof(DArrayRcuReader));
+        return NULL;
+    }
+    return reader;
+}
+
+void
+darray_rcu_reader_destroy(DArrayRcuReader_t self)
+{
+    DArrayRcuReader* reader = self;
+    unsigned site = reader->rcu->site;
+
+    ebr_unregister(reader->thread);
+    clib_free(CLIB_MEM_DARRAY, site, reader, sizeof(DArrayRcuReader));
+}
+
+DArray_t
+darray_rcu_read_lock(DArrayRcuReader_t self)
+{
+    DArrayRcuReader* reader = self;
+
+    ebr_enter(reader->thread);
+    return atomic_load_explicit(&reader->rcu->current, memory_order_acquire);
+}
+
+void
+darray_rcu_read_unlock(DArrayRcuReader_t self)
+{
+    DArrayRcuReader* reader = self;
+
+    ebr_exit(reader->thread);
+}
+
+/*
+ * Publishes array and retires the old version, the lock is held.
+ */
+static void
+publish_locked(DArrayRcu* rcu, DArray* array)
+{
+    DArray* old = atomic_load_explicit(&rcu->current, memory_order_relaxed);
+
+    // the old version is retired after it is unpublished, readers that
+    // enter later can't load it.
+    atomic_store_explicit(&rcu->current, array, memory_order_release);
+    if (ebr_retire(rcu->writer, old, darray_destroy)) {
+        ebr_synchronize(rcu->writer);
+        darray_destroy(old);
+        return;
+    }
+
+    // versions are few and may be large, don't wait for a batch.
+    ebr_collect(rcu->writer);
+}
+
+int
+darray_rcu_update(DArrayRcu_t self, da_rcu_update_func func, void* arg)
+{
+    DArrayRcu* rcu = self;
+    int ret;
+
+    pthread_mutex_lock(&rcu->lock);
+    DArray* cur = atomic_load_explicit(&rcu->current, memory_order_relaxed);
+    DArray* copy = darray_create_capacity(cur->esize,
+                                          cur->ff,
+                                          cur->cf,
+                                          cur->size
+                                          );
+
+    ret = copy ? 0 : -1;
+    for (size_t i = 0; !ret && i < cur->size; i++)
+        ret = darray_append(copy, darray_get(cur, i)) ? -1 : 0;
+    if (!ret)
+        ret = func(copy, arg);
+    if (!ret)
+        publish_locked(rcu, copy);
+    pthread_mutex_unlock(&rcu->lock);
+
+    if (ret && copy)
+        darray_destroy(copy);
+    return ret;
+}
+
+int
+darray_rcu_publish(DArrayRcu_t self, DArray_t array)
+{
+    DArrayRcu* rcu = self;
+
+    pthread_mutex_lock(&rcu->lock);
+    publish_locked(rcu, array);
+    pthread_mutex_unlock(&rcu->lock);
+    return 0;
+}
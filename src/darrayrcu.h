@@ -0,0 +1,121 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DARRAYRCU_H
+#define DARRAYRCU_H
+
+#include "darray.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A read mostly DArray_t with readers that don't take a lock.
+ *
+ * The wrapper publishes an immutable version of an array. A reader gets
+ * the current version and may use it until it unlocks, it doesn't write
+ * to memory that is shared with other readers, so reading scales with
+ * the number of threads. A writer updates a copy of the array and
+ * publishes the copy, the old version is freed once no reader uses it,
+ * see ebr.h. Writers are serialized by a mutex.
+ */
+typedef void* DArrayRcu_t;
+
+/**
+ * The registration of a reader thread, it is used by that thread only.
+ */
+typedef void* DArrayRcuReader_t;
+
+/**
+ * Updates the private copy of the array, returns 0 to publish it.
+ */
+typedef int (*da_rcu_update_func)(DArray_t copy, void* arg);
+
+/**
+ * Create a wrapper that publishes array.
+ *
+ * @param array [in] the first version, the wrapper owns it.
+ *
+ * @return the wrapper or NULL when out of memory.
+ */
+DArrayRcu_t darray_rcu_create(DArray_t array);
+
+/**
+ * Destroys the wrapper and all versions of the array.
+ *
+ * All readers must be destroyed.
+ */
+void darray_rcu_destroy(DArrayRcu_t rcu);
+
+/**
+ * Registers the calling thread as a reader.
+ *
+ * @return the reader or NULL when out of memory.
+ */
+DArrayRcuReader_t darray_rcu_reader_create(DArrayRcu_t rcu);
+
+/**
+ * Unregisters a reader that holds no version.
+ */
+void darray_rcu_reader_destroy(DArrayRcuReader_t reader);
+
+/**
+ * Returns the current version of the array.
+ *
+ * The version must not be modified, it remains valid until
+ * darray_rcu_read_unlock(). The calls may be nested.
+ */
+DArray_t darray_rcu_read_lock(DArrayRcuReader_t reader);
+
+/**
+ * Releases the version returned by darray_rcu_read_lock().
+ */
+void darray_rcu_read_unlock(DArrayRcuReader_t reader);
+
+/**
+ * Copies the current version, lets func update the copy and publishes it.
+ *
+ * The elements are copied with the copy func of the array. When there is
+ * no memory to queue the old version for reclamation, the update waits
+ * until no reader holds it, so a thread must not update while it holds
+ * a version.
+ *
+ * @return 0, the value returned by func when it isn't 0, then nothing
+ *         is published, or -1 when out of memory.
+ */
+int darray_rcu_update(DArrayRcu_t rcu, da_rcu_update_func func, void* arg);
+
+/**
+ * Publishes array as the new version.
+ *
+ * Like darray_rcu_update() it may wait for the readers when out of
+ * memory.
+ *
+ * @param array [in] the new version, the wrapper owns it.
+ *
+ * @return 0
+ */
+int darray_rcu_publish(DArrayRcu_t rcu, DArray_t array);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef DARRAYRCU_H*/
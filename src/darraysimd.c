@@ -0,0 +1,625 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Byte and numeric kernels for DArray_t with runtime selection of the
+ * instruction set.
+ *
+ * The byte kernels compare whole vectors of bytes with a vector holding
+ * copies of the value, an element matches when all of its bytes do. As
+ * the element size divides the vector size, every vector holds whole
+ * elements. The numeric kernels use the vector extensions of GCC and
+ * clang, they are compiled once for every instruction set.
+ */
+
+#include "darray.h"
+#include "priv/darraypriv.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include "priv/simdpriv.h"
+
+/*
+ * The largest vector in bytes, values are replicated to this size.
+ */
+#define SIMD_MAX_VECTOR 64
+
+static atomic_int g_level = -1;
+
+static int
+detect_level(void)
+{
+#if defined(CLIB_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        return DARRAY_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return DARRAY_SIMD_AVX2;
+    return DARRAY_SIMD_SSE2;
+#else
+    return DARRAY_SIMD_SCALAR;
+#endif
+}
+
+int
+darray_simd_level(void)
+{
+    int level = atomic_load_explicit(&g_level, memory_order_relaxed);
+    if (level < 0) {
+        level = detect_level();
+        atomic_store_explicit(&g_level, level, memory_order_relaxed);
+    }
+    return level;
+}
+
+int
+darray_set_simd_level(int level)
+{
+    int best = detect_level();
+    if (level > best)
+        level = best;
+    if (level < DARRAY_SIMD_SCALAR)
+        level = DARRAY_SIMD_SCALAR;
+    atomic_store_explicit(&g_level, level, memory_order_relaxed);
+    return level;
+}
+
+/* * scalar kernels * */
+
+static size_t
+find_scalar(const char* p, size_t n, size_t w, const char* value)
+{
+    if (w == 1) {
+        const char* found = memchr(p, *value, n);
+        return found ? (size_t) (found - p) : n;
+    }
+    for (size_t i = 0; i < n; i++, p += w)
+        if (memcmp(p, value, w) == 0)
+            return i;
+    return n;
+}
+
+static size_t
+count_scalar(const char* p, size_t n, size_t w, const char* value)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++, p += w)
+        count += memcmp(p, value, w) == 0;
+    return count;
+}
+
+/*
+ * Copies value into the first element and doubles the filled part until
+ * the buffer is full.
+ */
+static void
+fill_scalar(char* p, size_t n, size_t w, const char* value)
+{
+    size_t bytes = n * w, done = w;
+
+    memcpy(p, value, w);
+    while (done < bytes) {
+        size_t len = done < bytes - done ? done : bytes - done;
+        memcpy(p + done, p, len);
+        done += len;
+    }
+}
+
+#if defined(CLIB_SIMD_X86)
+
+/* * vector kernels for bytes * */
+
+/*
+ * Reduces a mask with one bit per byte to a mask with the lowest bit of
+ * every element set when all bytes of that element match.
+ */
+static inline uint64_t
+element_bits(uint64_t m, size_t w)
+{
+    static const uint64_t first_bytes[17] = {
+        [1]  = UINT64_C(0xffffffffffffffff),
+        [2]  = UINT64_C(0x5555555555555555),
+        [4]  = UINT64_C(0x1111111111111111),
+        [8]  = UINT64_C(0x0101010101010101),
+        [16] = UINT64_C(0x0001000100010001)
+    };
+    for (size_t k = 1; k < w; k <<= 1)
+        m &= m >> k;
+    return m & first_bytes[w];
+}
+
+#define LOAD_SSE2(p)        _mm_loadu_si128((const __m128i*) (p))
+#define STORE_SSE2(p, v)    _mm_storeu_si128((__m128i*) (p), v)
+#define MATCH_SSE2(a, b)    \
+    ((uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)))
+
+#define LOAD_AVX2(p)        _mm256_loadu_si256((const __m256i*) (p))
+#define STORE_AVX2(p, v)    _mm256_storeu_si256((__m256i*) (p), v)
+#define MATCH_AVX2(a, b)    \
+    ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)))
+
+#define LOAD_AVX512(p)      _mm512_loadu_si512((const void*) (p))
+#define STORE_AVX512(p, v)  _mm512_storeu_si512((void*) (p), v)
+#define MATCH_AVX512(a, b)  ((uint64_t) _mm512_cmpeq_epi8_mask(a, b))
+
+/*
+ * Defines find, count and fill for one instruction set, pattern holds
+ * the value replicated to a whole vector.
+ */
+#define DEFINE_BYTE_KERNELS(ISA, VB, VT)                                    \
+ATTR_##ISA static size_t                                                    \
+find_##ISA(const char* p, size_t n, size_t w, const char* pattern)          \
+{                                                                           \
+    size_t i = 0, bytes = n * w;                                            \
+    VT v = LOAD_##ISA(pattern);                                             \
+    for (; i + VB <= bytes; i += VB) {                                      \
+        uint64_t m = element_bits(MATCH_##ISA(LOAD_##ISA(p + i), v), w);    \
+        if (m)                                                              \
+            return (i + (size_t) __builtin_ctzll(m)) / w;                   \
+    }                                                                       \
+    return i / w + find_scalar(p + i, n - i / w, w, pattern);               \
+}                                                                           \
+                                                                            \
+ATTR_##ISA static size_t                                                    \
+count_##ISA(const char* p, size_t n, size_t w, const char* pattern)         \
+{                                                                           \
+    size_t i = 0, bytes = n * w, count = 0;                                 \
+    VT v = LOAD_##ISA(pattern);                                             \
+    for (; i + VB <= bytes; i += VB) {                                      \
+        uint64_t m = element_bits(MATCH_##ISA(LOAD_##ISA(p + i), v), w);    \
+        count += (size_t) __builtin_popcountll(m);                          \
+    }                                                                       \
+    return count + count_scalar(p + i, n - i / w, w, pattern);              \
+}                                                                           \
+                                                                            \
+ATTR_##ISA static void                                                      \
+fill_##ISA(char* p, size_t n, size_t w, const char* pattern)                \
+{                                                                           \
+    size_t i = 0, bytes = n * w;                                            \
+    VT v = LOAD_##ISA(pattern);                                             \
+    for (; i + VB <= bytes; i += VB)                                        \
+        STORE_##ISA(p + i, v);                                              \
+    memcpy(p + i, pattern, bytes - i);                                      \
+}
+
+DEFINE_BYTE_KERNELS(SSE2, 16, __m128i)
+DEFINE_BYTE_KERNELS(AVX2, 32, __m256i)
+DEFINE_BYTE_KERNELS(AVX512, 64, __m512i)
+
+/* * vector kernels for numbers * */
+
+/*
+ * Defines minmax_<S>_<ISA> for elements of type T, M is the integer type
+ * of the same size that comparisons produce. Elements are blended with
+ * the comparison masks as C has no ?: for vectors.
+ */
+#define DEFINE_MINMAX(ISA, VB, T, M, S)                                     \
+typedef T vec_##S##_##ISA __attribute__((vector_size(VB)));                 \
+typedef M mask_##S##_##ISA __attribute__((vector_size(VB)));                \
+                                                                            \
+ATTR_##ISA static void                                                      \
+minmax_##S##_##ISA(const T* a, size_t n, T* min, T* max)                    \
+{                                                                           \
+    enum { L = VB / sizeof(T) };                                            \
+    vec_##S##_##ISA lo, hi, v;                                              \
+    mask_##S##_##ISA lt, gt;                                                \
+    size_t i;                                                               \
+    T rmin, rmax;                                                           \
+                                                                            \
+    if (n < L) {                                                            \
+        minmax_##S##_scalar(a, n, min, max);                                \
+        return;                                                             \
+    }                                                                       \
+    memcpy(&lo, a, VB);                                                     \
+    hi = lo;                                                                \
+    for (i = L; i + L <= n; i += L) {                                       \
+        memcpy(&v, a + i, VB);                                              \
+        lt = v < lo;                                                        \
+        gt = v > hi;                                                        \
+        lo = (vec_##S##_##ISA) ((lt & (mask_##S##_##ISA) v) |               \
+                                (~lt & (mask_##S##_##ISA) lo));             \
+        hi = (vec_##S##_##ISA) ((gt & (mask_##S##_##ISA) v) |               \
+                                (~gt & (mask_##S##_##ISA) hi));             \
+    }                                                                       \
+    rmin = lo[0];                                                           \
+    rmax = hi[0];                                                           \
+    for (size_t k = 1; k < L; k++) {                                        \
+        rmin = lo[k] < rmin ? lo[k] : rmin;                                 \
+        rmax = hi[k] > rmax ? hi[k] : rmax;                                 \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+        rmin = a[i] < rmin ? a[i] : rmin;                                   \
+        rmax = a[i] > rmax ? a[i] : rmax;                                   \
+    }                                                                       \
+    *min = rmin;                                                            \
+    *max = rmax;                                                            \
+}
+
+/*
+ * Defines sum_<S>_<ISA> that adds elements of type T in two vectors of
+ * accumulators of type A.
+ */
+#define DEFINE_SUM(ISA, VB, T, A, S)                                        \
+typedef A acc_##S##_##ISA __attribute__((vector_size(VB)));                 \
+typedef T in_##S##_##ISA                                                    \
+    __attribute__((vector_size(VB / sizeof(A) * sizeof(T))));               \
+                                                                            \
+ATTR_##ISA static A                                                         \
+sum_##S##_##ISA(const T* a, size_t n)                                       \
+{                                                                           \
+    enum { L = VB / sizeof(A) };                                            \
+    acc_##S##_##ISA acc0 = {0}, acc1 = {0};                                 \
+    in_##S##_##ISA v0, v1;                                                  \
+    size_t i = 0;                                                           \
+    A sum = 0;                                                              \
+                                                                            \
+    for (; i + 2 * L <= n; i += 2 * L) {                                    \
+        memcpy(&v0, a + i, sizeof(v0));                                     \
+        memcpy(&v1, a + i + L, sizeof(v1));                                 \
+        acc0 += __builtin_convertvector(v0, acc_##S##_##ISA);               \
+        acc1 += __builtin_convertvector(v1, acc_##S##_##ISA);               \
+    }                                                                       \
+    acc0 += acc1;                                                           \
+    for (size_t k = 0; k < L; k++)                                          \
+        sum += acc0[k];                                                     \
+    for (; i < n; i++)                                                      \
+        sum += (A) a[i];                                                    \
+    return sum;                                                             \
+}
+
+#define DEFINE_NUM_KERNELS(S, T, M, A)                                      \
+    DEFINE_MINMAX(SSE2, 16, T, M, S)                                        \
+    DEFINE_MINMAX(AVX2, 32, T, M, S)                                        \
+    DEFINE_MINMAX(AVX512, 64, T, M, S)                                      \
+    DEFINE_SUM(SSE2, 16, T, A, S)                                           \
+    DEFINE_SUM(AVX2, 32, T, A, S)                                           \
+    DEFINE_SUM(AVX512, 64, T, A, S)
+
+#else
+
+#define DEFINE_NUM_KERNELS(S, T, M, A)
+
+#endif /*defined(CLIB_SIMD_X86)*/
+
+/*
+ * The scalar numeric kernels, the vector ones fall back on them for
+ * short arrays.
+ */
+#define DEFINE_SCALAR_NUM_KERNELS(S, T, A)                                  \
+static void                                                                 \
+minmax_##S##_scalar(const T* a, size_t n, T* min, T* max)                   \
+{                                                                           \
+    T rmin = a[0], rmax = a[0];                                             \
+    for (size_t i = 1; i < n; i++) {                                        \
+        rmin = a[i] < rmin ? a[i] : rmin;                                   \
+        rmax = a[i] > rmax ? a[i] : rmax;                                   \
+    }                                                                       \
+    *min = rmin;                                                            \
+    *max = rmax;                                                            \
+}                                                                           \
+                                                                            \
+static A                                                                    \
+sum_##S##_scalar(const T* a, size_t n)                                      \
+{                                                                           \
+    A sum = 0;                                                              \
+    for (size_t i = 0; i < n; i++)                                          \
+        sum += (A) a[i];                                                    \
+    return sum;                                                             \
+}
+
+DEFINE_SCALAR_NUM_KERNELS(i32, int32_t, int64_t)
+DEFINE_SCALAR_NUM_KERNELS(i64, int64_t, uint64_t)
+DEFINE_SCALAR_NUM_KERNELS(f32, float, double)
+DEFINE_SCALAR_NUM_KERNELS(f64, double, double)
+
+DEFINE_NUM_KERNELS(i32, int32_t, int32_t, int64_t)
+DEFINE_NUM_KERNELS(i64, int64_t, int64_t, uint64_t)
+DEFINE_NUM_KERNELS(f32, float, int32_t, double)
+DEFINE_NUM_KERNELS(f64, double, int64_t, double)
+
+/* * dispatch * */
+
+/*
+ * Whether the vector kernels handle elements of w bytes.
+ */
+static inline int
+vector_width(size_t w)
+{
+    return w == 1 || w == 2 || w == 4 || w == 8 || w == 16;
+}
+
+/*
+ * Fills pattern with copies of value.
+ */
+static void
+make_pattern(char* pattern, const void* value, size_t w)
+{
+    for (size_t i = 0; i < SIMD_MAX_VECTOR; i += w)
+        memcpy(pattern + i, value, w);
+}
+
+/*
+ * Visits the elements of a strided slice one by one.
+ */
+static size_t
+find_strided(const DArraySlice* slice, const void* value)
+{
+    for (size_t i = 0; i < slice->n; i++)
+        if (memcmp(slice->data + i * slice->stride, value, slice->esize) == 0)
+            return i;
+    return slice->n;
+}
+
+static size_t
+count_strided(const DArraySlice* slice, const void* value)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < slice->n; i++)
+        count += memcmp(slice->data + i * slice->stride,
+                        value,
+                        slice->esize
+                        ) == 0;
+    return count;
+}
+
+size_t
+darray_slice_find_bytes(const DArraySlice* slice, const void* value)
+{
+    _Alignas(SIMD_MAX_VECTOR) char pattern[SIMD_MAX_VECTOR];
+    const char* p = slice->data;
+    size_t n = slice->n, w = slice->esize;
+
+    if (!n)
+        return 0;
+    if (!darray_slice_contiguous(slice))
+        return find_strided(slice, value);
+    if (!vector_width(w))
+        return find_scalar(p, n, w, value);
+
+    make_pattern(pattern, value, w);
+    switch (darray_simd_level()) {
+#if defined(CLIB_SIMD_X86)
+        case DARRAY_SIMD_AVX512:
+            return find_AVX512(p, n, w, pattern);
+        case DARRAY_SIMD_AVX2:
+            return find_AVX2(p, n, w, pattern);
+        case DARRAY_SIMD_SSE2:
+            return find_SSE2(p, n, w, pattern);
+#endif
+        default:
+            return find_scalar(p, n, w, pattern);
+    }
+}
+
+size_t
+darray_find_bytes(const DArray_t array, const void* value)
+{
+    DArraySlice slice = darray_slice_all(array);
+    return darray_slice_find_bytes(&slice, value);
+}
+
+size_t
+darray_slice_count_bytes(const DArraySlice* slice, const void* value)
+{
+    _Alignas(SIMD_MAX_VECTOR) char pattern[SIMD_MAX_VECTOR];
+    const char* p = slice->data;
+    size_t n = slice->n, w = slice->esize;
+
+    if (!n)
+        return 0;
+    if (!darray_slice_contiguous(slice))
+        return count_strided(slice, value);
+    if (!vector_width(w))
+        return count_scalar(p, n, w, value);
+
+    make_pattern(pattern, value, w);
+    switch (darray_simd_level()) {
+#if defined(CLIB_SIMD_X86)
+        case DARRAY_SIMD_AVX512:
+            return count_AVX512(p, n, w, pattern);
+        case DARRAY_SIMD_AVX2:
+            return count_AVX2(p, n, w, pattern);
+        case DARRAY_SIMD_SSE2:
+            return count_SSE2(p, n, w, pattern);
+#endif
+        default:
+            return count_scalar(p, n, w, pattern);
+    }
+}
+
+size_t
+darray_count_bytes(const DArray_t array, const void* value)
+{
+    DArraySlice slice = darray_slice_all(array);
+    return darray_slice_count_bytes(&slice, value);
+}
+
+void
+darray_fill(DArray_t array, const void* value)
+{
+    DArray* ar = array;
+    _Alignas(SIMD_MAX_VECTOR) char pattern[SIMD_MAX_VECTOR];
+
+    if (!ar->size)
+        return;
+    if (!vector_width(ar->esize)) {
+        fill_scalar(ar->elems, ar->size, ar->esize, value);
+        return;
+    }
+
+    make_pattern(pattern, value, ar->esize);
+    switch (darray_simd_level()) {
+#if defined(CLIB_SIMD_X86)
+        case DARRAY_SIMD_AVX512:
+            fill_AVX512(ar->elems, ar->size, ar->esize, pattern);
+            break;
+        case DARRAY_SIMD_AVX2:
+            fill_AVX2(ar->elems, ar->size, ar->esize, pattern);
+            break;
+        case DARRAY_SIMD_SSE2:
+            fill_SSE2(ar->elems, ar->size, ar->esize, pattern);
+            break;
+#endif
+        default:
+            fill_scalar(ar->elems, ar->size, ar->esize, pattern);
+    }
+}
+
+int
+darray_equal(const DArray_t a, const DArray_t b)
+{
+    const DArray* x = a;
+    const DArray* y = b;
+
+    if (x->esize != y->esize || x->size != y->size)
+        return 0;
+    // memcmp of the C library already uses the widest vectors available.
+    return x->size == 0 || memcmp(x->elems, y->elems, x->size * x->esize) == 0;
+}
+
+#if defined(CLIB_SIMD_X86)
+#define DISPATCH(FUNC, S, ...)                                              \
+    switch (darray_simd_level()) {                                          \
+        case DARRAY_SIMD_AVX512:                                            \
+            FUNC##_##S##_AVX512(__VA_ARGS__);                               \
+            break;                                                          \
+        case DARRAY_SIMD_AVX2:                                              \
+            FUNC##_##S##_AVX2(__VA_ARGS__);                                 \
+            break;                                                          \
+        case DARRAY_SIMD_SSE2:                                              \
+            FUNC##_##S##_SSE2(__VA_ARGS__);                                 \
+            break;                                                          \
+        default:                                                            \
+            FUNC##_##S##_scalar(__VA_ARGS__);                               \
+    }
+#define DISPATCH_RET(RET, FUNC, S, ...)                                     \
+    switch (darray_simd_level()) {                                          \
+        case DARRAY_SIMD_AVX512:                                            \
+            RET = FUNC##_##S##_AVX512(__VA_ARGS__);                         \
+            break;                                                          \
+        case DARRAY_SIMD_AVX2:                                              \
+            RET = FUNC##_##S##_AVX2(__VA_ARGS__);                           \
+            break;                                                          \
+        case DARRAY_SIMD_SSE2:                                              \
+            RET = FUNC##_##S##_SSE2(__VA_ARGS__);                           \
+            break;                                                          \
+        default:                                                            \
+            RET = FUNC##_##S##_scalar(__VA_ARGS__);                         \
+    }
+#else
+#define DISPATCH(FUNC, S, ...) FUNC##_##S##_scalar(__VA_ARGS__);
+#define DISPATCH_RET(RET, FUNC, S, ...) RET = FUNC##_##S##_scalar(__VA_ARGS__);
+#endif
+
+/*
+ * Computes the minimum and maximum, either may be NULL.
+ */
+static int
+minmax(const DArray* ar, int type, void* min, void* max)
+{
+    union {
+        int32_t i32;
+        int64_t i64;
+        float   f32;
+        double  f64;
+    } lo, hi;
+
+    if (!ar->size)
+        return 1;
+
+    switch (type) {
+        case DARRAY_INT32:
+            assert(ar->esize == sizeof(int32_t));
+            DISPATCH(minmax, i32,
+                     (const int32_t*) ar->elems, ar->size, &lo.i32, &hi.i32)
+            break;
+        case DARRAY_INT64:
+            assert(ar->esize == sizeof(int64_t));
+            DISPATCH(minmax, i64,
+                     (const int64_t*) ar->elems, ar->size, &lo.i64, &hi.i64)
+            break;
+        case DARRAY_FLOAT:
+            assert(ar->esize == sizeof(float));
+            DISPATCH(minmax, f32,
+                     (const float*) ar->elems, ar->size, &lo.f32, &hi.f32)
+            break;
+        case DARRAY_DOUBLE:
+            assert(ar->esize == sizeof(double));
+            DISPATCH(minmax, f64,
+                     (const double*) ar->elems, ar->size, &lo.f64, &hi.f64)
+            break;
+        default:
+            assert(0 && "unknown DArrayNumType");
+            return 1;
+    }
+
+    if (min)
+        memcpy(min, &lo, ar->esize);
+    if (max)
+        memcpy(max, &hi, ar->esize);
+    return 0;
+}
+
+int
+darray_min(const DArray_t array, int type, void* min)
+{
+    return minmax(array, type, min, NULL);
+}
+
+int
+darray_max(const DArray_t array, int type, void* max)
+{
+    return minmax(array, type, NULL, max);
+}
+
+void
+darray_sum(const DArray_t array, int type, void* sum)
+{
+    const DArray* ar = array;
+    int64_t  isum = 0;
+    uint64_t usum = 0;
+    double   dsum = 0;
+
+    switch (type) {
+        case DARRAY_INT32:
+            assert(ar->esize == sizeof(int32_t));
+            DISPATCH_RET(isum, sum, i32, (const int32_t*) ar->elems, ar->size)
+            memcpy(sum, &isum, sizeof(isum));
+            break;
+        case DARRAY_INT64:
+            assert(ar->esize == sizeof(int64_t));
+            DISPATCH_RET(usum, sum, i64, (const int64_t*) ar->elems, ar->size)
+            isum = (int64_t) usum;
+            memcpy(sum, &isum, sizeof(isum));
+            break;
+        case DARRAY_FLOAT:
+            assert(ar->esize == sizeof(float));
+            DISPATCH_RET(dsum, sum, f32, (const float*) ar->elems, ar->size)
+            memcpy(sum, &dsum, sizeof(dsum));
+            break;
+        case DARRAY_DOUBLE:
+            assert(ar->esize == sizeof(double));
+            DISPATCH_RET(dsum, sum, f64, (const double*) ar->elems, ar->size)
+            memcpy(sum, &dsum, sizeof(dsum));
+            break;
+        default:
+            assert(0 && "unknown DArrayNumType");
+    }
+}
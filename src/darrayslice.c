@@ -0,0 +1,111 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "darray.h"
+#include "priv/darraypriv.h"
+#include <string.h>
+#include <assert.h>
+
+DArraySlice
+darray_slice(DArray_t array, size_t begin, size_t end)
+{
+    DArray* ar = array;
+    DArraySlice slice = {ar->elems + begin * ar->esize,
+                         ar->esize,
+                         end - begin,
+                         ar->esize
+                         };
+    assert(begin <= end && end <= ar->size);
+    return slice;
+}
+
+DArraySlice
+darray_slice_all(DArray_t array)
+{
+    DArray* ar = array;
+    return darray_slice(array, 0, ar->size);
+}
+
+void*
+darray_slice_get(const DArraySlice* slice, size_t n)
+{
+    assert(n < slice->n);
+    return slice->data + n * slice->stride;
+}
+
+DArraySlice
+darray_slice_sub(const DArraySlice* slice, size_t begin, size_t end)
+{
+    DArraySlice sub = {slice->data + begin * slice->stride,
+                       slice->esize,
+                       end - begin,
+                       slice->stride
+                       };
+    assert(begin <= end && end <= slice->n);
+    return sub;
+}
+
+DArraySlice
+darray_slice_strided(const DArraySlice* slice, size_t step)
+{
+    DArraySlice view = {slice->data,
+                        slice->esize,
+                        (slice->n + step - 1) / step,
+                        slice->stride * step
+                        };
+    assert(step > 0);
+    return view;
+}
+
+int
+darray_slice_contiguous(const DArraySlice* slice)
+{
+    return slice->stride == slice->esize || slice->n <= 1;
+}
+
+void
+darray_slice_copy(const DArraySlice* slice, void* dest)
+{
+    char* d = dest;
+    const char* s = slice->data;
+
+    if (!slice->n)
+        return;
+    if (darray_slice_contiguous(slice)) {
+        memcpy(d, s, slice->n * slice->esize);
+        return;
+    }
+    for (size_t i = 0; i < slice->n; i++, d += slice->esize, s += slice->stride)
+        memcpy(d, s, slice->esize);
+}
+
+DArraySliceIter
+darray_slice_iter(const DArraySlice* slice)
+{
+    DArraySliceIter iter = {*slice, 0};
+    return iter;
+}
+
+void*
+darray_slice_next(DArraySliceIter* iter)
+{
+    if (iter->next == iter->slice.n)
+        return NULL;
+    return iter->slice.data + iter->next++ * iter->slice.stride;
+}
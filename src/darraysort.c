@@ -0,0 +1,470 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Sorting and merging of DArray_t.
+ */
+
+#include "darray.h"
+#include "priv/darraypriv.h"
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Runs up to this length are sorted by insertion sort before merging.
+ */
+#define SORT_INSERTION_RUN 16
+
+/*
+ * The number of runs per thread that are sorted independently.
+ */
+#define SORT_RUNS_PER_THREAD 2
+
+/*
+ * The smallest number of elements that a task sorts or merges.
+ */
+#define SORT_MIN_TASK 4096
+
+typedef int (*qsort_compare_func)(const void*, const void*);
+
+static void
+insertion_sort(char* a, size_t n, size_t es, clib_compare_func cmp, char* tmp)
+{
+    for (size_t i = 1; i < n; i++) {
+        size_t j = i;
+        if (cmp(a + (i - 1) * es, a + i * es) <= 0)
+            continue;
+        memcpy(tmp, a + i * es, es);
+        while (j > 0 && cmp(a + (j - 1) * es, tmp) > 0)
+            j--;
+        memmove(a + (j + 1) * es, a + j * es, (i - j) * es);
+        memcpy(a + j * es, tmp, es);
+    }
+}
+
+/*
+ * Merges a and b into out, on ties the element of a goes first.
+ */
+static void
+merge(const char*       a,
+      size_t            na,
+      const char*       b,
+      size_t            nb,
+      char*             out,
+      size_t            es,
+      clib_compare_func cmp
+      )
+{
+    while (na && nb) {
+        if (cmp((void*) b, (void*) a) < 0) {
+            memcpy(out, b, es);
+            b += es;
+            nb--;
+        }
+        else {
+            memcpy(out, a, es);
+            a += es;
+            na--;
+        }
+        out += es;
+    }
+    memcpy(out, a, na * es);
+    memcpy(out + na * es, b, nb * es);
+}
+
+/*
+ * Returns how many of the first k elements of the merge of a and b come
+ * from a.
+ */
+static size_t
+co_rank(size_t            k,
+        const char*       a,
+        size_t            na,
+        const char*       b,
+        size_t            nb,
+        size_t            es,
+        clib_compare_func cmp
+        )
+{
+    size_t lo = k > nb ? k - nb : 0;
+    size_t hi = k < na ? k : na;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp((void*) (a + mid * es), (void*) (b + (k - mid - 1) * es)) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Stable bottom up merge sort of a, buf must hold n elements.
+ */
+static void
+stable_sort(char* a, char* buf, size_t n, size_t es, clib_compare_func cmp)
+{
+    char* from = a;
+    char* to = buf;
+
+    for (size_t lo = 0; lo < n; lo += SORT_INSERTION_RUN) {
+        size_t len = n - lo < SORT_INSERTION_RUN ? n - lo : SORT_INSERTION_RUN;
+        insertion_sort(a + lo * es, len, es, cmp, buf);
+    }
+
+    for (size_t w = SORT_INSERTION_RUN; w < n; w *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * w) {
+            size_t mid = lo + w < n ? lo + w : n;
+            size_t hi = lo + 2 * w < n ? lo + 2 * w : n;
+            merge(from + lo * es, mid - lo,
+                  from + mid * es, hi - mid,
+                  to + lo * es, es, cmp);
+        }
+        char* t = from;
+        from = to;
+        to = t;
+    }
+
+    if (from != a)
+        memcpy(a, from, n * es);
+}
+
+/**
+ * \brief The state shared by the tasks of darray_parallel_sort.
+ *
+ * \private
+ */
+struct SortJob {
+    char*               data;   ///< the elements of the array.
+    char*               tmp;    ///< a buffer for n elements.
+    size_t              es;     ///< element size.
+    size_t              n;      ///< number of elements.
+    clib_compare_func   cmp;
+    int                 stable;
+
+    size_t              run;    ///< the length of the initial runs.
+
+    const char*         from;   ///< the input of a merge pass.
+    char*               to;     ///< the output of a merge pass.
+    size_t              width;  ///< the length of the runs that are merged.
+    size_t              seg;    ///< the output length of a merge task.
+    size_t              tasks;  ///< the number of merge tasks per pair.
+};
+
+typedef struct SortJob SortJob;
+
+static void
+sort_runs(size_t begin, size_t end, void* arg)
+{
+    SortJob* job = arg;
+
+    for (size_t r = begin; r < end; r++) {
+        size_t lo = r * job->run;
+        size_t len = job->n - lo < job->run ? job->n - lo : job->run;
+        if (job->stable)
+            stable_sort(job->data + lo * job->es,
+                        job->tmp + lo * job->es,
+                        len,
+                        job->es,
+                        job->cmp
+                        );
+        else
+            qsort(job->data + lo * job->es,
+                  len,
+                  job->es,
+                  (qsort_compare_func) job->cmp
+                  );
+    }
+}
+
+/*
+ * Every pair of runs is merged by several tasks, each task produces the
+ * output of one segment, the co-rank tells which input it needs.
+ */
+static void
+merge_segments(size_t begin, size_t end, void* arg)
+{
+    SortJob* job = arg;
+    size_t es = job->es;
+
+    for (size_t t = begin; t < end; t++) {
+        size_t lo  = t / job->tasks * 2 * job->width;
+        size_t mid = lo + job->width < job->n ? lo + job->width : job->n;
+        size_t hi  = lo + 2 * job->width < job->n ? lo + 2 * job->width
+                                                   : job->n;
+        size_t k0  = t % job->tasks * job->seg;
+        size_t k1  = k0 + job->seg;
+        const char* a = job->from + lo * es;
+        const char* b = job->from + mid * es;
+
+        if (k0 >= hi - lo)
+            continue;
+        if (k1 > hi - lo)
+            k1 = hi - lo;
+
+        size_t i0 = co_rank(k0, a, mid - lo, b, hi - mid, es, job->cmp);
+        size_t i1 = co_rank(k1, a, mid - lo, b, hi - mid, es, job->cmp);
+        merge(a + i0 * es, i1 - i0,
+              b + (k0 - i0) * es, (k1 - i1) - (k0 - i0),
+              job->to + (lo + k0) * es, es, job->cmp);
+    }
+}
+
+static void
+copy_back(size_t begin, size_t end, void* arg)
+{
+    SortJob* job = arg;
+    memcpy(job->data + begin * job->es,
+           job->from + begin * job->es,
+           (end - begin) * job->es
+           );
+}
+
+/*
+ * Sorts n adjacent elements, the buffer is accounted to site.
+ */
+static int
+sort_contiguous(char*             data,
+                size_t            n,
+                size_t            es,
+                unsigned          site,
+                ThreadPool_t      pool,
+                clib_compare_func cmp,
+                int               stable
+                )
+{
+    SortJob job = {
+        .data = data, .es = es, .n = n, .cmp = cmp, .stable = stable
+    };
+    size_t nthreads, nruns;
+
+    if (n < 2)
+        return 0;
+
+    if (n < DARRAY_PARALLEL_THRESHOLD && !stable) {
+        qsort(data, n, es, (qsort_compare_func) cmp);
+        return 0;
+    }
+
+    job.tmp = clib_malloc(CLIB_MEM_DARRAY, site, n * es);
+    if (!job.tmp)
+        return 1;
+
+    if (n < DARRAY_PARALLEL_THRESHOLD) {
+        stable_sort(data, job.tmp, n, es, cmp);
+        clib_free(CLIB_MEM_DARRAY, site, job.tmp, n * es);
+        return 0;
+    }
+
+    pool = pool ? pool : threadpool_default();
+    nthreads = threadpool_size(pool) + 1;
+
+    job.run = (job.n + nthreads * SORT_RUNS_PER_THREAD - 1) /
+              (nthreads * SORT_RUNS_PER_THREAD);
+    if (job.run < SORT_MIN_TASK)
+        job.run = SORT_MIN_TASK;
+    nruns = (job.n + job.run - 1) / job.run;
+    threadpool_parallel_for(pool, 0, nruns, 1, sort_runs, &job);
+
+    // the last passes merge few pairs, so split the output of a pair.
+    job.seg = (job.n + nthreads * 4 - 1) / (nthreads * 4);
+    if (job.seg < SORT_MIN_TASK)
+        job.seg = SORT_MIN_TASK;
+    job.from = job.data;
+    job.to = job.tmp;
+    for (job.width = job.run; job.width < job.n; job.width *= 2) {
+        size_t npairs = (job.n + 2 * job.width - 1) / (2 * job.width);
+        job.tasks = (2 * job.width + job.seg - 1) / job.seg;
+        threadpool_parallel_for(pool,
+                                0,
+                                npairs * job.tasks,
+                                1,
+                                merge_segments,
+                                &job
+                                );
+        char* t = (char*) job.from;
+        job.from = job.to;
+        job.to = t;
+    }
+
+    if (job.from != job.data)
+        threadpool_parallel_for(pool, 0, job.n, job.seg, copy_back, &job);
+
+    clib_free(CLIB_MEM_DARRAY, site, job.tmp, n * es);
+    return 0;
+}
+
+int
+darray_parallel_sort(DArray_t          array,
+                     ThreadPool_t      pool,
+                     clib_compare_func cmp,
+                     int               stable
+                     )
+{
+    DArray* ar = array;
+    return sort_contiguous(ar->elems,
+                           ar->size,
+                           ar->esize,
+                           ar->site,
+                           pool,
+                           cmp,
+                           stable
+                           );
+}
+
+int
+darray_slice_sort(const DArraySlice* slice,
+                  ThreadPool_t       pool,
+                  clib_compare_func  cmp,
+                  int                stable
+                  )
+{
+    unsigned site = clib_mem_current_site();
+    size_t bytes = slice->n * slice->esize;
+    char* packed;
+    int ret;
+
+    if (darray_slice_contiguous(slice))
+        return sort_contiguous(slice->data,
+                               slice->n,
+                               slice->esize,
+                               site,
+                               pool,
+                               cmp,
+                               stable
+                               );
+
+    packed = clib_malloc(CLIB_MEM_DARRAY, site, bytes);
+    if (!packed)
+        return 1;
+    darray_slice_copy(slice, packed);
+    ret = sort_contiguous(packed, slice->n, slice->esize, site, pool, cmp, stable);
+    if (!ret) {
+        for (size_t i = 0; i < slice->n; i++)
+            memcpy(slice->data + i * slice->stride,
+                   packed + i * slice->esize,
+                   slice->esize
+                   );
+    }
+    clib_free(CLIB_MEM_DARRAY, site, packed, bytes);
+    return ret;
+}
+
+
+/*
+ * Whether the head of run a is selected before the head of run b, an
+ * exhausted run loses from everything.
+ */
+static inline int
+kway_beats(DArray** runs,
+           size_t* pos,
+           size_t a,
+           size_t b,
+           clib_compare_func cmp
+           )
+{
+    if (pos[b] == runs[b]->size)
+        return 1;
+    if (pos[a] == runs[a]->size)
+        return 0;
+    int c = cmp(runs[a]->elems + pos[a] * runs[a]->esize,
+                runs[b]->elems + pos[b] * runs[b]->esize
+                );
+    return c < 0 || (c == 0 && a < b);
+}
+
+int
+darray_kway_merge(DArray_t          dest,
+                  DArray_t*         runs,
+                  size_t            k,
+                  clib_compare_func cmp
+                  )
+{
+    DArray* d = dest;
+    DArray** r = (DArray**) runs;
+    size_t total = 0;
+    size_t bytes = 4 * k * sizeof(size_t);
+    size_t *pos, *tree, *win;
+
+    for (size_t i = 0; i < k; i++) {
+        assert(r[i]->esize == d->esize && r[i] != d);
+        total += r[i]->size;
+    }
+
+    // allocate before dest is erased, so it is unchanged on failure.
+    if (d->cap < total && darray_reserve_capacity(d, total))
+        return 1;
+    // pos[k] the head of every run, tree[k] the losers, win[2k] scratch.
+    pos = k ? clib_malloc(CLIB_MEM_DARRAY, d->site, bytes) : NULL;
+    if (k && !pos)
+        return 1;
+
+    if (d->ff) {
+        for (size_t i = 0; i < d->size; i++)
+            d->ff(d->elems + i * d->esize);
+    }
+    d->size = 0;
+    if (k == 0)
+        return 0;
+
+    tree = pos + k;
+    win = tree + k;
+    memset(pos, 0, k * sizeof(size_t));
+
+    // The leaves are the nodes k .. 2k-1, the internal node n keeps the
+    // loser of the match between its children, tree[0] the overall winner.
+    for (size_t i = 0; i < k; i++)
+        win[k + i] = i;
+    for (size_t n = k - 1; n >= 1; n--) {
+        size_t a = win[2 * n], b = win[2 * n + 1];
+        if (kway_beats(r, pos, a, b, cmp)) {
+            win[n] = a;
+            tree[n] = b;
+        }
+        else {
+            win[n] = b;
+            tree[n] = a;
+        }
+    }
+    tree[0] = k > 1 ? win[1] : 0;
+
+    for (size_t i = 0; i < total; i++) {
+        size_t w = tree[0];
+        d->cf(d->elems + i * d->esize,
+              r[w]->elems + pos[w] * r[w]->esize,
+              d->esize
+              );
+        pos[w]++;
+
+        // replay the matches on the path of the winner.
+        for (size_t n = (w + k) / 2; n >= 1; n /= 2) {
+            if (kway_beats(r, pos, tree[n], w, cmp)) {
+                size_t t = tree[n];
+                tree[n] = w;
+                w = t;
+            }
+        }
+        tree[0] = w;
+        d->size++;
+    }
+
+    clib_free(CLIB_MEM_DARRAY, d->site, pos, bytes);
+    return 0;
+}
@@ -0,0 +1,378 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "deque.h"
+#include "priv/memtracepriv.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * \brief the private implementation of a deque.
+ *
+ * The elements live in elems[head], elems[(head + 1) & mask], ...
+ *
+ * \private
+ */
+struct Deque {
+    size_t  esize;      ///< Element size.
+    size_t  head;       ///< index of the first element.
+    size_t  size;       ///< number of elements contained.
+    size_t  cap;        ///< capacity, zero or a power of two.
+    char*   elems;      ///< pointer to the elements.
+
+    clib_free_func ff;  ///< called when an element is erased.
+    clib_copy_func cf;  ///< called when an element is copied in or out.
+    unsigned site;      ///< creation site for memory accounting.
+};
+
+typedef struct Deque Deque;
+
+static inline size_t
+slot(const Deque* dq, size_t n)
+{
+    return (dq->head + n) & (dq->cap - 1);
+}
+
+static inline void*
+slot_ptr(const Deque* dq, size_t n)
+{
+    return dq->elems + slot(dq, n) * dq->esize;
+}
+
+/*
+ * n must be at most (SIZE_MAX >> 1) + 1, the largest power of two.
+ */
+static size_t
+round_pow2(size_t n)
+{
+    size_t p = 1;
+    assert(n <= (SIZE_MAX >> 1) + 1);
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+static int
+deque_grow(Deque* dq, size_t min_cap)
+{
+    if (min_cap < dq->size)     // size + n overflowed.
+        return DEQUE_OUT_OF_MEM;
+    if (min_cap <= dq->cap)
+        return DEQUE_OK;
+    return deque_reserve_capacity(dq, min_cap);
+}
+
+/*
+ * Copies n elements from src into the ring starting at logical index i,
+ * memcpy is done span wise, other copy functions per element.
+ */
+static void
+copy_in(Deque* dq, size_t i, const char* src, size_t n)
+{
+    if (dq->cf == memcpy) {
+        size_t first = dq->cap - slot(dq, i);
+        if (first > n)
+            first = n;
+        memcpy(slot_ptr(dq, i), src, first * dq->esize);
+        memcpy(slot_ptr(dq, i + first),
+               src + first * dq->esize,
+               (n - first) * dq->esize
+               );
+    }
+    else {
+        for (size_t k = 0; k < n; k++)
+            dq->cf(slot_ptr(dq, i + k), src + k * dq->esize, dq->esize);
+    }
+}
+
+Deque_t
+deque_create(size_t element_size, clib_free_func ff, clib_copy_func cf)
+{
+    unsigned site = clib_mem_current_site();
+    Deque* ret = clib_calloc(CLIB_MEM_DEQUE, site, 1, sizeof(Deque));
+    if (ret) {
+        ret->site   = site;
+        ret->esize  = element_size;
+        ret->ff     = ff;
+        ret->cf     = cf ? cf : memcpy;
+    }
+    return ret;
+}
+
+Deque_t
+deque_create_capacity(size_t         element_size,
+                      clib_free_func ff,
+                      clib_copy_func cf,
+                      size_t         capacity
+                      )
+{
+    Deque* ret = deque_create(element_size, ff, cf);
+    if (ret && deque_reserve_capacity(ret, capacity) != DEQUE_OK) {
+        deque_destroy(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+void
+deque_destroy(Deque_t deque)
+{
+    Deque* dq = deque;
+    if (dq->ff) {
+        for (size_t i = 0; i < dq->size; i++)
+            dq->ff(slot_ptr(dq, i));
+    }
+    clib_free(CLIB_MEM_DEQUE, dq->site, dq->elems, dq->esize * dq->cap);
+    clib_free(CLIB_MEM_DEQUE, dq->site, dq, sizeof(Deque));
+}
+
+size_t
+deque_size(const Deque_t deque)
+{
+    const Deque* dq = deque;
+    return dq->size;
+}
+
+size_t
+deque_capacity(const Deque_t deque)
+{
+    const Deque* dq = deque;
+    return dq->cap;
+}
+
+int
+deque_reserve_capacity(Deque_t deque, size_t capacity)
+{
+    Deque* dq = deque;
+    size_t old_cap = dq->cap;
+
+    if (capacity <= old_cap)
+        return DEQUE_OK;
+    if (capacity > (SIZE_MAX >> 1) + 1)
+        return DEQUE_OUT_OF_MEM;
+    size_t new_cap = round_pow2(capacity);
+    if (dq->esize && new_cap > SIZE_MAX / dq->esize)
+        return DEQUE_OUT_OF_MEM;
+
+    char* elems = clib_realloc(CLIB_MEM_DEQUE,
+                               dq->site,
+                               dq->elems,
+                               dq->esize * old_cap,
+                               dq->esize * new_cap
+                               );
+    if (!elems)
+        return DEQUE_OUT_OF_MEM;
+    dq->elems = elems;
+    dq->cap   = new_cap;
+
+    // Unwrap: the part that wrapped to the start of the old buffer
+    // fits behind the old end, since new_cap >= 2 * old_cap.
+    if (dq->head + dq->size > old_cap) {
+        size_t wrapped = dq->head + dq->size - old_cap;
+        memcpy(elems + old_cap * dq->esize, elems, wrapped * dq->esize);
+    }
+    return DEQUE_OK;
+}
+
+void*
+deque_get(Deque_t deque, size_t n)
+{
+    Deque* dq = deque;
+    assert(n < dq->size);
+    return slot_ptr(dq, n);
+}
+
+void*
+deque_front(Deque_t deque)
+{
+    Deque* dq = deque;
+    return dq->size ? slot_ptr(dq, 0) : NULL;
+}
+
+void*
+deque_back(Deque_t deque)
+{
+    Deque* dq = deque;
+    return dq->size ? slot_ptr(dq, dq->size - 1) : NULL;
+}
+
+int
+deque_push_back(Deque_t deque, const void* item)
+{
+    Deque* dq = deque;
+    if (dq->size == dq->cap && deque_grow(dq, dq->size + 1))
+        return DEQUE_OUT_OF_MEM;
+
+    dq->cf(slot_ptr(dq, dq->size), item, dq->esize);
+    dq->size++;
+    return DEQUE_OK;
+}
+
+int
+deque_push_front(Deque_t deque, const void* item)
+{
+    Deque* dq = deque;
+    if (dq->size == dq->cap && deque_grow(dq, dq->size + 1))
+        return DEQUE_OUT_OF_MEM;
+
+    dq->head = (dq->head - 1) & (dq->cap - 1);
+    dq->cf(slot_ptr(dq, 0), item, dq->esize);
+    dq->size++;
+    return DEQUE_OK;
+}
+
+int
+deque_pop_back(Deque_t deque, void* item)
+{
+    Deque* dq = deque;
+    if (!dq->size)
+        return DEQUE_EMPTY;
+
+    void* elem = slot_ptr(dq, dq->size - 1);
+    if (item)
+        memcpy(item, elem, dq->esize);  // the element moves to the caller.
+    else if (dq->ff)
+        dq->ff(elem);
+    dq->size--;
+    return DEQUE_OK;
+}
+
+int
+deque_pop_front(Deque_t deque, void* item)
+{
+    Deque* dq = deque;
+    if (!dq->size)
+        return DEQUE_EMPTY;
+
+    void* elem = slot_ptr(dq, 0);
+    if (item)
+        memcpy(item, elem, dq->esize);  // the element moves to the caller.
+    else if (dq->ff)
+        dq->ff(elem);
+    dq->head = slot(dq, 1);
+    dq->size--;
+    return DEQUE_OK;
+}
+
+int
+deque_push_back_n(Deque_t deque, const void* src, size_t n)
+{
+    Deque* dq = deque;
+    if (!n)
+        return DEQUE_OK;
+    if (deque_grow(dq, dq->size + n))
+        return DEQUE_OUT_OF_MEM;
+
+    copy_in(dq, dq->size, src, n);
+    dq->size += n;
+    return DEQUE_OK;
+}
+
+size_t
+deque_pop_front_n(Deque_t deque, void* dest, size_t n)
+{
+    Deque* dq = deque;
+    DequeSpan spans[2];
+    char* out = dest;
+    size_t done = 0;
+
+    if (n > dq->size)
+        n = dq->size;
+
+    deque_read_spans(dq, spans);
+    for (size_t s = 0; s < 2 && done < n; s++) {
+        size_t m = spans[s].n < n - done ? spans[s].n : n - done;
+        memcpy(out, spans[s].data, m * dq->esize);
+        out  += m * dq->esize;
+        done += m;
+    }
+
+    // ownership has moved to dest.
+    dq->head = slot(dq, n);
+    dq->size -= n;
+    return n;
+}
+
+size_t
+deque_read_spans(Deque_t deque, DequeSpan spans[2])
+{
+    Deque* dq = deque;
+    size_t first = 0;
+
+    if (dq->size) {
+        first = dq->cap - dq->head;
+        if (first > dq->size)
+            first = dq->size;
+    }
+
+    spans[0].data = dq->size ? slot_ptr(dq, 0) : NULL;
+    spans[0].n    = first;
+    spans[1].data = dq->elems;
+    spans[1].n    = dq->size - first;
+
+    return (spans[0].n > 0) + (spans[1].n > 0);
+}
+
+void
+deque_consume(Deque_t deque, size_t n)
+{
+    Deque* dq = deque;
+    assert(n <= dq->size);
+
+    if (dq->ff) {
+        for (size_t i = 0; i < n; i++)
+            dq->ff(slot_ptr(dq, i));
+    }
+    dq->head = slot(dq, n);
+    dq->size -= n;
+}
+
+size_t
+deque_write_spans(Deque_t deque, size_t n, DequeSpan spans[2])
+{
+    Deque* dq = deque;
+    size_t first;
+
+    spans[0].data = spans[1].data = NULL;
+    spans[0].n = spans[1].n = 0;
+    if (!n)
+        return 0;
+    if (deque_grow(dq, dq->size + n))
+        return 0;
+
+    first = dq->cap - slot(dq, dq->size);
+    if (first > n)
+        first = n;
+
+    spans[0].data = slot_ptr(dq, dq->size);
+    spans[0].n    = first;
+    spans[1].data = dq->elems;
+    spans[1].n    = n - first;
+
+    return (spans[0].n > 0) + (spans[1].n > 0);
+}
+
+void
+deque_commit(Deque_t deque, size_t n)
+{
+    Deque* dq = deque;
+    assert(dq->size + n <= dq->cap);
+    dq->size += n;
+}
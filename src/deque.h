@@ -0,0 +1,212 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DEQUE_H
+#define DEQUE_H
+
+#include <stdlib.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A double ended queue stored in a contiguous ring buffer.
+ *
+ * The capacity is always a power of two, so pushing and popping at
+ * either end is O(1).
+ */
+typedef void* Deque_t;
+
+enum DequeResult {
+    DEQUE_OK = 0,
+    DEQUE_OUT_OF_MEM,
+    DEQUE_EMPTY
+};
+
+/**
+ * \brief A contiguous run of elements inside the ring buffer.
+ */
+typedef struct DequeSpan {
+    void*   data;   ///< pointer to the first element of the span.
+    size_t  n;      ///< number of elements in the span.
+} DequeSpan;
+
+/**
+ * create an empty deque.
+ *
+ * @param element_size [in] the sizeof() a single element.
+ * @param ff [in] the free func will be called when individual elements
+ *                are erased from the deque, may be NULL.
+ * @param cf [in] the function used to copy an element into the deque.
+ *                if none is specified memcpy will be used.
+ */
+Deque_t deque_create(size_t element_size, clib_free_func ff, clib_copy_func cf);
+
+/**
+ * create an empty deque with room for at least capacity elements.
+ *
+ * The capacity is rounded up to a power of two.
+ */
+Deque_t
+deque_create_capacity(size_t         element_size,
+                      clib_free_func ff,
+                      clib_copy_func cf,
+                      size_t         capacity
+                      );
+
+/**
+ * Destroys the deque, ff is called on all remaining elements.
+ */
+void deque_destroy(Deque_t deque);
+
+/**
+ * Returns the number of elements in the deque.
+ */
+size_t deque_size(const Deque_t deque);
+
+/**
+ * Returns the number of elements that fit without growing.
+ */
+size_t deque_capacity(const Deque_t deque);
+
+/**
+ * Make sure the deque can hold at least capacity elements.
+ *
+ * When the elements wrap around the end of the buffer, the wrapped part
+ * is moved behind the old end with one copy.
+ *
+ * @return DEQUE_OK or DEQUE_OUT_OF_MEM
+ */
+int deque_reserve_capacity(Deque_t deque, size_t capacity);
+
+/**
+ * Get a pointer to the n-th element counted from the front.
+ *
+ * @param n [in] should be smaller than deque_size().
+ */
+void* deque_get(Deque_t deque, size_t n);
+
+/**
+ * Returns a pointer to the first element or NULL when empty.
+ */
+void* deque_front(Deque_t deque);
+
+/**
+ * Returns a pointer to the last element or NULL when empty.
+ */
+void* deque_back(Deque_t deque);
+
+/**
+ * Copy an item to the back of the deque.
+ *
+ * @return DEQUE_OK or DEQUE_OUT_OF_MEM
+ */
+int deque_push_back(Deque_t deque, const void* item);
+
+/**
+ * Copy an item to the front of the deque.
+ *
+ * @return DEQUE_OK or DEQUE_OUT_OF_MEM
+ */
+int deque_push_front(Deque_t deque, const void* item);
+
+/**
+ * Removes the last element of the deque.
+ *
+ * @param item [out] When not NULL, the bytes of the element are moved to
+ *                   item and the caller owns it, the copy func isn't
+ *                   used. When NULL, the element is freed with ff.
+ *
+ * @return DEQUE_OK or DEQUE_EMPTY
+ */
+int deque_pop_back(Deque_t deque, void* item);
+
+/**
+ * Removes the first element of the deque.
+ *
+ * @param item [out] When not NULL, the bytes of the element are moved to
+ *                   item and the caller owns it, the copy func isn't
+ *                   used. When NULL, the element is freed with ff.
+ *
+ * @return DEQUE_OK or DEQUE_EMPTY
+ */
+int deque_pop_front(Deque_t deque, void* item);
+
+/**
+ * Copy n elements from src to the back of the deque.
+ *
+ * @return DEQUE_OK or DEQUE_OUT_OF_MEM, then nothing is added.
+ */
+int deque_push_back_n(Deque_t deque, const void* src, size_t n);
+
+/**
+ * Move up to n elements from the front of the deque to dest.
+ *
+ * The bytes of the elements are moved as by deque_pop_front(), the
+ * caller owns the elements in dest.
+ *
+ * @return the number of elements moved.
+ */
+size_t deque_pop_front_n(Deque_t deque, void* dest, size_t n);
+
+/**
+ * Get the elements of the deque in at most two contiguous spans.
+ *
+ * The spans stay valid until the deque is modified.
+ *
+ * @param spans [out] spans[0] starts at the front, spans[1] continues it.
+ *
+ * @return the number of spans that are not empty.
+ */
+size_t deque_read_spans(Deque_t deque, DequeSpan spans[2]);
+
+/**
+ * Remove n elements from the front, for instance after they are read
+ * through deque_read_spans. ff is called on the removed elements.
+ *
+ * @param n [in] should not be larger than deque_size().
+ */
+void deque_consume(Deque_t deque, size_t n);
+
+/**
+ * Get room for n elements at the back of the deque.
+ *
+ * Write the elements into the spans and publish them with
+ * deque_commit(). The deque grows when necessary.
+ *
+ * @param spans [out] spans[0] is directly behind the back, spans[1]
+ *                    continues it.
+ *
+ * @return the number of spans that are not empty or 0 when the deque
+ *         cannot grow.
+ */
+size_t deque_write_spans(Deque_t deque, size_t n, DequeSpan spans[2]);
+
+/**
+ * Add n elements that were written through deque_write_spans to the back.
+ */
+void deque_commit(Deque_t deque, size_t n);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef DEQUE_H*/
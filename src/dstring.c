@@ -0,0 +1,302 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "dstring.h"
+#include "priv/memtracepriv.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * A small string stores its bytes and the '\0' at the start of u.small,
+ * a full one has its terminator at u.small[DSTRING_SMALL]. The last byte
+ * holds DSTRING_SMALL - size. A heap string sets the high bit of that
+ * byte, it is part of heap.capacity: the most significant byte on little
+ * endian platforms and the least significant on big endian ones, where
+ * the capacity is shifted out of its way.
+ *
+ * The buffers aren't attributed to a creation site, a DString doesn't
+ * have room to remember it.
+ */
+
+#define LAST (sizeof(DString) - 1)
+#define HEAP_BIT 0x80
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CAP_SHIFT 8
+#define CAP_FLAG ((size_t) HEAP_BIT)
+#else
+#define CAP_SHIFT 0
+#define CAP_FLAG ((size_t) HEAP_BIT << (8 * (sizeof(size_t) - 1)))
+#endif
+
+#define MAX_CAPACITY ((SIZE_MAX >> 8) - 1)
+#define DSTRING_SITE 0
+
+static inline int
+is_heap(const DString* s)
+{
+    return (unsigned char) s->u.small[LAST] & HEAP_BIT;
+}
+
+static inline size_t
+heap_capacity(const DString* s)
+{
+    return (s->u.heap.capacity & ~CAP_FLAG) >> CAP_SHIFT;
+}
+
+static inline char*
+data_of(const DString* s)
+{
+    return is_heap(s) ? s->u.heap.data : (char*) s->u.small;
+}
+
+static inline void
+set_size(DString* s, size_t n)
+{
+    if (is_heap(s)) {
+        s->u.heap.size = n;
+        s->u.heap.data[n] = '\0';
+    }
+    else {
+        s->u.small[n] = '\0';
+        s->u.small[LAST] = (char) (DSTRING_SMALL - n);
+    }
+}
+
+/*
+ * Grows the buffer to hold at least needed bytes and a '\0'.
+ */
+static int
+grow(DString* s, size_t needed)
+{
+    size_t capacity = dstring_capacity(s);
+    if (needed <= capacity)
+        return 0;
+    if (needed > MAX_CAPACITY)
+        return 1;
+
+    if (capacity * 2 > needed && capacity * 2 <= MAX_CAPACITY)
+        needed = capacity * 2;
+
+    char* data;
+    if (is_heap(s)) {
+        data = clib_realloc(
+                CLIB_MEM_DSTRING,
+                DSTRING_SITE,
+                s->u.heap.data,
+                capacity + 1,
+                needed + 1
+                );
+        if (!data)
+            return 1;
+    }
+    else {
+        size_t size = dstring_size(s);
+        data = clib_malloc(CLIB_MEM_DSTRING, DSTRING_SITE, needed + 1);
+        if (!data)
+            return 1;
+        memcpy(data, s->u.small, size + 1);
+        s->u.heap.size = size;
+    }
+    s->u.heap.data = data;
+    s->u.heap.capacity = (needed << CAP_SHIFT) | CAP_FLAG;
+    assert(is_heap(s));
+    return 0;
+}
+
+void dstring_init(DString* s)
+{
+    s->u.small[0] = '\0';
+    s->u.small[LAST] = (char) DSTRING_SMALL;
+}
+
+void dstring_destroy(DString* s)
+{
+    if (is_heap(s))
+        clib_free(
+                CLIB_MEM_DSTRING,
+                DSTRING_SITE,
+                s->u.heap.data,
+                heap_capacity(s) + 1
+                );
+    dstring_init(s);
+}
+
+size_t dstring_size(const DString* s)
+{
+    if (is_heap(s))
+        return s->u.heap.size;
+    return DSTRING_SMALL - (size_t) s->u.small[LAST];
+}
+
+size_t dstring_capacity(const DString* s)
+{
+    return is_heap(s) ? heap_capacity(s) : DSTRING_SMALL;
+}
+
+const char* dstring_cstr(const DString* s)
+{
+    return data_of(s);
+}
+
+char* dstring_data(DString* s)
+{
+    return data_of(s);
+}
+
+int dstring_reserve(DString* s, size_t capacity)
+{
+    return grow(s, capacity);
+}
+
+int dstring_append(DString* s, const char* str, size_t n)
+{
+    size_t size = dstring_size(s);
+    if (n > MAX_CAPACITY - size)
+        return 1;
+
+    const char* data = data_of(s);
+    if (str >= data && str <= data + size) {
+        // str points into s, it moves along with the buffer.
+        size_t offset = (size_t) (str - data);
+        if (grow(s, size + n))
+            return 1;
+        str = data_of(s) + offset;
+    }
+    else if (grow(s, size + n)) {
+        return 1;
+    }
+
+    memcpy(data_of(s) + size, str, n);
+    set_size(s, size + n);
+    return 0;
+}
+
+int dstring_append_cstr(DString* s, const char* str)
+{
+    return dstring_append(s, str, strlen(str));
+}
+
+int dstring_append_char(DString* s, char c)
+{
+    size_t size = dstring_size(s);
+    if (grow(s, size + 1))
+        return 1;
+    data_of(s)[size] = c;
+    set_size(s, size + 1);
+    return 0;
+}
+
+int dstring_append_view(DString* s, DStringView view)
+{
+    return dstring_append(s, view.data, view.size);
+}
+
+int dstring_appendf(DString* s, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int ret = dstring_vappendf(s, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int dstring_vappendf(DString* s, const char* fmt, va_list args)
+{
+    size_t size = dstring_size(s);
+    size_t room = dstring_capacity(s) - size;
+    va_list copy;
+
+    // try to print into the room that is left, most often it fits.
+    va_copy(copy, args);
+    int n = vsnprintf(data_of(s) + size, room + 1, fmt, copy);
+    va_end(copy);
+    if (n < 0)
+        goto fail;
+
+    if ((size_t) n > room) {
+        if (grow(s, size + (size_t) n))
+            goto fail;
+        vsnprintf(data_of(s) + size, (size_t) n + 1, fmt, args);
+    }
+    set_size(s, size + (size_t) n);
+    return 0;
+
+fail:
+    set_size(s, size);
+    return 1;
+}
+
+void dstring_truncate(DString* s, size_t n)
+{
+    if (n < dstring_size(s))
+        set_size(s, n);
+}
+
+void dstring_clear(DString* s)
+{
+    set_size(s, 0);
+}
+
+DStringView dstring_view(const DString* s)
+{
+    DStringView view = {data_of(s), dstring_size(s)};
+    return view;
+}
+
+DStringView dstring_view_cstr(const char* str)
+{
+    DStringView view = {str, strlen(str)};
+    return view;
+}
+
+DStringView dstring_view_sub(DStringView view, size_t pos, size_t n)
+{
+    if (pos > view.size)
+        pos = view.size;
+    if (n > view.size - pos)
+        n = view.size - pos;
+    DStringView sub = {view.data + pos, n};
+    return sub;
+}
+
+int dstring_view_equal(DStringView a, DStringView b)
+{
+    return a.size == b.size &&
+           (a.size == 0 || memcmp(a.data, b.data, a.size) == 0);
+}
+
+size_t dstring_view_find(DStringView view, DStringView needle, size_t pos)
+{
+    if (pos > view.size || needle.size > view.size - pos)
+        return DSTRING_NPOS;
+    if (needle.size == 0)
+        return pos;
+
+    const char* p = view.data + pos;
+    const char* end = view.data + view.size - needle.size + 1;
+    while ((p = memchr(p, needle.data[0], (size_t) (end - p))) != NULL) {
+        if (memcmp(p, needle.data, needle.size) == 0)
+            return (size_t) (p - view.data);
+        p++;
+    }
+    return DSTRING_NPOS;
+}
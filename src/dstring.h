@@ -0,0 +1,193 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DSTRING_H
+#define DSTRING_H
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A growable string of bytes that is always terminated by a '\0'.
+ *
+ * A DString is a value, it lives on the stack or inside another struct.
+ * Strings up to DSTRING_SMALL bytes (22 on 64 bit platforms) are stored
+ * inside the DString itself, longer strings in a buffer on the heap that
+ * grows geometrically. The members are private, use the functions.
+ *
+ * A DString must be initialized with dstring_init() and released with
+ * dstring_destroy().
+ */
+typedef struct DString {
+    union {
+        struct {
+            char*   data;
+            size_t  size;
+            size_t  capacity;   ///< encoded with the heap flag.
+        } heap;
+        char small[3 * sizeof(size_t)];
+    } u;
+} DString;
+
+/**
+ * The number of bytes stored without a heap allocation.
+ */
+#define DSTRING_SMALL (sizeof(DString) - 2)
+
+/**
+ * A view on a range of bytes, it doesn't own them and is not terminated.
+ *
+ * A view of a DString is invalidated when the string is modified.
+ */
+typedef struct DStringView {
+    const char* data;
+    size_t      size;
+} DStringView;
+
+/**
+ * Returned by dstring_view_find when nothing is found.
+ */
+#define DSTRING_NPOS SIZE_MAX
+
+/**
+ * Initialize an empty string, this doesn't allocate.
+ */
+void dstring_init(DString* s);
+
+/**
+ * Frees the buffer of the string, it is empty afterwards.
+ */
+void dstring_destroy(DString* s);
+
+/**
+ * Returns the length of the string, not counting the '\0'.
+ */
+size_t dstring_size(const DString* s);
+
+/**
+ * Returns the number of bytes that can be stored without reallocating.
+ */
+size_t dstring_capacity(const DString* s);
+
+/**
+ * Returns the bytes of the string followed by a '\0'. The pointer is
+ * invalidated when the string grows.
+ */
+const char* dstring_cstr(const DString* s);
+
+/**
+ * Returns the bytes of the string, they may be modified in place.
+ */
+char* dstring_data(DString* s);
+
+/**
+ * Make room for a string of capacity bytes.
+ *
+ * @return 0 or !0 when out of memory.
+ */
+int dstring_reserve(DString* s, size_t capacity);
+
+/**
+ * Appends n bytes of str, str may point into s.
+ *
+ * @return 0 or !0 when out of memory, then s is unchanged.
+ */
+int dstring_append(DString* s, const char* str, size_t n);
+
+/**
+ * Appends a '\0' terminated string.
+ */
+int dstring_append_cstr(DString* s, const char* str);
+
+/**
+ * Appends one byte.
+ */
+int dstring_append_char(DString* s, char c);
+
+/**
+ * Appends the bytes of a view.
+ */
+int dstring_append_view(DString* s, DStringView view);
+
+/**
+ * Appends text formatted as by printf, it is printed directly into the
+ * buffer of the string.
+ *
+ * @return 0 or !0 when out of memory or on an encoding error, then s is
+ *         unchanged.
+ */
+int dstring_appendf(DString* s, const char* fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+/**
+ * Like dstring_appendf with a va_list.
+ */
+int dstring_vappendf(DString* s, const char* fmt, va_list args);
+
+/**
+ * Shortens the string to n bytes, nothing happens when it is shorter.
+ * The capacity is kept.
+ */
+void dstring_truncate(DString* s, size_t n);
+
+/**
+ * Empties the string, the capacity is kept.
+ */
+void dstring_clear(DString* s);
+
+/**
+ * Returns a view of the whole string.
+ */
+DStringView dstring_view(const DString* s);
+
+/**
+ * Returns a view of a '\0' terminated string.
+ */
+DStringView dstring_view_cstr(const char* str);
+
+/**
+ * Returns a view of at most n bytes from position pos of view. pos and n
+ * are clamped to the view.
+ */
+DStringView dstring_view_sub(DStringView view, size_t pos, size_t n);
+
+/**
+ * Returns !0 when the views contain the same bytes.
+ */
+int dstring_view_equal(DStringView a, DStringView b);
+
+/**
+ * Returns the position of the first occurence of needle in view at or
+ * after pos, or DSTRING_NPOS.
+ */
+size_t dstring_view_find(DStringView view, DStringView needle, size_t pos);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef DSTRING_H*/
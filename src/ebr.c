@@ -0,0 +1,327 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ebr.h"
+#include "priv/memtracepriv.h"
+#include "priv/cachelinepriv.h"
+#include "priv/retiredpriv.h"
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * The number of retired nodes after which a thread tries to advance the
+ * epoch and reclaim.
+ */
+#define EBR_BATCH 64
+
+/*
+ * Nodes retired in epoch e are freed once the global epoch is e + 2,
+ * so a thread needs a list for three epochs.
+ */
+#define EBR_NLISTS 3
+
+/**
+ * \brief The registration of a thread.
+ *
+ * state is written by the thread and read by the threads that advance
+ * the epoch, it has a cache line of its own. Registrations are reused
+ * after ebr_unregister() and freed with the domain, so they can be
+ * scanned without a lock.
+ *
+ * \private
+ */
+struct EbrThread {
+    _Alignas(CLIB_CACHE_LINE) atomic_uint state; ///< epoch << 1 | active
+    _Alignas(CLIB_CACHE_LINE) unsigned nest;
+    atomic_int          in_use;
+    unsigned            site;
+    size_t              nretired;   ///< retired since the last collect.
+    struct Ebr*         ebr;
+    struct EbrThread*   next;
+    ClibRetiredList     retired[EBR_NLISTS];
+    unsigned            epochs[EBR_NLISTS]; ///< the epoch of retired[i].
+};
+
+typedef struct EbrThread EbrThread;
+
+/**
+ * \brief A reclamation domain.
+ * \private
+ */
+struct Ebr {
+    _Alignas(CLIB_CACHE_LINE) atomic_uint epoch;
+    _Alignas(CLIB_CACHE_LINE) _Atomic(EbrThread*) threads;
+    pthread_mutex_t     lock;       ///< guards registration and orphans.
+    ClibRetiredList     orphans;    ///< left behind by unregistered threads.
+    unsigned            site;
+};
+
+typedef struct Ebr Ebr;
+
+static inline unsigned
+ebr_active(unsigned epoch)
+{
+    return epoch << 1 | 1;
+}
+
+Ebr_t
+ebr_create(void)
+{
+    unsigned site = clib_mem_current_site();
+    Ebr* ebr = clib_aligned_alloc(CLIB_MEM_EBR,
+                                  site,
+                                  CLIB_CACHE_LINE,
+                                  sizeof(Ebr)
+                                  );
+    if (!ebr)
+        return NULL;
+
+    memset(ebr, 0, sizeof(Ebr));
+    atomic_init(&ebr->epoch, 0);
+    atomic_init(&ebr->threads, NULL);
+    pthread_mutex_init(&ebr->lock, NULL);
+    ebr->site = site;
+    return ebr;
+}
+
+void
+ebr_destroy(Ebr_t domain)
+{
+    Ebr* ebr = domain;
+    EbrThread* t = atomic_load(&ebr->threads);
+
+    while (t) {
+        EbrThread* next = t->next;
+        assert(!atomic_load(&t->in_use));
+        for (unsigned i = 0; i < EBR_NLISTS; i++)
+            clib_retired_destroy(&t->retired[i], CLIB_MEM_EBR, t->site);
+        clib_free(CLIB_MEM_EBR,
+                  t->site,
+                  t,
+                  CLIB_CACHE_ROUND(sizeof(EbrThread))
+                  );
+        t = next;
+    }
+    clib_retired_destroy(&ebr->orphans, CLIB_MEM_EBR, ebr->site);
+    pthread_mutex_destroy(&ebr->lock);
+    clib_free(CLIB_MEM_EBR, ebr->site, ebr, CLIB_CACHE_ROUND(sizeof(Ebr)));
+}
+
+EbrThread_t
+ebr_register(Ebr_t domain)
+{
+    Ebr* ebr = domain;
+    EbrThread* t;
+
+    pthread_mutex_lock(&ebr->lock);
+    for (t = atomic_load(&ebr->threads); t; t = t->next)
+        if (!atomic_load_explicit(&t->in_use, memory_order_relaxed))
+            break;
+
+    if (!t) {
+        unsigned site = clib_mem_current_site();
+        t = clib_aligned_alloc(CLIB_MEM_EBR,
+                               site,
+                               CLIB_CACHE_LINE,
+                               sizeof(EbrThread)
+                               );
+        if (t) {
+            memset(t, 0, sizeof(EbrThread));
+            atomic_init(&t->state, 0);
+            t->site = site;
+            t->ebr = ebr;
+            t->next = atomic_load(&ebr->threads);
+            atomic_store_explicit(&ebr->threads, t, memory_order_release);
+        }
+    }
+    if (t) {
+        atomic_store_explicit(&t->in_use, 1, memory_order_relaxed);
+        t->nest = 0;
+        t->nretired = 0;
+    }
+    pthread_mutex_unlock(&ebr->lock);
+    return t;
+}
+
+/*
+ * Frees the nodes of t that were retired at least two epochs before
+ * epoch.
+ */
+static void
+ebr_reclaim(EbrThread* t, unsigned epoch)
+{
+    for (unsigned i = 0; i < EBR_NLISTS; i++)
+        if (t->retired[i].n && epoch - t->epochs[i] >= 2)
+            clib_retired_free_all(&t->retired[i]);
+}
+
+/*
+ * Advances the global epoch when every thread in a critical section has
+ * observed it, returns the global epoch.
+ */
+static unsigned
+ebr_advance(Ebr* ebr)
+{
+    unsigned epoch = atomic_load_explicit(&ebr->epoch, memory_order_relaxed);
+    unsigned active = ebr_active(epoch);
+
+    // order the unlinking of the retired nodes before the scan.
+    atomic_thread_fence(memory_order_seq_cst);
+    EbrThread* t = atomic_load_explicit(&ebr->threads, memory_order_acquire);
+    for (; t; t = t->next) {
+        unsigned state = atomic_load_explicit(&t->state, memory_order_acquire);
+        if ((state & 1) && state != active)
+            return epoch;
+    }
+
+    if (atomic_compare_exchange_strong_explicit(&ebr->epoch,
+                                                &epoch,
+                                                epoch + 1,
+                                                memory_order_acq_rel,
+                                                memory_order_relaxed
+                                                ))
+        return epoch + 1;
+    return epoch;
+}
+
+/*
+ * Adds the orphans to the nodes that t retires in the current epoch.
+ *
+ * The orphans may have been retired in an epoch newer than the one
+ * ebr_advance() returned, so the epoch is loaded again under the lock
+ * that ebr_unregister() holds while it hands them over.
+ */
+static void
+ebr_adopt(EbrThread* t)
+{
+    Ebr* ebr = t->ebr;
+
+    if (pthread_mutex_trylock(&ebr->lock))
+        return;
+    unsigned epoch = atomic_load_explicit(&ebr->epoch, memory_order_acquire);
+    unsigned i = epoch % EBR_NLISTS;
+    if (t->retired[i].n == 0 || t->epochs[i] == epoch) {
+        t->epochs[i] = epoch;
+        clib_retired_append(&t->retired[i],
+                            CLIB_MEM_EBR,
+                            t->site,
+                            &ebr->orphans
+                            );
+    }
+    pthread_mutex_unlock(&ebr->lock);
+}
+
+void
+ebr_collect(EbrThread_t thread)
+{
+    EbrThread* t = thread;
+    unsigned epoch = ebr_advance(t->ebr);
+
+    ebr_reclaim(t, epoch);
+    ebr_adopt(t);
+    t->nretired = 0;
+}
+
+void
+ebr_synchronize(EbrThread_t thread)
+{
+    EbrThread* t = thread;
+    Ebr* ebr = t->ebr;
+
+    assert(t->nest == 0);
+    // the nodes are unlinked before start is loaded, see ebr_retire().
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned start = atomic_load_explicit(&ebr->epoch, memory_order_acquire);
+    while (ebr_advance(ebr) - start < 2)
+        sched_yield();
+}
+
+void
+ebr_unregister(EbrThread_t thread)
+{
+    EbrThread* t = thread;
+    Ebr* ebr = t->ebr;
+
+    assert(t->nest == 0);
+    ebr_collect(t);
+
+    pthread_mutex_lock(&ebr->lock);
+    // on out of memory the nodes stay with the registration.
+    for (unsigned i = 0; i < EBR_NLISTS; i++)
+        clib_retired_append(&ebr->orphans,
+                            CLIB_MEM_EBR,
+                            ebr->site,
+                            &t->retired[i]
+                            );
+    atomic_store_explicit(&t->in_use, 0, memory_order_relaxed);
+    pthread_mutex_unlock(&ebr->lock);
+}
+
+void
+ebr_enter(EbrThread_t thread)
+{
+    EbrThread* t = thread;
+
+    if (t->nest++ == 0) {
+        unsigned epoch = atomic_load_explicit(&t->ebr->epoch,
+                                              memory_order_relaxed
+                                              );
+        atomic_store_explicit(&t->state,
+                              ebr_active(epoch),
+                              memory_order_relaxed
+                              );
+        // the epoch must be visible before the shared nodes are read.
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+}
+
+void
+ebr_exit(EbrThread_t thread)
+{
+    EbrThread* t = thread;
+
+    assert(t->nest > 0);
+    if (--t->nest == 0)
+        atomic_store_explicit(&t->state, 0, memory_order_release);
+}
+
+int
+ebr_retire(EbrThread_t thread, void* p, clib_free_func ff)
+{
+    EbrThread* t = thread;
+
+    // order the unlinking of p before the epoch load, also outside a
+    // critical section where ebr_enter() doesn't fence.
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned epoch = atomic_load_explicit(&t->ebr->epoch, memory_order_acquire);
+    unsigned i = epoch % EBR_NLISTS;
+
+    // the list of this epoch was last used three epochs ago.
+    ebr_reclaim(t, epoch);
+    t->epochs[i] = epoch;
+    if (clib_retired_push(&t->retired[i], CLIB_MEM_EBR, t->site, p, ff))
+        return 1;
+
+    if (++t->nretired >= EBR_BATCH)
+        ebr_collect(t);
+    return 0;
+}
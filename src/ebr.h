@@ -0,0 +1,125 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef EBR_H
+#define EBR_H
+
+#include <stdlib.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Epoch based reclamation of memory of lock-free structures.
+ *
+ * A thread reads shared nodes only inside a critical section, between
+ * ebr_enter() and ebr_exit(). A node that is unlinked from a structure
+ * is retired with ebr_retire(), it is freed once every thread has left
+ * the critical sections that could have seen it. A global epoch advances
+ * when all threads in a critical section have observed the current
+ * epoch, nodes retired two epochs ago are then unreachable.
+ *
+ * The read side loads the global epoch and publishes it in a slot of the
+ * thread, which is followed by a full fence; there is no shared write.
+ * The epoch is advanced and the nodes are freed in batches by
+ * ebr_retire(). A thread that stays in a critical section
+ * holds back the reclamation of all threads, see hazard.h for a scheme
+ * with bounded memory.
+ */
+typedef void* Ebr_t;
+
+/**
+ * The registration of a thread with an Ebr_t, it is used by that thread
+ * only.
+ */
+typedef void* EbrThread_t;
+
+/**
+ * Create a reclamation domain.
+ *
+ * @return the domain or NULL when out of memory.
+ */
+Ebr_t ebr_create(void);
+
+/**
+ * Destroys the domain and frees all retired nodes.
+ *
+ * All threads must be unregistered.
+ */
+void ebr_destroy(Ebr_t ebr);
+
+/**
+ * Registers the calling thread.
+ *
+ * @return the registration or NULL when out of memory.
+ */
+EbrThread_t ebr_register(Ebr_t ebr);
+
+/**
+ * Unregisters a thread that is not in a critical section.
+ *
+ * The nodes it retired that can't be freed yet are handed to the domain.
+ */
+void ebr_unregister(EbrThread_t thread);
+
+/**
+ * Enters a critical section, critical sections may be nested.
+ */
+void ebr_enter(EbrThread_t thread);
+
+/**
+ * Leaves a critical section.
+ */
+void ebr_exit(EbrThread_t thread);
+
+/**
+ * Frees p with ff once no thread can hold a reference to it.
+ *
+ * p must be unreachable for threads that enter a critical section after
+ * this call. May be called inside or outside a critical section.
+ *
+ * @return 0 or !0 when out of memory, then p is not retired.
+ */
+int ebr_retire(EbrThread_t thread, void* p, clib_free_func ff);
+
+/**
+ * Tries to advance the epoch and frees the nodes that are safe to free.
+ *
+ * ebr_retire() does this every few nodes, call it to reclaim memory
+ * sooner, e.g. when a thread becomes idle.
+ */
+void ebr_collect(EbrThread_t thread);
+
+/**
+ * Waits until the threads that are in a critical section have left it.
+ *
+ * Afterwards nodes that were unlinked before the call are unreachable
+ * and may be freed directly, it is the fallback when ebr_retire() runs
+ * out of memory. The calling thread must not be in a critical section,
+ * also not with another registration of the same domain.
+ */
+void ebr_synchronize(EbrThread_t thread);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef EBR_H*/
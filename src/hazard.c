@@ -0,0 +1,284 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "hazard.h"
+#include "priv/memtracepriv.h"
+#include "priv/cachelinepriv.h"
+#include "priv/retiredpriv.h"
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * A thread collects when it has retired this many nodes, or twice the
+ * total number of slots when that is more.
+ */
+#define HAZARD_BATCH 64
+
+/**
+ * \brief The registration of a thread.
+ *
+ * The slots follow on a cache line of their own. Registrations are
+ * reused after hazard_unregister() and freed with the domain, so they
+ * can be scanned without a lock.
+ *
+ * \private
+ */
+struct HazardThread {
+    struct Hazard*          hazard;
+    struct HazardThread*    next;
+    atomic_int              in_use;
+    unsigned                site;
+    ClibRetiredList         retired;
+    const void**            scratch;    ///< the hazards during a collect.
+    size_t                  scratch_cap;
+    _Atomic(const void*)*   slots;
+};
+
+typedef struct HazardThread HazardThread;
+
+/**
+ * \brief A domain of hazard pointers.
+ * \private
+ */
+struct Hazard {
+    _Atomic(HazardThread*)  threads;
+    atomic_size_t           nthreads;
+    unsigned                nslots;     ///< slots per thread.
+    unsigned                site;
+    pthread_mutex_t         lock;       ///< guards registration and orphans.
+    ClibRetiredList         orphans;    ///< of unregistered threads.
+};
+
+typedef struct Hazard Hazard;
+
+static inline size_t
+hazard_thread_size(const Hazard* hazard)
+{
+    return CLIB_CACHE_ROUND(sizeof(HazardThread)) +
+           CLIB_CACHE_ROUND(hazard->nslots * sizeof(_Atomic(const void*)));
+}
+
+Hazard_t
+hazard_create(unsigned slots)
+{
+    unsigned site = clib_mem_current_site();
+    Hazard* hazard;
+
+    assert(slots > 0);
+    if (!(hazard = clib_malloc(CLIB_MEM_HAZARD, site, sizeof(Hazard))))
+        return NULL;
+
+    memset(hazard, 0, sizeof(Hazard));
+    atomic_init(&hazard->threads, NULL);
+    atomic_init(&hazard->nthreads, 0);
+    hazard->nslots = slots;
+    hazard->site = site;
+    pthread_mutex_init(&hazard->lock, NULL);
+    return hazard;
+}
+
+void
+hazard_destroy(Hazard_t domain)
+{
+    Hazard* hazard = domain;
+    HazardThread* t = atomic_load(&hazard->threads);
+
+    while (t) {
+        HazardThread* next = t->next;
+        assert(!atomic_load(&t->in_use));
+        clib_retired_destroy(&t->retired, CLIB_MEM_HAZARD, t->site);
+        clib_free(CLIB_MEM_HAZARD,
+                  t->site,
+                  t->scratch,
+                  t->scratch_cap * sizeof(void*)
+                  );
+        clib_free(CLIB_MEM_HAZARD, t->site, t, hazard_thread_size(hazard));
+        t = next;
+    }
+    clib_retired_destroy(&hazard->orphans, CLIB_MEM_HAZARD, hazard->site);
+    pthread_mutex_destroy(&hazard->lock);
+    clib_free(CLIB_MEM_HAZARD, hazard->site, hazard, sizeof(Hazard));
+}
+
+HazardThread_t
+hazard_register(Hazard_t domain)
+{
+    Hazard* hazard = domain;
+    HazardThread* t;
+
+    pthread_mutex_lock(&hazard->lock);
+    for (t = atomic_load(&hazard->threads); t; t = t->next)
+        if (!atomic_load_explicit(&t->in_use, memory_order_relaxed))
+            break;
+
+    if (!t) {
+        unsigned site = clib_mem_current_site();
+        size_t size = hazard_thread_size(hazard);
+        t = clib_aligned_alloc(CLIB_MEM_HAZARD, site, CLIB_CACHE_LINE, size);
+        if (t) {
+            memset(t, 0, sizeof(HazardThread));
+            t->hazard = hazard;
+            t->site = site;
+            t->slots = (_Atomic(const void*)*)
+                ((char*) t + CLIB_CACHE_ROUND(sizeof(HazardThread)));
+            for (unsigned i = 0; i < hazard->nslots; i++)
+                atomic_init(&t->slots[i], NULL);
+            t->next = atomic_load(&hazard->threads);
+            atomic_store_explicit(&hazard->threads, t, memory_order_release);
+            atomic_fetch_add(&hazard->nthreads, 1);
+        }
+    }
+    if (t)
+        atomic_store_explicit(&t->in_use, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&hazard->lock);
+    return t;
+}
+
+void
+hazard_set(HazardThread_t thread, unsigned slot, const void* p)
+{
+    HazardThread* t = thread;
+
+    assert(slot < t->hazard->nslots);
+    atomic_store_explicit(&t->slots[slot], p, memory_order_relaxed);
+    // the hazard must be visible before the pointer is checked again.
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void
+hazard_clear(HazardThread_t thread, unsigned slot)
+{
+    HazardThread* t = thread;
+
+    assert(slot < t->hazard->nslots);
+    atomic_store_explicit(&t->slots[slot], NULL, memory_order_release);
+}
+
+static int
+ptr_cmp(const void* a, const void* b)
+{
+    uintptr_t pa = (uintptr_t) *(const void* const*) a;
+    uintptr_t pb = (uintptr_t) *(const void* const*) b;
+    return (pa > pb) - (pa < pb);
+}
+
+void
+hazard_collect(HazardThread_t thread)
+{
+    HazardThread* t = thread;
+    Hazard* hazard = t->hazard;
+    size_t nhazards = 0;
+
+    // take over the nodes of unregistered threads.
+    if (!pthread_mutex_trylock(&hazard->lock)) {
+        clib_retired_append(&t->retired,
+                            CLIB_MEM_HAZARD,
+                            t->site,
+                            &hazard->orphans
+                            );
+        pthread_mutex_unlock(&hazard->lock);
+    }
+    if (!t->retired.n)
+        return;
+
+    size_t cap = atomic_load(&hazard->nthreads) * hazard->nslots;
+    if (cap > t->scratch_cap) {
+        const void** scratch = clib_realloc(CLIB_MEM_HAZARD,
+                                            t->site,
+                                            t->scratch,
+                                            t->scratch_cap * sizeof(void*),
+                                            cap * sizeof(void*)
+                                            );
+        if (!scratch)
+            return;
+        t->scratch = scratch;
+        t->scratch_cap = cap;
+    }
+
+    // order the unlinking of the retired nodes before reading the slots.
+    atomic_thread_fence(memory_order_seq_cst);
+    HazardThread* o = atomic_load_explicit(&hazard->threads,
+                                           memory_order_acquire
+                                           );
+    for (; o; o = o->next) {
+        for (unsigned i = 0; i < hazard->nslots; i++) {
+            const void* p = atomic_load_explicit(&o->slots[i],
+                                                 memory_order_acquire
+                                                 );
+            if (!p)
+                continue;
+            // a thread registered after the scratch was sized, try later.
+            if (nhazards == t->scratch_cap)
+                return;
+            t->scratch[nhazards++] = p;
+        }
+    }
+    qsort(t->scratch, nhazards, sizeof(void*), ptr_cmp);
+
+    // free the unprotected nodes, keep the others in order.
+    size_t kept = 0;
+    for (size_t i = 0; i < t->retired.n; i++) {
+        ClibRetired r = t->retired.items[i];
+        if (bsearch(&r.p, t->scratch, nhazards, sizeof(void*), ptr_cmp))
+            t->retired.items[kept++] = r;
+        else
+            r.ff(r.p);
+    }
+    t->retired.n = kept;
+}
+
+void
+hazard_unregister(HazardThread_t thread)
+{
+    HazardThread* t = thread;
+    Hazard* hazard = t->hazard;
+
+    for (unsigned i = 0; i < hazard->nslots; i++)
+        hazard_clear(t, i);
+    hazard_collect(t);
+
+    pthread_mutex_lock(&hazard->lock);
+    // on out of memory the nodes stay with the registration.
+    clib_retired_append(&hazard->orphans,
+                        CLIB_MEM_HAZARD,
+                        hazard->site,
+                        &t->retired
+                        );
+    atomic_store_explicit(&t->in_use, 0, memory_order_relaxed);
+    pthread_mutex_unlock(&hazard->lock);
+}
+
+int
+hazard_retire(HazardThread_t thread, void* p, clib_free_func ff)
+{
+    HazardThread* t = thread;
+    Hazard* hazard = t->hazard;
+    size_t threshold = 2 * atomic_load_explicit(&hazard->nthreads,
+                                                memory_order_relaxed
+                                                ) * hazard->nslots;
+
+    if (clib_retired_push(&t->retired, CLIB_MEM_HAZARD, t->site, p, ff))
+        return 1;
+    if (t->retired.n >= (threshold > HAZARD_BATCH ? threshold : HAZARD_BATCH))
+        hazard_collect(t);
+    return 0;
+}
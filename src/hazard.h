@@ -0,0 +1,123 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef HAZARD_H
+#define HAZARD_H
+
+#include <stdlib.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hazard pointers, reclamation of memory of lock-free structures with a
+ * bound on the memory that waits to be freed.
+ *
+ * Before a thread dereferences a shared node it publishes the pointer in
+ * one of its hazard slots and checks that the node is still reachable:
+ *
+ *     do {
+ *         node = atomic_load(&shared);
+ *         hazard_set(thread, 0, node);
+ *     } while (node != atomic_load(&shared));
+ *
+ * A node that is unlinked is retired with hazard_retire(). Retired nodes
+ * are collected in batches, the nodes that are not in any hazard slot are
+ * freed. Unlike epoch based reclamation (ebr.h) a stalled thread only
+ * holds back the nodes in its own slots, but every protected read costs
+ * a full fence.
+ */
+typedef void* Hazard_t;
+
+/**
+ * The registration of a thread with a Hazard_t, it is used by that thread
+ * only.
+ */
+typedef void* HazardThread_t;
+
+/**
+ * Create a domain of hazard pointers.
+ *
+ * @param slots [in] the number of hazard slots per thread, not 0.
+ *
+ * @return the domain or NULL when out of memory.
+ */
+Hazard_t hazard_create(unsigned slots);
+
+/**
+ * Destroys the domain and frees all retired nodes.
+ *
+ * All threads must be unregistered.
+ */
+void hazard_destroy(Hazard_t hazard);
+
+/**
+ * Registers the calling thread, its slots are empty.
+ *
+ * @return the registration or NULL when out of memory.
+ */
+HazardThread_t hazard_register(Hazard_t hazard);
+
+/**
+ * Clears the slots of the thread and unregisters it.
+ *
+ * The nodes it retired that can't be freed yet are handed to the domain.
+ */
+void hazard_unregister(HazardThread_t thread);
+
+/**
+ * Protects p from being freed, until the slot is set again or cleared.
+ *
+ * p is only protected when it is still reachable after this call, see
+ * the loop above.
+ *
+ * @param slot [in] a slot smaller than the slots of the domain.
+ */
+void hazard_set(HazardThread_t thread, unsigned slot, const void* p);
+
+/**
+ * Clears a slot.
+ */
+void hazard_clear(HazardThread_t thread, unsigned slot);
+
+/**
+ * Frees p with ff once it is in no hazard slot.
+ *
+ * p must be unreachable for threads that load it after this call.
+ *
+ * @return 0 or !0 when out of memory, then p is not retired.
+ */
+int hazard_retire(HazardThread_t thread, void* p, clib_free_func ff);
+
+/**
+ * Frees the retired nodes of thread that are not protected.
+ *
+ * hazard_retire() does this when enough nodes are retired, the number of
+ * nodes that wait to be freed is bounded by a multiple of the total
+ * number of slots.
+ */
+void hazard_collect(HazardThread_t thread);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef HAZARD_H*/
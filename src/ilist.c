@@ -0,0 +1,155 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ilist.h"
+#include <assert.h>
+
+/*
+ * Puts link between prev and next.
+ */
+static inline void
+ilist_link(IList* self, IListLink* prev, IListLink* next, IListLink* link)
+{
+    assert(!ilist_is_linked(link));
+    link->prev = prev;
+    link->next = next;
+    prev->next = link;
+    next->prev = link;
+    self->size++;
+}
+
+void
+ilist_init(IList* self)
+{
+    self->head.next = self->head.prev = &self->head;
+    self->size = 0;
+}
+
+size_t
+ilist_size(const IList* self)
+{
+    return self->size;
+}
+
+int
+ilist_is_linked(const IListLink* link)
+{
+    return link->next != NULL;
+}
+
+void
+ilist_prepend(IList* self, IListLink* link)
+{
+    ilist_link(self, &self->head, self->head.next, link);
+}
+
+void
+ilist_append(IList* self, IListLink* link)
+{
+    ilist_link(self, self->head.prev, &self->head, link);
+}
+
+void
+ilist_insert(IList* self, IListLink* before, IListLink* link)
+{
+    if (!before)
+        before = &self->head;
+    ilist_link(self, before->prev, before, link);
+}
+
+void
+ilist_insert_after(IList* self, IListLink* after, IListLink* link)
+{
+    assert(after);
+    ilist_link(self, after, after->next, link);
+}
+
+void
+ilist_remove(IList* self, IListLink* link)
+{
+    assert(ilist_is_linked(link) && self->size > 0);
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = link->prev = NULL;
+    self->size--;
+}
+
+void
+ilist_clear(IList* self, ilist_visit_func func, void* arg)
+{
+    IListLink* link = self->head.next;
+
+    while (link != &self->head) {
+        IListLink* next = link->next;
+        link->next = link->prev = NULL;
+        if (func)
+            func(link, arg);
+        link = next;
+    }
+    ilist_init(self);
+}
+
+IListLink*
+ilist_begin(const IList* self)
+{
+    return self->size ? self->head.next : NULL;
+}
+
+IListLink*
+ilist_last(const IList* self)
+{
+    return self->size ? self->head.prev : NULL;
+}
+
+IListLink*
+ilist_next(const IList* self, const IListLink* link)
+{
+    return link->next != &self->head ? link->next : NULL;
+}
+
+IListLink*
+ilist_prev(const IList* self, const IListLink* link)
+{
+    return link->prev != &self->head ? link->prev : NULL;
+}
+
+IListLink*
+ilist_find(const IList* self, const void* value, ilist_cmp_func cmpf)
+{
+    const IListLink* end = &self->head;
+
+    for (IListLink* link = self->head.next; link != end; link = link->next)
+        if (cmpf(link, value) == 0)
+            return link;
+    return NULL;
+}
+
+void
+ilist_reverse(IList* self)
+{
+    IListLink* link = &self->head;
+
+    // swapping next and prev of every link, the head included, reverses.
+    do {
+        IListLink* next = link->next;
+        link->next = link->prev;
+        link->prev = next;
+        link = next;
+    } while (link != &self->head);
+}
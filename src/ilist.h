@@ -0,0 +1,172 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef ILIST_H
+#define ILIST_H
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The link of an intrusive list.
+ *
+ * Embed an IListLink in your own type to put it in an IList, the list
+ * neither allocates nor copies: it links the objects where they are. An
+ * object is in at most one list per IListLink it embeds.
+ */
+typedef struct IListLink {
+    struct IListLink*   next;   ///< NULL when the link isn't in a list.
+    struct IListLink*   prev;
+} IListLink;
+
+/**
+ * An intrusive doubly linked list.
+ *
+ * The list is circular around the head link, so linking and unlinking
+ * never test for the ends. An IList may be embedded in another object,
+ * initialize it with ilist_init().
+ */
+typedef struct IList {
+    IListLink   head;
+    size_t      size;
+} IList;
+
+/**
+ * Returns the object of type that embeds link as member.
+ */
+#define ilist_entry(link, type, member) \
+    ((type*) ((char*) (link) - offsetof(type, member)))
+
+typedef int (*ilist_cmp_func)(const IListLink* link, const void* value);
+typedef void (*ilist_visit_func)(IListLink* link, void* arg);
+
+/**
+ * Initialize an empty list.
+ */
+void ilist_init(IList* list);
+
+/**
+ * Returns the number of links in the list.
+ */
+size_t ilist_size(const IList* list);
+
+/**
+ * Returns whether link is in a list.
+ *
+ * A link is not in a list after ilist_remove(), zero initialize a link
+ * to mark it as unlinked before it is first used.
+ */
+int ilist_is_linked(const IListLink* link);
+
+/**
+ * Links to the start of the list.
+ *
+ * @param list [in] the list to link to.
+ * @param link [in] a link that isn't in a list.
+ */
+void ilist_prepend(IList* list, IListLink* link);
+
+/**
+ * Links to the end of the list.
+ *
+ * @param list [in] the list to link to.
+ * @param link [in] a link that isn't in a list.
+ */
+void ilist_append(IList* list, IListLink* link);
+
+/**
+ * Links before another link.
+ *
+ * @param list [in] the list to link to.
+ * @param before [in] a link in list, or NULL for the end of the list.
+ * @param link [in] a link that isn't in a list.
+ */
+void ilist_insert(IList* list, IListLink* before, IListLink* link);
+
+/**
+ * Links after another link.
+ *
+ * @param list [in] the list to link to.
+ * @param after [in] a link in list.
+ * @param link [in] a link that isn't in a list.
+ */
+void ilist_insert_after(IList* list, IListLink* after, IListLink* link);
+
+/**
+ * Unlinks a link from the list in constant time.
+ *
+ * The object that embeds the link is not freed.
+ *
+ * @param list [in] the list that contains link.
+ * @param link [in] a link in list.
+ */
+void ilist_remove(IList* list, IListLink* link);
+
+/**
+ * Unlinks all links from the list.
+ *
+ * @param list [in] the list to clear.
+ * @param func [in] NULL or called with each link after it is unlinked,
+ *                  e.g. to return the object to its pool.
+ * @param arg [in] passed to func.
+ */
+void ilist_clear(IList* list, ilist_visit_func func, void* arg);
+
+/**
+ * Returns the first link or NULL when the list is empty.
+ */
+IListLink* ilist_begin(const IList* list);
+
+/**
+ * Returns the last link or NULL when the list is empty.
+ */
+IListLink* ilist_last(const IList* list);
+
+/**
+ * Returns the link after link or NULL at the end of the list.
+ */
+IListLink* ilist_next(const IList* list, const IListLink* link);
+
+/**
+ * Returns the link before link or NULL at the start of the list.
+ */
+IListLink* ilist_prev(const IList* list, const IListLink* link);
+
+/**
+ * Finds the first link for which cmpf returns 0, or NULL.
+ */
+IListLink* ilist_find(const IList* list,
+                      const void* value,
+                      ilist_cmp_func cmpf
+                      );
+
+/**
+ * Reverses a list in place.
+ */
+void ilist_reverse(IList* list);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef ILIST_H*/
@@ -20,56 +20,155 @@
 #include "priv/listpriv.h"
 #include "list.h"
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <assert.h>
 
-struct ListClass {
-    size_t  elem_size;
-    void  (*construct)(struct List*, size_t, list_free_func, list_copy_func);
-    void  (*destruct)(struct List* self);
-    size_t(*size)(const struct List* self);
-    ListNode* (*prepend)
-        (struct List* self, const void* value);
-    ListNode* (*append)
-        (struct List* self, ListNode* start, const void* value);
-    ListNode* (*insert)
-        (struct List* self, ListNode* before, const void* value);
-    ListNode* (*insert_after)
-        (struct List* self, ListNode* after, const void* value);
-    void (*remove) (struct List* self, ListNode* node);
-    void (*remove_range)
-        (struct List* self, ListNode* begin, ListNode* end);
-    ListNode* (*find)(struct List* self, const void* value, list_cmp_func cmp);
-    ListNode* (*begin)(const struct List* self);
-    void (*reverse)(struct List* self);
-    int  (*compare)
-        (const struct List* l1, const struct List* l2, list_cmp_func cmp);
+/*
+ * The largest number of nodes in a block made by list_compact.
+ */
+#define LIST_BLOCK_NODES 65536
+
+/*
+ * Lists with fewer elements are not compacted automatically.
+ */
+#define LIST_COMPACT_MIN 64
+
+/**
+ * \brief A block with nodes, made by list_compact or list_from_array.
+ *
+ * The nodes follow the header, when the list owns the elements they
+ * follow the nodes. Nodes in a block are not freed one by one. Nodes may
+ * be spliced into other lists, so every list with nodes in the block
+ * holds a reference, the block is freed with the last reference.
+ *
+ * \private
+ */
+struct ListBlock {
+    size_t              n;          ///< the number of nodes.
+    size_t              live;       ///< nodes that are still in a list.
+    size_t              refs;       ///< lists that refer to the block.
+    size_t              size;       ///< bytes of the block.
+    ClibMemType         mtype;      ///< the block is accounted to mtype,
+    unsigned            site;       ///< and site.
+    int                 mark;       ///< scratch flag for list_splice.
+    char*               data;       ///< the elements or NULL.
+    ListNode            nodes[];
 };
 
-typedef struct ListClass ListClass;
+typedef struct ListBlock ListBlock;
+
+/**
+ * \brief The reference of a list to a block.
+ * \private
+ */
+struct ListBlockRef {
+    struct ListBlockRef*    next;
+    ListBlock*              block;
+};
+
+typedef struct ListBlockRef ListBlockRef;
 
 static ListNode*
 list_node_create(struct List* self, const void* value)
 {
-    ListNode* newnode = calloc(1, sizeof(ListNode));
-    void* data = malloc(self->elem_size);
+    ListNode* newnode = clib_calloc(self->mtype, self->site, 1, sizeof(ListNode));
+    void* data = clib_malloc(self->mtype, self->site, self->elem_size);
     if (!data || ! newnode) {
-        free(newnode);
-        free(data);
+        clib_free(self->mtype, self->site, newnode, sizeof(ListNode));
+        clib_free(self->mtype, self->site, data, self->elem_size);
         return NULL;
     }
     else {
         newnode->data = data;
         self->cf(data, value, self->elem_size);
+        self->nscattered++;
         return newnode;
     }
 }
 
+/*
+ * Returns the reference to the block that holds node or NULL.
+ */
+static ListBlockRef*
+list_block_of(const struct List*    self,
+              const ListNode*       node,
+              ListBlockRef**        prev
+              )
+{
+    ListBlockRef* p = NULL;
+    for (ListBlockRef* r = self->blocks; r; p = r, r = r->next) {
+        const ListBlock* b = r->block;
+        if (node >= b->nodes && node < b->nodes + b->n) {
+            if (prev)
+                *prev = p;
+            return r;
+        }
+    }
+    return NULL;
+}
+
+static ListBlockRef*
+list_block_ref(struct List* self, ListBlock* b)
+{
+    ListBlockRef* r = clib_malloc(self->mtype, self->site, sizeof(ListBlockRef));
+    if (r) {
+        r->next = NULL;
+        r->block = b;
+        b->refs++;
+    }
+    return r;
+}
+
+/*
+ * Drops the reference r that follows prev, frees the block with its last
+ * reference.
+ */
+static void
+list_block_release(struct List* self, ListBlockRef* r, ListBlockRef* prev)
+{
+    ListBlock* b = r->block;
+
+    if (prev)
+        prev->next = r->next;
+    else
+        self->blocks = r->next;
+    clib_free(self->mtype, self->site, r, sizeof(ListBlockRef));
+
+    self->nholes = self->nholes > b->n ? self->nholes - b->n : 0;
+    if (--b->refs == 0)
+        clib_free(b->mtype, b->site, b, b->size);
+}
+
+static void
+list_blocks_release(struct List* self)
+{
+    while (self->blocks)
+        list_block_release(self, self->blocks, NULL);
+}
+
 static void 
 list_node_destroy(struct List* self, ListNode* node)
 {
-    self->ff(node->data);
-    free(node);
+    ListBlockRef* prev = NULL;
+    ListBlockRef* r = self->blocks ? list_block_of(self, node, &prev) : NULL;
+
+    if (!r) {
+        // the free func releases the data.
+        clib_mem_trace_free(self->mtype, self->site, node->data, self->elem_size);
+        self->ff(node->data);
+        clib_free(self->mtype, self->site, node, sizeof(ListNode));
+        self->nscattered--;
+        return;
+    }
+
+    if (!r->block->data) {
+        clib_mem_trace_free(self->mtype, self->site, node->data, self->elem_size);
+        self->ff(node->data);
+    }
+    self->nholes++;
+    if (--r->block->live == 0)
+        list_block_release(self, r, prev);
 }
 
 struct ListClass list_class;
@@ -108,10 +207,10 @@ list_destructor(struct List* self)
     while (pnode) {
         struct ListNode* temp = pnode;
         pnode = pnode->next;
-        self->ff(temp->data);
-        free(temp);
+        list_node_destroy(self, temp);
     }
-    free(self);
+    list_blocks_release(self);
+    clib_free(self->mtype, self->site, self, sizeof(struct List));
 }
 
 static size_t 
@@ -260,6 +359,129 @@ _list_compare(const struct List* l1, const struct List* l2, list_cmp_func cmp)
     return ret;
 }
 
+/*
+ * Returns references to new blocks with n nodes in total, the nodes are
+ * not linked yet.
+ */
+static ListBlockRef*
+list_blocks_create(struct List* self, size_t n, int own_data)
+{
+    const size_t align = _Alignof(max_align_t);
+    ListBlockRef* refs = NULL, **tail = &refs;
+
+    while (n) {
+        size_t k = n < LIST_BLOCK_NODES ? n : LIST_BLOCK_NODES;
+        size_t data_off = offsetof(ListBlock, nodes) + k * sizeof(ListNode);
+        data_off = (data_off + align - 1) / align * align;
+        size_t size = data_off + (own_data ? k * self->elem_size : 0);
+        ListBlock* b = clib_malloc(self->mtype, self->site, size);
+        ListBlockRef* r = NULL;
+        if (b) {
+            b->n = b->live = k;
+            b->refs = 0;
+            b->size = size;
+            b->mtype = self->mtype;
+            b->site = self->site;
+            b->mark = 0;
+            b->data = own_data ? (char*) b + data_off : NULL;
+            r = list_block_ref(self, b);
+        }
+        if (!r) {
+            if (b)
+                clib_free(self->mtype, self->site, b, size);
+            while (refs) {
+                ListBlockRef* next = refs->next;
+                clib_free(self->mtype, self->site, refs->block, refs->block->size);
+                clib_free(self->mtype, self->site, refs, sizeof(ListBlockRef));
+                refs = next;
+            }
+            return NULL;
+        }
+        *tail = r;
+        tail = &r->next;
+        n -= k;
+    }
+    return refs;
+}
+
+/*
+ * Links the nodes of the blocks in refs after each other, returns the
+ * last node.
+ */
+static ListNode*
+list_blocks_link(struct List* self, ListBlockRef* refs)
+{
+    ListNode* last = NULL;
+
+    for (; refs; refs = refs->next) {
+        ListBlock* b = refs->block;
+        for (size_t i = 0; i < b->n; i++) {
+            if (b->data)
+                b->nodes[i].data = b->data + i * self->elem_size;
+            if (last)
+                last->next = &b->nodes[i];
+            last = &b->nodes[i];
+        }
+    }
+    last->next = NULL;
+    return last;
+}
+
+static int
+_list_compact(struct List* self)
+{
+    // only elements that are released by free may be moved.
+    int own_data = self->ff == free;
+    ListBlockRef* refs;
+    ListNode* old, *node;
+
+    if (!self->nelements)
+        return 0;
+    if (!(refs = list_blocks_create(self, self->nelements, own_data)))
+        return 1;
+
+    list_blocks_link(self, refs);
+    node = &refs->block->nodes[0];
+    for (old = self->head; old; old = old->next, node = node->next) {
+        if (own_data)
+            memcpy(node->data, old->data, self->elem_size);
+        else
+            node->data = old->data;
+    }
+
+    // release the old nodes, the new blocks aren't in self->blocks yet.
+    old = self->head;
+    while (old) {
+        ListNode* next = old->next;
+        ListBlockRef* r = list_block_of(self, old, NULL);
+        if (r) {
+            if (own_data && !r->block->data)
+                clib_free(self->mtype, self->site, old->data, self->elem_size);
+            r->block->live--;
+        }
+        else {
+            if (own_data)
+                clib_free(self->mtype, self->site, old->data, self->elem_size);
+            clib_free(self->mtype, self->site, old, sizeof(ListNode));
+        }
+        old = next;
+    }
+    list_blocks_release(self);
+
+    self->blocks = refs;
+    self->head = &refs->block->nodes[0];
+    self->nscattered = 0;
+    self->nholes = 0;
+    return 0;
+}
+
+static double
+_list_fragmentation(const struct List* self)
+{
+    size_t total = self->nelements + self->nholes;
+    return total ? (double) (self->nscattered + self->nholes) / total : 0.0;
+}
+
 struct ListClass list_class = {
     sizeof(struct List),
     list_constructor,
@@ -274,20 +496,58 @@ struct ListClass list_class = {
     _list_find,
     _list_begin,
     _list_reverse,
-    _list_compare
+    _list_compare,
+    _list_compact,
+    _list_fragmentation
 };
 
-List_t list_create(size_t element_sz, list_free_func ff, list_copy_func cf)
+/*
+ * Compacts the list when automatic compaction is enabled and the list is
+ * fragmented, returns node at its new location.
+ */
+static ListNode*
+list_auto_compact(struct List* self, ListNode* node)
+{
+    size_t idx = 0;
+
+    if (self->compact_threshold <= 0 ||
+        !node ||
+        self->nelements < LIST_COMPACT_MIN ||
+        self->klass->fragmentation(self) <= self->compact_threshold)
+        return node;
+
+    for (ListNode* n = self->head; n != node; n = n->next)
+        idx++;
+    if (self->klass->compact(self))
+        return node;
+    for (node = self->head; idx; idx--)
+        node = node->next;
+    return node;
+}
+
+List_t list_create_accounted(size_t          element_sz,
+                             list_free_func  ff,
+                             list_copy_func  cf,
+                             ClibMemType     type
+                             )
 {
-    struct List* self = calloc(1, sizeof(struct List));
+    unsigned site = clib_mem_current_site();
+    struct List* self = clib_calloc(type, site, 1, sizeof(struct List));
     if (!self)
         return self;
 
+    self->mtype = type;
+    self->site  = site;
     self->klass = &list_class;
     self->klass->construct(self, element_sz, ff, cf);
     return self;
 }
 
+List_t list_create(size_t element_sz, list_free_func ff, list_copy_func cf)
+{
+    return list_create_accounted(element_sz, ff, cf, CLIB_MEM_LIST);
+}
+
 void list_destroy(List_t self)
 {
     struct List* this = self;
@@ -309,7 +569,7 @@ ListNode* list_prepend(List_t self, const void* value)
     struct List* this = (struct List*) self;
     ListClass* klass = this->klass;
 
-    return klass->prepend(self, value);
+    return list_auto_compact(this, klass->prepend(self, value));
 }
 
 ListNode* list_append(List_t self, ListNode* start, const void* value)
@@ -317,7 +577,7 @@ ListNode* list_append(List_t self, ListNode* start, const void* value)
     struct List* this = (struct List*) self;
     ListClass* klass = this->klass;
 
-    return klass->append(self, start, value);
+    return list_auto_compact(this, klass->append(self, start, value));
 }
 
 ListNode* list_insert(List_t self, ListNode* before, const void* value)
@@ -325,7 +585,7 @@ ListNode* list_insert(List_t self, ListNode* before, const void* value)
     struct List* this = (struct List*) self;
     ListClass* klass = this->klass;
 
-    return klass->insert(self, before, value);
+    return list_auto_compact(this, klass->insert(self, before, value));
 }
 
 ListNode* list_insert_after(List_t self, ListNode* after, const void* value)
@@ -333,7 +593,7 @@ ListNode* list_insert_after(List_t self, ListNode* after, const void* value)
     struct List* this = (struct List*) self;
     ListClass* klass = this->klass;
 
-    return klass->insert_after(self, after, value);
+    return list_auto_compact(this, klass->insert_after(self, after, value));
 }
 
 void list_remove(List_t self, ListNode* node) {
@@ -381,3 +641,202 @@ int list_compare(List_t self, List_t l2, list_cmp_func cmp)
 
     return klass->compare(self, l2, cmp);
 }
+
+int list_compact(List_t self)
+{
+    struct List* this = (struct List*) self;
+    ListClass* klass = this->klass;
+
+    return klass->compact(this);
+}
+
+double list_fragmentation(const List_t self)
+{
+    struct List* this = (struct List*) self;
+    ListClass* klass = this->klass;
+
+    return klass->fragmentation(this);
+}
+
+void list_set_auto_compact(List_t self, double threshold)
+{
+    struct List* this = (struct List*) self;
+
+    this->compact_threshold = threshold;
+}
+
+List_t list_from_array(size_t          element_sz,
+                       list_free_func  ff,
+                       list_copy_func  cf,
+                       const void*     src,
+                       size_t          n
+                       )
+{
+    struct List* self = list_create(element_sz, ff, cf);
+    ListBlockRef* refs;
+
+    if (!self || !n)
+        return self;
+    // like list_compact, elements released by free are kept in the block.
+    int own_data = self->ff == free;
+    if (!(refs = list_blocks_create(self, n, own_data))) {
+        list_destroy(self);
+        return NULL;
+    }
+    self->blocks = refs;
+    list_blocks_link(self, refs);
+
+    // the elements that the free func releases are allocated one by one.
+    ListNode* head = &refs->block->nodes[0];
+    size_t i = 0;
+    for (ListNode* node = head; node; node = node->next, i++) {
+        if (!own_data &&
+            !(node->data = clib_malloc(self->mtype, self->site, element_sz))) {
+            for (ListNode* done = head; done != node; done = done->next) {
+                clib_mem_trace_free(self->mtype, self->site, done->data, element_sz);
+                self->ff(done->data);
+            }
+            list_blocks_release(self);
+            list_destroy(self);
+            return NULL;
+        }
+        self->cf(node->data, (const char*) src + i * element_sz, element_sz);
+    }
+    self->head = &refs->block->nodes[0];
+    self->nelements = n;
+    return self;
+}
+
+/*
+ * Moves the accounting of a node that moves from src to dest.
+ */
+static void
+list_node_transfer(struct List*   dest,
+                   struct List*   src,
+                   ListNode*      node,
+                   int            in_block
+                   )
+{
+    if (!in_block) {
+        clib_mem_trace_free(src->mtype, src->site, node, sizeof(ListNode));
+        clib_mem_trace_alloc(dest->mtype, dest->site, node, sizeof(ListNode));
+    }
+    clib_mem_trace_free(src->mtype, src->site, node->data, src->elem_size);
+    clib_mem_trace_alloc(dest->mtype, dest->site, node->data, dest->elem_size);
+}
+
+int list_splice(List_t      dest,
+                ListNode*   after,
+                List_t      src,
+                ListNode*   prev,
+                ListNode*   last
+                )
+{
+    struct List* d = dest, *s = src;
+    ListBlockRef* refs = NULL, *r;
+    ListNode* first = prev ? prev->next : s->head, *node;
+    size_t n = 0, nscattered = 0;
+
+    assert(first && last && d != s);
+    if (d->klass != &list_class || s->klass != &list_class ||
+        d->elem_size != s->elem_size || d->ff != s->ff || d->cf != s->cf)
+        return 1;
+
+    // count the range and mark the blocks it uses.
+    for (node = first; ; node = node->next) {
+        n++;
+        if ((r = list_block_of(s, node, NULL)))
+            r->block->mark = 1;
+        else
+            nscattered++;
+        if (node == last)
+            break;
+    }
+
+    // dest needs a reference to the marked blocks.
+    for (r = s->blocks; r; r = r->next) {
+        if (!r->block->mark)
+            continue;
+        r->block->mark = 0;
+        ListBlockRef* dr = d->blocks;
+        while (dr && dr->block != r->block)
+            dr = dr->next;
+        if (dr)
+            continue;
+        if (!(dr = list_block_ref(d, r->block))) {
+            for (r = s->blocks; r; r = r->next)
+                r->block->mark = 0;
+            while (refs) {
+                ListBlockRef* next = refs->next;
+                refs->block->refs--;
+                clib_free(d->mtype, d->site, refs, sizeof(ListBlockRef));
+                refs = next;
+            }
+            return 1;
+        }
+        dr->next = refs;
+        refs = dr;
+    }
+    if (refs) {
+        for (r = refs; r->next; r = r->next)
+            ;
+        r->next = d->blocks;
+        d->blocks = refs;
+    }
+
+    if (d->mtype != s->mtype || d->site != s->site) {
+        for (node = first; ; node = node->next) {
+            ListBlockRef* br = list_block_of(s, node, NULL);
+            if (!br || !br->block->data)
+                list_node_transfer(d, s, node, br != NULL);
+            if (node == last)
+                break;
+        }
+    }
+
+    if (prev)
+        prev->next = last->next;
+    else
+        s->head = last->next;
+    if (after) {
+        last->next = after->next;
+        after->next = first;
+    }
+    else {
+        last->next = d->head;
+        d->head = first;
+    }
+
+    s->nelements -= n;
+    d->nelements += n;
+    s->nscattered -= nscattered;
+    d->nscattered += nscattered;
+    return 0;
+}
+
+List_t list_split_at(List_t self, size_t index)
+{
+    struct List* this = self, *tail;
+    ListNode* prev = NULL, *last;
+
+    if (this->klass != &list_class || index > this->nelements)
+        return NULL;
+
+    tail = list_create_accounted(this->elem_size,
+                                 this->ff,
+                                 this->cf,
+                                 this->mtype
+                                 );
+    if (!tail || index == this->nelements)
+        return tail;
+
+    for (size_t i = 0; i < index; i++)
+        prev = prev ? prev->next : this->head;
+    for (last = prev ? prev->next : this->head; last->next; last = last->next)
+        ;
+    if (list_splice(tail, NULL, this, prev, last)) {
+        list_destroy(tail);
+        return NULL;
+    }
+    return tail;
+}
@@ -46,6 +46,55 @@ typedef int   (list_cmp_func)(const void* k1, const void* k2);
  */
 List_t list_create(size_t element_size, list_free_func ff, list_copy_func cf);
 
+/**
+ * create an empty unrolled list.
+ *
+ * An unrolled list stores a run of elements and their ListNodes next to
+ * each other in one chunk of a few cache lines, a scan follows the nodes
+ * through consecutive memory. Chunks are split when they are full and
+ * merged when they become sparse.
+ *
+ * Elements are moved within and between chunks, so a ListNode refers to
+ * a position: an insertion or removal invalidates the other nodes of its
+ * chunk and of the neighbouring chunks, before as well as after it. Don't
+ * keep nodes across modifications.
+ *
+ * @param element_size [in] the sizeof() an single element.
+ * @param ff [in] called with an element before it is erased from the
+ *                list. Unlike for list_create the list owns the memory
+ *                of the element, so ff releases only what the element
+ *                refers to and must not free the element itself. free,
+ *                the default of list_create, is treated as NULL. May be
+ *                NULL.
+ * @param cf [in] the function used to copy an element into the list.
+ *                if none is specified memcpy will be used.
+ */
+List_t list_create_unrolled(size_t         element_size,
+                            list_free_func ff,
+                            list_copy_func cf
+                            );
+
+/**
+ * create a list with a copy of the elements of an array.
+ *
+ * All nodes are allocated in one block, in the order of the array, and
+ * when ff is NULL the elements are stored in the block as well.
+ *
+ * @param element_size [in] the sizeof() an single element.
+ * @param ff [in] the free func of the elements, see list_create.
+ * @param cf [in] copies the elements, see list_create.
+ * @param src [in] an array of n elements.
+ * @param n [in] the number of elements.
+ *
+ * @returns the list or NULL when out of memory.
+ */
+List_t list_from_array(size_t          element_size,
+                       list_free_func  ff,
+                       list_copy_func  cf,
+                       const void*     src,
+                       size_t          n
+                       );
+
 /**
  * Destroys the list and frees all members.
  */
@@ -158,4 +207,83 @@ ListNode* list_begin(const List_t list);
  */
 int list_compare(const List_t l1, const List_t l2, list_cmp_func cmp);
 
+/**
+ * Moves the nodes into a few contiguous blocks in list order.
+ *
+ * After many insertions and removals the nodes of a list are spread over
+ * the heap and a traversal waits for memory at every node. Compaction
+ * restores sequential access. When the list was created without a free
+ * func the elements move along with the nodes, otherwise only the nodes
+ * move. An unrolled list fills its chunks.
+ *
+ * All ListNodes of the list are invalidated.
+ *
+ * @returns 0 or !0 when out of memory, then the list is unchanged.
+ */
+int list_compact(List_t list);
+
+/**
+ * Returns an estimate between 0 and 1 of how much a list would gain from
+ * list_compact().
+ *
+ * For a list this is the fraction of the nodes and holes that are not in
+ * blocks made by list_compact(), for an unrolled list the fraction of
+ * unused slots.
+ */
+double list_fragmentation(const List_t list);
+
+/**
+ * Compact the list automatically when it is fragmented.
+ *
+ * When enabled the insertion functions call list_compact() when
+ * list_fragmentation() exceeds threshold, they return the new node at its
+ * new location. Other nodes are invalidated, so enable this only when
+ * nodes are not kept across insertions.
+ *
+ * @param threshold [in] 0 disables, otherwise a value between 0 and 1.
+ */
+void list_set_auto_compact(List_t list, double threshold);
+
+/**
+ * Moves a range of nodes from one list into another.
+ *
+ * The nodes are relinked, nothing is allocated per node or copied. The
+ * range is walked once to update the sizes of the lists. The ListNodes
+ * remain valid and are now in dest.
+ *
+ * Both lists must be made by list_create or list_from_array with the same
+ * element size, free func and copy func.
+ *
+ * @param dest [in] the list that receives the nodes.
+ * @param after [in] a node in dest or NULL to move the nodes to the start.
+ * @param src [in] the list that gives the nodes, not dest.
+ * @param prev [in] the node in src before the range, or NULL when the
+ *                  range starts at the head of src.
+ * @param last [in] the last node of the range.
+ *
+ * @returns 0 or !0 when the lists are incompatible or out of memory, then
+ *          both lists are unchanged.
+ */
+int list_splice(List_t      dest,
+                ListNode*   after,
+                List_t      src,
+                ListNode*   prev,
+                ListNode*   last
+                );
+
+/**
+ * Splits a list in two.
+ *
+ * The elements from index onwards are moved to a new list, the nodes are
+ * relinked as by list_splice. Only for lists made by list_create or
+ * list_from_array.
+ *
+ * @param list [in] the list to split.
+ * @param index [in] the number of elements that stay in list.
+ *
+ * @returns the list with the tail, or NULL when index > list_size(list)
+ *          or when out of memory.
+ */
+List_t list_split_at(List_t list, size_t index);
+
 #endif /* ifndef LIST_H*/
@@ -0,0 +1,532 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "priv/listpriv.h"
+#include "list.h"
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * The targeted size of the elements of a chunk, four cache lines, and
+ * the bounds of the number of elements in a chunk.
+ */
+#define UNROLLED_BYTES  256
+#define UNROLLED_MIN    4
+#define UNROLLED_MAX    64
+
+/**
+ * \brief A run of elements.
+ *
+ * Slot i always has nodes[i] and the element at data_off + i * elem_size,
+ * nodes[i].data points to it. Only the first n slots are in use. Chunks
+ * are never empty.
+ *
+ * \private
+ */
+struct ListChunk {
+    struct ListChunk*   next;
+    size_t              n;
+    ListNode            nodes[];
+};
+
+typedef struct ListChunk ListChunk;
+
+/**
+ * \brief An unrolled list, head is the first node of the first chunk.
+ *
+ * \private
+ */
+struct ListUnrolled {
+    struct List     base;
+    ListChunk*      chunks;
+    size_t          cap;        ///< slots per chunk.
+    size_t          data_off;   ///< offset of the elements in a chunk.
+    size_t          chunk_size; ///< bytes of a chunk.
+    size_t          nchunks;
+};
+
+typedef struct ListUnrolled ListUnrolled;
+
+static inline char*
+slot_data(const ListUnrolled* self, const ListChunk* c, size_t i)
+{
+    return (char*) c + self->data_off + i * self->base.elem_size;
+}
+
+/*
+ * Moves n elements from slot src of chunk from to slot dest of chunk to.
+ */
+static inline void
+move_elements(ListUnrolled*    self,
+              ListChunk*       to,
+              size_t           dest,
+              const ListChunk* from,
+              size_t           src,
+              size_t           n
+              )
+{
+    memmove(slot_data(self, to, dest),
+            slot_data(self, from, src),
+            n * self->base.elem_size
+            );
+}
+
+static ListChunk*
+chunk_create(ListUnrolled* self)
+{
+    ListChunk* c = clib_malloc(self->base.mtype,
+                               self->base.site,
+                               self->chunk_size
+                               );
+    if (!c)
+        return NULL;
+    self->nchunks++;
+    c->next = NULL;
+    c->n = 0;
+    for (size_t i = 0; i < self->cap; i++) {
+        c->nodes[i].next = NULL;
+        c->nodes[i].data = slot_data(self, c, i);
+    }
+    return c;
+}
+
+static void
+chunk_destroy(ListUnrolled* self, ListChunk* c)
+{
+    clib_free(self->base.mtype, self->base.site, c, self->chunk_size);
+    self->nchunks--;
+}
+
+/*
+ * Points the nodes of c to their successors.
+ */
+static void
+relink(ListChunk* c)
+{
+    if (!c)
+        return;
+    for (size_t i = 0; i + 1 < c->n; i++)
+        c->nodes[i].next = &c->nodes[i + 1];
+    c->nodes[c->n - 1].next = c->next ? &c->next->nodes[0] : NULL;
+}
+
+static void
+update_head(ListUnrolled* self)
+{
+    self->base.head = self->chunks ? &self->chunks->nodes[0] : NULL;
+}
+
+/*
+ * Finds the chunk of node and the chunk before it.
+ */
+static ListChunk*
+locate(const ListUnrolled* self,
+       const ListNode*     node,
+       ListChunk**         prev,
+       size_t*             idx
+       )
+{
+    ListChunk* p = NULL;
+
+    *prev = NULL;
+    *idx = 0;
+    for (ListChunk* c = self->chunks; c; p = c, c = c->next) {
+        if (node >= c->nodes && node < c->nodes + c->n) {
+            *prev = p;
+            *idx = node - c->nodes;
+            return c;
+        }
+    }
+    assert(0 && "node is not in the list");
+    return NULL;
+}
+
+static ListChunk*
+last_chunk(const ListUnrolled* self, ListChunk** prev)
+{
+    ListChunk* p = NULL, *c = self->chunks;
+    while (c && c->next) {
+        p = c;
+        c = c->next;
+    }
+    *prev = p;
+    return c;
+}
+
+/*
+ * Inserts value in slot idx of c, c is NULL for an empty list.
+ */
+static ListNode*
+insert_at(ListUnrolled* self, ListChunk* c, size_t idx, const void* value)
+{
+    ListChunk* right = NULL;
+
+    if (!c) {
+        if (!(c = chunk_create(self)))
+            return NULL;
+        self->chunks = c;
+    }
+    else if (c->n == self->cap) {
+        // split, the upper half moves to a new chunk.
+        size_t half = self->cap / 2;
+        if (!(right = chunk_create(self)))
+            return NULL;
+        move_elements(self, right, 0, c, half, c->n - half);
+        right->n = c->n - half;
+        right->next = c->next;
+        c->n = half;
+        c->next = right;
+        if (idx > half) {
+            idx -= half;
+            relink(c);
+            c = right;
+        }
+        else
+            relink(right);
+    }
+
+    move_elements(self, c, idx + 1, c, idx, c->n - idx);
+    self->base.cf(slot_data(self, c, idx), value, self->base.elem_size);
+    c->n++;
+    relink(c);
+    self->base.nelements++;
+    update_head(self);
+    return &c->nodes[idx];
+}
+
+/*
+ * Merges the chunk after c into c when they fit in three quarters of a
+ * chunk, so a chunk that is split isn't merged again right away.
+ */
+static void
+try_merge(ListUnrolled* self, ListChunk* c)
+{
+    ListChunk* next = c ? c->next : NULL;
+    if (!next || c->n + next->n > self->cap * 3 / 4)
+        return;
+    move_elements(self, c, c->n, next, 0, next->n);
+    c->n += next->n;
+    c->next = next->next;
+    chunk_destroy(self, next);
+}
+
+/*
+ * Removes n elements from slot idx of c on, prev is the chunk before c.
+ */
+static void
+remove_at(ListUnrolled* self, ListChunk* prev, ListChunk* c, size_t idx, size_t n)
+{
+    ListChunk* first = prev;
+
+    while (n && c) {
+        size_t k = c->n - idx < n ? c->n - idx : n;
+        ListChunk* next = c->next;
+
+        if (self->base.ff)
+            for (size_t i = idx; i < idx + k; i++)
+                self->base.ff(slot_data(self, c, i));
+        move_elements(self, c, idx, c, idx + k, c->n - idx - k);
+        c->n -= k;
+        n -= k;
+        self->base.nelements -= k;
+
+        if (c->n == 0) {
+            if (prev)
+                prev->next = next;
+            else
+                self->chunks = next;
+            chunk_destroy(self, c);
+        }
+        else
+            prev = c;
+        c = next;
+        idx = 0;
+    }
+
+    /*
+     * Only the chunk before the removed elements and the first and last
+     * chunk with removed elements changed, the ones in between are gone.
+     */
+    if (!first)
+        first = self->chunks;
+    if (first) {
+        try_merge(self, first);
+        try_merge(self, first->next);
+        for (size_t i = 0; first && i < 3; i++, first = first->next)
+            relink(first);
+    }
+    update_head(self);
+}
+
+/* * ListClass functions * */
+
+struct ListClass list_unrolled_class;
+
+static void
+unrolled_constructor(struct List*   base,
+                     size_t         element_sz,
+                     list_free_func ff,
+                     list_copy_func cf
+                     )
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    const size_t align = _Alignof(max_align_t);
+    size_t cap = UNROLLED_BYTES / (element_sz ? element_sz : 1);
+
+    if (cap < UNROLLED_MIN)
+        cap = UNROLLED_MIN;
+    if (cap > UNROLLED_MAX)
+        cap = UNROLLED_MAX;
+
+    base->elem_size = element_sz;
+    // the elements live in the chunks, free must not release them.
+    base->ff = ff == free ? NULL : ff;
+    base->cf = cf ? cf : memcpy;
+    self->cap = cap;
+    self->data_off = offsetof(ListChunk, nodes) + cap * sizeof(ListNode);
+    self->data_off = (self->data_off + align - 1) / align * align;
+    self->chunk_size = self->data_off + cap * element_sz;
+}
+
+static void
+unrolled_destructor(struct List* base)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    if (!self)
+        return;
+
+    ListChunk* c = self->chunks;
+    while (c) {
+        ListChunk* next = c->next;
+        if (base->ff)
+            for (size_t i = 0; i < c->n; i++)
+                base->ff(slot_data(self, c, i));
+        chunk_destroy(self, c);
+        c = next;
+    }
+    clib_free(base->mtype, base->site, self, base->klass->elem_size);
+}
+
+static size_t
+unrolled_size(const struct List* base)
+{
+    return base->nelements;
+}
+
+static ListNode*
+unrolled_prepend(struct List* base, const void* value)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    return insert_at(self, self->chunks, 0, value);
+}
+
+static ListNode*
+unrolled_append(struct List* base, ListNode* start, const void* value)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    ListChunk* prev;
+    ListChunk* c = last_chunk(self, &prev);
+    (void) start; // the chunks are found faster than the nodes.
+    return insert_at(self, c, c ? c->n : 0, value);
+}
+
+static ListNode*
+unrolled_insert(struct List* base, ListNode* before, const void* value)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    ListChunk* prev;
+    size_t idx;
+
+    if (!before)
+        return unrolled_append(base, NULL, value);
+    ListChunk* c = locate(self, before, &prev, &idx);
+    return insert_at(self, c, idx, value);
+}
+
+static ListNode*
+unrolled_insert_after(struct List* base, ListNode* after, const void* value)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    ListChunk* prev;
+    size_t idx;
+
+    assert(after != NULL);
+    ListChunk* c = locate(self, after, &prev, &idx);
+    return insert_at(self, c, idx + 1, value);
+}
+
+static void
+unrolled_remove_range(struct List* base, ListNode* begin, ListNode* end)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    ListChunk* prev;
+    size_t idx, n = 0;
+
+    for (ListNode* node = begin; node != end; node = node->next)
+        n++;
+    if (!n)
+        return;
+    ListChunk* c = locate(self, begin, &prev, &idx);
+    remove_at(self, prev, c, idx, n);
+}
+
+static void
+unrolled_remove(struct List* base, ListNode* node)
+{
+    unrolled_remove_range(base, node, node->next);
+}
+
+static ListNode*
+unrolled_find(struct List* base, const void* value, list_cmp_func cmp)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    for (ListChunk* c = self->chunks; c; c = c->next)
+        for (size_t i = 0; i < c->n; i++)
+            if (cmp(slot_data(self, c, i), value) == 0)
+                return &c->nodes[i];
+    return NULL;
+}
+
+static ListNode*
+unrolled_begin(const struct List* base)
+{
+    return base->head;
+}
+
+static void
+swap_bytes(char* a, char* b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        char t = a[i];
+        a[i] = b[i];
+        b[i] = t;
+    }
+}
+
+static void
+unrolled_reverse(struct List* base)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+    ListChunk* c = self->chunks, *reversed = NULL;
+
+    while (c) {
+        ListChunk* next = c->next;
+        for (size_t i = 0, j = c->n - 1; i < j; i++, j--)
+            swap_bytes(slot_data(self, c, i), slot_data(self, c, j), base->elem_size);
+        c->next = reversed;
+        reversed = c;
+        c = next;
+    }
+    self->chunks = reversed;
+    for (c = self->chunks; c; c = c->next)
+        relink(c);
+    update_head(self);
+}
+
+static int
+unrolled_compare(const struct List* l1, const struct List* l2, list_cmp_func cmp)
+{
+    int ret = l1->nelements - l2->nelements;
+    if (ret)
+        return ret;
+    ListNode* n1 = l1->head, *n2 = l2->head;
+
+    while (n1 && n2) {
+        if ((ret = cmp(n1->data, n2->data)) != 0)
+            return ret;
+        n1 = n1->next, n2 = n2->next;
+    }
+    return ret;
+}
+
+/*
+ * Fills every chunk from the chunks after it, in place.
+ */
+static int
+unrolled_compact(struct List* base)
+{
+    ListUnrolled* self = (ListUnrolled*) base;
+
+    for (ListChunk* c = self->chunks; c; c = c->next) {
+        while (c->n < self->cap && c->next) {
+            ListChunk* src = c->next;
+            size_t k = self->cap - c->n < src->n ? self->cap - c->n : src->n;
+            move_elements(self, c, c->n, src, 0, k);
+            move_elements(self, src, 0, src, k, src->n - k);
+            c->n += k;
+            src->n -= k;
+            if (src->n == 0) {
+                c->next = src->next;
+                chunk_destroy(self, src);
+            }
+        }
+        relink(c);
+    }
+    update_head(self);
+    return 0;
+}
+
+static double
+unrolled_fragmentation(const struct List* base)
+{
+    const ListUnrolled* self = (const ListUnrolled*) base;
+    size_t slots = self->nchunks * self->cap;
+    return slots ? 1.0 - (double) base->nelements / slots : 0.0;
+}
+
+struct ListClass list_unrolled_class = {
+    sizeof(struct ListUnrolled),
+    unrolled_constructor,
+    unrolled_destructor,
+    unrolled_size,
+    unrolled_prepend,
+    unrolled_append,
+    unrolled_insert,
+    unrolled_insert_after,
+    unrolled_remove,
+    unrolled_remove_range,
+    unrolled_find,
+    unrolled_begin,
+    unrolled_reverse,
+    unrolled_compare,
+    unrolled_compact,
+    unrolled_fragmentation
+};
+
+List_t list_create_unrolled(size_t         element_sz,
+                            list_free_func ff,
+                            list_copy_func cf
+                            )
+{
+    unsigned site = clib_mem_current_site();
+    struct List* self = clib_calloc(CLIB_MEM_LIST,
+                                    site,
+                                    1,
+                                    list_unrolled_class.elem_size
+                                    );
+    if (!self)
+        return self;
+
+    self->mtype = CLIB_MEM_LIST;
+    self->site  = site;
+    self->klass = &list_unrolled_class;
+    self->klass->construct(self, element_sz, ff, cf);
+    return self;
+}
@@ -0,0 +1,398 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "memtrace.h"
+#include "priv/memtracepriv.h"
+#include <string.h>
+
+#ifndef CLIB_NO_MEMTRACE
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * Every thread counts into its own MemCounters, only the owning thread
+ * writes them, so a relaxed load/store pair suffices and no cache lines
+ * bounce between threads. The live byte deltas are flushed into the global
+ * counters once they exceed MEM_FLUSH_BYTES, the peak is only computed
+ * from global values. Hence, the peak may be off by at most
+ * MEM_FLUSH_BYTES per thread.
+ */
+
+#define MEM_FLUSH_BYTES (64 * 1024)
+
+typedef long long counter_t;
+
+struct MemCounters {
+    struct MemCounters* next;
+    _Atomic counter_t   unflushed[CLIB_MEM_NTYPES];
+    _Atomic counter_t   nallocs[CLIB_MEM_NTYPES];
+    _Atomic counter_t   nfrees[CLIB_MEM_NTYPES];
+    _Atomic counter_t   site_live[CLIB_MEM_NTYPES][CLIB_MEM_MAX_SITES];
+    _Atomic counter_t   histogram[CLIB_MEM_NTYPES][CLIB_MEM_NBUCKETS];
+};
+
+typedef struct MemCounters MemCounters;
+
+struct MemHooks {
+    _Atomic(clib_mem_hook)  on_alloc;
+    _Atomic(clib_mem_hook)  on_free;
+    _Atomic(void*)          data;
+};
+
+static pthread_mutex_t  g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t   g_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t    g_key;
+
+static MemCounters*     g_threads;  // counters of running threads
+static MemCounters      g_retired;  // counters of threads that exited
+
+static _Atomic counter_t g_live[CLIB_MEM_NTYPES + 1];
+static _Atomic counter_t g_peak[CLIB_MEM_NTYPES + 1];
+
+static const char*      g_sites[CLIB_MEM_MAX_SITES]; // g_sites[0] is default
+static atomic_uint      g_nsites = 1;
+
+static struct MemHooks  g_hooks;
+
+static _Thread_local MemCounters*   tl_counters;
+static _Thread_local const char*    tl_site_name;
+static _Thread_local unsigned       tl_site;
+
+static inline void
+counter_add(_Atomic counter_t* c, counter_t v)
+{
+    counter_t old = atomic_load_explicit(c, memory_order_relaxed);
+    atomic_store_explicit(c, old + v, memory_order_relaxed);
+}
+
+static inline counter_t
+counter_get(_Atomic counter_t* c)
+{
+    return atomic_load_explicit(c, memory_order_relaxed);
+}
+
+static inline unsigned
+size_bucket(size_t n)
+{
+    unsigned b = 0;
+    while (n >>= 1)
+        b++;
+    return b < CLIB_MEM_NBUCKETS ? b : CLIB_MEM_NBUCKETS - 1;
+}
+
+static void
+update_peak(size_t index, counter_t live)
+{
+    counter_t peak = atomic_load_explicit(&g_peak[index], memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(
+                &g_peak[index], &peak, live,
+                memory_order_relaxed, memory_order_relaxed)
+           )
+        ;
+}
+
+static void
+flush_live(MemCounters* c, ClibMemType type)
+{
+    counter_t delta = counter_get(&c->unflushed[type]);
+    if (!delta)
+        return;
+    atomic_store_explicit(&c->unflushed[type], 0, memory_order_relaxed);
+    counter_t live  = atomic_fetch_add_explicit(
+            &g_live[type], delta, memory_order_relaxed) + delta;
+    counter_t total = atomic_fetch_add_explicit(
+            &g_live[CLIB_MEM_NTYPES], delta, memory_order_relaxed) + delta;
+    update_peak(type, live);
+    update_peak(CLIB_MEM_NTYPES, total);
+}
+
+static void
+merge_counters(MemCounters* dest, MemCounters* src)
+{
+    for (size_t t = 0; t < CLIB_MEM_NTYPES; t++) {
+        counter_add(&dest->nallocs[t], counter_get(&src->nallocs[t]));
+        counter_add(&dest->nfrees[t], counter_get(&src->nfrees[t]));
+        for (size_t s = 0; s < CLIB_MEM_MAX_SITES; s++)
+            counter_add(&dest->site_live[t][s], counter_get(&src->site_live[t][s]));
+        for (size_t b = 0; b < CLIB_MEM_NBUCKETS; b++)
+            counter_add(&dest->histogram[t][b], counter_get(&src->histogram[t][b]));
+    }
+}
+
+static void
+thread_exit(void* arg)
+{
+    MemCounters* c = arg, **pp;
+
+    pthread_mutex_lock(&g_lock);
+    for (pp = &g_threads; *pp; pp = &(*pp)->next) {
+        if (*pp == c) {
+            *pp = c->next;
+            break;
+        }
+    }
+    for (size_t t = 0; t < CLIB_MEM_NTYPES; t++)
+        flush_live(c, t);
+    merge_counters(&g_retired, c);
+    pthread_mutex_unlock(&g_lock);
+
+    tl_counters = NULL;
+    free(c);
+}
+
+static void
+make_key(void)
+{
+    pthread_key_create(&g_key, thread_exit);
+}
+
+static MemCounters*
+thread_counters(void)
+{
+    if (tl_counters)
+        return tl_counters;
+
+    pthread_once(&g_key_once, make_key);
+
+    // Not accounted, it is the accounting itself.
+    MemCounters* c = calloc(1, sizeof(MemCounters));
+    if (!c)
+        return NULL;
+
+    pthread_mutex_lock(&g_lock);
+    c->next = g_threads;
+    g_threads = c;
+    pthread_mutex_unlock(&g_lock);
+
+    pthread_setspecific(g_key, c);
+    tl_counters = c;
+    return c;
+}
+
+static unsigned
+site_index(const char* site)
+{
+    if (!site)
+        return 0;
+
+    unsigned n = atomic_load_explicit(&g_nsites, memory_order_acquire);
+    for (unsigned i = 1; i < n; i++)
+        if (g_sites[i] == site || strcmp(g_sites[i], site) == 0)
+            return i;
+
+    pthread_mutex_lock(&g_lock);
+    // another thread may have added it meanwhile.
+    unsigned i;
+    n = atomic_load_explicit(&g_nsites, memory_order_relaxed);
+    for (i = 1; i < n; i++)
+        if (strcmp(g_sites[i], site) == 0)
+            break;
+    if (i == n) {
+        if (n < CLIB_MEM_MAX_SITES) {
+            g_sites[n] = site;
+            atomic_store_explicit(&g_nsites, n + 1, memory_order_release);
+        }
+        else
+            i = 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return i;
+}
+
+static void
+account(ClibMemType type, unsigned site, size_t n, int alloc)
+{
+    MemCounters* c = thread_counters();
+    if (!c)
+        return;
+
+    counter_t delta = alloc ? (counter_t) n : -(counter_t) n;
+    counter_add(&c->site_live[type][site], delta);
+    counter_add(&c->unflushed[type], delta);
+    if (alloc) {
+        counter_add(&c->nallocs[type], 1);
+        counter_add(&c->histogram[type][size_bucket(n)], 1);
+    }
+    else
+        counter_add(&c->nfrees[type], 1);
+
+    counter_t pending = counter_get(&c->unflushed[type]);
+    if (pending >= MEM_FLUSH_BYTES || pending <= -MEM_FLUSH_BYTES)
+        flush_live(c, type);
+}
+
+void
+clib_mem_trace_alloc(ClibMemType type, unsigned site, void* p, size_t n)
+{
+    account(type, site, n, 1);
+
+    clib_mem_hook hook = atomic_load_explicit(&g_hooks.on_alloc,
+                                              memory_order_acquire);
+    if (hook)
+        hook(type, g_sites[site], p, n, atomic_load(&g_hooks.data));
+}
+
+void
+clib_mem_trace_free(ClibMemType type, unsigned site, void* p, size_t n)
+{
+    clib_mem_hook hook = atomic_load_explicit(&g_hooks.on_free,
+                                              memory_order_acquire);
+    if (hook)
+        hook(type, g_sites[site], p, n, atomic_load(&g_hooks.data));
+
+    account(type, site, n, 0);
+}
+
+unsigned
+clib_mem_current_site(void)
+{
+    return tl_site;
+}
+
+void
+clib_mem_set_hooks(clib_mem_hook on_alloc, clib_mem_hook on_free, void* data)
+{
+    atomic_store(&g_hooks.data, data);
+    atomic_store_explicit(&g_hooks.on_alloc, on_alloc, memory_order_release);
+    atomic_store_explicit(&g_hooks.on_free, on_free, memory_order_release);
+}
+
+const char*
+clib_mem_set_site(const char* site)
+{
+    const char* prev = tl_site_name;
+    tl_site_name = site;
+    tl_site = site_index(site);
+    return prev;
+}
+
+static void
+add_stats(ClibMemStats* stats, MemCounters* c, size_t type)
+{
+    stats->nallocs  += counter_get(&c->nallocs[type]);
+    stats->nfrees   += counter_get(&c->nfrees[type]);
+    for (size_t b = 0; b < CLIB_MEM_NBUCKETS; b++)
+        stats->histogram[b] += counter_get(&c->histogram[type][b]);
+}
+
+void
+clib_mem_stats(ClibMemType type, ClibMemStats* stats)
+{
+    size_t first = type, last = type + 1;
+    counter_t live;
+    MemCounters* c;
+
+    if (type == CLIB_MEM_NTYPES) {
+        first = 0;
+        last = CLIB_MEM_NTYPES;
+    }
+
+    memset(stats, 0, sizeof(ClibMemStats));
+
+    pthread_mutex_lock(&g_lock);
+    live = atomic_load_explicit(&g_live[type], memory_order_relaxed);
+    for (size_t t = first; t < last; t++) {
+        add_stats(stats, &g_retired, t);
+        for (c = g_threads; c; c = c->next) {
+            add_stats(stats, c, t);
+            live += counter_get(&c->unflushed[t]);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (live < 0) // frees were flushed before the matching allocations.
+        live = 0;
+    update_peak(type, live);
+    stats->live_bytes = live;
+    stats->peak_bytes = atomic_load_explicit(&g_peak[type],
+                                             memory_order_relaxed);
+}
+
+size_t
+clib_mem_site_live_bytes(ClibMemType type, const char* site)
+{
+    size_t first = type, last = type + 1;
+    unsigned s = site_index(site);
+    counter_t live = 0;
+
+    if (type == CLIB_MEM_NTYPES) {
+        first = 0;
+        last = CLIB_MEM_NTYPES;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    for (size_t t = first; t < last; t++) {
+        live += counter_get(&g_retired.site_live[t][s]);
+        for (MemCounters* c = g_threads; c; c = c->next)
+            live += counter_get(&c->site_live[t][s]);
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    return live > 0 ? (size_t) live : 0;
+}
+
+size_t
+clib_mem_sites(const char** sites, size_t n)
+{
+    size_t nsites = atomic_load_explicit(&g_nsites, memory_order_acquire);
+    for (size_t i = 0; i < nsites && i < n; i++)
+        sites[i] = g_sites[i];
+    return nsites;
+}
+
+#else /* CLIB_NO_MEMTRACE */
+
+void
+clib_mem_set_hooks(clib_mem_hook on_alloc, clib_mem_hook on_free, void* data)
+{
+    (void) on_alloc; (void) on_free; (void) data;
+}
+
+const char*
+clib_mem_set_site(const char* site)
+{
+    (void) site;
+    return NULL;
+}
+
+void
+clib_mem_stats(ClibMemType type, ClibMemStats* stats)
+{
+    (void) type;
+    memset(stats, 0, sizeof(ClibMemStats));
+}
+
+size_t
+clib_mem_site_live_bytes(ClibMemType type, const char* site)
+{
+    (void) type; (void) site;
+    return 0;
+}
+
+size_t
+clib_mem_sites(const char** sites, size_t n)
+{
+    if (n)
+        sites[0] = NULL;
+    return 1;
+}
+
+#endif /* CLIB_NO_MEMTRACE */
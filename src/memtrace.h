@@ -0,0 +1,162 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief The kind of container that owns a piece of memory.
+ *
+ * Every allocation made by c-lib is accounted to one of these types.
+ */
+typedef enum ClibMemType {
+    CLIB_MEM_DARRAY = 0,
+    CLIB_MEM_LIST,
+    CLIB_MEM_STACK,
+    CLIB_MEM_DEQUE,
+    CLIB_MEM_SPSC_QUEUE,
+    CLIB_MEM_MPMC_QUEUE,
+    CLIB_MEM_THREADPOOL,
+    CLIB_MEM_SOA_ARRAY,
+    CLIB_MEM_BITSET,
+    CLIB_MEM_BLOOM,
+    CLIB_MEM_CACHE,
+    CLIB_MEM_BTREE,
+    CLIB_MEM_ART,
+    CLIB_MEM_PLIST,
+    CLIB_MEM_PVECTOR,
+    CLIB_MEM_EBR,
+    CLIB_MEM_HAZARD,
+    CLIB_MEM_SLOTMAP,
+    CLIB_MEM_SPARSESET,
+    CLIB_MEM_DSTRING,
+    CLIB_MEM_OTHER,
+    CLIB_MEM_NTYPES     ///< Number of types, not a type itself.
+} ClibMemType;
+
+/**
+ * The number of buckets in the allocation size histogram. Bucket i counts
+ * the allocations with a size in [2^i, 2^(i+1)), bucket 0 also counts
+ * allocations of 0 bytes.
+ */
+#define CLIB_MEM_NBUCKETS 48
+
+/**
+ * The maximum number of distinct creation sites that are tracked. Sites
+ * registered after the table is full are accounted to the default site.
+ */
+#define CLIB_MEM_MAX_SITES 64
+
+/**
+ * \brief A snapshot of the memory accounting.
+ */
+typedef struct ClibMemStats {
+    size_t  live_bytes;     ///< bytes currently held.
+    size_t  peak_bytes;     ///< high-water mark of live_bytes.
+    size_t  nallocs;        ///< number of allocations.
+    size_t  nfrees;         ///< number of frees.
+    size_t  histogram[CLIB_MEM_NBUCKETS]; ///< allocation sizes (log2 buckets)
+} ClibMemStats;
+
+/**
+ * \brief A function that is called on every allocation or free.
+ *
+ * @param type  [in] the kind of container that (de)allocates.
+ * @param site  [in] the creation site of the container.
+ * @param ptr   [in] the memory that is allocated or freed.
+ * @param size  [in] the number of bytes allocated or freed.
+ * @param data  [in] the user data passed to clib_mem_set_hooks.
+ */
+typedef void (*clib_mem_hook)(ClibMemType type,
+                              const char* site,
+                              void*       ptr,
+                              size_t      size,
+                              void*       data
+                              );
+
+/**
+ * Install hooks that are called on every allocation and free.
+ *
+ * The hooks are called from the thread that does the (de)allocation, so
+ * they should be thread safe. Pass NULL to remove the hooks.
+ *
+ * @param on_alloc  [in] called after memory is allocated, may be NULL.
+ * @param on_free   [in] called when memory is freed, may be NULL. The
+ *                       pointer is only an address, it may not be
+ *                       dereferenced anymore.
+ * @param data      [in] passed to the hooks.
+ */
+void clib_mem_set_hooks(clib_mem_hook on_alloc,
+                        clib_mem_hook on_free,
+                        void*         data
+                        );
+
+/**
+ * Set the creation site for containers created by the calling thread.
+ *
+ * Containers remember the site that was active when they were created and
+ * account all their memory to it. The site string is not copied, so it
+ * should live as long as the program, string literals are ideal.
+ *
+ * @param site [in] the name of the site or NULL for the default site.
+ *
+ * @return the previous site of this thread.
+ */
+const char* clib_mem_set_site(const char* site);
+
+/**
+ * Get the memory statistics of one type of container.
+ *
+ * Thread local counters are merged when this function is called.
+ *
+ * @param type  [in] the type of container or CLIB_MEM_NTYPES for all types.
+ * @param stats [out] the statistics.
+ */
+void clib_mem_stats(ClibMemType type, ClibMemStats* stats);
+
+/**
+ * Get the number of live bytes of a container type created at a site.
+ *
+ * @param type  [in] the type of container or CLIB_MEM_NTYPES for all types.
+ * @param site  [in] the site as given to clib_mem_set_site, NULL for the
+ *                   default site.
+ */
+size_t clib_mem_site_live_bytes(ClibMemType type, const char* site);
+
+/**
+ * Get the names of the sites that have been registered.
+ *
+ * @param sites [out] room for n names, the default site is reported as NULL.
+ * @param n     [in]  the number of names that fit in sites.
+ *
+ * @return the number of registered sites, which may exceed n.
+ */
+size_t clib_mem_sites(const char** sites, size_t n);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef MEMTRACE_H*/
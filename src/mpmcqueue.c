@@ -0,0 +1,341 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "mpmcqueue.h"
+#include "priv/memtracepriv.h"
+#include "priv/cachelinepriv.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+ * The number of times the blocking functions retry before they go to
+ * sleep.
+ */
+#define MPMC_SPIN_COUNT 128
+
+/**
+ * \brief the private implementation of the multi producer multi consumer
+ * queue.
+ *
+ * This is Dmitry Vyukov's bounded queue: every cell has a sequence number
+ * that tells whether it is ready to be written (seq == pos) or to be read
+ * (seq == pos + 1) for the position that a thread has claimed. Producers
+ * and consumers only contend on their own position counter.
+ *
+ * The blocking functions register themselves in n_wait_push/n_wait_pop
+ * before sleeping, so the other side only takes the lock when somebody
+ * actually sleeps.
+ *
+ * \private
+ */
+struct MpmcQueue {
+    size_t          esize;      ///< Element size.
+    size_t          stride;     ///< size of a cell.
+    size_t          mask;       ///< capacity - 1
+    char*           cells;      ///< sequence number followed by the element.
+    clib_free_func  ff;         ///< called on elements left at destruction.
+    clib_copy_func  cf;         ///< copies elements in and out.
+    unsigned        site;       ///< creation site for memory accounting.
+
+    pthread_mutex_t lock;       ///< protects sleeping only.
+    pthread_cond_t  not_full;
+    pthread_cond_t  not_empty;
+    atomic_uint     n_wait_push;
+    atomic_uint     n_wait_pop;
+    atomic_int      closed;
+
+    _Alignas(CLIB_CACHE_LINE) atomic_size_t enqueue_pos;
+    _Alignas(CLIB_CACHE_LINE) atomic_size_t dequeue_pos;
+};
+
+typedef struct MpmcQueue MpmcQueue;
+
+#define CELL_DATA_OFFSET \
+    ((sizeof(atomic_size_t) + _Alignof(max_align_t) - 1) & \
+     ~(_Alignof(max_align_t) - 1))
+
+static inline atomic_size_t*
+cell_seq(const MpmcQueue* q, size_t pos)
+{
+    return (atomic_size_t*) (q->cells + (pos & q->mask) * q->stride);
+}
+
+static inline void*
+cell_data(const MpmcQueue* q, size_t pos)
+{
+    return q->cells + (pos & q->mask) * q->stride + CELL_DATA_OFFSET;
+}
+
+static void
+wake(MpmcQueue* q, atomic_uint* n_waiting, pthread_cond_t* cond)
+{
+    // pairs with the fence in the sleeping thread.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(n_waiting, memory_order_relaxed)) {
+        pthread_mutex_lock(&q->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+static int
+try_push(MpmcQueue* q, const void* item)
+{
+    size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+
+    if (atomic_load_explicit(&q->closed, memory_order_relaxed))
+        return MPMC_QUEUE_CLOSED;
+
+    for (;;) {
+        size_t seq = atomic_load_explicit(cell_seq(q, pos),
+                                          memory_order_acquire);
+        intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                        &q->enqueue_pos, &pos, pos + 1,
+                        memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (dif < 0)
+            return MPMC_QUEUE_FULL;
+        else
+            pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    }
+
+    q->cf(cell_data(q, pos), item, q->esize);
+    atomic_store_explicit(cell_seq(q, pos), pos + 1, memory_order_release);
+    return MPMC_QUEUE_OK;
+}
+
+static int
+try_pop(MpmcQueue* q, void* item)
+{
+    size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+
+    for (;;) {
+        size_t seq = atomic_load_explicit(cell_seq(q, pos),
+                                          memory_order_acquire);
+        intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                        &q->dequeue_pos, &pos, pos + 1,
+                        memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (dif < 0)
+            return MPMC_QUEUE_EMPTY;
+        else
+            pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    }
+
+    memcpy(item, cell_data(q, pos), q->esize);  // moves to the caller.
+    atomic_store_explicit(cell_seq(q, pos),
+                          pos + q->mask + 1,
+                          memory_order_release
+                          );
+    return MPMC_QUEUE_OK;
+}
+
+MpmcQueue_t
+mpmc_queue_create(size_t         element_size,
+                  clib_free_func ff,
+                  clib_copy_func cf,
+                  size_t         capacity
+                  )
+{
+    unsigned site = clib_mem_current_site();
+    size_t cap = 2, stride;
+
+    // the capacity must be a power of two that fits in a size_t.
+    if (capacity > (SIZE_MAX >> 1) + 1 ||
+        element_size > SIZE_MAX / 4 ||
+        capacity > SIZE_MAX / 4 / (CELL_DATA_OFFSET + element_size))
+        return NULL;
+    while (cap < capacity)
+        cap <<= 1;
+    stride = (CELL_DATA_OFFSET + element_size + _Alignof(max_align_t) - 1) &
+             ~(_Alignof(max_align_t) - 1);
+
+    MpmcQueue* q = clib_aligned_alloc(CLIB_MEM_MPMC_QUEUE,
+                                      site,
+                                      CLIB_CACHE_LINE,
+                                      sizeof(MpmcQueue)
+                                      );
+    if (!q)
+        return NULL;
+    memset(q, 0, sizeof(MpmcQueue));
+
+    q->cells = clib_aligned_alloc(CLIB_MEM_MPMC_QUEUE,
+                                  site,
+                                  CLIB_CACHE_LINE,
+                                  CLIB_CACHE_ROUND(cap * stride)
+                                  );
+    if (!q->cells) {
+        clib_free(CLIB_MEM_MPMC_QUEUE, site, q, sizeof(MpmcQueue));
+        return NULL;
+    }
+
+    q->esize    = element_size;
+    q->stride   = stride;
+    q->mask     = cap - 1;
+    q->ff       = ff;
+    q->cf       = cf ? cf : memcpy;
+    q->site     = site;
+    for (size_t i = 0; i < cap; i++)
+        atomic_init(cell_seq(q, i), i);
+    atomic_init(&q->enqueue_pos, 0);
+    atomic_init(&q->dequeue_pos, 0);
+    atomic_init(&q->n_wait_push, 0);
+    atomic_init(&q->n_wait_pop, 0);
+    atomic_init(&q->closed, 0);
+
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    return q;
+}
+
+void
+mpmc_queue_destroy(MpmcQueue_t queue)
+{
+    MpmcQueue* q = queue;
+    size_t pos = atomic_load(&q->dequeue_pos);
+    size_t end = atomic_load(&q->enqueue_pos);
+
+    if (q->ff) {
+        for (; pos != end; pos++)
+            q->ff(cell_data(q, pos));
+    }
+
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    pthread_mutex_destroy(&q->lock);
+    clib_free(CLIB_MEM_MPMC_QUEUE,
+              q->site,
+              q->cells,
+              CLIB_CACHE_ROUND((q->mask + 1) * q->stride)
+              );
+    clib_free(CLIB_MEM_MPMC_QUEUE, q->site, q, sizeof(MpmcQueue));
+}
+
+size_t
+mpmc_queue_capacity(const MpmcQueue_t queue)
+{
+    const MpmcQueue* q = queue;
+    return q->mask + 1;
+}
+
+size_t
+mpmc_queue_size(const MpmcQueue_t queue)
+{
+    MpmcQueue* q = queue;
+    size_t deq = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    size_t enq = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    return enq > deq ? enq - deq : 0;
+}
+
+int
+mpmc_queue_try_push(MpmcQueue_t queue, const void* item)
+{
+    MpmcQueue* q = queue;
+    int ret = try_push(q, item);
+    if (ret == MPMC_QUEUE_OK)
+        wake(q, &q->n_wait_pop, &q->not_empty);
+    return ret;
+}
+
+int
+mpmc_queue_try_pop(MpmcQueue_t queue, void* item)
+{
+    MpmcQueue* q = queue;
+    int ret = try_pop(q, item);
+    if (ret == MPMC_QUEUE_OK)
+        wake(q, &q->n_wait_push, &q->not_full);
+    return ret;
+}
+
+int
+mpmc_queue_push(MpmcQueue_t queue, const void* item)
+{
+    MpmcQueue* q = queue;
+    int ret;
+
+    for (unsigned i = 0; i < MPMC_SPIN_COUNT; i++) {
+        if ((ret = mpmc_queue_try_push(q, item)) != MPMC_QUEUE_FULL)
+            return ret;
+        clib_cpu_relax();
+    }
+
+    pthread_mutex_lock(&q->lock);
+    atomic_fetch_add(&q->n_wait_push, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while ((ret = try_push(q, item)) == MPMC_QUEUE_FULL)
+        pthread_cond_wait(&q->not_full, &q->lock);
+    atomic_fetch_sub(&q->n_wait_push, 1);
+    pthread_mutex_unlock(&q->lock);
+
+    if (ret == MPMC_QUEUE_OK)
+        wake(q, &q->n_wait_pop, &q->not_empty);
+    return ret;
+}
+
+int
+mpmc_queue_pop(MpmcQueue_t queue, void* item)
+{
+    MpmcQueue* q = queue;
+    int ret;
+
+    for (unsigned i = 0; i < MPMC_SPIN_COUNT; i++) {
+        if ((ret = mpmc_queue_try_pop(q, item)) == MPMC_QUEUE_OK)
+            return ret;
+        clib_cpu_relax();
+    }
+
+    pthread_mutex_lock(&q->lock);
+    atomic_fetch_add(&q->n_wait_pop, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while ((ret = try_pop(q, item)) == MPMC_QUEUE_EMPTY) {
+        if (atomic_load(&q->closed)) {
+            ret = MPMC_QUEUE_CLOSED;
+            break;
+        }
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+    atomic_fetch_sub(&q->n_wait_pop, 1);
+    pthread_mutex_unlock(&q->lock);
+
+    if (ret == MPMC_QUEUE_OK)
+        wake(q, &q->n_wait_push, &q->not_full);
+    return ret;
+}
+
+void
+mpmc_queue_close(MpmcQueue_t queue)
+{
+    MpmcQueue* q = queue;
+    atomic_store(&q->closed, 1);
+
+    pthread_mutex_lock(&q->lock);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
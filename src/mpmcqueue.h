@@ -0,0 +1,127 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include <stdlib.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A bounded queue for any number of producer and consumer threads.
+ *
+ * The try functions never block. The blocking functions spin for a short
+ * while and then sleep on a condition variable until they can proceed or
+ * the queue is closed.
+ */
+typedef void* MpmcQueue_t;
+
+enum MpmcQueueResult {
+    MPMC_QUEUE_OK = 0,
+    MPMC_QUEUE_FULL,
+    MPMC_QUEUE_EMPTY,
+    MPMC_QUEUE_CLOSED
+};
+
+/**
+ * create an empty queue.
+ *
+ * @param element_size [in] the sizeof() a single element.
+ * @param ff [in] the free func is called on the elements that are still
+ *                in the queue when it is destroyed, may be NULL.
+ * @param cf [in] the function used to copy an element into the queue.
+ *                if none is specified memcpy will be used. cf copies in,
+ *                popped elements are moved out with memcpy.
+ * @param capacity [in] the number of elements the queue can hold, it is
+ *                      rounded up to a power of two and at least 2.
+ *
+ * @return a new queue or NULL when out of memory.
+ */
+MpmcQueue_t
+mpmc_queue_create(size_t         element_size,
+                  clib_free_func ff,
+                  clib_copy_func cf,
+                  size_t         capacity
+                  );
+
+/**
+ * Destroys the queue, no thread may use it anymore.
+ */
+void mpmc_queue_destroy(MpmcQueue_t queue);
+
+/**
+ * Returns the number of elements the queue can hold.
+ */
+size_t mpmc_queue_capacity(const MpmcQueue_t queue);
+
+/**
+ * Returns an estimate of the number of elements in the queue.
+ */
+size_t mpmc_queue_size(const MpmcQueue_t queue);
+
+/**
+ * Copy an element into the queue if there is room.
+ *
+ * @return MPMC_QUEUE_OK, MPMC_QUEUE_FULL or MPMC_QUEUE_CLOSED
+ */
+int mpmc_queue_try_push(MpmcQueue_t queue, const void* item);
+
+/**
+ * Move an element out of the queue if there is one.
+ *
+ * The bytes of the element are moved to item, the caller owns it.
+ *
+ * @return MPMC_QUEUE_OK or MPMC_QUEUE_EMPTY
+ */
+int mpmc_queue_try_pop(MpmcQueue_t queue, void* item);
+
+/**
+ * Copy an element into the queue, waits while the queue is full.
+ *
+ * @return MPMC_QUEUE_OK or MPMC_QUEUE_CLOSED
+ */
+int mpmc_queue_push(MpmcQueue_t queue, const void* item);
+
+/**
+ * Move an element out of the queue, waits while the queue is empty.
+ *
+ * The bytes of the element are moved to item, the caller owns it.
+ *
+ * @return MPMC_QUEUE_OK or MPMC_QUEUE_CLOSED when the queue is closed and
+ *         empty.
+ */
+int mpmc_queue_pop(MpmcQueue_t queue, void* item);
+
+/**
+ * Close the queue.
+ *
+ * Pushing to a closed queue fails, the elements that are in the queue
+ * can still be popped. All waiting threads are woken up.
+ */
+void mpmc_queue_close(MpmcQueue_t queue);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef MPMCQUEUE_H*/
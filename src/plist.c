@@ -0,0 +1,161 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "plist.h"
+#include "priv/memtracepriv.h"
+#include <stddef.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * \brief A cell of a persistent list.
+ *
+ * A cell holds a reference to the next cell and is never modified after
+ * it is made. The list ends in an empty cell, the nil of the list, that
+ * keeps the element size and free func in its data.
+ *
+ * \private
+ */
+struct PListCell {
+    atomic_size_t       refs;
+    size_t              length;
+    struct PListCell*   next;
+    struct PListCell*   nil;
+    unsigned            site;
+    _Alignas(max_align_t) char data[];
+};
+
+typedef struct PListCell PListCell;
+
+/**
+ * \brief The data of the nil cell.
+ * \private
+ */
+struct PListInfo {
+    size_t          esize;
+    clib_free_func  ff;
+};
+
+typedef struct PListInfo PListInfo;
+
+static inline const PListInfo*
+plist_info(const PListCell* cell)
+{
+    return (const PListInfo*) cell->nil->data;
+}
+
+PList_t
+plist_create(size_t element_size, clib_free_func ff)
+{
+    unsigned site = clib_mem_current_site();
+    size_t size = offsetof(PListCell, data) + sizeof(PListInfo);
+    PListCell* nil = clib_malloc(CLIB_MEM_PLIST, site, size);
+    if (!nil)
+        return NULL;
+
+    atomic_init(&nil->refs, 1);
+    nil->length = 0;
+    nil->next = NULL;
+    nil->nil = nil;
+    nil->site = site;
+    PListInfo info = {element_size, ff};
+    memcpy(nil->data, &info, sizeof(info));
+    return nil;
+}
+
+PList_t
+plist_retain(const PList_t list)
+{
+    PListCell* cell = (PListCell*) list;
+    atomic_fetch_add_explicit(&cell->refs, 1, memory_order_relaxed);
+    return cell;
+}
+
+void
+plist_release(PList_t list)
+{
+    PListCell* cell = list;
+
+    // a cell owns a reference to the next, release them without recursion.
+    while (cell) {
+        size_t refs = atomic_fetch_sub_explicit(&cell->refs,
+                                                1,
+                                                memory_order_acq_rel
+                                                );
+        if (refs > 1)
+            return;
+
+        PListCell* next = cell->next;
+        size_t size;
+        if (cell == cell->nil)
+            size = offsetof(PListCell, data) + sizeof(PListInfo);
+        else {
+            const PListInfo* info = plist_info(cell);
+            if (info->ff)
+                info->ff(cell->data);
+            size = offsetof(PListCell, data) + info->esize;
+        }
+        clib_free(CLIB_MEM_PLIST, cell->site, cell, size);
+        cell = next;
+    }
+}
+
+PList_t
+plist_prepend(const PList_t list, const void* value)
+{
+    PListCell* tail = (PListCell*) list;
+    const PListInfo* info = plist_info(tail);
+    unsigned site = clib_mem_current_site();
+    PListCell* cell = clib_malloc(CLIB_MEM_PLIST,
+                                  site,
+                                  offsetof(PListCell, data) + info->esize
+                                  );
+    if (!cell)
+        return NULL;
+
+    atomic_init(&cell->refs, 1);
+    cell->length = tail->length + 1;
+    cell->next = plist_retain(tail);
+    cell->nil = tail->nil;
+    cell->site = site;
+    memcpy(cell->data, value, info->esize);
+    return cell;
+}
+
+size_t
+plist_size(const PList_t list)
+{
+    const PListCell* cell = list;
+    return cell->length;
+}
+
+const void*
+plist_head(const PList_t list)
+{
+    const PListCell* cell = list;
+    return cell->length ? cell->data : NULL;
+}
+
+PList_t
+plist_tail(const PList_t list)
+{
+    PListCell* cell = (PListCell*) list;
+    return cell->length ? cell->next : cell;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PLIST_H
+#define PLIST_H
+
+#include <stdlib.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A persistent singly linked list.
+ *
+ * A PList_t is an immutable version of a list. Prepending makes a new
+ * version that shares the old version as its tail, so a list is never
+ * copied. The cells are reference counted with atomic counters, every
+ * version stays readable without locking by any thread that holds a
+ * reference, and it is freed when its last reference is released.
+ *
+ * An empty list is made by plist_create(), the functions that return a
+ * new reference are paired with plist_release().
+ */
+typedef void* PList_t;
+
+/**
+ * Create an empty list.
+ *
+ * @param element_size [in] the sizeof() an single element.
+ * @param ff [in] NULL or called with an element before the cell that
+ *                holds it is freed.
+ *
+ * @return a reference to the empty list or NULL when out of memory.
+ */
+PList_t plist_create(size_t element_size, clib_free_func ff);
+
+/**
+ * Returns a new reference to list, a snapshot in constant time.
+ */
+PList_t plist_retain(const PList_t list);
+
+/**
+ * Releases a reference, the cells that are no longer referenced by any
+ * version are freed.
+ */
+void plist_release(PList_t list);
+
+/**
+ * Returns a new list with value in front of list.
+ *
+ * Constant time, list is shared as the tail of the new list and
+ * remains valid.
+ *
+ * @return a reference to the new list or NULL when out of memory.
+ */
+PList_t plist_prepend(const PList_t list, const void* value);
+
+/**
+ * Returns the number of elements in constant time.
+ */
+size_t plist_size(const PList_t list);
+
+/**
+ * Returns the first element or NULL when the list is empty.
+ */
+const void* plist_head(const PList_t list);
+
+/**
+ * Returns the list without its first element, list for the empty list.
+ *
+ * No reference is taken, the tail is valid as long as list is, use
+ * plist_retain() to keep it longer.
+ */
+PList_t plist_tail(const PList_t list);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef PLIST_H*/
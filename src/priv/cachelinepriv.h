@@ -0,0 +1,48 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef CACHELINEPRIV_H
+#define CACHELINEPRIV_H
+
+/*
+ * The size of a cache line on the targets we care about. Members that are
+ * written by different threads are aligned to it, so they don't share a
+ * line.
+ */
+#define CLIB_CACHE_LINE 64
+
+/* Rounds n up to a multiple of CLIB_CACHE_LINE */
+#define CLIB_CACHE_ROUND(n) \
+    (((n) + CLIB_CACHE_LINE - 1) & ~((size_t) CLIB_CACHE_LINE - 1))
+
+/*
+ * Tells the cpu we are in a spin loop, which saves power and frees
+ * resources for a hyper thread sibling.
+ */
+static inline void
+clib_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+#endif /*CACHELINEPRIV_H*/
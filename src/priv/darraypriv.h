@@ -0,0 +1,45 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DARRAYPRIV_H
+#define DARRAYPRIV_H
+
+#include <stdlib.h>
+#include "../darray.h"
+#include "memtracepriv.h"
+
+/**
+ * \brief the private implementation of an array.
+ *
+ * \private
+ */
+struct DArray {
+    size_t  esize;   ///< Element size;
+    size_t  size;    ///< number of elements contained
+    size_t  cap;     ///< capacity of the buffer (in number of elements).
+    char*   elems;   ///< pointer to the elements.
+
+    da_free_func ff; ///< function called when erasing element from the array
+    da_copy_func cf; ///< This function is called when a new member is inserted.
+    unsigned site;   ///< creation site for memory accounting.
+};
+
+typedef struct DArray DArray;
+
+#endif /*DARRAYPRIV_H*/
@@ -0,0 +1,98 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef HASHPRIV_H
+#define HASHPRIV_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Hashing of byte strings for the hashed containers.
+ *
+ * This is MurmurHash64A by Austin Appleby (public domain). The input is
+ * read as little endian words, so the hashes, and hence serialized
+ * filters, are the same on every platform.
+ */
+
+static inline uint64_t
+clib_load_le64(const unsigned char* p)
+{
+    return  (uint64_t) p[0]        | (uint64_t) p[1] << 8  |
+            (uint64_t) p[2] << 16  | (uint64_t) p[3] << 24 |
+            (uint64_t) p[4] << 32  | (uint64_t) p[5] << 40 |
+            (uint64_t) p[6] << 48  | (uint64_t) p[7] << 56;
+}
+
+static inline void
+clib_store_le64(unsigned char* p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (unsigned char) (v >> (8 * i));
+}
+
+static inline uint64_t
+clib_hash_bytes(const void* key, size_t len, uint64_t seed)
+{
+    const uint64_t m = UINT64_C(0xc6a4a7935bd1e995);
+    const int r = 47;
+    const unsigned char* p = key;
+    uint64_t h = seed ^ (len * m);
+
+    for (; len >= 8; len -= 8, p += 8) {
+        uint64_t k = clib_load_le64(p);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    switch (len) {
+        case 7: h ^= (uint64_t) p[6] << 48; /* fall through */
+        case 6: h ^= (uint64_t) p[5] << 40; /* fall through */
+        case 5: h ^= (uint64_t) p[4] << 32; /* fall through */
+        case 4: h ^= (uint64_t) p[3] << 24; /* fall through */
+        case 3: h ^= (uint64_t) p[2] << 16; /* fall through */
+        case 2: h ^= (uint64_t) p[1] << 8;  /* fall through */
+        case 1: h ^= (uint64_t) p[0];
+                h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+/*
+ * Mixes the bits of a 64 bit value, the finalizer of MurmurHash3.
+ */
+static inline uint64_t
+clib_hash_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+    return h;
+}
+
+#endif /*HASHPRIV_H*/
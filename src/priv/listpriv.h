@@ -22,14 +22,15 @@
 
 #include <stdlib.h>
 #include "../list.h"
-
-struct ListClass;
+#include "memtracepriv.h"
 
 //struct ListNode {
 //    struct ListNode*    next;
 //    void*               data;
 //};
 
+struct ListBlockRef;
+
 struct List {
     struct ListClass*   klass;
     struct ListNode*    head;
@@ -37,6 +38,57 @@ struct List {
     size_t              nelements;
     list_free_func      ff;
     list_copy_func      cf;
+    ClibMemType         mtype;  ///< the container type memory is accounted to
+    unsigned            site;   ///< the creation site of the list
+    struct ListBlockRef* blocks; ///< the blocks with nodes of the list
+    size_t              nscattered; ///< nodes allocated on their own
+    size_t              nholes; ///< removed nodes in the blocks
+    double              compact_threshold; ///< 0 or the auto compact level
+};
+
+/**
+ * \brief The virtual functions of a list.
+ *
+ * elem_size is the size of the instance, a struct that starts with a
+ * struct List, so other list implementations can extend it.
+ *
+ * \private
+ */
+struct ListClass {
+    size_t  elem_size;
+    void  (*construct)(struct List*, size_t, list_free_func, list_copy_func);
+    void  (*destruct)(struct List* self);
+    size_t(*size)(const struct List* self);
+    ListNode* (*prepend)
+        (struct List* self, const void* value);
+    ListNode* (*append)
+        (struct List* self, ListNode* start, const void* value);
+    ListNode* (*insert)
+        (struct List* self, ListNode* before, const void* value);
+    ListNode* (*insert_after)
+        (struct List* self, ListNode* after, const void* value);
+    void (*remove) (struct List* self, ListNode* node);
+    void (*remove_range)
+        (struct List* self, ListNode* begin, ListNode* end);
+    ListNode* (*find)(struct List* self, const void* value, list_cmp_func cmp);
+    ListNode* (*begin)(const struct List* self);
+    void (*reverse)(struct List* self);
+    int  (*compare)
+        (const struct List* l1, const struct List* l2, list_cmp_func cmp);
+    int  (*compact)(struct List* self);
+    double (*fragmentation)(const struct List* self);
 };
 
+typedef struct ListClass ListClass;
+
+/**
+ * Creates a list whose memory is accounted to another container type,
+ * for containers that are build on top of a list.
+ */
+List_t list_create_accounted(size_t         element_size,
+                             list_free_func ff,
+                             list_copy_func cf,
+                             ClibMemType    type
+                             );
+
 #endif /*LISTPRIV_H*/
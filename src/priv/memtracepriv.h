@@ -0,0 +1,117 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef MEMTRACEPRIV_H
+#define MEMTRACEPRIV_H
+
+#include <stdlib.h>
+#include "../memtrace.h"
+
+/*
+ * The containers allocate through the functions below, so that all memory
+ * held by c-lib is accounted to a container type and a creation site.
+ * Configuring with CLIB_MEMTRACE=OFF defines CLIB_NO_MEMTRACE which turns
+ * them into plain malloc/free.
+ */
+
+#ifndef CLIB_NO_MEMTRACE
+
+void     clib_mem_trace_alloc(ClibMemType type, unsigned site, void* p, size_t n);
+void     clib_mem_trace_free (ClibMemType type, unsigned site, void* p, size_t n);
+unsigned clib_mem_current_site(void);
+
+#else
+
+static inline void
+clib_mem_trace_alloc(ClibMemType type, unsigned site, void* p, size_t n)
+{
+    (void) type; (void) site; (void) p; (void) n;
+}
+
+static inline void
+clib_mem_trace_free(ClibMemType type, unsigned site, void* p, size_t n)
+{
+    (void) type; (void) site; (void) p; (void) n;
+}
+
+static inline unsigned
+clib_mem_current_site(void)
+{
+    return 0;
+}
+
+#endif
+
+static inline void*
+clib_malloc(ClibMemType type, unsigned site, size_t n)
+{
+    void* p = malloc(n);
+    if (p)
+        clib_mem_trace_alloc(type, site, p, n);
+    return p;
+}
+
+static inline void*
+clib_calloc(ClibMemType type, unsigned site, size_t nmemb, size_t n)
+{
+    void* p = calloc(nmemb, n);
+    if (p)
+        clib_mem_trace_alloc(type, site, p, nmemb * n);
+    return p;
+}
+
+/*
+ * align must be a power of two, n is rounded up to a multiple of align.
+ */
+static inline void*
+clib_aligned_alloc(ClibMemType type, unsigned site, size_t align, size_t n)
+{
+    n = (n + align - 1) & ~(align - 1);
+    void* p = aligned_alloc(align, n);
+    if (p)
+        clib_mem_trace_alloc(type, site, p, n);
+    return p;
+}
+
+/*
+ * old_n must be the size of the previous allocation of p, on failure
+ * p remains valid and is accounted again.
+ */
+static inline void*
+clib_realloc(ClibMemType type, unsigned site, void* p, size_t old_n, size_t n)
+{
+    if (p)
+        clib_mem_trace_free(type, site, p, old_n);
+    void* np = realloc(p, n);
+    if (np)
+        clib_mem_trace_alloc(type, site, np, n);
+    else if (p && n)
+        clib_mem_trace_alloc(type, site, p, old_n);
+    return np;
+}
+
+static inline void
+clib_free(ClibMemType type, unsigned site, void* p, size_t n)
+{
+    if (p)
+        clib_mem_trace_free(type, site, p, n);
+    free(p);
+}
+
+#endif /*MEMTRACEPRIV_H*/
@@ -0,0 +1,108 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef RETIREDPRIV_H
+#define RETIREDPRIV_H
+
+#include <stdlib.h>
+#include "../function-types.h"
+#include "memtracepriv.h"
+
+/*
+ * A growing array of objects that are retired but not yet freed, used
+ * by the memory reclamation schemes.
+ */
+
+typedef struct ClibRetired {
+    void*           p;
+    clib_free_func  ff;
+} ClibRetired;
+
+typedef struct ClibRetiredList {
+    ClibRetired*    items;
+    size_t          n;
+    size_t          cap;
+} ClibRetiredList;
+
+/*
+ * Returns 0 or !0 when out of memory.
+ */
+static inline int
+clib_retired_push(ClibRetiredList*  list,
+                  ClibMemType       type,
+                  unsigned          site,
+                  void*             p,
+                  clib_free_func    ff
+                  )
+{
+    if (list->n == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        ClibRetired* items = clib_realloc(type,
+                                          site,
+                                          list->items,
+                                          list->cap * sizeof(ClibRetired),
+                                          cap * sizeof(ClibRetired)
+                                          );
+        if (!items)
+            return 1;
+        list->items = items;
+        list->cap = cap;
+    }
+    list->items[list->n].p = p;
+    list->items[list->n].ff = ff;
+    list->n++;
+    return 0;
+}
+
+/*
+ * Moves all items of src to the end of dest.
+ */
+static inline int
+clib_retired_append(ClibRetiredList*    dest,
+                    ClibMemType         type,
+                    unsigned            site,
+                    ClibRetiredList*    src
+                    )
+{
+    for (; src->n; src->n--) {
+        ClibRetired* r = &src->items[src->n - 1];
+        if (clib_retired_push(dest, type, site, r->p, r->ff))
+            return 1;
+    }
+    return 0;
+}
+
+static inline void
+clib_retired_free_all(ClibRetiredList* list)
+{
+    for (size_t i = 0; i < list->n; i++)
+        list->items[i].ff(list->items[i].p);
+    list->n = 0;
+}
+
+static inline void
+clib_retired_destroy(ClibRetiredList* list, ClibMemType type, unsigned site)
+{
+    clib_retired_free_all(list);
+    clib_free(type, site, list->items, list->cap * sizeof(ClibRetired));
+    list->items = NULL;
+    list->cap = 0;
+}
+
+#endif /*RETIREDPRIV_H*/
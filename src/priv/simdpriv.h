@@ -0,0 +1,37 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SIMDPRIV_H
+#define SIMDPRIV_H
+
+/*
+ * Helpers for kernels that are compiled for several instruction sets,
+ * the one that is used is selected at runtime by darray_simd_level().
+ */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CLIB_SIMD_X86 1
+#include <immintrin.h>
+
+#define ATTR_SSE2
+#define ATTR_AVX2           __attribute__((target("avx2")))
+#define ATTR_AVX512         __attribute__((target("avx512f,avx512bw")))
+#endif
+
+#endif /*SIMDPRIV_H*/
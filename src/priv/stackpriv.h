@@ -28,6 +28,7 @@ struct StackClass;
 struct Stack {
     struct StackClass*  klass;
     List_t              list;
+    unsigned            site;   ///< the creation site of the stack
 };
 
 typedef struct Stack Stack;
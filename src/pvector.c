@@ -0,0 +1,667 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pvector.h"
+#include "priv/memtracepriv.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * A node has up to 1 << PV_BITS children or elements.
+ */
+#define PV_BITS     5
+#define PV_BRANCH   (1u << PV_BITS)
+#define PV_MASK     (PV_BRANCH - 1)
+
+/*
+ * A concatenation may leave this many more nodes on a level than needed,
+ * the extra search steps in a relaxed node are bounded by it.
+ */
+#define PV_EXTRA    2
+
+/**
+ * \brief A leaf or inner node of a vector.
+ *
+ * A leaf holds up to PV_BRANCH elements. An inner node holds up to
+ * PV_BRANCH children and the cumulative sizes of its children. When all
+ * children but the last are full the node is balanced and is searched
+ * by radix, otherwise it is relaxed and is searched with the sizes.
+ * Whether a node is a leaf follows from its height in the tree. Nodes
+ * are never modified after they are shared.
+ *
+ * \private
+ */
+struct PVNode {
+    atomic_size_t   refs;
+    unsigned        site;
+    uint16_t        n;          ///< the number of children or elements.
+    uint8_t         relaxed;
+    _Alignas(max_align_t) char items[];
+};
+
+typedef struct PVNode PVNode;
+
+/**
+ * \brief A version of a vector.
+ * \private
+ */
+struct PVector {
+    atomic_size_t   refs;
+    size_t          size;
+    size_t          esize;
+    unsigned        height;     ///< 0 when the root is a leaf.
+    unsigned        site;
+    PVNode*         root;       ///< NULL when the vector is empty.
+};
+
+typedef struct PVector PVector;
+
+#define PV_INNER_SIZE \
+    (offsetof(PVNode, items) + PV_BRANCH * (sizeof(PVNode*) + sizeof(size_t)))
+
+static inline size_t
+pv_leaf_size(size_t esize)
+{
+    return offsetof(PVNode, items) + PV_BRANCH * esize;
+}
+
+static inline PVNode**
+pv_children(const PVNode* node)
+{
+    return (PVNode**) node->items;
+}
+
+static inline size_t*
+pv_sizes(const PVNode* node)
+{
+    return (size_t*) (node->items + PV_BRANCH * sizeof(PVNode*));
+}
+
+static inline char*
+pv_elem(const PVNode* node, size_t i, size_t esize)
+{
+    return (char*) node->items + i * esize;
+}
+
+/*
+ * Returns the number of elements below a node at height h.
+ */
+static inline size_t
+pv_count(const PVNode* node, unsigned h)
+{
+    return h ? pv_sizes(node)[node->n - 1] : node->n;
+}
+
+static PVNode*
+pv_node_alloc(const PVector* v, unsigned h)
+{
+    unsigned site = clib_mem_current_site();
+    size_t size = h ? PV_INNER_SIZE : pv_leaf_size(v->esize);
+    PVNode* node = clib_malloc(CLIB_MEM_PVECTOR, site, size);
+    if (node) {
+        atomic_init(&node->refs, 1);
+        node->site = site;
+        node->n = 0;
+        node->relaxed = 0;
+    }
+    return node;
+}
+
+static inline PVNode*
+pv_node_retain(PVNode* node)
+{
+    atomic_fetch_add_explicit(&node->refs, 1, memory_order_relaxed);
+    return node;
+}
+
+static void
+pv_node_release(PVNode* node, unsigned h, size_t esize)
+{
+    if (atomic_fetch_sub_explicit(&node->refs, 1, memory_order_acq_rel) > 1)
+        return;
+
+    if (h) {
+        for (unsigned i = 0; i < node->n; i++)
+            pv_node_release(pv_children(node)[i], h - 1, esize);
+    }
+    clib_free(CLIB_MEM_PVECTOR,
+              node->site,
+              node,
+              h ? PV_INNER_SIZE : pv_leaf_size(esize)
+              );
+}
+
+/*
+ * Computes the sizes of an inner node at height h and whether it is
+ * relaxed.
+ */
+static void
+pv_node_finish(PVNode* node, unsigned h)
+{
+    const size_t cap = (size_t) 1 << (PV_BITS * h);
+    size_t total = 0;
+
+    node->relaxed = 0;
+    for (unsigned i = 0; i < node->n; i++) {
+        size_t count = pv_count(pv_children(node)[i], h - 1);
+        if (count != cap && i + 1 < node->n)
+            node->relaxed = 1;
+        total += count;
+        pv_sizes(node)[i] = total;
+    }
+}
+
+/*
+ * Returns a copy of node that shares its children.
+ */
+static PVNode*
+pv_node_copy(const PVector* v, const PVNode* node, unsigned h)
+{
+    PVNode* copy = pv_node_alloc(v, h);
+    if (!copy)
+        return NULL;
+
+    copy->n = node->n;
+    copy->relaxed = node->relaxed;
+    if (h) {
+        memcpy(copy->items,
+               node->items,
+               PV_INNER_SIZE - offsetof(PVNode, items)
+               );
+        for (unsigned i = 0; i < copy->n; i++)
+            pv_node_retain(pv_children(copy)[i]);
+    }
+    else
+        memcpy(copy->items, node->items, node->n * v->esize);
+    return copy;
+}
+
+/*
+ * Returns the child of an inner node at height h that holds element *i,
+ * *i becomes the index in the child.
+ */
+static inline unsigned
+pv_child_index(const PVNode* node, unsigned h, size_t* i)
+{
+    unsigned shift = PV_BITS * h;
+    unsigned slot;
+
+    if (!node->relaxed) {
+        slot = (*i >> shift) & PV_MASK;
+        *i &= ((size_t) 1 << shift) - 1;
+        return slot;
+    }
+
+    // a child holds at most 1 << shift elements, the radix is a lower bound.
+    const size_t* sizes = pv_sizes(node);
+    slot = *i >> shift;
+    while (sizes[slot] <= *i)
+        slot++;
+    if (slot)
+        *i -= sizes[slot - 1];
+    return slot;
+}
+
+static PVector*
+pv_version(const PVector* v, PVNode* root, unsigned height, size_t size)
+{
+    unsigned site = clib_mem_current_site();
+    PVector* nv = clib_malloc(CLIB_MEM_PVECTOR, site, sizeof(PVector));
+    if (!nv)
+        return NULL;
+
+    atomic_init(&nv->refs, 1);
+    nv->size = size;
+    nv->esize = v->esize;
+    nv->height = height;
+    nv->site = site;
+    nv->root = root;
+    return nv;
+}
+
+PVector_t
+pvector_create(size_t element_size)
+{
+    PVector proto = {0};
+
+    assert(element_size);
+    proto.esize = element_size;
+    return pv_version(&proto, NULL, 0, 0);
+}
+
+PVector_t
+pvector_retain(const PVector_t vec)
+{
+    PVector* v = (PVector*) vec;
+    atomic_fetch_add_explicit(&v->refs, 1, memory_order_relaxed);
+    return v;
+}
+
+void
+pvector_release(PVector_t vec)
+{
+    PVector* v = vec;
+
+    if (atomic_fetch_sub_explicit(&v->refs, 1, memory_order_acq_rel) > 1)
+        return;
+
+    if (v->root)
+        pv_node_release(v->root, v->height, v->esize);
+    clib_free(CLIB_MEM_PVECTOR, v->site, v, sizeof(PVector));
+}
+
+size_t
+pvector_size(const PVector_t vec)
+{
+    const PVector* v = vec;
+    return v->size;
+}
+
+const void*
+pvector_get(const PVector_t vec, size_t i)
+{
+    const PVector* v = vec;
+    const PVNode* node = v->root;
+
+    assert(i < v->size);
+    for (unsigned h = v->height; h; h--)
+        node = pv_children(node)[pv_child_index(node, h, &i)];
+    return pv_elem(node, i, v->esize);
+}
+
+/* * set * */
+
+static PVNode*
+pv_set(const PVector*   v,
+       const PVNode*    node,
+       unsigned         h,
+       size_t           i,
+       const void*      value
+       )
+{
+    PVNode* copy = pv_node_copy(v, node, h);
+    if (!copy)
+        return NULL;
+
+    if (!h) {
+        memcpy(pv_elem(copy, i, v->esize), value, v->esize);
+        return copy;
+    }
+
+    unsigned slot = pv_child_index(node, h, &i);
+    PVNode* child = pv_set(v, pv_children(node)[slot], h - 1, i, value);
+    if (!child) {
+        pv_node_release(copy, h, v->esize);
+        return NULL;
+    }
+    pv_node_release(pv_children(copy)[slot], h - 1, v->esize);
+    pv_children(copy)[slot] = child;
+    return copy;
+}
+
+PVector_t
+pvector_set(const PVector_t vec, size_t i, const void* value)
+{
+    const PVector* v = vec;
+    PVector* nv;
+    PVNode* root;
+
+    assert(i < v->size);
+    if (!(root = pv_set(v, v->root, v->height, i, value)))
+        return NULL;
+    if (!(nv = pv_version(v, root, v->height, v->size)))
+        pv_node_release(root, v->height, v->esize);
+    return nv;
+}
+
+/* * push back * */
+
+static int
+pv_has_room(const PVNode* node, unsigned h)
+{
+    if (node->n < PV_BRANCH)
+        return 1;
+    return h ? pv_has_room(pv_children(node)[node->n - 1], h - 1) : 0;
+}
+
+/*
+ * Returns a new path of height h to a leaf with value.
+ */
+static PVNode*
+pv_new_path(const PVector* v, unsigned h, const void* value)
+{
+    PVNode* node = pv_node_alloc(v, 0);
+    if (!node)
+        return NULL;
+    memcpy(pv_elem(node, 0, v->esize), value, v->esize);
+    node->n = 1;
+
+    for (unsigned level = 1; level <= h; level++) {
+        PVNode* parent = pv_node_alloc(v, level);
+        if (!parent) {
+            pv_node_release(node, level - 1, v->esize);
+            return NULL;
+        }
+        pv_children(parent)[0] = node;
+        parent->n = 1;
+        pv_node_finish(parent, level);
+        node = parent;
+    }
+    return node;
+}
+
+/*
+ * Appends value below a node at height h that has room for it.
+ */
+static PVNode*
+pv_push(const PVector* v, const PVNode* node, unsigned h, const void* value)
+{
+    PVNode* copy = pv_node_copy(v, node, h), *child;
+    if (!copy)
+        return NULL;
+
+    if (!h) {
+        memcpy(pv_elem(copy, copy->n++, v->esize), value, v->esize);
+        return copy;
+    }
+
+    PVNode* last = pv_children(node)[node->n - 1];
+    if (pv_has_room(last, h - 1)) {
+        if (!(child = pv_push(v, last, h - 1, value)))
+            goto error;
+        pv_node_release(pv_children(copy)[copy->n - 1], h - 1, v->esize);
+        pv_children(copy)[copy->n - 1] = child;
+    }
+    else {
+        if (!(child = pv_new_path(v, h - 1, value)))
+            goto error;
+        pv_children(copy)[copy->n++] = child;
+    }
+    pv_node_finish(copy, h);
+    return copy;
+
+error:
+    pv_node_release(copy, h, v->esize);
+    return NULL;
+}
+
+PVector_t
+pvector_push_back(const PVector_t vec, const void* value)
+{
+    const PVector* v = vec;
+    unsigned height = v->height;
+    PVector* nv;
+    PVNode* root;
+
+    if (!v->root)
+        root = pv_new_path(v, 0, value);
+    else if (pv_has_room(v->root, v->height))
+        root = pv_push(v, v->root, v->height, value);
+    else {
+        // the tree is full, grow a level.
+        PVNode* path = pv_new_path(v, height, value);
+        root = path ? pv_node_alloc(v, height + 1) : NULL;
+        if (!root) {
+            if (path)
+                pv_node_release(path, height, v->esize);
+            return NULL;
+        }
+        pv_children(root)[0] = pv_node_retain(v->root);
+        pv_children(root)[1] = path;
+        root->n = 2;
+        pv_node_finish(root, ++height);
+    }
+
+    if (!root)
+        return NULL;
+    if (!(nv = pv_version(v, root, height, v->size + 1)))
+        pv_node_release(root, height, v->esize);
+    return nv;
+}
+
+/* * concatenation * */
+
+/*
+ * Merges the children of left but its last, the children of center and
+ * the children of right but its first, all at height h - 1. They are
+ * redistributed so there are at most PV_EXTRA nodes more than needed.
+ * left and right are borrowed and center is consumed.
+ *
+ * Returns a node at height h + 1 with one or two children, or for the
+ * top of the tree a node at height h when that suffices.
+ */
+static PVNode*
+pv_rebalance(const PVector*   v,
+             const PVNode*    left,
+             PVNode*          center,
+             const PVNode*    right,
+             unsigned         h,
+             int              top,
+             unsigned*        height
+             )
+{
+    PVNode* items[3 * PV_BRANCH], *merged[3 * PV_BRANCH];
+    unsigned counts[3 * PV_BRANCH];
+    unsigned n = 0, nmerged = 0, owned = 0, total = 0;
+    PVNode* parents[2] = {NULL, NULL}, *result = NULL;
+
+    if (left)
+        for (unsigned i = 0; i + 1 < left->n; i++)
+            items[n++] = pv_children(left)[i];
+    for (unsigned i = 0; i < center->n; i++)
+        items[n++] = pv_children(center)[i];
+    if (right)
+        for (unsigned i = 1; i < right->n; i++)
+            items[n++] = pv_children(right)[i];
+
+    // plan the number of children or elements of the merged nodes.
+    for (unsigned i = 0; i < n; i++)
+        total += counts[i] = items[i]->n;
+    unsigned optimal = (total + PV_BRANCH - 1) / PV_BRANCH;
+    unsigned len = n, i = 0;
+    while (len > optimal + PV_EXTRA) {
+        while (counts[i] > PV_BRANCH - PV_EXTRA / 2)
+            i++;
+        // spread the node at i over the nodes after it.
+        unsigned remaining = counts[i];
+        do {
+            unsigned size = remaining + counts[i + 1];
+            if (size > PV_BRANCH)
+                size = PV_BRANCH;
+            remaining = remaining + counts[i + 1] - size;
+            counts[i] = size;
+            i++;
+        } while (remaining > 0);
+        for (unsigned j = i; j + 1 < len; j++)
+            counts[j] = counts[j + 1];
+        len--;
+        i--;
+    }
+
+    // carry out the plan, nodes that stay the same are shared.
+    unsigned src = 0, offset = 0;
+    for (unsigned k = 0; k < len; k++) {
+        PVNode* s = items[src];
+        if (offset == 0 && s->n == counts[k]) {
+            merged[nmerged++] = pv_node_retain(s);
+            src++;
+            continue;
+        }
+
+        PVNode* node = pv_node_alloc(v, h - 1);
+        if (!node)
+            goto error;
+        while (node->n < counts[k]) {
+            s = items[src];
+            unsigned take = counts[k] - node->n;
+            if (take > s->n - offset)
+                take = s->n - offset;
+            if (h - 1) {
+                for (unsigned j = 0; j < take; j++)
+                    pv_children(node)[node->n + j] =
+                        pv_node_retain(pv_children(s)[offset + j]);
+            }
+            else {
+                memcpy(pv_elem(node, node->n, v->esize),
+                       pv_elem(s, offset, v->esize),
+                       take * v->esize
+                       );
+            }
+            node->n += take;
+            offset += take;
+            if (offset == s->n) {
+                src++;
+                offset = 0;
+            }
+        }
+        if (h - 1)
+            pv_node_finish(node, h - 1);
+        merged[nmerged++] = node;
+    }
+
+    // distribute the merged nodes over one or two parents.
+    for (unsigned p = 0; p * PV_BRANCH < nmerged; p++) {
+        unsigned first = p * PV_BRANCH;
+        unsigned k = nmerged - first < PV_BRANCH ? nmerged - first : PV_BRANCH;
+        if (!(parents[p] = pv_node_alloc(v, h)))
+            goto error;
+        memcpy(pv_children(parents[p]), merged + first, k * sizeof(PVNode*));
+        parents[p]->n = k;
+        pv_node_finish(parents[p], h);
+        owned += k;
+    }
+
+    if (top && !parents[1]) {
+        result = parents[0];
+        *height = h;
+    }
+    else {
+        if (!(result = pv_node_alloc(v, h + 1)))
+            goto error;
+        pv_children(result)[0] = parents[0];
+        pv_children(result)[1] = parents[1];
+        result->n = parents[1] ? 2 : 1;
+        pv_node_finish(result, h + 1);
+        *height = h + 1;
+    }
+    pv_node_release(center, h, v->esize);
+    return result;
+
+error:
+    for (unsigned k = 0; k < 2; k++)
+        if (parents[k])
+            pv_node_release(parents[k], h, v->esize);
+    for (unsigned k = owned; k < nmerged; k++)
+        pv_node_release(merged[k], h - 1, v->esize);
+    pv_node_release(center, h, v->esize);
+    return NULL;
+}
+
+/*
+ * Concatenates left at height hl and right at height hr. Returns a node
+ * at height max(hl, hr) + 1, or for the top of the tree possibly a node
+ * at height max(hl, hr). The height of the result is stored in height.
+ */
+static PVNode*
+pv_concat(const PVector*   v,
+          const PVNode*    left,
+          unsigned         hl,
+          const PVNode*    right,
+          unsigned         hr,
+          int              top,
+          unsigned*        height
+          )
+{
+    PVNode* center;
+    unsigned hc;
+
+    if (hl > hr) {
+        center = pv_concat(v, pv_children(left)[left->n - 1], hl - 1,
+                           right, hr, 0, &hc);
+        return center ? pv_rebalance(v, left, center, NULL, hl, top, height)
+                      : NULL;
+    }
+    if (hl < hr) {
+        center = pv_concat(v, left, hl, pv_children(right)[0], hr - 1,
+                           0, &hc);
+        return center ? pv_rebalance(v, NULL, center, right, hr, top, height)
+                      : NULL;
+    }
+    if (hl == 0) {
+        PVNode* node;
+        if (top && left->n + right->n <= PV_BRANCH) {
+            if (!(node = pv_node_copy(v, left, 0)))
+                return NULL;
+            memcpy(pv_elem(node, node->n, v->esize),
+                   right->items,
+                   right->n * v->esize
+                   );
+            node->n += right->n;
+            *height = 0;
+            return node;
+        }
+        // the leaves are merged with their neighbours by the caller.
+        if (!(node = pv_node_alloc(v, 1)))
+            return NULL;
+        pv_children(node)[0] = pv_node_retain((PVNode*) left);
+        pv_children(node)[1] = pv_node_retain((PVNode*) right);
+        node->n = 2;
+        pv_node_finish(node, 1);
+        *height = 1;
+        return node;
+    }
+
+    center = pv_concat(v, pv_children(left)[left->n - 1], hl - 1,
+                       pv_children(right)[0], hr - 1, 0, &hc);
+    return center ? pv_rebalance(v, left, center, right, hl, top, height)
+                  : NULL;
+}
+
+PVector_t
+pvector_concat(const PVector_t left, const PVector_t right)
+{
+    const PVector* l = left, *r = right;
+    PVector* nv;
+    PVNode* root;
+    unsigned height;
+
+    assert(l->esize == r->esize);
+    if (!r->root)
+        return pvector_retain(left);
+    if (!l->root)
+        return pvector_retain(right);
+
+    root = pv_concat(l, l->root, l->height, r->root, r->height, 1, &height);
+    if (!root)
+        return NULL;
+
+    // drop the levels that have a single child.
+    while (height && root->n == 1) {
+        PVNode* child = pv_node_retain(pv_children(root)[0]);
+        pv_node_release(root, height--, l->esize);
+        root = child;
+    }
+
+    if (!(nv = pv_version(l, root, height, l->size + r->size)))
+        pv_node_release(root, height, l->esize);
+    return nv;
+}
@@ -0,0 +1,106 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PVECTOR_H
+#define PVECTOR_H
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A persistent vector, a relaxed radix balanced (RRB) tree.
+ *
+ * A PVector_t is an immutable version of a vector. The elements are in
+ * leaves of 32 elements below inner nodes with 32 children, an update
+ * copies the path from the root to one leaf and shares all other nodes
+ * with the old version, so it costs O(log32 n). Two vectors are
+ * concatenated in O(log32 n) by merging only the nodes along the seam,
+ * the nodes there may hold fewer children and carry a table with the
+ * sizes of their children.
+ *
+ * The nodes are reference counted with atomic counters, every version
+ * stays readable without locking by any thread that holds a reference.
+ * Elements are copied bytewise between nodes, so they should not own
+ * resources, store a pointer to such elements instead.
+ */
+typedef void* PVector_t;
+
+/**
+ * Create an empty vector.
+ *
+ * @param element_size [in] the sizeof() an single element, not 0.
+ *
+ * @return a reference to the empty vector or NULL when out of memory.
+ */
+PVector_t pvector_create(size_t element_size);
+
+/**
+ * Returns a new reference to vec, a snapshot in constant time.
+ */
+PVector_t pvector_retain(const PVector_t vec);
+
+/**
+ * Releases a reference, the nodes that are no longer referenced by any
+ * version are freed.
+ */
+void pvector_release(PVector_t vec);
+
+/**
+ * Returns the number of elements.
+ */
+size_t pvector_size(const PVector_t vec);
+
+/**
+ * Returns a pointer to element i, i < pvector_size(vec).
+ *
+ * The element is valid as long as vec is and must not be modified.
+ */
+const void* pvector_get(const PVector_t vec, size_t i);
+
+/**
+ * Returns a new vector with element i replaced by value.
+ *
+ * @return a reference to the new vector or NULL when out of memory.
+ */
+PVector_t pvector_set(const PVector_t vec, size_t i, const void* value);
+
+/**
+ * Returns a new vector with value appended.
+ *
+ * @return a reference to the new vector or NULL when out of memory.
+ */
+PVector_t pvector_push_back(const PVector_t vec, const void* value);
+
+/**
+ * Returns the concatenation of two vectors with the same element size.
+ *
+ * Both vectors remain valid and share their nodes with the result.
+ *
+ * @return a reference to the new vector or NULL when out of memory.
+ */
+PVector_t pvector_concat(const PVector_t left, const PVector_t right);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef PVECTOR_H*/
@@ -0,0 +1,290 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "slotmap.h"
+#include "priv/memtracepriv.h"
+#include <string.h>
+#include <assert.h>
+
+/**
+ * \brief A slot of the indirection table.
+ *
+ * A slot in use holds the position of its element in the dense array, a
+ * free slot the index of the next free slot.
+ *
+ * \private
+ */
+struct Slot {
+    uint32_t    index;
+    uint32_t    generation; ///< bumped when the element is erased.
+};
+
+/**
+ * \brief the private implementation of a slot map.
+ *
+ * The dense array and the slots have the same capacity: the slots only
+ * grow when none is free, that is when every slot is in use. The owners
+ * array maps a position in the dense array back to its slot, erase uses
+ * it to update the slot of the element that moves and lookups to verify
+ * that a slot is in use.
+ *
+ * \private
+ */
+struct SlotMap {
+    char*           data;       ///< capacity elements.
+    struct Slot*    slots;      ///< capacity slots followed by the owners.
+    uint32_t*       owners;     ///< the slot of each element.
+    size_t          size;
+    size_t          capacity;
+    size_t          nslots;     ///< the number of slots ever used.
+    uint32_t        free_head;  ///< the first free slot or SLOT_END.
+    size_t          element_size;
+    clib_free_func  ff;
+    clib_copy_func  cf;
+    unsigned        site;       ///< creation site for memory accounting.
+};
+
+typedef struct SlotMap SlotMap;
+
+#define SLOT_END UINT32_MAX
+#define SLOT_MAX_CAPACITY ((size_t) UINT32_MAX)
+#define SLOT_MIN_CAPACITY 16
+
+static inline size_t
+meta_bytes(size_t capacity)
+{
+    return capacity * (sizeof(struct Slot) + sizeof(uint32_t));
+}
+
+static inline SlotHandle
+make_handle(uint32_t slot, uint32_t generation)
+{
+    return ((SlotHandle) generation << 32) | slot;
+}
+
+/*
+ * Returns the slot of handle when it refers to an element, otherwise NULL.
+ */
+static inline struct Slot*
+lookup(const SlotMap* m, SlotHandle handle)
+{
+    uint32_t i = (uint32_t) handle;
+    if (i >= m->nslots)
+        return NULL;
+    struct Slot* slot = &m->slots[i];
+    if (slot->generation != (uint32_t) (handle >> 32) ||
+        slot->index >= m->size ||
+        m->owners[slot->index] != i)
+        return NULL;
+    return slot;
+}
+
+static inline void
+bump(struct Slot* slot)
+{
+    // generation 0 is never handed out, so SLOT_HANDLE_NULL stays invalid.
+    if (++slot->generation == 0)
+        slot->generation = 1;
+}
+
+static int
+grow(SlotMap* m, size_t capacity)
+{
+    if (capacity > SLOT_MAX_CAPACITY)
+        return 1;
+
+    struct Slot* slots = clib_malloc(
+            CLIB_MEM_SLOTMAP, m->site, meta_bytes(capacity)
+            );
+    if (!slots)
+        return 1;
+    uint32_t* owners = (uint32_t*) (slots + capacity);
+
+    char* data = clib_realloc(
+            CLIB_MEM_SLOTMAP,
+            m->site,
+            m->data,
+            m->capacity * m->element_size,
+            capacity * m->element_size
+            );
+    if (!data) {
+        clib_free(CLIB_MEM_SLOTMAP, m->site, slots, meta_bytes(capacity));
+        return 1;
+    }
+
+    if (m->slots) {
+        memcpy(slots, m->slots, m->nslots * sizeof(struct Slot));
+        memcpy(owners, m->owners, m->size * sizeof(uint32_t));
+        clib_free(
+                CLIB_MEM_SLOTMAP, m->site, m->slots, meta_bytes(m->capacity)
+                );
+    }
+    m->data = data;
+    m->slots = slots;
+    m->owners = owners;
+    m->capacity = capacity;
+    return 0;
+}
+
+SlotMap_t slotmap_create(size_t         element_size,
+                         clib_free_func ff,
+                         clib_copy_func cf
+                         )
+{
+    assert(element_size > 0);
+    unsigned site = clib_mem_current_site();
+    SlotMap* m = clib_calloc(CLIB_MEM_SLOTMAP, site, 1, sizeof(SlotMap));
+    if (!m)
+        return NULL;
+
+    m->free_head = SLOT_END;
+    m->element_size = element_size;
+    m->ff = ff;
+    m->cf = cf ? cf : memcpy;
+    m->site = site;
+    return m;
+}
+
+void slotmap_destroy(SlotMap_t map)
+{
+    SlotMap* m = map;
+    if (m->ff)
+        for (size_t i = 0; i < m->size; i++)
+            m->ff(m->data + i * m->element_size);
+    clib_free(
+            CLIB_MEM_SLOTMAP,
+            m->site,
+            m->data,
+            m->capacity * m->element_size
+            );
+    clib_free(CLIB_MEM_SLOTMAP, m->site, m->slots, meta_bytes(m->capacity));
+    clib_free(CLIB_MEM_SLOTMAP, m->site, m, sizeof(SlotMap));
+}
+
+size_t slotmap_size(const SlotMap_t map)
+{
+    const SlotMap* m = map;
+    return m->size;
+}
+
+int slotmap_reserve(SlotMap_t map, size_t capacity)
+{
+    SlotMap* m = map;
+    if (capacity <= m->capacity)
+        return 0;
+    return grow(m, capacity);
+}
+
+SlotHandle slotmap_insert(SlotMap_t map, const void* value)
+{
+    SlotMap* m = map;
+    if (m->size == m->capacity) {
+        size_t capacity = m->capacity ? m->capacity * 2 : SLOT_MIN_CAPACITY;
+        if (capacity > SLOT_MAX_CAPACITY)
+            capacity = SLOT_MAX_CAPACITY;
+        if (capacity == m->capacity || grow(m, capacity))
+            return SLOT_HANDLE_NULL;
+    }
+
+    uint32_t i;
+    if (m->free_head != SLOT_END) {
+        i = m->free_head;
+        m->free_head = m->slots[i].index;
+    }
+    else {
+        i = (uint32_t) m->nslots++;
+        m->slots[i].generation = 1;
+    }
+
+    m->cf(m->data + m->size * m->element_size, value, m->element_size);
+    m->slots[i].index = (uint32_t) m->size;
+    m->owners[m->size] = i;
+    m->size++;
+    return make_handle(i, m->slots[i].generation);
+}
+
+void* slotmap_get(const SlotMap_t map, SlotHandle handle)
+{
+    const SlotMap* m = map;
+    struct Slot* slot = lookup(m, handle);
+    return slot ? m->data + (size_t) slot->index * m->element_size : NULL;
+}
+
+int slotmap_contains(const SlotMap_t map, SlotHandle handle)
+{
+    return lookup(map, handle) != NULL;
+}
+
+int slotmap_erase(SlotMap_t map, SlotHandle handle)
+{
+    SlotMap* m = map;
+    struct Slot* slot = lookup(m, handle);
+    if (!slot)
+        return 1;
+
+    size_t esize = m->element_size;
+    uint32_t pos = slot->index;
+    size_t last = m->size - 1;
+    if (m->ff)
+        m->ff(m->data + pos * esize);
+    if (pos != last) {
+        memcpy(m->data + pos * esize, m->data + last * esize, esize);
+        m->owners[pos] = m->owners[last];
+        m->slots[m->owners[pos]].index = pos;
+    }
+    m->size--;
+
+    bump(slot);
+    slot->index = m->free_head;
+    m->free_head = (uint32_t) (slot - m->slots);
+    return 0;
+}
+
+void slotmap_clear(SlotMap_t map)
+{
+    SlotMap* m = map;
+    if (m->ff)
+        for (size_t i = 0; i < m->size; i++)
+            m->ff(m->data + i * m->element_size);
+    for (size_t i = 0; i < m->size; i++)
+        bump(&m->slots[m->owners[i]]);
+    m->size = 0;
+
+    // relink all slots, the lowest first.
+    m->free_head = SLOT_END;
+    for (size_t i = m->nslots; i-- > 0;) {
+        m->slots[i].index = m->free_head;
+        m->free_head = (uint32_t) i;
+    }
+}
+
+void* slotmap_data(const SlotMap_t map)
+{
+    const SlotMap* m = map;
+    return m->size ? m->data : NULL;
+}
+
+SlotHandle slotmap_handle_at(const SlotMap_t map, size_t i)
+{
+    const SlotMap* m = map;
+    assert(i < m->size);
+    uint32_t slot = m->owners[i];
+    return make_handle(slot, m->slots[slot].generation);
+}
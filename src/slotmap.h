@@ -0,0 +1,141 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A slot map stores elements in one dense array and hands out handles to
+ * them.
+ *
+ * A handle holds the index of a slot in its low 32 bits and the generation
+ * of that slot in its high 32 bits. The slot refers to the position of the
+ * element in the dense array. Erasing an element moves the last element
+ * in its place and bumps the generation of the slot, so a handle of an
+ * erased element never aliases a newer element. Insertion, erasure and
+ * lookup are O(1) and the elements can be iterated as a plain array.
+ */
+typedef void* SlotMap_t;
+
+/**
+ * A handle of an element in a slot map.
+ */
+typedef uint64_t SlotHandle;
+
+/**
+ * A handle that never refers to an element.
+ */
+#define SLOT_HANDLE_NULL ((SlotHandle) 0)
+
+/**
+ * Create an empty slot map.
+ *
+ * @param element_size [in] the sizeof() an single element.
+ * @param ff [in] called with an element before it is erased, may be NULL.
+ * @param cf [in] the function used to copy an element into the map.
+ *                if none is specified memcpy will be used.
+ *
+ * @return the map or NULL when out of memory.
+ */
+SlotMap_t slotmap_create(size_t         element_size,
+                         clib_free_func ff,
+                         clib_copy_func cf
+                         );
+
+/**
+ * Destroys the map and frees all elements.
+ */
+void slotmap_destroy(SlotMap_t map);
+
+/**
+ * Returns the number of elements.
+ */
+size_t slotmap_size(const SlotMap_t map);
+
+/**
+ * Make room for capacity elements, so that inserting them doesn't
+ * allocate.
+ *
+ * @return 0 or !0 when out of memory.
+ */
+int slotmap_reserve(SlotMap_t map, size_t capacity);
+
+/**
+ * Copies value into the map.
+ *
+ * The element is stored at the end of the dense array, pointers to
+ * elements are invalidated when the array grows.
+ *
+ * @return the handle of the element or SLOT_HANDLE_NULL when out of memory.
+ */
+SlotHandle slotmap_insert(SlotMap_t map, const void* value);
+
+/**
+ * Returns a pointer to the element of handle, or NULL when the element
+ * is erased.
+ */
+void* slotmap_get(const SlotMap_t map, SlotHandle handle);
+
+/**
+ * Returns !0 when handle refers to an element of the map.
+ */
+int slotmap_contains(const SlotMap_t map, SlotHandle handle);
+
+/**
+ * Erases the element of handle.
+ *
+ * The last element of the dense array is moved in its place, the handle
+ * of that element remains valid.
+ *
+ * @return 0 or !0 when handle doesn't refer to an element.
+ */
+int slotmap_erase(SlotMap_t map, SlotHandle handle);
+
+/**
+ * Erases all elements, all handles become invalid.
+ */
+void slotmap_clear(SlotMap_t map);
+
+/**
+ * Returns the dense array of slotmap_size() elements, or NULL when the map
+ * is empty. Iterate over the elements with:
+ *
+ *     for (i = 0; i < slotmap_size(map); i++)
+ *         use((T*) slotmap_data(map) + i);
+ */
+void* slotmap_data(const SlotMap_t map);
+
+/**
+ * Returns the handle of the element at index i of the dense array.
+ */
+SlotHandle slotmap_handle_at(const SlotMap_t map, size_t i);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef SLOTMAP_H*/
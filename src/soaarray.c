@@ -0,0 +1,313 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "soaarray.h"
+#include "priv/memtracepriv.h"
+#include "priv/cachelinepriv.h"
+#include <string.h>
+#include <assert.h>
+
+/**
+ * \brief the private implementation of a structure of arrays.
+ *
+ * All columns live in one buffer, column f starts at offsets[f], which is
+ * a multiple of the cache line size.
+ *
+ * \private
+ */
+struct SoaArray {
+    size_t      nfields;    ///< the number of columns.
+    size_t      size;       ///< number of records.
+    size_t      cap;        ///< capacity in records.
+    char*       block;      ///< the buffer of all columns.
+    size_t      block_size; ///< size of block in bytes.
+    unsigned    site;       ///< creation site for memory accounting.
+    size_t*     offsets;    ///< the start of every column in block.
+    size_t      sizes[];    ///< the size of every field, then the offsets.
+};
+
+typedef struct SoaArray SoaArray;
+
+#define SOA_ARRAY_INC 2
+
+/*
+ * Returns the size of the buffer for cap records.
+ */
+static size_t
+block_size(const SoaArray* a, size_t cap)
+{
+    size_t total = 0;
+    for (size_t f = 0; f < a->nfields; f++)
+        total += CLIB_CACHE_ROUND(cap * a->sizes[f]);
+    return total;
+}
+
+static inline char*
+column(const SoaArray* a, size_t field)
+{
+    return a->block + a->offsets[field];
+}
+
+SoaArray_t
+soa_array_create(size_t nfields, const size_t* field_sizes)
+{
+    unsigned site = clib_mem_current_site();
+    size_t bytes = sizeof(SoaArray) + 2 * nfields * sizeof(size_t);
+    SoaArray* a = clib_calloc(CLIB_MEM_SOA_ARRAY, site, 1, bytes);
+    if (!a)
+        return NULL;
+
+    a->nfields = nfields;
+    a->site = site;
+    a->offsets = a->sizes + nfields;
+    memcpy(a->sizes, field_sizes, nfields * sizeof(size_t));
+    return a;
+}
+
+void
+soa_array_destroy(SoaArray_t array)
+{
+    SoaArray* a = array;
+    if (a->block)
+        clib_free(CLIB_MEM_SOA_ARRAY, a->site, a->block, a->block_size);
+    clib_free(CLIB_MEM_SOA_ARRAY,
+              a->site,
+              a,
+              sizeof(SoaArray) + 2 * a->nfields * sizeof(size_t)
+              );
+}
+
+size_t
+soa_array_size(const SoaArray_t array)
+{
+    const SoaArray* a = array;
+    return a->size;
+}
+
+size_t
+soa_array_capacity(const SoaArray_t array)
+{
+    const SoaArray* a = array;
+    return a->cap;
+}
+
+size_t
+soa_array_nfields(const SoaArray_t array)
+{
+    const SoaArray* a = array;
+    return a->nfields;
+}
+
+size_t
+soa_array_field_size(const SoaArray_t array, size_t field)
+{
+    const SoaArray* a = array;
+    assert(field < a->nfields);
+    return a->sizes[field];
+}
+
+int
+soa_array_reserve_capacity(SoaArray_t array, size_t capacity)
+{
+    SoaArray* a = array;
+    char* block = NULL;
+    size_t bytes = block_size(a, capacity);
+    size_t offset = 0;
+    assert(capacity >= a->size);
+
+    if (bytes) {
+        block = clib_aligned_alloc(CLIB_MEM_SOA_ARRAY,
+                                   a->site,
+                                   CLIB_CACHE_LINE,
+                                   bytes
+                                   );
+        if (!block)
+            return SOA_ARRAY_OUT_OF_MEM;
+    }
+
+    for (size_t f = 0; f < a->nfields; f++) {
+        if (a->size)
+            memcpy(block + offset, column(a, f), a->size * a->sizes[f]);
+        a->offsets[f] = offset;
+        offset += CLIB_CACHE_ROUND(capacity * a->sizes[f]);
+    }
+
+    if (a->block)
+        clib_free(CLIB_MEM_SOA_ARRAY, a->site, a->block, a->block_size);
+    a->block = block;
+    a->block_size = bytes;
+    a->cap = capacity;
+    return SOA_ARRAY_OK;
+}
+
+/*
+ * Make room for n more records.
+ */
+static int
+grow(SoaArray* a, size_t n)
+{
+    size_t cap = a->cap ? a->cap : 1;
+    if (a->size + n <= a->cap)
+        return SOA_ARRAY_OK;
+    while (cap < a->size + n)
+        cap *= SOA_ARRAY_INC;
+    return soa_array_reserve_capacity(a, cap);
+}
+
+int
+soa_array_resize(SoaArray_t array, size_t size)
+{
+    SoaArray* a = array;
+    if (size > a->size) {
+        if (grow(a, size - a->size))
+            return SOA_ARRAY_OUT_OF_MEM;
+        for (size_t f = 0; f < a->nfields; f++)
+            memset(column(a, f) + a->size * a->sizes[f],
+                   0,
+                   (size - a->size) * a->sizes[f]
+                   );
+    }
+    a->size = size;
+    return SOA_ARRAY_OK;
+}
+
+void*
+soa_array_column(SoaArray_t array, size_t field)
+{
+    SoaArray* a = array;
+    assert(field < a->nfields);
+    return column(a, field);
+}
+
+void*
+soa_array_get(SoaArray_t array, size_t field, size_t n)
+{
+    SoaArray* a = array;
+    assert(field < a->nfields && n < a->size);
+    return column(a, field) + n * a->sizes[field];
+}
+
+int
+soa_array_append_columns(SoaArray_t         array,
+                         const void* const* columns,
+                         size_t             n
+                         )
+{
+    SoaArray* a = array;
+    if (!n)
+        return SOA_ARRAY_OK;
+    if (grow(a, n))
+        return SOA_ARRAY_OUT_OF_MEM;
+
+    for (size_t f = 0; f < a->nfields; f++)
+        memcpy(column(a, f) + a->size * a->sizes[f],
+               columns[f],
+               n * a->sizes[f]
+               );
+    a->size += n;
+    return SOA_ARRAY_OK;
+}
+
+int
+soa_array_append_records(SoaArray_t    array,
+                         const void*   records,
+                         size_t        stride,
+                         const size_t* offsets,
+                         size_t        n
+                         )
+{
+    SoaArray* a = array;
+    if (!n)
+        return SOA_ARRAY_OK;
+    if (grow(a, n))
+        return SOA_ARRAY_OUT_OF_MEM;
+
+    // one column at a time, so the writes are sequential.
+    for (size_t f = 0; f < a->nfields; f++) {
+        size_t w = a->sizes[f];
+        const char* src = (const char*) records + offsets[f];
+        char* dest = column(a, f) + a->size * w;
+        for (size_t i = 0; i < n; i++, src += stride, dest += w)
+            memcpy(dest, src, w);
+    }
+    a->size += n;
+    return SOA_ARRAY_OK;
+}
+
+void
+soa_array_get_record(SoaArray_t    array,
+                     size_t        n,
+                     void*         record,
+                     const size_t* offsets
+                     )
+{
+    SoaArray* a = array;
+    assert(n < a->size);
+    for (size_t f = 0; f < a->nfields; f++)
+        memcpy((char*) record + offsets[f],
+               column(a, f) + n * a->sizes[f],
+               a->sizes[f]
+               );
+}
+
+/*
+ * Gathers the values of a column in the order of perm into dest, the
+ * common sizes get a constant size copy.
+ */
+#define GATHER(W)                                                           \
+    for (size_t i = 0; i < n; i++)                                          \
+        memcpy(dest + i * (W), src + perm[i] * (W), (W))
+
+static void
+gather(char* dest, const char* src, size_t w, const size_t* perm, size_t n)
+{
+    switch (w) {
+        case 1: GATHER(1); break;
+        case 2: GATHER(2); break;
+        case 4: GATHER(4); break;
+        case 8: GATHER(8); break;
+        default: GATHER(w);
+    }
+}
+
+int
+soa_array_permute(SoaArray_t array, const size_t* perm)
+{
+    SoaArray* a = array;
+    size_t widest = 0;
+    char* scratch;
+
+    if (!a->size)
+        return SOA_ARRAY_OK;
+    for (size_t f = 0; f < a->nfields; f++)
+        if (a->sizes[f] > widest)
+            widest = a->sizes[f];
+
+    scratch = clib_malloc(CLIB_MEM_SOA_ARRAY, a->site, widest * a->size);
+    if (!scratch)
+        return SOA_ARRAY_OUT_OF_MEM;
+
+    for (size_t f = 0; f < a->nfields; f++) {
+        gather(scratch, column(a, f), a->sizes[f], perm, a->size);
+        memcpy(column(a, f), scratch, a->size * a->sizes[f]);
+    }
+
+    clib_free(CLIB_MEM_SOA_ARRAY, a->site, scratch, widest * a->size);
+    return SOA_ARRAY_OK;
+}
@@ -0,0 +1,168 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SOAARRAY_H
+#define SOAARRAY_H
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An array of records stored as a structure of arrays.
+ *
+ * Every field of the records is stored in its own column, a contiguous
+ * array that starts on a cache line. A scan over one field only reads
+ * that field. The fields are copied with memcpy, so they should not own
+ * resources.
+ */
+typedef void* SoaArray_t;
+
+enum SoaArrayResult {
+    SOA_ARRAY_OK = 0,
+    SOA_ARRAY_OUT_OF_MEM
+};
+
+/**
+ * Create an empty array.
+ *
+ * @param nfields     [in] the number of fields of a record.
+ * @param field_sizes [in] the sizeof() of every field, nfields values.
+ *
+ * @return the array or NULL when out of memory.
+ */
+SoaArray_t soa_array_create(size_t nfields, const size_t* field_sizes);
+
+/**
+ * Destroys the array and its columns.
+ */
+void soa_array_destroy(SoaArray_t array);
+
+/**
+ * Returns the number of records.
+ */
+size_t soa_array_size(const SoaArray_t array);
+
+/**
+ * Returns the number of records that fit without growing.
+ */
+size_t soa_array_capacity(const SoaArray_t array);
+
+/**
+ * Returns the number of fields of a record.
+ */
+size_t soa_array_nfields(const SoaArray_t array);
+
+/**
+ * Returns the size of a field.
+ */
+size_t soa_array_field_size(const SoaArray_t array, size_t field);
+
+/**
+ * Make sure the array can hold capacity records.
+ *
+ * All columns are moved to a new buffer, so pointers obtained with
+ * soa_array_column() become invalid.
+ *
+ * @param capacity [in] should not be smaller than the size.
+ *
+ * @return SOA_ARRAY_OK or SOA_ARRAY_OUT_OF_MEM
+ */
+int soa_array_reserve_capacity(SoaArray_t array, size_t capacity);
+
+/**
+ * Change the number of records, new records are zeroed.
+ *
+ * @return SOA_ARRAY_OK or SOA_ARRAY_OUT_OF_MEM
+ */
+int soa_array_resize(SoaArray_t array, size_t size);
+
+/**
+ * Returns a pointer to the first value of a column, it is aligned on a
+ * cache line.
+ */
+void* soa_array_column(SoaArray_t array, size_t field);
+
+/**
+ * Returns a pointer to a field of the n-th record.
+ */
+void* soa_array_get(SoaArray_t array, size_t field, size_t n);
+
+/**
+ * Append n records that are given per column.
+ *
+ * @param columns [in] nfields pointers, columns[f] points to n values of
+ *                     field f.
+ * @param n       [in] the number of records.
+ *
+ * @return SOA_ARRAY_OK or SOA_ARRAY_OUT_OF_MEM
+ */
+int soa_array_append_columns(SoaArray_t         array,
+                             const void* const* columns,
+                             size_t             n
+                             );
+
+/**
+ * Append n records that are stored as an array of structs.
+ *
+ * @param records [in] the first record.
+ * @param stride  [in] the distance between records in bytes, usually the
+ *                     sizeof() the struct.
+ * @param offsets [in] the offset of every field in a record, offsetof().
+ * @param n       [in] the number of records.
+ *
+ * @return SOA_ARRAY_OK or SOA_ARRAY_OUT_OF_MEM
+ */
+int soa_array_append_records(SoaArray_t    array,
+                             const void*   records,
+                             size_t        stride,
+                             const size_t* offsets,
+                             size_t        n
+                             );
+
+/**
+ * Copy the n-th record into a struct, the opposite of
+ * soa_array_append_records().
+ */
+void soa_array_get_record(SoaArray_t    array,
+                          size_t        n,
+                          void*         record,
+                          const size_t* offsets
+                          );
+
+/**
+ * Reorder all columns with one permutation.
+ *
+ * Afterwards record i is the record that was at perm[i] before, so a
+ * permutation that sorts one column sorts all records by that field.
+ *
+ * @param perm [in] soa_array_size() distinct indices.
+ *
+ * @return SOA_ARRAY_OK or SOA_ARRAY_OUT_OF_MEM, the array is unchanged
+ *         when out of memory.
+ */
+int soa_array_permute(SoaArray_t array, const size_t* perm);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef SOAARRAY_H*/
@@ -0,0 +1,213 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "sparseset.h"
+#include "priv/memtracepriv.h"
+#include <string.h>
+#include <assert.h>
+
+/**
+ * \brief the private implementation of a sparse set.
+ *
+ * id is a member when sparse[id] < size and dense[sparse[id]] == id, so
+ * clear only resets the size and stale entries of the sparse pages need
+ * not be erased. The pages are zeroed on allocation to avoid reading
+ * uninitialized memory.
+ *
+ * \private
+ */
+struct SparseSet {
+    uint32_t*   dense;      ///< the members.
+    size_t      size;
+    size_t      capacity;   ///< of dense.
+    uint32_t**  pages;      ///< npages pages, NULL until used.
+    size_t      npages;
+    unsigned    site;       ///< creation site for memory accounting.
+};
+
+typedef struct SparseSet SparseSet;
+
+#define PAGE_SHIFT 12
+#define PAGE_IDS (1u << PAGE_SHIFT)
+#define PAGE_MASK (PAGE_IDS - 1)
+#define PAGE_BYTES (PAGE_IDS * sizeof(uint32_t))
+#define SPARSESET_MIN_CAPACITY 16
+
+/*
+ * Returns the sparse entry of id or NULL when its page is not allocated.
+ */
+static inline uint32_t*
+sparse_entry(const SparseSet* s, uint32_t id)
+{
+    size_t p = id >> PAGE_SHIFT;
+    if (p >= s->npages || !s->pages[p])
+        return NULL;
+    return &s->pages[p][id & PAGE_MASK];
+}
+
+static int
+alloc_page(SparseSet* s, size_t p)
+{
+    if (p >= s->npages) {
+        size_t npages = s->npages ? s->npages : 1;
+        while (npages <= p)
+            npages *= 2;
+        uint32_t** pages = clib_realloc(
+                CLIB_MEM_SPARSESET,
+                s->site,
+                s->pages,
+                s->npages * sizeof(uint32_t*),
+                npages * sizeof(uint32_t*)
+                );
+        if (!pages)
+            return 1;
+        memset(pages + s->npages, 0,
+               (npages - s->npages) * sizeof(uint32_t*)
+               );
+        s->pages = pages;
+        s->npages = npages;
+    }
+    s->pages[p] = clib_calloc(CLIB_MEM_SPARSESET, s->site, 1, PAGE_BYTES);
+    return s->pages[p] == NULL;
+}
+
+SparseSet_t sparseset_create(void)
+{
+    unsigned site = clib_mem_current_site();
+    SparseSet* s = clib_calloc(CLIB_MEM_SPARSESET, site, 1, sizeof(SparseSet));
+    if (s)
+        s->site = site;
+    return s;
+}
+
+void sparseset_destroy(SparseSet_t set)
+{
+    SparseSet* s = set;
+    for (size_t p = 0; p < s->npages; p++)
+        clib_free(CLIB_MEM_SPARSESET, s->site, s->pages[p], PAGE_BYTES);
+    clib_free(
+            CLIB_MEM_SPARSESET,
+            s->site,
+            s->pages,
+            s->npages * sizeof(uint32_t*)
+            );
+    clib_free(
+            CLIB_MEM_SPARSESET,
+            s->site,
+            s->dense,
+            s->capacity * sizeof(uint32_t)
+            );
+    clib_free(CLIB_MEM_SPARSESET, s->site, s, sizeof(SparseSet));
+}
+
+size_t sparseset_size(const SparseSet_t set)
+{
+    const SparseSet* s = set;
+    return s->size;
+}
+
+int sparseset_contains(const SparseSet_t set, uint32_t id)
+{
+    const SparseSet* s = set;
+    uint32_t* entry = sparse_entry(s, id);
+    return entry && *entry < s->size && s->dense[*entry] == id;
+}
+
+int sparseset_insert(SparseSet_t set, uint32_t id)
+{
+    SparseSet* s = set;
+    if (sparseset_contains(s, id))
+        return 0;
+
+    uint32_t* entry = sparse_entry(s, id);
+    if (!entry) {
+        if (alloc_page(s, id >> PAGE_SHIFT))
+            return 1;
+        entry = sparse_entry(s, id);
+    }
+
+    if (s->size == s->capacity) {
+        size_t capacity = s->capacity ?
+            s->capacity * 2 : SPARSESET_MIN_CAPACITY;
+        uint32_t* dense = clib_realloc(
+                CLIB_MEM_SPARSESET,
+                s->site,
+                s->dense,
+                s->capacity * sizeof(uint32_t),
+                capacity * sizeof(uint32_t)
+                );
+        if (!dense)
+            return 1;
+        s->dense = dense;
+        s->capacity = capacity;
+    }
+
+    *entry = (uint32_t) s->size;
+    s->dense[s->size++] = id;
+    return 0;
+}
+
+int sparseset_erase(SparseSet_t set, uint32_t id)
+{
+    SparseSet* s = set;
+    if (!sparseset_contains(s, id))
+        return 1;
+
+    uint32_t pos = *sparse_entry(s, id);
+    uint32_t last = s->dense[--s->size];
+    s->dense[pos] = last;
+    *sparse_entry(s, last) = pos;
+    return 0;
+}
+
+void sparseset_clear(SparseSet_t set)
+{
+    SparseSet* s = set;
+    s->size = 0;
+}
+
+const uint32_t* sparseset_members(const SparseSet_t set)
+{
+    const SparseSet* s = set;
+    return s->dense;
+}
+
+int sparseset_intersect(SparseSet_t         dest,
+                        const SparseSet_t   a,
+                        const SparseSet_t   b
+                        )
+{
+    assert(dest != a && dest != b);
+    const SparseSet* small = a;
+    const SparseSet* large = b;
+    if (small->size > large->size) {
+        small = b;
+        large = a;
+    }
+
+    sparseset_clear(dest);
+    for (size_t i = 0; i < small->size; i++) {
+        uint32_t id = small->dense[i];
+        if (sparseset_contains((SparseSet_t) large, id) &&
+            sparseset_insert(dest, id))
+            return 1;
+    }
+    return 0;
+}
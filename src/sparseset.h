@@ -0,0 +1,109 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SPARSESET_H
+#define SPARSESET_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A set of integer ids with O(1) insertion, erasure, membership test and
+ * clear.
+ *
+ * The members are stored in a dense array, a sparse array maps an id to
+ * its position in the dense array. The sparse array is allocated in pages
+ * when an id in the page is first inserted, so a few large ids don't cost
+ * memory for all the ids below them. Iteration only visits the members.
+ */
+typedef void* SparseSet_t;
+
+/**
+ * Create an empty set.
+ *
+ * @return the set or NULL when out of memory.
+ */
+SparseSet_t sparseset_create(void);
+
+/**
+ * Destroys the set.
+ */
+void sparseset_destroy(SparseSet_t set);
+
+/**
+ * Returns the number of members.
+ */
+size_t sparseset_size(const SparseSet_t set);
+
+/**
+ * Adds id to the set, adding a member is a no-op.
+ *
+ * @return 0 or !0 when out of memory.
+ */
+int sparseset_insert(SparseSet_t set, uint32_t id);
+
+/**
+ * Removes id from the set, the last member takes its position in the
+ * dense array.
+ *
+ * @return 0 or !0 when id is not a member.
+ */
+int sparseset_erase(SparseSet_t set, uint32_t id);
+
+/**
+ * Returns !0 when id is a member.
+ */
+int sparseset_contains(const SparseSet_t set, uint32_t id);
+
+/**
+ * Removes all members in constant time, the memory is kept.
+ */
+void sparseset_clear(SparseSet_t set);
+
+/**
+ * Returns the dense array of sparseset_size() members in no particular
+ * order. It is invalidated by an insertion or erasure.
+ */
+const uint32_t* sparseset_members(const SparseSet_t set);
+
+/**
+ * Stores the members that are in both a and b in dest.
+ *
+ * The members of the smaller set are tested for membership of the other.
+ *
+ * @param dest [out] is cleared first, it must not be a or b.
+ * @param a [in] a set.
+ * @param b [in] another set.
+ *
+ * @return 0 or !0 when out of memory.
+ */
+int sparseset_intersect(SparseSet_t         dest,
+                        const SparseSet_t   a,
+                        const SparseSet_t   b
+                        );
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef SPARSESET_H*/
@@ -0,0 +1,223 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "spscqueue.h"
+#include "priv/memtracepriv.h"
+#include "priv/cachelinepriv.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * \brief the private implementation of a single producer single consumer
+ * queue.
+ *
+ * head and tail are free running counters, the slot of an index is
+ * index & mask. Each side keeps a cached copy of the index of the other
+ * side and only reloads it when the queue seems full or empty, so in the
+ * steady state the sides don't touch each others cache line.
+ *
+ * \private
+ */
+struct SpscQueue {
+    size_t          esize;      ///< Element size.
+    size_t          mask;       ///< capacity - 1
+    char*           elems;      ///< pointer to the elements.
+    clib_free_func  ff;         ///< called on elements left at destruction.
+    clib_copy_func  cf;         ///< copies elements in and out.
+    unsigned        site;       ///< creation site for memory accounting.
+
+    // Written by the consumer.
+    _Alignas(CLIB_CACHE_LINE) atomic_size_t head;
+    size_t          tail_cache; ///< last tail seen by the consumer.
+
+    // Written by the producer.
+    _Alignas(CLIB_CACHE_LINE) atomic_size_t tail;
+    size_t          head_cache; ///< last head seen by the producer.
+};
+
+typedef struct SpscQueue SpscQueue;
+
+static inline void*
+slot_ptr(const SpscQueue* q, size_t index)
+{
+    return q->elems + (index & q->mask) * q->esize;
+}
+
+/*
+ * copies n elements between the ring, starting at index, and the flat
+ * buffer buf, in at most two runs. Elements are copied in with cf and
+ * moved out with memcpy, the consumer takes over what they own.
+ */
+static void
+copy_ring(SpscQueue* q, size_t index, char* buf, size_t n, int to_ring)
+{
+    size_t first = q->mask + 1 - (index & q->mask);
+    if (first > n)
+        first = n;
+
+    if (to_ring && q->cf != memcpy) {
+        for (size_t i = 0; i < n; i++)
+            q->cf(slot_ptr(q, index + i), buf + i * q->esize, q->esize);
+        return;
+    }
+
+    char* ring = slot_ptr(q, index);
+    if (to_ring) {
+        memcpy(ring, buf, first * q->esize);
+        memcpy(q->elems, buf + first * q->esize, (n - first) * q->esize);
+    }
+    else {
+        memcpy(buf, ring, first * q->esize);
+        memcpy(buf + first * q->esize, q->elems, (n - first) * q->esize);
+    }
+}
+
+SpscQueue_t
+spsc_queue_create(size_t         element_size,
+                  clib_free_func ff,
+                  clib_copy_func cf,
+                  size_t         capacity
+                  )
+{
+    unsigned site = clib_mem_current_site();
+    size_t cap = 1;
+    // the capacity must be a power of two that fits in a size_t.
+    if (capacity > (SIZE_MAX >> 1) + 1 ||
+        (element_size && capacity > SIZE_MAX / 2 / element_size))
+        return NULL;
+    while (cap < capacity)
+        cap <<= 1;
+
+    SpscQueue* q = clib_aligned_alloc(CLIB_MEM_SPSC_QUEUE,
+                                      site,
+                                      CLIB_CACHE_LINE,
+                                      sizeof(SpscQueue)
+                                      );
+    if (!q)
+        return NULL;
+    memset(q, 0, sizeof(SpscQueue));
+
+    q->elems = clib_aligned_alloc(CLIB_MEM_SPSC_QUEUE,
+                                  site,
+                                  CLIB_CACHE_LINE,
+                                  CLIB_CACHE_ROUND(cap * element_size)
+                                  );
+    if (!q->elems) {
+        clib_free(CLIB_MEM_SPSC_QUEUE, site, q, sizeof(SpscQueue));
+        return NULL;
+    }
+
+    q->esize    = element_size;
+    q->mask     = cap - 1;
+    q->ff       = ff;
+    q->cf       = cf ? cf : memcpy;
+    q->site     = site;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    return q;
+}
+
+void
+spsc_queue_destroy(SpscQueue_t queue)
+{
+    SpscQueue* q = queue;
+    size_t head = atomic_load(&q->head), tail = atomic_load(&q->tail);
+
+    if (q->ff) {
+        for (; head != tail; head++)
+            q->ff(slot_ptr(q, head));
+    }
+    clib_free(CLIB_MEM_SPSC_QUEUE,
+              q->site,
+              q->elems,
+              CLIB_CACHE_ROUND((q->mask + 1) * q->esize)
+              );
+    clib_free(CLIB_MEM_SPSC_QUEUE, q->site, q, sizeof(SpscQueue));
+}
+
+size_t
+spsc_queue_capacity(const SpscQueue_t queue)
+{
+    const SpscQueue* q = queue;
+    return q->mask + 1;
+}
+
+size_t
+spsc_queue_size(const SpscQueue_t queue)
+{
+    SpscQueue* q = queue;
+    size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    return tail - head;
+}
+
+int
+spsc_queue_push(SpscQueue_t queue, const void* item)
+{
+    return spsc_queue_push_n(queue, item, 1) ? SPSC_QUEUE_OK : SPSC_QUEUE_FULL;
+}
+
+int
+spsc_queue_pop(SpscQueue_t queue, void* item)
+{
+    return spsc_queue_pop_n(queue, item, 1) ? SPSC_QUEUE_OK : SPSC_QUEUE_EMPTY;
+}
+
+size_t
+spsc_queue_push_n(SpscQueue_t queue, const void* src, size_t n)
+{
+    SpscQueue* q = queue;
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t room = q->mask + 1 - (tail - q->head_cache);
+
+    if (room < n) {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        room = q->mask + 1 - (tail - q->head_cache);
+        if (n > room)
+            n = room;
+    }
+    if (!n)
+        return 0;
+
+    copy_ring(q, tail, (char*) src, n, 1);
+    atomic_store_explicit(&q->tail, tail + n, memory_order_release);
+    return n;
+}
+
+size_t
+spsc_queue_pop_n(SpscQueue_t queue, void* dest, size_t n)
+{
+    SpscQueue* q = queue;
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t avail = q->tail_cache - head;
+
+    if (avail < n) {
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        avail = q->tail_cache - head;
+        if (n > avail)
+            n = avail;
+    }
+    if (!n)
+        return 0;
+
+    copy_ring(q, head, dest, n, 0);
+    atomic_store_explicit(&q->head, head + n, memory_order_release);
+    return n;
+}
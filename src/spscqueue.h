@@ -0,0 +1,125 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <stdlib.h>
+#include "function-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A bounded wait-free queue for exactly one producer and one consumer
+ * thread.
+ *
+ * Only one thread may call the push functions and only one (other) thread
+ * may call the pop functions. Neither side ever blocks, a full or empty
+ * queue is reported to the caller.
+ */
+typedef void* SpscQueue_t;
+
+enum SpscQueueResult {
+    SPSC_QUEUE_OK = 0,
+    SPSC_QUEUE_FULL,
+    SPSC_QUEUE_EMPTY
+};
+
+/**
+ * create an empty queue.
+ *
+ * @param element_size [in] the sizeof() a single element.
+ * @param ff [in] the free func is called on the elements that are still
+ *                in the queue when it is destroyed, may be NULL.
+ * @param cf [in] the function used to copy an element into the queue.
+ *                if none is specified memcpy will be used. cf copies in,
+ *                popped elements are moved out with memcpy.
+ * @param capacity [in] the number of elements the queue can hold, it is
+ *                      rounded up to a power of two.
+ *
+ * @return a new queue or NULL when out of memory.
+ */
+SpscQueue_t
+spsc_queue_create(size_t         element_size,
+                  clib_free_func ff,
+                  clib_copy_func cf,
+                  size_t         capacity
+                  );
+
+/**
+ * Destroys the queue, no thread may use it anymore.
+ */
+void spsc_queue_destroy(SpscQueue_t queue);
+
+/**
+ * Returns the number of elements the queue can hold.
+ */
+size_t spsc_queue_capacity(const SpscQueue_t queue);
+
+/**
+ * Returns the number of elements in the queue.
+ *
+ * When called while the other thread is active, the result may be
+ * outdated as soon as it is returned.
+ */
+size_t spsc_queue_size(const SpscQueue_t queue);
+
+/**
+ * Copy one element into the queue, producer only.
+ *
+ * @return SPSC_QUEUE_OK or SPSC_QUEUE_FULL
+ */
+int spsc_queue_push(SpscQueue_t queue, const void* item);
+
+/**
+ * Move one element out of the queue, consumer only.
+ *
+ * The bytes of the element are moved to item, the caller owns it.
+ *
+ * @return SPSC_QUEUE_OK or SPSC_QUEUE_EMPTY
+ */
+int spsc_queue_pop(SpscQueue_t queue, void* item);
+
+/**
+ * Copy up to n elements into the queue, producer only.
+ *
+ * The elements are published to the consumer with a single atomic store.
+ *
+ * @return the number of elements pushed.
+ */
+size_t spsc_queue_push_n(SpscQueue_t queue, const void* src, size_t n);
+
+/**
+ * Move up to n elements out of the queue, consumer only.
+ *
+ * The bytes of the elements are moved to dest, the caller owns them.
+ *
+ * The slots are returned to the producer with a single atomic store.
+ *
+ * @return the number of elements popped.
+ */
+size_t spsc_queue_pop_n(SpscQueue_t queue, void* dest, size_t n);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef SPSCQUEUE_H*/
@@ -18,6 +18,8 @@
  */
 
 #include "priv/stackpriv.h"
+#include "priv/listpriv.h"
+#include "priv/memtracepriv.h"
 #include "stack.h"
 #include <assert.h>
 #include <stdlib.h>
@@ -41,14 +43,15 @@ _stack_construct(struct Stack* self,
                  clib_copy_func cf
                  )
 {
-    self->list = list_create(element_size, ff, cf);
+    self->list = list_create_accounted(element_size, ff, cf, CLIB_MEM_STACK);
 }
 
 static void
 _stack_destruct(struct Stack* self)
 {
-    list_destroy(self->list);
-    free(self);
+    if (self->list)
+        list_destroy(self->list);
+    clib_free(CLIB_MEM_STACK, self->site, self, sizeof(Stack));
 }
 
 static size_t
@@ -93,10 +96,12 @@ struct StackClass stack_class = {
 Stack_t
 stack_create(size_t element_size, clib_free_func ff, clib_copy_func cf)
 {
-    Stack* self = malloc(stack_class.element_sz);
+    unsigned site = clib_mem_current_site();
+    Stack* self = clib_malloc(CLIB_MEM_STACK, site, stack_class.element_sz);
     if (!self)
         return NULL;
 
+    self->site  = site;
     self->klass = &stack_class;
     self->klass->construct(self, element_size, ff, cf);
     if (!self->list) {
@@ -0,0 +1,752 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "threadpool.h"
+#include "mpmcqueue.h"
+#include "priv/memtracepriv.h"
+#include "priv/cachelinepriv.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* number of failed attempts to find work before a thread goes to sleep */
+#define THREADPOOL_SPIN_COUNT       64
+/* capacity of the queue for tasks submitted by non worker threads */
+#define THREADPOOL_INJECT_CAPACITY  4096
+/* initial capacity of the deque of a worker */
+#define WS_INITIAL_CAPACITY         256
+
+typedef struct ThreadPool ThreadPool;
+typedef struct Task Task;
+
+/**
+ * \brief Something that can be executed by the pool.
+ *
+ * run executes the task and releases it when it is detached.
+ *
+ * \private
+ */
+struct Task {
+    void                (*run)(ThreadPool* pool, Task* task);
+    threadpool_task_func func;
+    void*                arg;
+    void*                result;
+    ThreadPool*          pool;
+    atomic_int           done;
+    int                  detached;
+};
+
+/* returned by ws_steal when it lost a race, the deque may not be empty. */
+#define WS_ABORT ((Task*) 1)
+
+/**
+ * \brief The buffer of a work-stealing deque.
+ *
+ * Replaced buffers may still be read by thieves, so they are kept until
+ * the deque is destroyed.
+ *
+ * \private
+ */
+typedef struct WsArray {
+    struct WsArray* retired;    ///< the buffer this one replaced.
+    int64_t         size;       ///< a power of two.
+    _Atomic(Task*)  tasks[];
+} WsArray;
+
+/**
+ * \brief The Chase-Lev work-stealing deque.
+ *
+ * The owner pushes and takes at the bottom, thieves steal from the top.
+ * This follows "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" by Lê, Pop, Cohen and Zappa Nardelli.
+ *
+ * \private
+ */
+typedef struct WsDeque {
+    _Alignas(CLIB_CACHE_LINE) _Atomic int64_t top;
+    _Alignas(CLIB_CACHE_LINE) _Atomic int64_t bottom;
+    _Atomic(WsArray*)   array;
+} WsDeque;
+
+typedef struct Worker {
+    WsDeque         deque;
+    ThreadPool*     pool;
+    pthread_t       thread;
+    uint64_t        rng;        ///< state to pick a victim.
+} Worker;
+
+/**
+ * \brief the private implementation of a thread pool.
+ *
+ * Sleeping threads announce themselves in n_sleeping (idle workers) or
+ * n_joining (threads waiting for a task), the other threads only take the
+ * lock to wake them when these counters are not zero.
+ *
+ * \private
+ */
+struct ThreadPool {
+    size_t          nworkers;
+    Worker*         workers;
+    MpmcQueue_t     inject;     ///< tasks submitted by other threads.
+    unsigned        site;       ///< creation site for memory accounting.
+
+    pthread_mutex_t lock;
+    pthread_cond_t  work_cond;  ///< signalled when work is available.
+    pthread_cond_t  done_cond;  ///< broadcast when a task finished.
+    atomic_uint     n_sleeping;
+    atomic_uint     n_joining;
+    atomic_int      shutdown;
+};
+
+/**
+ * \brief A part of the range of threadpool_parallel_for.
+ *
+ * \private
+ */
+struct ForContext {
+    threadpool_range_func   func;
+    void*                   arg;
+    size_t                  grain;
+    atomic_size_t           pending;    ///< number of unfinished ForTasks
+};
+
+typedef struct ForTask {
+    Task                task;   ///< must be the first member.
+    struct ForContext*  ctx;
+    size_t              begin;
+    size_t              end;
+    int                 heap;   ///< whether the task must be freed.
+} ForTask;
+
+static _Thread_local Worker* tl_worker;
+
+static pthread_once_t   g_default_once = PTHREAD_ONCE_INIT;
+static ThreadPool_t     g_default_pool;
+
+/* ****** work-stealing deque ****** */
+
+static WsArray*
+ws_array_create(ThreadPool* pool, int64_t size)
+{
+    WsArray* a = clib_malloc(CLIB_MEM_THREADPOOL,
+                             pool->site,
+                             sizeof(WsArray) + size * sizeof(Task*)
+                             );
+    if (a) {
+        a->retired  = NULL;
+        a->size     = size;
+    }
+    return a;
+}
+
+static int
+ws_init(ThreadPool* pool, WsDeque* d)
+{
+    WsArray* a = ws_array_create(pool, WS_INITIAL_CAPACITY);
+    if (!a)
+        return THREADPOOL_OUT_OF_MEM;
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    atomic_init(&d->array, a);
+    return THREADPOOL_OK;
+}
+
+static void
+ws_destroy(ThreadPool* pool, WsDeque* d)
+{
+    WsArray* a = atomic_load(&d->array);
+    while (a) {
+        WsArray* next = a->retired;
+        clib_free(CLIB_MEM_THREADPOOL,
+                  pool->site,
+                  a,
+                  sizeof(WsArray) + a->size * sizeof(Task*)
+                  );
+        a = next;
+    }
+}
+
+static int
+ws_push(ThreadPool* pool, WsDeque* d, Task* task)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    WsArray* a = atomic_load_explicit(&d->array, memory_order_relaxed);
+
+    if (b - t > a->size - 1) {
+        WsArray* bigger = ws_array_create(pool, a->size * 2);
+        if (!bigger)
+            return THREADPOOL_OUT_OF_MEM;
+        for (int64_t i = t; i < b; i++)
+            atomic_store_explicit(
+                &bigger->tasks[i & (bigger->size - 1)],
+                atomic_load_explicit(&a->tasks[i & (a->size - 1)],
+                                     memory_order_relaxed),
+                memory_order_release
+                );
+        bigger->retired = a;
+        atomic_store_explicit(&d->array, bigger, memory_order_release);
+        a = bigger;
+    }
+    // release on the slot too, so a thief that reads the task also sees
+    // its contents.
+    atomic_store_explicit(&a->tasks[b & (a->size - 1)],
+                          task,
+                          memory_order_release
+                          );
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return THREADPOOL_OK;
+}
+
+static Task*
+ws_take(WsDeque* d)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    WsArray* a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    Task* task = NULL;
+
+    if (t <= b) {
+        task = atomic_load_explicit(&a->tasks[b & (a->size - 1)],
+                                    memory_order_relaxed);
+        if (t == b) {
+            // the last task, race against thieves.
+            if (!atomic_compare_exchange_strong_explicit(
+                        &d->top, &t, t + 1,
+                        memory_order_seq_cst, memory_order_relaxed))
+                task = NULL;
+            atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        }
+    }
+    else
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return task;
+}
+
+static Task*
+ws_steal(WsDeque* d)
+{
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b)
+        return NULL;
+
+    WsArray* a = atomic_load_explicit(&d->array, memory_order_acquire);
+    Task* task = atomic_load_explicit(&a->tasks[t & (a->size - 1)],
+                                      memory_order_acquire);
+    if (!atomic_compare_exchange_strong_explicit(
+                &d->top, &t, t + 1,
+                memory_order_seq_cst, memory_order_relaxed))
+        return WS_ABORT;
+    return task;
+}
+
+static int
+ws_empty(WsDeque* d)
+{
+    int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    return b <= t;
+}
+
+/* ****** scheduling ****** */
+
+static Worker*
+current_worker(ThreadPool* pool)
+{
+    return tl_worker && tl_worker->pool == pool ? tl_worker : NULL;
+}
+
+static uint64_t
+next_random(uint64_t* state)
+{
+    // xorshift64
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void
+notify(ThreadPool* pool, atomic_uint* n_waiting, pthread_cond_t* cond, int all)
+{
+    // pairs with the fence of the thread that goes to sleep.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(n_waiting, memory_order_relaxed)) {
+        pthread_mutex_lock(&pool->lock);
+        if (all)
+            pthread_cond_broadcast(cond);
+        else
+            pthread_cond_signal(cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static int
+spawn(ThreadPool* pool, Task* task)
+{
+    Worker* w = current_worker(pool);
+
+    if (w) {
+        if (ws_push(pool, &w->deque, task))
+            return THREADPOOL_OUT_OF_MEM;
+    }
+    else if (mpmc_queue_push(pool->inject, &task) != MPMC_QUEUE_OK)
+        return THREADPOOL_ERROR;
+
+    notify(pool, &pool->n_sleeping, &pool->work_cond, 0);
+    return THREADPOOL_OK;
+}
+
+/*
+ * Look for a task in the own deque, the shared queue and finally the
+ * deques of the other workers. Any thread may call this, w is NULL for
+ * threads that are not workers of the pool.
+ */
+static Task*
+find_task(ThreadPool* pool, Worker* w)
+{
+    Task* task = NULL;
+    uint64_t seed = (uintptr_t) &task | 1;
+    uint64_t* rng = w ? &w->rng : &seed;
+
+    if (w && (task = ws_take(&w->deque)))
+        return task;
+    if (mpmc_queue_try_pop(pool->inject, &task) == MPMC_QUEUE_OK)
+        return task;
+
+    size_t n = pool->nworkers;
+    for (size_t attempt = 0; attempt < 2 * n; attempt++) {
+        Worker* victim = &pool->workers[next_random(rng) % n];
+        if (victim == w)
+            continue;
+        task = ws_steal(&victim->deque);
+        if (task == WS_ABORT)
+            continue;
+        if (task)
+            return task;
+    }
+    return NULL;
+}
+
+static int
+has_work(ThreadPool* pool)
+{
+    if (mpmc_queue_size(pool->inject))
+        return 1;
+    for (size_t i = 0; i < pool->nworkers; i++)
+        if (!ws_empty(&pool->workers[i].deque))
+            return 1;
+    return 0;
+}
+
+static void*
+worker_main(void* arg)
+{
+    Worker* w = arg;
+    ThreadPool* pool = w->pool;
+    unsigned idle = 0;
+
+    tl_worker = w;
+    for (;;) {
+        Task* task = find_task(pool, w);
+        if (task) {
+            task->run(pool, task);
+            idle = 0;
+            continue;
+        }
+        if (atomic_load(&pool->shutdown) && !has_work(pool))
+            break;
+        if (++idle < THREADPOOL_SPIN_COUNT) {
+            clib_cpu_relax();
+            continue;
+        }
+
+        idle = 0;
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->n_sleeping, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!has_work(pool) && !atomic_load(&pool->shutdown))
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        atomic_fetch_sub(&pool->n_sleeping, 1);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    tl_worker = NULL;
+    return NULL;
+}
+
+/*
+ * Execute tasks of the pool until done(arg) returns true. When there is
+ * nothing to do, the awaited work runs on another thread, so the caller
+ * may sleep until a task finishes.
+ */
+static void
+help_until(ThreadPool* pool, int (*done)(void* arg), void* arg)
+{
+    Worker* w = current_worker(pool);
+    unsigned idle = 0;
+
+    while (!done(arg)) {
+        Task* task = find_task(pool, w);
+        if (task) {
+            task->run(pool, task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < THREADPOOL_SPIN_COUNT) {
+            clib_cpu_relax();
+            continue;
+        }
+
+        idle = 0;
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->n_joining, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!done(arg))
+            pthread_cond_wait(&pool->done_cond, &pool->lock);
+        atomic_fetch_sub(&pool->n_joining, 1);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/* ****** tasks ****** */
+
+static void
+run_user_task(ThreadPool* pool, Task* task)
+{
+    void* result = task->func(task->arg);
+
+    if (task->detached) {
+        clib_free(CLIB_MEM_THREADPOOL, pool->site, task, sizeof(Task));
+        return;
+    }
+    task->result = result;
+    atomic_store_explicit(&task->done, 1, memory_order_release);
+    notify(pool, &pool->n_joining, &pool->done_cond, 1);
+}
+
+static int
+task_done(void* arg)
+{
+    Task* task = arg;
+    return atomic_load_explicit(&task->done, memory_order_acquire);
+}
+
+static int
+should_split(ThreadPool* pool)
+{
+    Worker* w = current_worker(pool);
+    if (w)
+        return ws_empty(&w->deque);
+    return mpmc_queue_size(pool->inject) < pool->nworkers;
+}
+
+static void run_for_task(ThreadPool* pool, Task* task);
+
+static int
+spawn_range(ThreadPool* pool, struct ForContext* ctx, size_t b, size_t e)
+{
+    ForTask* ft = clib_malloc(CLIB_MEM_THREADPOOL, pool->site, sizeof(ForTask));
+    if (!ft)
+        return THREADPOOL_OUT_OF_MEM;
+
+    memset(ft, 0, sizeof(ForTask));
+    ft->task.run    = run_for_task;
+    ft->task.pool   = pool;
+    ft->ctx         = ctx;
+    ft->begin       = b;
+    ft->end         = e;
+    ft->heap        = 1;
+
+    atomic_fetch_add_explicit(&ctx->pending, 1, memory_order_relaxed);
+    int ret = spawn(pool, &ft->task);
+    if (ret) {
+        atomic_fetch_sub_explicit(&ctx->pending, 1, memory_order_relaxed);
+        clib_free(CLIB_MEM_THREADPOOL, pool->site, ft, sizeof(ForTask));
+    }
+    return ret;
+}
+
+static void
+run_for_task(ThreadPool* pool, Task* task)
+{
+    ForTask* ft = (ForTask*) task;
+    struct ForContext* ctx = ft->ctx;
+    size_t begin = ft->begin, end = ft->end;
+
+    // Lazy binary splitting: give away half of the range whenever the
+    // previous half has been stolen.
+    while (begin < end) {
+        if (end - begin > ctx->grain && should_split(pool)) {
+            size_t mid = begin + (end - begin) / 2;
+            if (spawn_range(pool, ctx, mid, end) == THREADPOOL_OK) {
+                end = mid;
+                continue;
+            }
+        }
+        size_t stop = end - begin > ctx->grain ? begin + ctx->grain : end;
+        ctx->func(begin, stop, ctx->arg);
+        begin = stop;
+    }
+
+    if (ft->heap)
+        clib_free(CLIB_MEM_THREADPOOL, pool->site, ft, sizeof(ForTask));
+    if (atomic_fetch_sub_explicit(&ctx->pending, 1, memory_order_acq_rel) == 1)
+        notify(pool, &pool->n_joining, &pool->done_cond, 1);
+}
+
+static int
+for_done(void* arg)
+{
+    struct ForContext* ctx = arg;
+    return atomic_load_explicit(&ctx->pending, memory_order_acquire) == 0;
+}
+
+/* ****** public interface ****** */
+
+ThreadPool_t
+threadpool_create(size_t nthreads)
+{
+    unsigned site = clib_mem_current_site();
+    size_t started = 0;
+
+    if (!nthreads) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = n > 0 ? (size_t) n : 1;
+    }
+
+    ThreadPool* pool = clib_calloc(CLIB_MEM_THREADPOOL,
+                                   site,
+                                   1,
+                                   sizeof(ThreadPool)
+                                   );
+    if (!pool)
+        return NULL;
+    pool->site = site;
+
+    pool->workers = clib_aligned_alloc(CLIB_MEM_THREADPOOL,
+                                       site,
+                                       CLIB_CACHE_LINE,
+                                       nthreads * sizeof(Worker)
+                                       );
+    pool->inject = mpmc_queue_create(sizeof(Task*),
+                                     NULL,
+                                     NULL,
+                                     THREADPOOL_INJECT_CAPACITY
+                                     );
+    if (!pool->workers || !pool->inject)
+        goto fail;
+    memset(pool->workers, 0, nthreads * sizeof(Worker));
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    atomic_init(&pool->n_sleeping, 0);
+    atomic_init(&pool->n_joining, 0);
+    atomic_init(&pool->shutdown, 0);
+
+    for (size_t i = 0; i < nthreads; i++) {
+        Worker* w = &pool->workers[i];
+        w->pool = pool;
+        w->rng  = 0x9E3779B97F4A7C15ull * (i + 1);
+        if (ws_init(pool, &w->deque))
+            break;
+        pool->nworkers++;
+    }
+    if (pool->nworkers == nthreads) {
+        for (; started < nthreads; started++) {
+            Worker* w = &pool->workers[started];
+            if (pthread_create(&w->thread, NULL, worker_main, w))
+                break;
+        }
+    }
+    if (started == nthreads)
+        return pool;
+
+    // stop what has been started.
+    atomic_store(&pool->shutdown, 1);
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < started; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+    for (size_t i = 0; i < pool->nworkers; i++)
+        ws_destroy(pool, &pool->workers[i].deque);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+
+fail:
+    if (pool->inject)
+        mpmc_queue_destroy(pool->inject);
+    clib_free(CLIB_MEM_THREADPOOL,
+              site,
+              pool->workers,
+              CLIB_CACHE_ROUND(nthreads * sizeof(Worker))
+              );
+    clib_free(CLIB_MEM_THREADPOOL, site, pool, sizeof(ThreadPool));
+    return NULL;
+}
+
+void
+threadpool_destroy(ThreadPool_t p)
+{
+    ThreadPool* pool = p;
+
+    atomic_store(&pool->shutdown, 1);
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->nworkers; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+    for (size_t i = 0; i < pool->nworkers; i++)
+        ws_destroy(pool, &pool->workers[i].deque);
+
+    mpmc_queue_destroy(pool->inject);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+    clib_free(CLIB_MEM_THREADPOOL,
+              pool->site,
+              pool->workers,
+              CLIB_CACHE_ROUND(pool->nworkers * sizeof(Worker))
+              );
+    clib_free(CLIB_MEM_THREADPOOL, pool->site, pool, sizeof(ThreadPool));
+}
+
+static void
+create_default_pool(void)
+{
+    g_default_pool = threadpool_create(0);
+}
+
+ThreadPool_t
+threadpool_default(void)
+{
+    pthread_once(&g_default_once, create_default_pool);
+    return g_default_pool;
+}
+
+size_t
+threadpool_size(const ThreadPool_t p)
+{
+    const ThreadPool* pool = p;
+    return pool->nworkers;
+}
+
+int
+threadpool_submit(ThreadPool_t         p,
+                  threadpool_task_func func,
+                  void*                arg,
+                  ThreadFuture_t*      future
+                  )
+{
+    ThreadPool* pool = p;
+
+    if (atomic_load(&pool->shutdown))
+        return THREADPOOL_ERROR;
+
+    Task* task = clib_malloc(CLIB_MEM_THREADPOOL, pool->site, sizeof(Task));
+    if (!task)
+        return THREADPOOL_OUT_OF_MEM;
+
+    task->run       = run_user_task;
+    task->func      = func;
+    task->arg       = arg;
+    task->result    = NULL;
+    task->pool      = pool;
+    task->detached  = future == NULL;
+    atomic_init(&task->done, 0);
+
+    // the task may run and be freed as soon as it is spawned.
+    if (future)
+        *future = task;
+
+    int ret = spawn(pool, task);
+    if (ret)
+        clib_free(CLIB_MEM_THREADPOOL, pool->site, task, sizeof(Task));
+    return ret;
+}
+
+void*
+threadpool_join(ThreadFuture_t future)
+{
+    Task* task = future;
+    ThreadPool* pool = task->pool;
+
+    help_until(pool, task_done, task);
+
+    void* result = task->result;
+    clib_free(CLIB_MEM_THREADPOOL, pool->site, task, sizeof(Task));
+    return result;
+}
+
+int
+threadpool_parallel_for(ThreadPool_t          p,
+                        size_t                begin,
+                        size_t                end,
+                        size_t                grain,
+                        threadpool_range_func func,
+                        void*                 arg
+                        )
+{
+    ThreadPool* pool = p;
+    struct ForContext ctx;
+    ForTask root;
+
+    if (begin >= end)
+        return THREADPOOL_OK;
+    if (!grain) {
+        grain = (end - begin) / (16 * (pool->nworkers + 1));
+        if (!grain)
+            grain = 1;
+    }
+    if (end - begin <= grain) {
+        func(begin, end, arg);
+        return THREADPOOL_OK;
+    }
+
+    ctx.func    = func;
+    ctx.arg     = arg;
+    ctx.grain   = grain;
+    atomic_init(&ctx.pending, 1);
+
+    memset(&root, 0, sizeof(ForTask));
+    root.task.run   = run_for_task;
+    root.task.pool  = pool;
+    root.ctx        = &ctx;
+    root.begin      = begin;
+    root.end        = end;
+    root.heap       = 0;
+
+    run_for_task(pool, &root.task);
+    help_until(pool, for_done, &ctx);
+    return THREADPOOL_OK;
+}
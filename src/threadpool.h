@@ -0,0 +1,147 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A pool of worker threads that execute tasks.
+ *
+ * Every worker has its own work-stealing deque, tasks that are submitted
+ * from a worker go to its own deque, tasks from other threads go to a
+ * shared queue. Idle workers steal from the others. Threads that wait for
+ * a task help executing tasks, so tasks may wait for other tasks.
+ */
+typedef void* ThreadPool_t;
+
+/**
+ * A handle to a submitted task, it must be joined exactly once.
+ */
+typedef void* ThreadFuture_t;
+
+enum ThreadPoolResult {
+    THREADPOOL_OK = 0,
+    THREADPOOL_OUT_OF_MEM,
+    THREADPOOL_ERROR
+};
+
+/**
+ * A task that runs on the pool.
+ *
+ * @param arg [in] the argument given to threadpool_submit.
+ *
+ * @return a result that is returned by threadpool_join.
+ */
+typedef void* (*threadpool_task_func)(void* arg);
+
+/**
+ * The body of a parallel for loop, it handles the indices [begin, end).
+ */
+typedef void (*threadpool_range_func)(size_t begin, size_t end, void* arg);
+
+/**
+ * Create a thread pool.
+ *
+ * @param nthreads [in] the number of worker threads, 0 uses one thread per
+ *                      online processor.
+ *
+ * @return the pool or NULL when the threads cannot be created.
+ */
+ThreadPool_t threadpool_create(size_t nthreads);
+
+/**
+ * Destroys the pool.
+ *
+ * Waits until all submitted tasks are executed and the workers have
+ * finished. The futures of tasks that have not been joined remain valid.
+ */
+void threadpool_destroy(ThreadPool_t pool);
+
+/**
+ * Returns a pool that is shared by the parallel algorithms of c-lib.
+ *
+ * It is created on first use with one thread per processor and lives
+ * until the program exits.
+ */
+ThreadPool_t threadpool_default(void);
+
+/**
+ * Returns the number of worker threads.
+ */
+size_t threadpool_size(const ThreadPool_t pool);
+
+/**
+ * Submit a task to the pool.
+ *
+ * @param func   [in] the function to run.
+ * @param arg    [in] passed to func.
+ * @param future [out] receives a handle to join the task, when NULL the
+ *                     task is detached. Only valid when THREADPOOL_OK is
+ *                     returned.
+ *
+ * @return THREADPOOL_OK, THREADPOOL_OUT_OF_MEM or THREADPOOL_ERROR when
+ *         the pool is being destroyed.
+ */
+int threadpool_submit(ThreadPool_t         pool,
+                      threadpool_task_func func,
+                      void*                arg,
+                      ThreadFuture_t*      future
+                      );
+
+/**
+ * Wait until a task has finished, the future is released.
+ *
+ * While waiting, the calling thread executes other tasks of the pool.
+ *
+ * @return the return value of the task.
+ */
+void* threadpool_join(ThreadFuture_t future);
+
+/**
+ * Call func for all indices in [begin, end) in parallel.
+ *
+ * The range is split adaptively: a range is only split in halves while
+ * there are idle workers to steal the other half, otherwise func is
+ * called with chunks of grain indices. Returns when the whole range is
+ * handled, the calling thread takes part in the work.
+ *
+ * @param grain [in] the largest number of indices handled by one call
+ *                   to func, 0 picks one based on the size of the pool.
+ *
+ * @return THREADPOOL_OK, when out of memory the range is split less.
+ */
+int threadpool_parallel_for(ThreadPool_t          pool,
+                            size_t                begin,
+                            size_t                end,
+                            size_t                grain,
+                            threadpool_range_func func,
+                            void*                 arg
+                            );
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /*ifndef THREADPOOL_H*/
@@ -0,0 +1,395 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../src/art.h"
+
+/* * utilities * */
+
+struct Collect {
+    char    keys[64][32];
+    size_t  n;
+    size_t  stop_after;
+};
+
+static int
+collect(const void* key, size_t len, void* value, void* arg)
+{
+    struct Collect* c = arg;
+    (void) value;
+    if (c->n < 64 && len < 32) {
+        memcpy(c->keys[c->n], key, len);
+        c->keys[c->n][len] = '\0';
+    }
+    c->n++;
+    return c->stop_after && c->n == c->stop_after;
+}
+
+struct Order {
+    char    prev[64];
+    size_t  prev_len;
+    size_t  n;
+    int     sorted;
+};
+
+static int
+check_order(const void* key, size_t len, void* value, void* arg)
+{
+    struct Order* o = arg;
+    size_t m = len < o->prev_len ? len : o->prev_len;
+    int c = memcmp(o->prev, key, m);
+    (void) value;
+    if (o->n && (c > 0 || (c == 0 && o->prev_len >= len)))
+        o->sorted = 0;
+    memcpy(o->prev, key, len);
+    o->prev_len = len;
+    o->n++;
+    return 0;
+}
+
+static size_t g_freed;
+
+static void
+count_free(void* value)
+{
+    (void) value;
+    g_freed++;
+}
+
+static int
+insert_str(Art_t t, const char* key, uintptr_t value)
+{
+    return art_insert(t, key, strlen(key), (void*) value);
+}
+
+static uintptr_t
+find_str(Art_t t, const char* key)
+{
+    return (uintptr_t) art_find(t, key, strlen(key));
+}
+
+/* * Tests * */
+
+void insert_find_art()
+{
+    Art_t t = art_create(count_free);
+    const char* keys[] = {"a", "ab", "abc", "abd", "b", "", "abcdefghijklmnopqrstuvwxyz",
+                          "abcdefghijklmnopqrstuvwxy0", "abcdefghijklmno"};
+    const size_t n = sizeof(keys) / sizeof(keys[0]);
+    int correct = 1;
+
+    g_freed = 0;
+    CU_ASSERT(t != NULL);
+    CU_ASSERT(art_size(t) == 0);
+    CU_ASSERT(art_find(t, "a", 1) == NULL);
+
+    for (size_t i = 0; i < n; i++)
+        if (insert_str(t, keys[i], i + 1) != ART_OK)
+            correct = 0;
+    CU_ASSERT(correct);
+    CU_ASSERT(art_size(t) == n);
+
+    for (size_t i = 0; i < n; i++)
+        if (find_str(t, keys[i]) != i + 1)
+            correct = 0;
+    CU_ASSERT(correct);
+    CU_ASSERT(find_str(t, "abcdefghijklmnopqrstuvwxyZ") == 0);
+    CU_ASSERT(find_str(t, "abcdefghijklmn") == 0);
+    CU_ASSERT(find_str(t, "c") == 0);
+    CU_ASSERT(find_str(t, "abcd") == 0);
+
+    // replacing passes the old value to the free function.
+    insert_str(t, "ab", 100);
+    CU_ASSERT(find_str(t, "ab") == 100);
+    CU_ASSERT(art_size(t) == n);
+    CU_ASSERT(g_freed == 1);
+
+    CU_ASSERT(art_remove(t, "ab", 2) == ART_OK);
+    CU_ASSERT(art_remove(t, "ab", 2) == ART_NOT_FOUND);
+    CU_ASSERT(art_remove(t, "abcdefghijklmnopqrstuvwxyZ", 26) == ART_NOT_FOUND);
+    CU_ASSERT(g_freed == 2);
+    CU_ASSERT(find_str(t, "ab") == 0);
+    CU_ASSERT(find_str(t, "abc") == 3);
+    CU_ASSERT(find_str(t, "a") == 1);
+
+    for (size_t i = 0; i < n; i++)
+        art_remove(t, keys[i], strlen(keys[i]));
+    CU_ASSERT(art_size(t) == 0);
+    CU_ASSERT(g_freed == n + 1);
+
+    insert_str(t, "x", 1);
+    art_destroy(t);
+    CU_ASSERT(g_freed == n + 2);
+}
+
+void grow_shrink_art()
+{
+    Art_t t = art_create(NULL);
+    unsigned char key[3] = {'k', 0, 0};
+    int correct = 1;
+
+    // 256 children under "k", 52 under every "k?".
+    for (unsigned i = 0; i < 256; i++) {
+        key[1] = (unsigned char) i;
+        for (unsigned j = 0; j < 256; j += 5) {
+            key[2] = (unsigned char) j;
+            art_insert(t, key, 3, (void*) (uintptr_t) (i * 256 + j + 1));
+        }
+    }
+    CU_ASSERT(art_size(t) == 256 * 52);
+
+    for (unsigned i = 0; i < 256; i++) {
+        key[1] = (unsigned char) i;
+        for (unsigned j = 0; j < 256; j++) {
+            key[2] = (unsigned char) j;
+            uintptr_t v = (uintptr_t) art_find(t, key, 3);
+            if (v != (j % 5 ? 0 : i * 256 + j + 1))
+                correct = 0;
+        }
+    }
+    CU_ASSERT(correct);
+
+    // remove most, so the nodes shrink again.
+    for (unsigned i = 0; i < 256; i++) {
+        key[1] = (unsigned char) i;
+        for (unsigned j = 5; j < 256; j += 5) {
+            key[2] = (unsigned char) j;
+            if (art_remove(t, key, 3) != ART_OK)
+                correct = 0;
+        }
+        if (i % 2) {
+            key[2] = 0;
+            art_remove(t, key, 3);
+        }
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(art_size(t) == 128);
+    for (unsigned i = 0; i < 256; i++) {
+        key[1] = (unsigned char) i;
+        key[2] = 0;
+        if ((art_find(t, key, 3) != NULL) != (i % 2 == 0))
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+
+    art_destroy(t);
+}
+
+void random_art()
+{
+    enum { N = 2000 };
+    static char keys[N][16];
+    static unsigned char present[N];
+    Art_t t = art_create(NULL);
+    uint32_t state = 99;
+    int correct = 1;
+
+    // keys from a small alphabet share many prefixes.
+    for (int i = 0; i < N; i++) {
+        state = state * 1664525u + 1013904223u;
+        int len = 1 + (state >> 24) % 12;
+        for (int j = 0; j < len; j++) {
+            state = state * 1664525u + 1013904223u;
+            keys[i][j] = "abc"[(state >> 24) % 3];
+        }
+        keys[i][len] = '\0';
+    }
+
+    for (int round = 0; round < 20000; round++) {
+        state = state * 1664525u + 1013904223u;
+        int i = (state >> 8) % N;
+        // duplicates in keys share the entry with the first of them.
+        int first = i;
+        for (int j = 0; j < i; j++)
+            if (strcmp(keys[j], keys[i]) == 0) {
+                first = j;
+                break;
+            }
+        if ((state >> 4) % 3) {
+            insert_str(t, keys[i], first + 1);
+            present[first] = 1;
+        }
+        else {
+            int ret = art_remove(t, keys[i], strlen(keys[i]));
+            if (ret != (present[first] ? ART_OK : ART_NOT_FOUND))
+                correct = 0;
+            present[first] = 0;
+        }
+    }
+    CU_ASSERT(correct);
+
+    size_t count = 0;
+    for (int i = 0; i < N; i++) {
+        uintptr_t v = find_str(t, keys[i]);
+        if (v && !present[v - 1])
+            correct = 0;
+        if (!v) {
+            for (int j = 0; j < N; j++)
+                if (present[j] && strcmp(keys[j], keys[i]) == 0)
+                    correct = 0;
+        }
+        count += present[i];
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(art_size(t) == count);
+
+    struct Order order = {{0}, 0, 0, 1};
+    art_iter_prefix(t, NULL, 0, check_order, &order);
+    CU_ASSERT(order.sorted);
+    CU_ASSERT(order.n == count);
+
+    art_destroy(t);
+}
+
+void longest_prefix_art()
+{
+    Art_t t = art_create(NULL);
+    size_t len = 0;
+
+    insert_str(t, "10.", 1);
+    insert_str(t, "10.1.", 2);
+    insert_str(t, "10.1.2.", 3);
+    insert_str(t, "192.168.0.0/this-is-a-long-route", 4);
+
+    CU_ASSERT(art_longest_prefix(t, "10.1.2.3", 8, &len) == (void*) 3);
+    CU_ASSERT(len == 7);
+    CU_ASSERT(art_longest_prefix(t, "10.1.3.3", 8, &len) == (void*) 2);
+    CU_ASSERT(len == 5);
+    CU_ASSERT(art_longest_prefix(t, "10.2", 4, &len) == (void*) 1);
+    CU_ASSERT(len == 3);
+    CU_ASSERT(art_longest_prefix(t, "10", 2, NULL) == NULL);
+    CU_ASSERT(art_longest_prefix(t, "11.0", 4, NULL) == NULL);
+    CU_ASSERT(art_longest_prefix(t, "192.168.0.0/this-is-a-long-routeX", 33, &len)
+              == (void*) 4);
+    CU_ASSERT(art_longest_prefix(t, "192.168.0.0/this-is-a-long-rXute", 32, NULL)
+              == NULL);
+
+    // the empty key is a prefix of everything.
+    insert_str(t, "", 5);
+    CU_ASSERT(art_longest_prefix(t, "11.0", 4, &len) == (void*) 5);
+    CU_ASSERT(len == 0);
+
+    art_destroy(t);
+}
+
+void iter_prefix_art()
+{
+    Art_t t = art_create(NULL);
+    struct Collect c;
+    const char* keys[] = {"car", "cart", "carbon", "care", "cat", "dog", "ca",
+                          "carbonated-beverage", "carbonated-water"};
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+        insert_str(t, keys[i], i + 1);
+
+    memset(&c, 0, sizeof(c));
+    CU_ASSERT(art_iter_prefix(t, "car", 3, collect, &c) == 0);
+    CU_ASSERT(c.n == 6);
+    CU_ASSERT(strcmp(c.keys[0], "car") == 0);
+    CU_ASSERT(strcmp(c.keys[1], "carbon") == 0);
+    CU_ASSERT(strcmp(c.keys[2], "carbonated-beverage") == 0);
+    CU_ASSERT(strcmp(c.keys[3], "carbonated-water") == 0);
+    CU_ASSERT(strcmp(c.keys[4], "care") == 0);
+    CU_ASSERT(strcmp(c.keys[5], "cart") == 0);
+
+    memset(&c, 0, sizeof(c));
+    art_iter_prefix(t, "carbonated", 10, collect, &c);
+    CU_ASSERT(c.n == 2);
+
+    memset(&c, 0, sizeof(c));
+    art_iter_prefix(t, "carbonated-x", 12, collect, &c);
+    CU_ASSERT(c.n == 0);
+
+    memset(&c, 0, sizeof(c));
+    art_iter_prefix(t, "x", 1, collect, &c);
+    CU_ASSERT(c.n == 0);
+
+    memset(&c, 0, sizeof(c));
+    c.stop_after = 3;
+    CU_ASSERT(art_iter_prefix(t, "", 0, collect, &c) == 1);
+    CU_ASSERT(c.n == 3);
+    CU_ASSERT(strcmp(c.keys[0], "ca") == 0);
+
+    art_destroy(t);
+}
+
+/* * Tests  registration * */
+
+int add_art_suite()
+{
+    CU_pSuite suite = CU_add_suite("art-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create art suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "insert_find", insert_find_art);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create art test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "grow_shrink", grow_shrink_art);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create art test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "random", random_art);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create art test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "longest_prefix", longest_prefix_art);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create art test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "iter_prefix", iter_prefix_art);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create art test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
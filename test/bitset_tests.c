@@ -0,0 +1,203 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include "../src/bitset.h"
+#include "../src/darray.h"
+
+/* * Tests * */
+
+void set_test_bitset()
+{
+    Bitset_t b = bitset_create(1000);
+    int correct = 1;
+
+    CU_ASSERT(b != NULL);
+    CU_ASSERT(bitset_size(b) == 1000);
+    CU_ASSERT(bitset_count(b) == 0);
+    CU_ASSERT(bitset_find_first(b) == 1000);
+
+    for (size_t i = 0; i < 1000; i += 3)
+        bitset_set(b, i);
+    for (size_t i = 0; i < 1000; i++)
+        if (bitset_test(b, i) != (i % 3 == 0))
+            correct = 0;
+    CU_ASSERT(correct);
+    CU_ASSERT(bitset_count(b) == 334);
+
+    bitset_clear(b, 0);
+    CU_ASSERT(!bitset_test(b, 0));
+    CU_ASSERT(bitset_count(b) == 333);
+
+    bitset_set_all(b);
+    CU_ASSERT(bitset_count(b) == 1000);
+    bitset_clear_all(b);
+    CU_ASSERT(bitset_count(b) == 0);
+
+    bitset_destroy(b);
+}
+
+void iterate_bitset()
+{
+    Bitset_t b = bitset_create(500);
+    size_t expected[] = {0, 63, 64, 65, 128, 300, 499};
+    size_t n = sizeof(expected) / sizeof(expected[0]);
+    size_t k = 0;
+    int correct = 1;
+
+    for (size_t i = 0; i < n; i++)
+        bitset_set(b, expected[i]);
+    for (size_t i = bitset_find_first(b);
+         i < bitset_size(b);
+         i = bitset_find_next(b, i + 1)) {
+        if (k >= n || i != expected[k])
+            correct = 0;
+        k++;
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(k == n);
+    CU_ASSERT(bitset_find_next(b, 301) == 499);
+    CU_ASSERT(bitset_find_next(b, 500) == 500);
+    bitset_destroy(b);
+}
+
+void resize_bitset()
+{
+    Bitset_t b = bitset_create(10);
+
+    bitset_set_all(b);
+    CU_ASSERT(bitset_resize(b, 5) == BITSET_OK);
+    CU_ASSERT(bitset_count(b) == 5);
+    // the bits that were cut off don't come back
+    CU_ASSERT(bitset_resize(b, 10000) == BITSET_OK);
+    CU_ASSERT(bitset_count(b) == 5);
+    CU_ASSERT(!bitset_test(b, 9));
+    bitset_set(b, 9999);
+    CU_ASSERT(bitset_count(b) == 6);
+    CU_ASSERT(bitset_find_next(b, 5) == 9999);
+    bitset_destroy(b);
+}
+
+void bulk_bitset()
+{
+    int best = darray_simd_level();
+    int correct = 1;
+
+    for (int level = DARRAY_SIMD_SCALAR; level <= best; level++) {
+        darray_set_simd_level(level);
+        Bitset_t a = bitset_create(1000);
+        Bitset_t b = bitset_create(1000);
+        Bitset_t small = bitset_create(100);
+
+        for (size_t i = 0; i < 1000; i += 2)
+            bitset_set(a, i);
+        for (size_t i = 0; i < 1000; i += 3)
+            bitset_set(b, i);
+        bitset_set_all(small);
+
+        // multiples of 6
+        bitset_and(a, b);
+        if (bitset_count(a) != 167)
+            correct = 0;
+        // multiples of 3
+        bitset_or(a, b);
+        if (bitset_count(a) != 334)
+            correct = 0;
+        // nothing
+        bitset_xor(a, b);
+        if (bitset_count(a) != 0)
+            correct = 0;
+
+        bitset_set_all(a);
+        bitset_andnot(a, b);
+        if (bitset_count(a) != 666)
+            correct = 0;
+
+        // a shorter src only affects its own bits, but clears the rest
+        // for and.
+        bitset_andnot(b, small);
+        if (bitset_find_first(b) != 102)
+            correct = 0;
+        bitset_or(small, b);
+        if (bitset_count(small) != 100)
+            correct = 0;
+        bitset_and(b, small);
+        if (bitset_count(b) != 0)
+            correct = 0;
+
+        bitset_destroy(a);
+        bitset_destroy(b);
+        bitset_destroy(small);
+    }
+    CU_ASSERT(correct);
+    darray_set_simd_level(best);
+}
+
+/* * Tests  registration * */
+
+int add_bitset_suite()
+{
+    CU_pSuite suite = CU_add_suite("bitset-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create bitset suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "set_test", set_test_bitset);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bitset test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "iterate", iterate_bitset);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bitset test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "resize", resize_bitset);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bitset test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "bulk", bulk_bitset);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bitset test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
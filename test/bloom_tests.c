@@ -0,0 +1,280 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../src/bloom.h"
+
+/* * utilities * */
+
+static uint64_t
+next_key(uint64_t* state)
+{
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+/* * Tests * */
+
+void no_false_negatives_bloom()
+{
+    BloomFilter_t f = bloom_create(10000, 0.01);
+    uint64_t state = 1;
+    int correct = 1;
+
+    CU_ASSERT(f != NULL);
+    CU_ASSERT(bloom_nhashes(f) >= 1);
+    CU_ASSERT(bloom_nbits(f) % 512 == 0);
+
+    for (int i = 0; i < 10000; i++) {
+        uint64_t key = next_key(&state);
+        bloom_insert(f, &key, sizeof(key));
+    }
+    state = 1;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t key = next_key(&state);
+        if (!bloom_query(f, &key, sizeof(key)))
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+
+    bloom_insert(f, "hello", 5);
+    CU_ASSERT(bloom_query(f, "hello", 5));
+
+    bloom_destroy(f);
+}
+
+void false_positive_rate_bloom()
+{
+    const int n = 20000, probes = 100000;
+    BloomFilter_t f = bloom_create(n, 0.01);
+    uint64_t state = 42;
+    int positives = 0;
+
+    for (int i = 0; i < n; i++) {
+        uint64_t key = next_key(&state);
+        bloom_insert(f, &key, sizeof(key));
+    }
+    // keys that are not inserted, the generator doesn't repeat.
+    for (int i = 0; i < probes; i++) {
+        uint64_t key = next_key(&state);
+        positives += bloom_query(f, &key, sizeof(key));
+    }
+    CU_ASSERT(positives < probes * 0.03);
+
+    bloom_destroy(f);
+}
+
+void batch_bloom()
+{
+    const size_t n = 1000;
+    uint64_t keys[1000];
+    unsigned char found[1000];
+    uint64_t state = 7;
+    int correct = 1;
+    BloomFilter_t f = bloom_create(n, 0.001);
+
+    for (size_t i = 0; i < n; i++)
+        keys[i] = next_key(&state);
+    bloom_insert_batch(f, keys, sizeof(keys[0]), n / 2);
+
+    size_t nfound = bloom_query_batch(f, keys, sizeof(keys[0]), n, found);
+    for (size_t i = 0; i < n; i++) {
+        if (i < n / 2 && !found[i])
+            correct = 0;
+        if (found[i] != bloom_query(f, &keys[i], sizeof(keys[0])))
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(nfound >= n / 2);
+    CU_ASSERT(nfound < n / 2 + 10);
+
+    bloom_destroy(f);
+}
+
+void counting_bloom()
+{
+    const size_t n = 1000;
+    uint64_t keys[1000];
+    unsigned char found[1000];
+    uint64_t state = 3;
+    int correct = 1;
+    CountingBloom_t f = counting_bloom_create(n, 0.01);
+
+    CU_ASSERT(f != NULL);
+    for (size_t i = 0; i < n; i++)
+        keys[i] = next_key(&state);
+    counting_bloom_insert_batch(f, keys, sizeof(keys[0]), n);
+    CU_ASSERT(counting_bloom_query_batch(f, keys, sizeof(keys[0]), n, found)
+              == n);
+
+    for (size_t i = 0; i < n / 2; i++)
+        if (counting_bloom_remove(f, &keys[i], sizeof(keys[0])) != BLOOM_OK)
+            correct = 0;
+    CU_ASSERT(correct);
+
+    // the remaining keys are still present.
+    for (size_t i = n / 2; i < n; i++)
+        if (!counting_bloom_query(f, &keys[i], sizeof(keys[0])))
+            correct = 0;
+    CU_ASSERT(correct);
+
+    // most removed keys are gone.
+    size_t left = counting_bloom_query_batch(f, keys, sizeof(keys[0]), n / 2,
+                                             found);
+    CU_ASSERT(left < n / 20);
+
+    // removing all keys empties the filter.
+    for (size_t i = n / 2; i < n; i++)
+        counting_bloom_remove(f, &keys[i], sizeof(keys[0]));
+    CU_ASSERT(counting_bloom_query_batch(f, keys, sizeof(keys[0]), n, found)
+              == 0);
+    CU_ASSERT(counting_bloom_remove(f, &keys[0], sizeof(keys[0])) ==
+              BLOOM_NOT_FOUND);
+
+    // counters saturate instead of overflowing.
+    for (int i = 0; i < 20; i++)
+        counting_bloom_insert(f, "key", 3);
+    for (int i = 0; i < 20; i++)
+        counting_bloom_remove(f, "key", 3);
+    CU_ASSERT(counting_bloom_query(f, "key", 3));
+
+    counting_bloom_destroy(f);
+}
+
+void serialize_bloom()
+{
+    BloomFilter_t f = bloom_create(500, 0.01);
+    CountingBloom_t c = counting_bloom_create(500, 0.01);
+    uint64_t state = 11;
+    int correct = 1;
+
+    for (int i = 0; i < 500; i++) {
+        uint64_t key = next_key(&state);
+        bloom_insert(f, &key, sizeof(key));
+        counting_bloom_insert(c, &key, sizeof(key));
+    }
+
+    size_t size = bloom_serialized_size(f);
+    unsigned char* buf = malloc(size);
+    CU_ASSERT(bloom_serialize(f, buf, size - 1) == 0);
+    CU_ASSERT(bloom_serialize(f, buf, size) == size);
+    CU_ASSERT(memcmp(buf, "CLBF", 4) == 0);
+
+    BloomFilter_t g = bloom_deserialize(buf, size);
+    CU_ASSERT(g != NULL);
+    CU_ASSERT(bloom_nbits(g) == bloom_nbits(f));
+    CU_ASSERT(bloom_nhashes(g) == bloom_nhashes(f));
+
+    // a filter of another type or a damaged buffer is rejected.
+    CU_ASSERT(counting_bloom_deserialize(buf, size) == NULL);
+    CU_ASSERT(bloom_deserialize(buf, size - 1) == NULL);
+    CU_ASSERT(bloom_deserialize(buf, 10) == NULL);
+    buf[0] = 'X';
+    CU_ASSERT(bloom_deserialize(buf, size) == NULL);
+    free(buf);
+
+    size_t csize = counting_bloom_serialized_size(c);
+    buf = malloc(csize);
+    CU_ASSERT(counting_bloom_serialize(c, buf, csize) == csize);
+    CountingBloom_t d = counting_bloom_deserialize(buf, csize);
+    CU_ASSERT(d != NULL);
+    free(buf);
+
+    state = 11;
+    for (int i = 0; i < 500; i++) {
+        uint64_t key = next_key(&state);
+        if (!bloom_query(g, &key, sizeof(key)) ||
+            counting_bloom_remove(d, &key, sizeof(key)) != BLOOM_OK)
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+
+    bloom_destroy(f);
+    bloom_destroy(g);
+    counting_bloom_destroy(c);
+    counting_bloom_destroy(d);
+}
+
+/* * Tests  registration * */
+
+int add_bloom_suite()
+{
+    CU_pSuite suite = CU_add_suite("bloom-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create bloom suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "no_false_negatives", no_false_negatives_bloom);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bloom test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "false_positive_rate", false_positive_rate_bloom);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bloom test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "batch", batch_bloom);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bloom test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "counting", counting_bloom);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bloom test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "serialize", serialize_bloom);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create bloom test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
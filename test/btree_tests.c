@@ -0,0 +1,339 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../src/btree.h"
+
+/* * utilities * */
+
+static int
+cmp_int(void* a, void* b)
+{
+    int x = *(int*) a, y = *(int*) b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t
+next_rand(uint32_t* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+/*
+ * Checks that the tree holds exactly the keys with present[key] set, in
+ * ascending order in both directions, with value key * 10.
+ */
+static int
+check_tree(BTree_t t, const unsigned char* present, int n)
+{
+    BTreeIter it;
+    size_t count = 0;
+    int prev = -1;
+
+    for (int k = 0; k < n; k++)
+        count += present[k];
+    if (btree_size(t) != count)
+        return 0;
+
+    count = 0;
+    for (btree_first(t, &it); btree_iter_valid(&it); btree_iter_next(&it)) {
+        int k = *(int*) btree_iter_key(&it);
+        if (k <= prev || !present[k] || *(long*) btree_iter_value(&it) != k * 10L)
+            return 0;
+        prev = k;
+        count++;
+    }
+    if (count != btree_size(t))
+        return 0;
+
+    prev = n;
+    for (btree_last(t, &it); btree_iter_valid(&it); btree_iter_prev(&it)) {
+        int k = *(int*) btree_iter_key(&it);
+        if (k >= prev)
+            return 0;
+        prev = k;
+        count--;
+    }
+    return count == 0;
+}
+
+/* * Tests * */
+
+void insert_find_btree()
+{
+    BTree_t t = btree_create(sizeof(int), sizeof(long), cmp_int);
+    BTreeIter it;
+    int correct = 1;
+
+    CU_ASSERT(t != NULL);
+    CU_ASSERT(btree_size(t) == 0);
+    btree_first(t, &it);
+    CU_ASSERT(!btree_iter_valid(&it));
+
+    // insert in a scrambled order.
+    for (int i = 0; i < 10000; i++) {
+        int k = (i * 7919) % 10000;
+        long v = k * 10L;
+        if (btree_insert(t, &k, &v) != BTREE_OK)
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(btree_size(t) == 10000);
+
+    for (int k = 0; k < 10000; k++) {
+        long* v = btree_find(t, &k);
+        if (!v || *v != k * 10L)
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+    int missing = 10000;
+    CU_ASSERT(btree_find(t, &missing) == NULL);
+    CU_ASSERT(!btree_contains(t, &missing));
+
+    // replacing keeps the size.
+    int k = 5;
+    long v = 55;
+    btree_insert(t, &k, &v);
+    CU_ASSERT(btree_size(t) == 10000);
+    CU_ASSERT(*(long*) btree_find(t, &k) == 55);
+
+    btree_clear(t);
+    CU_ASSERT(btree_size(t) == 0);
+    CU_ASSERT(!btree_contains(t, &k));
+    btree_insert(t, &k, &v);
+    CU_ASSERT(btree_size(t) == 1);
+
+    btree_destroy(t);
+}
+
+void random_btree()
+{
+    enum { N = 3000 };
+    static unsigned char present[N];
+    BTree_t t = btree_create(sizeof(int), sizeof(long), cmp_int);
+    uint32_t state = 12345;
+    int correct = 1;
+
+    memset(present, 0, sizeof(present));
+    for (int round = 0; round < 40000; round++) {
+        int k = next_rand(&state) % N;
+        if (next_rand(&state) % 3) {
+            long v = k * 10L;
+            btree_insert(t, &k, &v);
+            present[k] = 1;
+        }
+        else {
+            int ret = btree_remove(t, &k);
+            if (ret != (present[k] ? BTREE_OK : BTREE_NOT_FOUND))
+                correct = 0;
+            present[k] = 0;
+        }
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(check_tree(t, present, N));
+
+    // remove everything.
+    for (int k = 0; k < N; k++)
+        if (present[k] && btree_remove(t, &k) != BTREE_OK)
+            correct = 0;
+    CU_ASSERT(correct);
+    CU_ASSERT(btree_size(t) == 0);
+
+    btree_destroy(t);
+}
+
+void bulk_load_btree()
+{
+    enum { N = 5000 };
+    static unsigned char present[N];
+    BTree_t t = btree_create(sizeof(int), sizeof(long), cmp_int);
+    DArray_t keys = darray_create(sizeof(int), NULL, NULL);
+    DArray_t values = darray_create(sizeof(long), NULL, NULL);
+    DArray_t shorts = darray_create(sizeof(short), NULL, NULL);
+
+    for (int k = 0; k < N; k += 2) {
+        long v = k * 10L;
+        darray_append(keys, &k);
+        darray_append(values, &v);
+        present[k] = 1;
+    }
+    CU_ASSERT(btree_bulk_load(t, shorts, values) == BTREE_INVALID);
+    CU_ASSERT(btree_bulk_load(t, keys, NULL) == BTREE_INVALID);
+    CU_ASSERT(btree_bulk_load(t, keys, values) == BTREE_OK);
+    CU_ASSERT(check_tree(t, present, N));
+    CU_ASSERT(btree_bulk_load(t, keys, values) == BTREE_INVALID);
+
+    // the loaded tree is a normal tree.
+    for (int k = 1; k < N; k += 4) {
+        long v = k * 10L;
+        btree_insert(t, &k, &v);
+        present[k] = 1;
+    }
+    for (int k = 0; k < N; k += 6) {
+        btree_remove(t, &k);
+        present[k] = 0;
+    }
+    CU_ASSERT(check_tree(t, present, N));
+
+    // unsorted keys are rejected.
+    BTree_t u = btree_create(sizeof(int), sizeof(long), cmp_int);
+    int k = 0;
+    darray_set(keys, 1, &k);
+    CU_ASSERT(btree_bulk_load(u, keys, values) == BTREE_INVALID);
+    CU_ASSERT(btree_size(u) == 0);
+
+    btree_destroy(u);
+    btree_destroy(t);
+    darray_destroy(keys);
+    darray_destroy(values);
+    darray_destroy(shorts);
+}
+
+void range_btree()
+{
+    BTree_t t = btree_create(sizeof(int), 0, cmp_int);
+    BTreeIter it;
+    int lo = 100, hi = 200, sum = 0, count = 0;
+
+    // a set of the multiples of 3 below 1000.
+    for (int k = 0; k < 1000; k += 3)
+        btree_insert(t, &k, NULL);
+
+    for (btree_lower_bound(t, &lo, &it);
+         btree_iter_valid(&it) && cmp_int(btree_iter_key(&it), &hi) < 0;
+         btree_iter_next(&it)) {
+        sum += *(int*) btree_iter_key(&it);
+        count++;
+    }
+    CU_ASSERT(count == 33);       // 102 .. 198
+    CU_ASSERT(sum == 33 * 150);
+
+    int k = 99;
+    btree_lower_bound(t, &k, &it);
+    CU_ASSERT(*(int*) btree_iter_key(&it) == 99);
+    btree_successor(t, &k, &it);
+    CU_ASSERT(*(int*) btree_iter_key(&it) == 102);
+    btree_predecessor(t, &k, &it);
+    CU_ASSERT(*(int*) btree_iter_key(&it) == 96);
+
+    k = 0;
+    btree_predecessor(t, &k, &it);
+    CU_ASSERT(!btree_iter_valid(&it));
+    k = 999;
+    btree_successor(t, &k, &it);
+    CU_ASSERT(!btree_iter_valid(&it));
+    btree_lower_bound(t, &k, &it);
+    CU_ASSERT(*(int*) btree_iter_key(&it) == 999);
+    k = 5000;
+    btree_predecessor(t, &k, &it);
+    CU_ASSERT(*(int*) btree_iter_key(&it) == 999);
+
+    btree_destroy(t);
+}
+
+void large_keys_btree()
+{
+    // the key is the first member, so cmp_int compares them.
+    struct Big { int key; char pad[300]; } big;
+    BTree_t t = btree_create(sizeof(big), sizeof(int), cmp_int);
+    int correct = 1;
+
+    memset(&big, 0, sizeof(big));
+    for (int i = 0; i < 500; i++) {
+        big.key = (i * 37) % 500;
+        btree_insert(t, &big, &i);
+    }
+    for (int i = 0; i < 500; i += 2) {
+        big.key = i;
+        btree_remove(t, &big);
+    }
+    CU_ASSERT(btree_size(t) == 250);
+    for (int i = 0; i < 500; i++) {
+        big.key = i;
+        if (btree_contains(t, &big) != (i % 2))
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+    btree_destroy(t);
+}
+
+/* * Tests  registration * */
+
+int add_btree_suite()
+{
+    CU_pSuite suite = CU_add_suite("btree-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create btree suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "insert_find", insert_find_btree);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create btree test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "random", random_btree);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create btree test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "bulk_load", bulk_load_btree);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create btree test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "range", range_btree);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create btree test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "large_keys", large_keys_btree);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create btree test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
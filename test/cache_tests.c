@@ -0,0 +1,284 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../src/cache.h"
+
+/* * utilities * */
+
+static size_t g_evicted;
+static uintptr_t g_evicted_sum;
+
+static void
+count_evict(void* value)
+{
+    g_evicted++;
+    g_evicted_sum += (uintptr_t) value;
+}
+
+static void
+reset_evicted(void)
+{
+    g_evicted = 0;
+    g_evicted_sum = 0;
+}
+
+static int
+put_int(Cache_t c, int key, uintptr_t value, size_t cost)
+{
+    return cache_put(c, &key, sizeof(key), (void*) value, cost);
+}
+
+static uintptr_t
+get_int(Cache_t c, int key)
+{
+    return (uintptr_t) cache_get(c, &key, sizeof(key));
+}
+
+static int
+contains_int(Cache_t c, int key)
+{
+    return cache_contains(c, &key, sizeof(key));
+}
+
+/* * Tests * */
+
+void put_get_cache()
+{
+    Cache_t c = cache_create(CACHE_LRU, 0, 0, count_evict);
+    CacheStats stats;
+
+    reset_evicted();
+    CU_ASSERT(c != NULL);
+    CU_ASSERT(cache_size(c) == 0);
+    CU_ASSERT(cache_get(c, "a", 1) == NULL);
+
+    CU_ASSERT(cache_put(c, "a", 1, (void*) 1, 10) == CACHE_OK);
+    CU_ASSERT(cache_put(c, "bb", 2, (void*) 2, 20) == CACHE_OK);
+    CU_ASSERT(cache_size(c) == 2);
+    CU_ASSERT(cache_bytes(c) == 30);
+    CU_ASSERT(cache_get(c, "a", 1) == (void*) 1);
+    CU_ASSERT(cache_get(c, "bb", 2) == (void*) 2);
+    CU_ASSERT(cache_get(c, "b", 1) == NULL);
+
+    // replacing passes the old value to evict.
+    CU_ASSERT(cache_put(c, "a", 1, (void*) 3, 5) == CACHE_OK);
+    CU_ASSERT(g_evicted == 1 && g_evicted_sum == 1);
+    CU_ASSERT(cache_get(c, "a", 1) == (void*) 3);
+    CU_ASSERT(cache_bytes(c) == 25);
+
+    CU_ASSERT(cache_remove(c, "bb", 2) == CACHE_OK);
+    CU_ASSERT(cache_remove(c, "bb", 2) == CACHE_NOT_FOUND);
+    CU_ASSERT(g_evicted == 2 && g_evicted_sum == 3);
+    CU_ASSERT(cache_size(c) == 1);
+
+    cache_stats(c, &stats);
+    CU_ASSERT(stats.hits == 3);
+    CU_ASSERT(stats.misses == 2);
+    CU_ASSERT(stats.evictions == 0);
+    cache_reset_stats(c);
+    cache_stats(c, &stats);
+    CU_ASSERT(stats.hits == 0 && stats.misses == 0);
+
+    cache_destroy(c);
+    CU_ASSERT(g_evicted == 3 && g_evicted_sum == 6);
+}
+
+void lru_cache()
+{
+    Cache_t c = cache_create(CACHE_LRU, 3, 0, count_evict);
+    CacheStats stats;
+
+    reset_evicted();
+    put_int(c, 1, 1, 0);
+    put_int(c, 2, 2, 0);
+    put_int(c, 3, 3, 0);
+    CU_ASSERT(get_int(c, 1) == 1); // 2 is now the least recent.
+
+    put_int(c, 4, 4, 0);
+    CU_ASSERT(cache_size(c) == 3);
+    CU_ASSERT(!contains_int(c, 2));
+    CU_ASSERT(contains_int(c, 1) && contains_int(c, 3) && contains_int(c, 4));
+    CU_ASSERT(g_evicted_sum == 2);
+
+    put_int(c, 5, 5, 0);
+    CU_ASSERT(!contains_int(c, 3));
+
+    cache_stats(c, &stats);
+    CU_ASSERT(stats.evictions == 2);
+    cache_destroy(c);
+}
+
+void clock_cache()
+{
+    Cache_t c = cache_create(CACHE_CLOCK, 3, 0, count_evict);
+
+    reset_evicted();
+    put_int(c, 1, 1, 0);
+    put_int(c, 2, 2, 0);
+    put_int(c, 3, 3, 0);
+    CU_ASSERT(get_int(c, 1) == 1); // 1 gets a second chance.
+
+    put_int(c, 4, 4, 0);
+    CU_ASSERT(!contains_int(c, 2));
+    CU_ASSERT(contains_int(c, 1));
+
+    // the hand has cleared the flag of 1, it is evicted after 3.
+    put_int(c, 5, 5, 0);
+    CU_ASSERT(!contains_int(c, 3));
+    put_int(c, 6, 6, 0);
+    CU_ASSERT(!contains_int(c, 1));
+    CU_ASSERT(contains_int(c, 4) && contains_int(c, 5) && contains_int(c, 6));
+
+    cache_destroy(c);
+}
+
+void byte_limit_cache()
+{
+    Cache_t c = cache_create(CACHE_LRU, 0, 100, count_evict);
+
+    reset_evicted();
+    CU_ASSERT(put_int(c, 1, 1, 101) == CACHE_TOO_LARGE);
+    CU_ASSERT(cache_size(c) == 0);
+
+    for (int i = 0; i < 10; i++)
+        put_int(c, i, i, 10);
+    CU_ASSERT(cache_bytes(c) == 100);
+    CU_ASSERT(g_evicted == 0);
+
+    put_int(c, 10, 10, 35);
+    CU_ASSERT(cache_bytes(c) <= 100);
+    CU_ASSERT(cache_size(c) == 7);
+    CU_ASSERT(!contains_int(c, 0) && !contains_int(c, 3));
+    CU_ASSERT(contains_int(c, 4));
+
+    // growing a value evicts others, never the value itself.
+    put_int(c, 4, 4, 100);
+    CU_ASSERT(cache_size(c) == 1);
+    CU_ASSERT(get_int(c, 4) == 4);
+    CU_ASSERT(cache_bytes(c) == 100);
+
+    cache_clear(c);
+    CU_ASSERT(cache_size(c) == 0);
+    CU_ASSERT(cache_bytes(c) == 0);
+    CU_ASSERT(g_evicted == 11);
+
+    cache_destroy(c);
+}
+
+void many_cache()
+{
+    const int n = 5000, cap = 1000;
+    Cache_t lru = cache_create(CACHE_LRU, cap, 0, NULL);
+    Cache_t clock = cache_create(CACHE_CLOCK, cap, 0, NULL);
+    int correct = 1;
+
+    for (int i = 0; i < n; i++) {
+        put_int(lru, i, i + 1, 1);
+        put_int(clock, i, i + 1, 1);
+        if (i % 3 == 0) {
+            int k = i - 7;
+            cache_remove(lru, &k, sizeof(k));
+            cache_remove(clock, &k, sizeof(k));
+        }
+    }
+    CU_ASSERT(cache_size(lru) <= (size_t) cap);
+    CU_ASSERT(cache_size(clock) <= (size_t) cap);
+
+    // the most recent keys are in the LRU cache.
+    for (int i = n - cap / 2; i < n; i++) {
+        uintptr_t v = get_int(lru, i);
+        if (v != (uintptr_t) i + 1 && !((i + 7) % 3 == 0 && i + 7 < n))
+            correct = 0;
+    }
+    // everything that is found has the right value.
+    for (int i = 0; i < n; i++) {
+        uintptr_t v = get_int(clock, i);
+        if (v && v != (uintptr_t) i + 1)
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+
+    cache_destroy(lru);
+    cache_destroy(clock);
+}
+
+/* * Tests  registration * */
+
+int add_cache_suite()
+{
+    CU_pSuite suite = CU_add_suite("cache-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create cache suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "put_get", put_get_cache);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create cache test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "lru", lru_cache);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create cache test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "clock", clock_cache);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create cache test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "byte_limit", byte_limit_cache);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create cache test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "many", many_cache);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create cache test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
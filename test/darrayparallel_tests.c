@@ -0,0 +1,222 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../src/darray.h"
+
+/* * utilities * */
+
+/* large enough to run in parallel. */
+#define PAR_N 100003
+
+/* the accumulator of an order sensitive reduction. */
+struct Span {
+    int64_t first;
+    int64_t last;
+    int64_t sum;
+    int     ordered;
+};
+
+static DArray_t
+make_array(size_t n)
+{
+    DArray_t array = darray_create_capacity(sizeof(int), NULL, NULL, n);
+    for (int i = 0; i < (int) n; i++)
+        darray_append(array, &i);
+    return array;
+}
+
+static void
+double_int(void* element, void* arg)
+{
+    *(int*) element *= 2;
+}
+
+static void
+sum_int(void* acc, const void* element, void* arg)
+{
+    *(int64_t*) acc += *(const int*) element;
+}
+
+static void
+sum_int64(void* acc, const void* other, void* arg)
+{
+    *(int64_t*) acc += *(const int64_t*) other;
+}
+
+static void
+span_add(void* acc, const void* element, void* arg)
+{
+    struct Span* s = acc;
+    int v = *(const int*) element;
+    if (s->first < 0)
+        s->first = v;
+    else if (v != s->last + 1)
+        s->ordered = 0;
+    s->last = v;
+    s->sum += v;
+}
+
+static void
+span_combine(void* acc, const void* other, void* arg)
+{
+    struct Span* s = acc;
+    const struct Span* o = other;
+    if (o->first < 0)
+        return;
+    if (s->first < 0)
+        *s = *o;
+    else {
+        if (o->first != s->last + 1 || !o->ordered)
+            s->ordered = 0;
+        s->last = o->last;
+        s->sum += o->sum;
+    }
+}
+
+static void
+int_to_double(void* dest, const void* src, void* arg)
+{
+    *(double*) dest = *(const int*) src * *(double*) arg;
+}
+
+/* * Tests * */
+
+void for_each_darray_parallel()
+{
+    ThreadPool_t pool = threadpool_create(3);
+    size_t sizes[] = {0, 10, PAR_N};
+    int correct = 1;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        DArray_t array = make_array(sizes[s]);
+        darray_parallel_for_each(array, pool, double_int, NULL);
+        darray_parallel_for_each(array, NULL, double_int, NULL);
+        for (size_t i = 0; i < darray_size(array); i++)
+            if (*(int*) darray_get(array, i) != (int) i * 4)
+                correct = 0;
+        darray_destroy(array);
+    }
+    CU_ASSERT(correct);
+    threadpool_destroy(pool);
+}
+
+void reduce_darray_parallel()
+{
+    ThreadPool_t pool = threadpool_create(3);
+    DArray_t array = make_array(PAR_N);
+    int64_t sum = 0;
+    struct Span span = {-1, -1, 0, 1};
+
+    darray_parallel_reduce(array, pool, &sum, sizeof(sum),
+                           sum_int, sum_int64, NULL);
+    CU_ASSERT(sum == (int64_t) PAR_N * (PAR_N - 1) / 2);
+
+    // the chunks are combined in order.
+    darray_parallel_reduce(array, NULL, &span, sizeof(span),
+                           span_add, span_combine, NULL);
+    CU_ASSERT(span.ordered);
+    CU_ASSERT(span.first == 0);
+    CU_ASSERT(span.last == PAR_N - 1);
+    CU_ASSERT(span.sum == sum);
+    darray_destroy(array);
+
+    array = make_array(100);
+    sum = 10;
+    darray_parallel_reduce(array, pool, &sum, sizeof(sum),
+                           sum_int, sum_int64, NULL);
+    CU_ASSERT(sum == 10 + 99 * 100 / 2);
+    darray_destroy(array);
+
+    threadpool_destroy(pool);
+}
+
+void transform_darray_parallel()
+{
+    ThreadPool_t pool = threadpool_create(3);
+    DArray_t src = make_array(PAR_N);
+    DArray_t dest = darray_create(sizeof(double), NULL, NULL);
+    double factor = 0.5;
+    int correct = 1;
+
+    CU_ASSERT(darray_parallel_transform(dest, src, pool,
+                                        int_to_double, &factor) == 0);
+    CU_ASSERT(darray_size(dest) == PAR_N);
+    for (size_t i = 0; i < darray_size(dest); i++)
+        if (*(double*) darray_get(dest, i) != i * 0.5)
+            correct = 0;
+    CU_ASSERT(correct);
+
+    // the old contents of dest are replaced.
+    darray_destroy(src);
+    src = make_array(7);
+    CU_ASSERT(darray_parallel_transform(dest, src, NULL,
+                                        int_to_double, &factor) == 0);
+    CU_ASSERT(darray_size(dest) == 7);
+    CU_ASSERT(*(double*) darray_get(dest, 6) == 3.0);
+
+    darray_destroy(dest);
+    darray_destroy(src);
+    threadpool_destroy(pool);
+}
+
+/* * Tests  registration * */
+
+int add_darray_parallel_suite()
+{
+    CU_pSuite suite = CU_add_suite("darray-parallel-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create darray parallel suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "for_each", for_each_darray_parallel);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray parallel test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "reduce", reduce_darray_parallel);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray parallel test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "transform", transform_darray_parallel);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray parallel test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,206 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "../src/darrayrcu.h"
+#include "../src/memtrace.h"
+
+/* * utilities * */
+
+static DArray_t
+make_array(int n, int value)
+{
+    DArray_t array = darray_create(sizeof(int), NULL, NULL);
+    for (int i = 0; i < n; i++)
+        darray_append(array, &value);
+    return array;
+}
+
+static int
+append_int(DArray_t copy, void* arg)
+{
+    return darray_append(copy, arg);
+}
+
+static int
+fail(DArray_t copy, void* arg)
+{
+    (void) copy;
+    (void) arg;
+    return 5;
+}
+
+static int
+fill_int(DArray_t copy, void* arg)
+{
+    darray_fill(copy, arg);
+    return 0;
+}
+
+/* * Tests * */
+
+void update_darray_rcu()
+{
+    DArrayRcu_t rcu = darray_rcu_create(make_array(10, 1));
+    DArrayRcuReader_t reader = darray_rcu_reader_create(rcu);
+    int value = 2;
+
+    DArray_t v1 = darray_rcu_read_lock(reader);
+    CU_ASSERT(darray_size(v1) == 10);
+
+    // the reader keeps its version while a writer publishes.
+    CU_ASSERT(darray_rcu_update(rcu, append_int, &value) == 0);
+    CU_ASSERT(darray_rcu_update(rcu, append_int, &value) == 0);
+    CU_ASSERT(darray_size(v1) == 10);
+    CU_ASSERT(*(int*) darray_get(v1, 9) == 1);
+
+    DArray_t nested = darray_rcu_read_lock(reader);
+    CU_ASSERT(darray_size(nested) == 12);
+    CU_ASSERT(*(int*) darray_get(nested, 11) == 2);
+    darray_rcu_read_unlock(reader);
+    darray_rcu_read_unlock(reader);
+
+    // a failing update publishes nothing.
+    CU_ASSERT(darray_rcu_update(rcu, fail, NULL) == 5);
+    DArray_t v2 = darray_rcu_read_lock(reader);
+    CU_ASSERT(darray_size(v2) == 12);
+    darray_rcu_read_unlock(reader);
+
+    CU_ASSERT(darray_rcu_publish(rcu, make_array(3, 7)) == 0);
+    DArray_t v3 = darray_rcu_read_lock(reader);
+    CU_ASSERT(darray_size(v3) == 3);
+    CU_ASSERT(*(int*) darray_get(v3, 0) == 7);
+    darray_rcu_read_unlock(reader);
+
+    darray_rcu_reader_destroy(reader);
+    darray_rcu_destroy(rcu);
+}
+
+void reclaim_darray_rcu()
+{
+    ClibMemStats before, after;
+    DArrayRcu_t rcu = darray_rcu_create(make_array(10000, 0));
+    DArrayRcuReader_t reader = darray_rcu_reader_create(rcu);
+
+    clib_mem_stats(CLIB_MEM_DARRAY, &before);
+    for (int i = 0; i < 100; i++) {
+        darray_rcu_read_lock(reader);
+        darray_rcu_read_unlock(reader);
+        darray_rcu_update(rcu, fill_int, &i);
+    }
+    clib_mem_stats(CLIB_MEM_DARRAY, &after);
+
+    // old versions don't pile up when the readers come and go.
+    CU_ASSERT(after.live_bytes < before.live_bytes + 4 * 10000 * sizeof(int));
+
+    darray_rcu_reader_destroy(reader);
+    darray_rcu_destroy(rcu);
+}
+
+struct RcuShared {
+    DArrayRcu_t     rcu;
+    atomic_int      stop;
+    atomic_int      errors;
+};
+
+static void*
+rcu_reader(void* arg)
+{
+    struct RcuShared* shared = arg;
+    DArrayRcuReader_t reader = darray_rcu_reader_create(shared->rcu);
+
+    while (!atomic_load(&shared->stop)) {
+        DArray_t version = darray_rcu_read_lock(reader);
+        int first = *(int*) darray_get(version, 0);
+        // every version holds one value, a torn version is an error.
+        for (size_t i = 1; i < darray_size(version); i++)
+            if (*(int*) darray_get(version, i) != first)
+                atomic_fetch_add(&shared->errors, 1);
+        darray_rcu_read_unlock(reader);
+    }
+    darray_rcu_reader_destroy(reader);
+    return NULL;
+}
+
+void threads_darray_rcu()
+{
+    struct RcuShared shared;
+    pthread_t readers[4];
+
+    shared.rcu = darray_rcu_create(make_array(1000, 0));
+    atomic_init(&shared.stop, 0);
+    atomic_init(&shared.errors, 0);
+
+    for (int t = 0; t < 4; t++)
+        pthread_create(&readers[t], NULL, rcu_reader, &shared);
+    for (int i = 1; i <= 2000; i++)
+        darray_rcu_update(shared.rcu, fill_int, &i);
+    atomic_store(&shared.stop, 1);
+    for (int t = 0; t < 4; t++)
+        pthread_join(readers[t], NULL);
+
+    CU_ASSERT(atomic_load(&shared.errors) == 0);
+    darray_rcu_destroy(shared.rcu);
+}
+
+/* * Tests  registration * */
+
+int add_darray_rcu_suite()
+{
+    CU_pSuite suite = CU_add_suite("darray_rcu-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create darray_rcu suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "update", update_darray_rcu);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray_rcu test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "reclaim", reclaim_darray_rcu);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray_rcu test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "threads", threads_darray_rcu);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray_rcu test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
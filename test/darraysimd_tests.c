@@ -0,0 +1,235 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../src/darray.h"
+
+/* * utilities * */
+
+/* element sizes with and without vector kernels. */
+static const size_t g_widths[] = {1, 2, 3, 4, 8, 16, 24};
+
+static DArray_t
+make_blobs(size_t w, size_t n)
+{
+    DArray_t array = darray_create_capacity(w, NULL, NULL, n);
+    unsigned char blob[32];
+    for (size_t i = 0; i < n; i++) {
+        // distinct as long as i < 250
+        memset(blob, 0, sizeof(blob));
+        blob[w - 1] = (unsigned char) (i % 250 + 1);
+        darray_append(array, blob);
+    }
+    return array;
+}
+
+/* * Tests * */
+
+void find_count_darray_simd()
+{
+    int best = darray_simd_level();
+    int correct = 1;
+    unsigned char blob[32] = {0};
+
+    for (int level = DARRAY_SIMD_SCALAR; level <= best; level++) {
+        CU_ASSERT(darray_set_simd_level(level) == level);
+        for (size_t k = 0; k < sizeof(g_widths) / sizeof(g_widths[0]); k++) {
+            size_t w = g_widths[k];
+            DArray_t array = make_blobs(w, 1000);
+
+            for (size_t i = 0; i < 250; i += 7) {
+                memset(blob, 0, sizeof(blob));
+                blob[w - 1] = (unsigned char) (i + 1);
+                if (darray_find_bytes(array, blob) != i)
+                    correct = 0;
+                // 1000 elements cycle through 250 values.
+                if (darray_count_bytes(array, blob) != 4)
+                    correct = 0;
+            }
+            // a value that matches all but one byte of the elements
+            blob[w - 1] = 0;
+            if (darray_find_bytes(array, blob) != 1000)
+                correct = 0;
+            if (darray_count_bytes(array, blob) != 0)
+                correct = 0;
+            darray_destroy(array);
+        }
+    }
+    CU_ASSERT(correct);
+    darray_set_simd_level(best);
+}
+
+void fill_equal_darray_simd()
+{
+    int best = darray_simd_level();
+    int correct = 1;
+    unsigned char blob[32];
+
+    for (size_t i = 0; i < sizeof(blob); i++)
+        blob[i] = (unsigned char) (i * 3 + 1);
+
+    for (int level = DARRAY_SIMD_SCALAR; level <= best; level++) {
+        darray_set_simd_level(level);
+        for (size_t k = 0; k < sizeof(g_widths) / sizeof(g_widths[0]); k++) {
+            size_t w = g_widths[k];
+            DArray_t a = make_blobs(w, 333);
+            DArray_t b = make_blobs(w, 333);
+
+            if (!darray_equal(a, b))
+                correct = 0;
+            darray_fill(a, blob);
+            if (darray_equal(a, b))
+                correct = 0;
+            if (darray_count_bytes(a, blob) != 333)
+                correct = 0;
+            darray_fill(b, blob);
+            if (!darray_equal(a, b))
+                correct = 0;
+            darray_destroy(a);
+            darray_destroy(b);
+        }
+    }
+    CU_ASSERT(correct);
+    darray_set_simd_level(best);
+}
+
+void numeric_darray_simd()
+{
+    int best = darray_simd_level();
+    size_t sizes[] = {1, 7, 1001};
+
+    for (int level = DARRAY_SIMD_SCALAR; level <= best; level++) {
+        darray_set_simd_level(level);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            size_t n = sizes[s];
+            DArray_t i32 = darray_create(sizeof(int32_t), NULL, NULL);
+            DArray_t i64 = darray_create(sizeof(int64_t), NULL, NULL);
+            DArray_t f32 = darray_create(sizeof(float), NULL, NULL);
+            DArray_t f64 = darray_create(sizeof(double), NULL, NULL);
+            int64_t isum, exp_sum = 0;
+            double dsum;
+            int32_t min32, max32;
+            int64_t min64, max64;
+            float minf, maxf;
+            double mind, maxd;
+
+            // values from -n/2 to n/2 in scrambled order
+            for (size_t i = 0; i < n; i++) {
+                int32_t v = (int32_t) ((i * 37) % n) - (int32_t) (n / 2);
+                int64_t v64 = (int64_t) v * 1000000000;
+                float vf = v * 0.5f;
+                double vd = v * 0.25;
+                darray_append(i32, &v);
+                darray_append(i64, &v64);
+                darray_append(f32, &vf);
+                darray_append(f64, &vd);
+                exp_sum += v;
+            }
+
+            CU_ASSERT(darray_min(i32, DARRAY_INT32, &min32) == 0);
+            CU_ASSERT(darray_max(i32, DARRAY_INT32, &max32) == 0);
+            CU_ASSERT(min32 == -(int32_t) (n / 2));
+            CU_ASSERT(max32 == (int32_t) (n - 1 - n / 2));
+            darray_sum(i32, DARRAY_INT32, &isum);
+            CU_ASSERT(isum == exp_sum);
+
+            darray_min(i64, DARRAY_INT64, &min64);
+            darray_max(i64, DARRAY_INT64, &max64);
+            CU_ASSERT(min64 == min32 * (int64_t) 1000000000);
+            CU_ASSERT(max64 == max32 * (int64_t) 1000000000);
+            darray_sum(i64, DARRAY_INT64, &isum);
+            CU_ASSERT(isum == exp_sum * 1000000000);
+
+            darray_min(f32, DARRAY_FLOAT, &minf);
+            darray_max(f32, DARRAY_FLOAT, &maxf);
+            CU_ASSERT(minf == min32 * 0.5f);
+            CU_ASSERT(maxf == max32 * 0.5f);
+            darray_sum(f32, DARRAY_FLOAT, &dsum);
+            CU_ASSERT(dsum == exp_sum * 0.5);
+
+            darray_min(f64, DARRAY_DOUBLE, &mind);
+            darray_max(f64, DARRAY_DOUBLE, &maxd);
+            CU_ASSERT(mind == min32 * 0.25);
+            CU_ASSERT(maxd == max32 * 0.25);
+            darray_sum(f64, DARRAY_DOUBLE, &dsum);
+            CU_ASSERT(dsum == exp_sum * 0.25);
+
+            darray_destroy(i32);
+            darray_destroy(i64);
+            darray_destroy(f32);
+            darray_destroy(f64);
+        }
+    }
+
+    DArray_t empty = darray_create(sizeof(int32_t), NULL, NULL);
+    int32_t v;
+    int64_t sum = 1;
+    CU_ASSERT(darray_min(empty, DARRAY_INT32, &v) != 0);
+    darray_sum(empty, DARRAY_INT32, &sum);
+    CU_ASSERT(sum == 0);
+    darray_destroy(empty);
+
+    darray_set_simd_level(best);
+}
+
+/* * Tests  registration * */
+
+int add_darray_simd_suite()
+{
+    CU_pSuite suite = CU_add_suite("darray-simd-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create darray simd suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "find_count", find_count_darray_simd);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray simd test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "fill_equal", fill_equal_darray_simd);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray simd test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "numeric", numeric_darray_simd);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray simd test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,206 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../src/darray.h"
+
+/* * utilities * */
+
+static DArray_t
+make_array(size_t n)
+{
+    DArray_t array = darray_create_capacity(sizeof(int), NULL, NULL, n);
+    for (int i = 0; i < (int) n; i++)
+        darray_append(array, &i);
+    return array;
+}
+
+static int
+cmp_int(void* a, void* b)
+{
+    int x = *(int*) a, y = *(int*) b;
+    return (x > y) - (x < y);
+}
+
+static void
+sum_int(void* acc, const void* element, void* arg)
+{
+    *(int64_t*) acc += *(const int*) element;
+}
+
+static void
+sum_int64(void* acc, const void* other, void* arg)
+{
+    *(int64_t*) acc += *(const int64_t*) other;
+}
+
+static void
+negate(void* dest, const void* src, void* arg)
+{
+    *(int*) dest = -*(const int*) src;
+}
+
+/* * Tests * */
+
+void view_darray_slice()
+{
+    DArray_t array = make_array(100);
+    DArraySlice all = darray_slice_all(array);
+    DArraySlice mid = darray_slice(array, 10, 50);
+    DArraySlice sub = darray_slice_sub(&mid, 5, 15);
+    DArraySlice odd = darray_slice_strided(&mid, 3);
+    int packed[14];
+    int correct = 1;
+
+    CU_ASSERT(all.n == 100);
+    CU_ASSERT(mid.n == 40);
+    CU_ASSERT(*(int*) darray_slice_get(&mid, 0) == 10);
+    CU_ASSERT(sub.n == 10);
+    CU_ASSERT(*(int*) darray_slice_get(&sub, 9) == 24);
+    CU_ASSERT(darray_slice_contiguous(&sub));
+
+    // 10, 13, ..., 49
+    CU_ASSERT(odd.n == 14);
+    CU_ASSERT(!darray_slice_contiguous(&odd));
+    CU_ASSERT(*(int*) darray_slice_get(&odd, 13) == 49);
+
+    darray_slice_copy(&odd, packed);
+    for (int i = 0; i < 14; i++)
+        if (packed[i] != 10 + 3 * i)
+            correct = 0;
+    CU_ASSERT(correct);
+
+    DArraySliceIter iter = darray_slice_iter(&odd);
+    int* v;
+    int count = 0;
+    while ((v = darray_slice_next(&iter)) != NULL) {
+        if (*v != 10 + 3 * count)
+            correct = 0;
+        count++;
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(count == 14);
+
+    DArraySlice empty = darray_slice_sub(&mid, 3, 3);
+    iter = darray_slice_iter(&empty);
+    CU_ASSERT(darray_slice_next(&iter) == NULL);
+    darray_destroy(array);
+}
+
+void sort_search_darray_slice()
+{
+    DArray_t array = make_array(1000);
+    DArraySlice all = darray_slice_all(array);
+    DArraySlice evens = darray_slice_strided(&all, 2);
+    DArraySlice tail = darray_slice(array, 900, 1000);
+    int key = 998, missing = 999;
+
+    // reverse the order of the even elements only
+    for (size_t i = 0; i < 1000; i += 2)
+        *(int*) darray_get(array, i) = (int) (1000 - i);
+    CU_ASSERT(darray_slice_sort(&evens, NULL, cmp_int, 1) == 0);
+    CU_ASSERT(*(int*) darray_get(array, 0) == 2);
+    CU_ASSERT(*(int*) darray_get(array, 998) == 1000);
+    CU_ASSERT(*(int*) darray_get(array, 1) == 1);
+
+    CU_ASSERT(darray_slice_find_bytes(&evens, &key) == 498);
+    CU_ASSERT(darray_slice_find_bytes(&evens, &missing) == evens.n);
+    CU_ASSERT(darray_slice_find_bytes(&tail, &missing) == 99);
+    CU_ASSERT(darray_slice_count_bytes(&tail, &key) == 1);
+    CU_ASSERT(darray_slice_count_bytes(&evens, &missing) == 0);
+
+    // a contiguous range is sorted in place
+    DArraySlice head = darray_slice(array, 0, 10);
+    for (size_t i = 0; i < 10; i++)
+        *(int*) darray_get(array, i) = (int) (10 - i);
+    CU_ASSERT(darray_slice_sort(&head, NULL, cmp_int, 0) == 0);
+    CU_ASSERT(*(int*) darray_get(array, 0) == 1);
+    CU_ASSERT(*(int*) darray_get(array, 9) == 10);
+    CU_ASSERT(*(int*) darray_get(array, 10) == 12);
+    darray_destroy(array);
+}
+
+void parallel_darray_slice()
+{
+    const size_t n = 100000;
+    DArray_t array = make_array(n);
+    DArray_t dest = darray_create(sizeof(int), NULL, NULL);
+    DArraySlice all = darray_slice_all(array);
+    DArraySlice thirds = darray_slice_strided(&all, 3);
+    int64_t sum = 0, expected = 0;
+
+    for (size_t i = 0; i < n; i += 3)
+        expected += (int64_t) i;
+    darray_slice_parallel_reduce(&thirds, NULL, &sum, sizeof(sum),
+                                 sum_int, sum_int64, NULL);
+    CU_ASSERT(sum == expected);
+
+    CU_ASSERT(darray_slice_parallel_transform(dest, &thirds, NULL,
+                                              negate, NULL) == 0);
+    CU_ASSERT(darray_size(dest) == thirds.n);
+    CU_ASSERT(*(int*) darray_get(dest, 100) == -300);
+
+    darray_destroy(dest);
+    darray_destroy(array);
+}
+
+/* * Tests  registration * */
+
+int add_darray_slice_suite()
+{
+    CU_pSuite suite = CU_add_suite("darray-slice-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create darray slice suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "view", view_darray_slice);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray slice test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "sort_search", sort_search_darray_slice);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray slice test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "parallel", parallel_darray_slice);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray slice test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,216 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include "../src/darray.h"
+
+/* * utilities * */
+
+/* large enough to sort in parallel. */
+#define SORT_N 200001
+
+struct Record {
+    int key;
+    int seq;
+};
+
+static unsigned g_seed = 12345;
+
+static int
+next_random()
+{
+    g_seed = g_seed * 1103515245u + 12345u;
+    return (int) (g_seed >> 16);
+}
+
+static int
+cmp_int(void* a, void* b)
+{
+    int x = *(int*) a, y = *(int*) b;
+    return (x > y) - (x < y);
+}
+
+static int
+cmp_record(void* a, void* b)
+{
+    return cmp_int(&((struct Record*) a)->key, &((struct Record*) b)->key);
+}
+
+static DArray_t
+random_records(size_t n, int nkeys)
+{
+    DArray_t array = darray_create_capacity(sizeof(struct Record),
+                                            NULL, NULL, n);
+    for (size_t i = 0; i < n; i++) {
+        struct Record r = {next_random() % nkeys, (int) i};
+        darray_append(array, &r);
+    }
+    return array;
+}
+
+/* checks the order and, when stable, the order of equal keys. */
+static int
+records_sorted(DArray_t array, int stable)
+{
+    for (size_t i = 1; i < darray_size(array); i++) {
+        struct Record* a = darray_get(array, i - 1);
+        struct Record* b = darray_get(array, i);
+        if (a->key > b->key)
+            return 0;
+        if (stable && a->key == b->key && a->seq > b->seq)
+            return 0;
+    }
+    return 1;
+}
+
+/* * Tests * */
+
+void sort_darray()
+{
+    ThreadPool_t pool = threadpool_create(3);
+    size_t sizes[] = {0, 1, 100, 5000, SORT_N};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        DArray_t array = darray_create(sizeof(int), NULL, NULL);
+        unsigned sum = 0, sorted_sum = 0;
+        for (size_t i = 0; i < sizes[s]; i++) {
+            int v = next_random();
+            sum += v;
+            darray_append(array, &v);
+        }
+
+        CU_ASSERT(darray_parallel_sort(array, pool, cmp_int, 0) == 0);
+        CU_ASSERT(darray_size(array) == sizes[s]);
+        int sorted = 1;
+        for (size_t i = 0; i < darray_size(array); i++) {
+            sorted_sum += *(int*) darray_get(array, i);
+            if (i && *(int*) darray_get(array, i - 1) >
+                     *(int*) darray_get(array, i))
+                sorted = 0;
+        }
+        CU_ASSERT(sorted);
+        CU_ASSERT(sum == sorted_sum);
+        darray_destroy(array);
+    }
+    threadpool_destroy(pool);
+}
+
+void stable_sort_darray()
+{
+    ThreadPool_t pool = threadpool_create(3);
+    DArray_t array = random_records(SORT_N, 100);
+
+    CU_ASSERT(darray_parallel_sort(array, pool, cmp_record, 1) == 0);
+    CU_ASSERT(darray_size(array) == SORT_N);
+    CU_ASSERT(records_sorted(array, 1));
+    darray_destroy(array);
+
+    array = random_records(1000, 10);
+    CU_ASSERT(darray_parallel_sort(array, NULL, cmp_record, 1) == 0);
+    CU_ASSERT(records_sorted(array, 1));
+    darray_destroy(array);
+
+    threadpool_destroy(pool);
+}
+
+void kway_merge_darray()
+{
+    size_t sizes[] = {1000, 0, 1, 777, 2048};
+    const size_t k = sizeof(sizes) / sizeof(sizes[0]);
+    DArray_t runs[sizeof(sizes) / sizeof(sizes[0])];
+    DArray_t dest = darray_create(sizeof(struct Record), NULL, NULL);
+    size_t total = 0;
+    int from_runs = 1;
+
+    // the sequence numbers tell the run, to check the order of ties.
+    for (size_t i = 0; i < k; i++) {
+        runs[i] = darray_create(sizeof(struct Record), NULL, NULL);
+        for (size_t j = 0; j < sizes[i]; j++) {
+            struct Record r = {next_random() % 50, (int) i};
+            darray_append(runs[i], &r);
+        }
+        darray_parallel_sort(runs[i], NULL, cmp_record, 0);
+        total += sizes[i];
+    }
+
+    CU_ASSERT(darray_kway_merge(dest, runs, k, cmp_record) == 0);
+    CU_ASSERT(darray_size(dest) == total);
+    CU_ASSERT(records_sorted(dest, 1));
+    for (size_t i = 0; i < darray_size(dest); i++) {
+        struct Record* r = darray_get(dest, i);
+        if (r->seq < 0 || r->seq >= (int) k)
+            from_runs = 0;
+    }
+    CU_ASSERT(from_runs);
+
+    // a single run is copied, no runs give an empty result.
+    CU_ASSERT(darray_kway_merge(dest, runs + 3, 1, cmp_record) == 0);
+    CU_ASSERT(darray_size(dest) == sizes[3]);
+    CU_ASSERT(records_sorted(dest, 0));
+    CU_ASSERT(darray_kway_merge(dest, runs, 0, cmp_record) == 0);
+    CU_ASSERT(darray_size(dest) == 0);
+
+    for (size_t i = 0; i < k; i++)
+        darray_destroy(runs[i]);
+    darray_destroy(dest);
+}
+
+/* * Tests  registration * */
+
+int add_darray_sort_suite()
+{
+    CU_pSuite suite = CU_add_suite("darray-sort-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create darray sort suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "sort", sort_darray);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray sort test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "stable_sort", stable_sort_darray);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray sort test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "kway_merge", kway_merge_darray);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create darray sort test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,251 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/deque.h"
+
+/* * utilities * */
+
+static int g_deque_frees = 0;
+
+static void
+deque_count_free(void* element)
+{
+    g_deque_frees++;
+}
+
+/* the elements are char* that own a copy of a string. */
+static void*
+deque_copy_str(void* dest, const void* src, size_t n)
+{
+    (void) n;
+    const char* str = *(char* const*) src;
+    char* copy = malloc(strlen(str) + 1);
+    strcpy(copy, str);
+    *(char**) dest = copy;
+    return dest;
+}
+
+static void
+deque_free_str(void* element)
+{
+    free(*(char**) element);
+}
+
+/* * Tests * */
+
+void create_deque()
+{
+    Deque_t dq = deque_create(sizeof(int), NULL, NULL);
+    CU_ASSERT(dq != NULL);
+    CU_ASSERT(deque_size(dq) == 0);
+    CU_ASSERT(deque_front(dq) == NULL);
+    CU_ASSERT(deque_pop_front(dq, NULL) == DEQUE_EMPTY);
+    deque_destroy(dq);
+
+    dq = deque_create_capacity(sizeof(int), NULL, NULL, 100);
+    CU_ASSERT(deque_capacity(dq) == 128);
+
+    // capacities that don't fit in memory fail instead of overflowing.
+    CU_ASSERT(deque_reserve_capacity(dq, SIZE_MAX) == DEQUE_OUT_OF_MEM);
+    CU_ASSERT(deque_reserve_capacity(dq, SIZE_MAX / 2) == DEQUE_OUT_OF_MEM);
+    CU_ASSERT(deque_capacity(dq) == 128);
+    deque_destroy(dq);
+    CU_ASSERT(deque_create_capacity(sizeof(int), NULL, NULL, SIZE_MAX) ==
+              NULL
+              );
+}
+
+void push_pop_deque()
+{
+    Deque_t dq = deque_create(sizeof(int), NULL, NULL);
+    int v;
+
+    // 0 1 2 ... 9 at the back, -1 .. -10 at the front.
+    for (int i = 0; i < 10; i++) {
+        CU_ASSERT(deque_push_back(dq, &i) == DEQUE_OK);
+        v = -i - 1;
+        CU_ASSERT(deque_push_front(dq, &v) == DEQUE_OK);
+    }
+    CU_ASSERT(deque_size(dq) == 20);
+    CU_ASSERT(*(int*) deque_front(dq) == -10);
+    CU_ASSERT(*(int*) deque_back(dq) == 9);
+
+    int ordered = 1;
+    for (int i = 0; i < 20; i++)
+        if (*(int*) deque_get(dq, i) != i - 10)
+            ordered = 0;
+    CU_ASSERT(ordered);
+
+    CU_ASSERT(deque_pop_back(dq, &v) == DEQUE_OK);
+    CU_ASSERT(v == 9);
+    CU_ASSERT(deque_pop_front(dq, &v) == DEQUE_OK);
+    CU_ASSERT(v == -10);
+    CU_ASSERT(deque_size(dq) == 18);
+    deque_destroy(dq);
+}
+
+void grow_wrapped_deque()
+{
+    Deque_t dq = deque_create_capacity(sizeof(int), NULL, NULL, 8);
+    int v, ordered = 1;
+
+    // move the head to the middle of the buffer and wrap around.
+    for (int i = 0; i < 6; i++)
+        deque_push_back(dq, &i);
+    for (int i = 0; i < 6; i++)
+        deque_pop_front(dq, NULL);
+    for (int i = 0; i < 100; i++)
+        deque_push_back(dq, &i);
+
+    CU_ASSERT(deque_size(dq) == 100);
+    for (int i = 0; i < 100; i++) {
+        deque_pop_front(dq, &v);
+        if (v != i)
+            ordered = 0;
+    }
+    CU_ASSERT(ordered);
+    deque_destroy(dq);
+}
+
+void spans_deque()
+{
+    Deque_t dq = deque_create_capacity(sizeof(int), NULL, NULL, 8);
+    DequeSpan spans[2];
+    int in[8] = {0, 1, 2, 3, 4, 5, 6, 7}, out[8];
+
+    CU_ASSERT(deque_push_back_n(dq, in, 5) == DEQUE_OK);
+    CU_ASSERT(deque_pop_front_n(dq, out, 5) == 5);
+    CU_ASSERT(memcmp(in, out, 5 * sizeof(int)) == 0);
+
+    // head is at 5, 6 elements wrap.
+    CU_ASSERT(deque_write_spans(dq, 6, spans) == 2);
+    CU_ASSERT(spans[0].n == 3 && spans[1].n == 3);
+    memcpy(spans[0].data, in, 3 * sizeof(int));
+    memcpy(spans[1].data, in + 3, 3 * sizeof(int));
+    deque_commit(dq, 6);
+    CU_ASSERT(deque_size(dq) == 6);
+
+    CU_ASSERT(deque_read_spans(dq, spans) == 2);
+    CU_ASSERT(spans[0].n + spans[1].n == 6);
+    CU_ASSERT(memcmp(spans[0].data, in, 3 * sizeof(int)) == 0);
+    CU_ASSERT(memcmp(spans[1].data, in + 3, 3 * sizeof(int)) == 0);
+
+    deque_consume(dq, 4);
+    CU_ASSERT(deque_read_spans(dq, spans) == 1);
+    CU_ASSERT(spans[0].n == 2 && *(int*) spans[0].data == 4);
+    deque_destroy(dq);
+}
+
+void free_deque()
+{
+    Deque_t dq = deque_create(sizeof(int), deque_count_free, NULL);
+    for (int i = 0; i < 10; i++)
+        deque_push_back(dq, &i);
+
+    g_deque_frees = 0;
+    deque_pop_back(dq, NULL);
+    deque_consume(dq, 2);
+    CU_ASSERT(g_deque_frees == 3);
+    deque_destroy(dq);
+    CU_ASSERT(g_deque_frees == 10);
+
+    // popped elements move to the caller, the deep copy isn't repeated.
+    const char* words[] = {"one", "two", "three", "four"};
+    char* out[2];
+    dq = deque_create(sizeof(char*), deque_free_str, deque_copy_str);
+    for (int i = 0; i < 4; i++)
+        deque_push_back(dq, &words[i]);
+    CU_ASSERT(deque_pop_front(dq, &out[0]) == DEQUE_OK);
+    CU_ASSERT(strcmp(out[0], "one") == 0 && out[0] != words[0]);
+    free(out[0]);
+    CU_ASSERT(deque_pop_back(dq, &out[0]) == DEQUE_OK);
+    CU_ASSERT(strcmp(out[0], "four") == 0);
+    free(out[0]);
+    CU_ASSERT(deque_pop_front_n(dq, out, 2) == 2);
+    CU_ASSERT(strcmp(out[0], "two") == 0 && strcmp(out[1], "three") == 0);
+    free(out[0]);
+    free(out[1]);
+    deque_destroy(dq);
+}
+
+/* * Tests  registration * */
+
+int add_deque_suite()
+{
+    CU_pSuite suite = CU_add_suite("deque-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create deque suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "create", create_deque);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create deque test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "push_pop", push_pop_deque);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create deque test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "grow_wrapped", grow_wrapped_deque);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create deque test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "spans", spans_deque);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create deque test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "free", free_deque);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create deque test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,198 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <string.h>
+#include "../src/dstring.h"
+#include "../src/memtrace.h"
+
+/* * Tests * */
+
+void small_dstring()
+{
+    ClibMemStats before, after;
+    DString s;
+
+    clib_mem_stats(CLIB_MEM_DSTRING, &before);
+    dstring_init(&s);
+    CU_ASSERT(dstring_size(&s) == 0);
+    CU_ASSERT(strcmp(dstring_cstr(&s), "") == 0);
+    CU_ASSERT(dstring_capacity(&s) == DSTRING_SMALL);
+
+    // fill the small buffer exactly, the terminator is still inline.
+    char full[DSTRING_SMALL + 1];
+    memset(full, 'x', DSTRING_SMALL);
+    full[DSTRING_SMALL] = '\0';
+    CU_ASSERT(dstring_append(&s, full, DSTRING_SMALL - 1) == 0);
+    CU_ASSERT(dstring_append_char(&s, 'x') == 0);
+    CU_ASSERT(dstring_size(&s) == DSTRING_SMALL);
+    CU_ASSERT(strcmp(dstring_cstr(&s), full) == 0);
+    CU_ASSERT((char*) dstring_cstr(&s) == (char*) &s);
+
+    clib_mem_stats(CLIB_MEM_DSTRING, &after);
+    CU_ASSERT(after.nallocs == before.nallocs);
+
+    dstring_truncate(&s, 3);
+    CU_ASSERT(strcmp(dstring_cstr(&s), "xxx") == 0);
+    dstring_clear(&s);
+    CU_ASSERT(dstring_size(&s) == 0);
+    dstring_destroy(&s);
+}
+
+void grow_dstring()
+{
+    DString s;
+    dstring_init(&s);
+
+    CU_ASSERT(dstring_append_cstr(&s, "hello, ") == 0);
+    CU_ASSERT(dstring_append_cstr(&s, "world, this doesn't fit") == 0);
+    CU_ASSERT(dstring_size(&s) == 30);
+    CU_ASSERT(strcmp(dstring_cstr(&s), "hello, world, this doesn't fit") == 0);
+
+    // appending a part of itself survives the reallocation.
+    for (int i = 0; i < 8; i++)
+        CU_ASSERT(dstring_append(&s, dstring_cstr(&s), dstring_size(&s)) == 0);
+    CU_ASSERT(dstring_size(&s) == 30 * 256);
+    CU_ASSERT(memcmp(dstring_cstr(&s) + 30 * 255, "hello", 5) == 0);
+    CU_ASSERT(dstring_cstr(&s)[30 * 256] == '\0');
+
+    CU_ASSERT(dstring_reserve(&s, 100000) == 0);
+    CU_ASSERT(dstring_capacity(&s) >= 100000);
+    const char* data = dstring_cstr(&s);
+    for (int i = 0; i < 1000; i++)
+        dstring_append_char(&s, 'a');
+    CU_ASSERT(dstring_cstr(&s) == data);
+
+    dstring_clear(&s);
+    CU_ASSERT(dstring_capacity(&s) >= 100000);
+    CU_ASSERT(strcmp(dstring_cstr(&s), "") == 0);
+    dstring_destroy(&s);
+    CU_ASSERT(dstring_size(&s) == 0);
+}
+
+void format_dstring()
+{
+    DString s;
+    dstring_init(&s);
+
+    CU_ASSERT(dstring_appendf(&s, "%d-%s", 42, "ab") == 0);
+    CU_ASSERT(strcmp(dstring_cstr(&s), "42-ab") == 0);
+
+    // doesn't fit in the room that is left.
+    CU_ASSERT(dstring_appendf(&s, " %0100d", 7) == 0);
+    CU_ASSERT(dstring_size(&s) == 106);
+    CU_ASSERT(dstring_cstr(&s)[105] == '7');
+    CU_ASSERT(memcmp(dstring_cstr(&s), "42-ab 000", 9) == 0);
+
+    for (int i = 0; i < 100; i++)
+        dstring_appendf(&s, "%c", 'a' + i % 26);
+    CU_ASSERT(dstring_size(&s) == 206);
+    CU_ASSERT(dstring_cstr(&s)[205] == 'a' + 99 % 26);
+
+    dstring_destroy(&s);
+}
+
+void view_dstring()
+{
+    DString s;
+    dstring_init(&s);
+    dstring_append_cstr(&s, "key=value; other=thing");
+
+    DStringView all = dstring_view(&s);
+    CU_ASSERT(all.data == dstring_cstr(&s));
+    CU_ASSERT(all.size == 22);
+
+    size_t eq = dstring_view_find(all, dstring_view_cstr("="), 0);
+    CU_ASSERT(eq == 3);
+    CU_ASSERT(dstring_view_find(all, dstring_view_cstr("="), eq + 1) == 16);
+    CU_ASSERT(dstring_view_find(all, dstring_view_cstr("thing"), 0) == 17);
+    CU_ASSERT(dstring_view_find(all, dstring_view_cstr("things"), 0) ==
+              DSTRING_NPOS
+              );
+    CU_ASSERT(dstring_view_find(all, dstring_view_cstr(""), 5) == 5);
+
+    DStringView key = dstring_view_sub(all, 0, eq);
+    DStringView value = dstring_view_sub(all, eq + 1, 5);
+    CU_ASSERT(dstring_view_equal(key, dstring_view_cstr("key")));
+    CU_ASSERT(dstring_view_equal(value, dstring_view_cstr("value")));
+    CU_ASSERT(!dstring_view_equal(key, value));
+    CU_ASSERT(dstring_view_sub(all, 20, 100).size == 2);
+    CU_ASSERT(dstring_view_sub(all, 100, 1).size == 0);
+
+    DString copy;
+    dstring_init(&copy);
+    CU_ASSERT(dstring_append_view(&copy, value) == 0);
+    CU_ASSERT(strcmp(dstring_cstr(&copy), "value") == 0);
+
+    dstring_destroy(&copy);
+    dstring_destroy(&s);
+}
+
+/* * Tests  registration * */
+
+int add_dstring_suite()
+{
+    CU_pSuite suite = CU_add_suite("dstring-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create dstring suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "small", small_dstring);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create dstring test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "grow", grow_dstring);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create dstring test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "format", format_dstring);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create dstring test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "view", view_dstring);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create dstring test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,270 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../src/ebr.h"
+
+#define NODE_MAGIC 0x5eed
+
+typedef struct Node {
+    int     magic;
+    int     value;
+} Node;
+
+static atomic_int g_nfreed;
+
+static void free_node(void* p)
+{
+    Node* node = p;
+    node->magic = 0;
+    atomic_fetch_add(&g_nfreed, 1);
+    free(node);
+}
+
+static Node* new_node(int value)
+{
+    Node* node = malloc(sizeof(Node));
+    node->magic = NODE_MAGIC;
+    node->value = value;
+    return node;
+}
+
+/* * Tests * */
+
+void retire_ebr()
+{
+    Ebr_t ebr = ebr_create();
+    EbrThread_t t = ebr_register(ebr);
+
+    atomic_store(&g_nfreed, 0);
+    ebr_enter(t);
+    for (int i = 0; i < 10; i++)
+        CU_ASSERT(ebr_retire(t, new_node(i), free_node) == 0);
+
+    // the thread itself may still read the nodes.
+    for (int i = 0; i < 5; i++)
+        ebr_collect(t);
+    CU_ASSERT(atomic_load(&g_nfreed) == 0);
+    ebr_exit(t);
+
+    for (int i = 0; i < 3; i++)
+        ebr_collect(t);
+    CU_ASSERT(atomic_load(&g_nfreed) == 10);
+
+    ebr_unregister(t);
+    ebr_destroy(ebr);
+}
+
+void stalled_ebr()
+{
+    Ebr_t ebr = ebr_create();
+    EbrThread_t writer = ebr_register(ebr);
+    EbrThread_t reader = ebr_register(ebr);
+
+    atomic_store(&g_nfreed, 0);
+
+    // a reader in a critical section holds back the reclamation.
+    ebr_enter(reader);
+    ebr_enter(reader);
+    for (int i = 0; i < 1000; i++)
+        ebr_retire(writer, new_node(i), free_node);
+    CU_ASSERT(atomic_load(&g_nfreed) == 0);
+    ebr_exit(reader);
+    ebr_collect(writer);
+    CU_ASSERT(atomic_load(&g_nfreed) == 0);
+
+    ebr_exit(reader);
+    for (int i = 0; i < 3; i++)
+        ebr_collect(writer);
+    CU_ASSERT(atomic_load(&g_nfreed) == 1000);
+
+    // nodes of an unregistered thread are freed by the domain.
+    ebr_enter(reader);
+    ebr_retire(writer, new_node(0), free_node);
+    ebr_unregister(writer);
+    ebr_exit(reader);
+    ebr_unregister(reader);
+    ebr_destroy(ebr);
+    CU_ASSERT(atomic_load(&g_nfreed) == 1001);
+}
+
+struct Shared {
+    Ebr_t               ebr;
+    _Atomic(Node*)      node;
+    atomic_int          stop;
+    atomic_int          errors;
+};
+
+static void* ebr_reader(void* arg)
+{
+    struct Shared* shared = arg;
+    EbrThread_t t = ebr_register(shared->ebr);
+
+    while (!atomic_load(&shared->stop)) {
+        ebr_enter(t);
+        Node* node = atomic_load(&shared->node);
+        if (node->magic != NODE_MAGIC)
+            atomic_fetch_add(&shared->errors, 1);
+        ebr_exit(t);
+    }
+    ebr_unregister(t);
+    return NULL;
+}
+
+static void* ebr_writer(void* arg)
+{
+    struct Shared* shared = arg;
+    EbrThread_t t = ebr_register(shared->ebr);
+
+    for (int i = 0; i < 20000; i++) {
+        Node* old = atomic_exchange(&shared->node, new_node(i));
+        ebr_retire(t, old, free_node);
+    }
+    ebr_unregister(t);
+    return NULL;
+}
+
+void threads_ebr()
+{
+    struct Shared shared;
+    pthread_t readers[3], writers[2];
+
+    shared.ebr = ebr_create();
+    atomic_init(&shared.node, new_node(-1));
+    atomic_init(&shared.stop, 0);
+    atomic_init(&shared.errors, 0);
+    atomic_store(&g_nfreed, 0);
+
+    for (int i = 0; i < 3; i++)
+        pthread_create(&readers[i], NULL, ebr_reader, &shared);
+    for (int i = 0; i < 2; i++)
+        pthread_create(&writers[i], NULL, ebr_writer, &shared);
+    for (int i = 0; i < 2; i++)
+        pthread_join(writers[i], NULL);
+    atomic_store(&shared.stop, 1);
+    for (int i = 0; i < 3; i++)
+        pthread_join(readers[i], NULL);
+
+    CU_ASSERT(atomic_load(&shared.errors) == 0);
+    ebr_destroy(shared.ebr);
+    CU_ASSERT(atomic_load(&g_nfreed) == 40000);
+    free_node(atomic_load(&shared.node));
+}
+
+struct SyncShared {
+    EbrThread_t     reader;
+    atomic_int      entered;
+    atomic_int      left;
+};
+
+static void* sync_reader(void* arg)
+{
+    struct SyncShared* shared = arg;
+
+    ebr_enter(shared->reader);
+    atomic_store(&shared->entered, 1);
+    for (int i = 0; i < 1000; i++)
+        sched_yield();
+    atomic_store(&shared->left, 1);
+    ebr_exit(shared->reader);
+    return NULL;
+}
+
+void synchronize_ebr()
+{
+    Ebr_t ebr = ebr_create();
+    EbrThread_t t = ebr_register(ebr);
+    struct SyncShared shared;
+    pthread_t reader;
+
+    shared.reader = ebr_register(ebr);
+    atomic_init(&shared.entered, 0);
+    atomic_init(&shared.left, 0);
+
+    // without readers in a critical section it doesn't wait.
+    ebr_synchronize(t);
+
+    pthread_create(&reader, NULL, sync_reader, &shared);
+    while (!atomic_load(&shared.entered))
+        ;
+    ebr_synchronize(t);
+    CU_ASSERT(atomic_load(&shared.left) == 1);
+    pthread_join(reader, NULL);
+
+    ebr_unregister(shared.reader);
+    ebr_unregister(t);
+    ebr_destroy(ebr);
+}
+
+/* * Tests  registration * */
+
+int add_ebr_suite()
+{
+    CU_pSuite suite = CU_add_suite("ebr-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create ebr suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "retire", retire_ebr);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create ebr test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "stalled", stalled_ebr);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create ebr test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "synchronize", synchronize_ebr);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create ebr test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "threads", threads_ebr);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create ebr test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
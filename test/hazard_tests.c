@@ -0,0 +1,217 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "../src/hazard.h"
+
+#define NODE_MAGIC 0x5eed
+
+typedef struct Node {
+    int     magic;
+    int     value;
+} Node;
+
+static atomic_int g_nfreed;
+
+static void free_node(void* p)
+{
+    Node* node = p;
+    node->magic = 0;
+    atomic_fetch_add(&g_nfreed, 1);
+    free(node);
+}
+
+static Node* new_node(int value)
+{
+    Node* node = malloc(sizeof(Node));
+    node->magic = NODE_MAGIC;
+    node->value = value;
+    return node;
+}
+
+/* * Tests * */
+
+void protect_hazard()
+{
+    Hazard_t hazard = hazard_create(2);
+    HazardThread_t reader = hazard_register(hazard);
+    HazardThread_t writer = hazard_register(hazard);
+    Node* a = new_node(1), *b = new_node(2);
+
+    atomic_store(&g_nfreed, 0);
+    hazard_set(reader, 0, a);
+    hazard_set(reader, 1, b);
+    CU_ASSERT(hazard_retire(writer, a, free_node) == 0);
+    CU_ASSERT(hazard_retire(writer, b, free_node) == 0);
+    hazard_collect(writer);
+    CU_ASSERT(atomic_load(&g_nfreed) == 0);
+
+    hazard_clear(reader, 1);
+    hazard_collect(writer);
+    CU_ASSERT(atomic_load(&g_nfreed) == 1);
+    CU_ASSERT(a->magic == NODE_MAGIC);
+
+    // unregistering clears the slots.
+    hazard_unregister(reader);
+    hazard_collect(writer);
+    CU_ASSERT(atomic_load(&g_nfreed) == 2);
+
+    hazard_unregister(writer);
+    hazard_destroy(hazard);
+}
+
+void bounded_hazard()
+{
+    Hazard_t hazard = hazard_create(1);
+    HazardThread_t t = hazard_register(hazard);
+    Node* kept = new_node(0);
+    int bounded = 1;
+
+    atomic_store(&g_nfreed, 0);
+    hazard_set(t, 0, kept);
+    hazard_retire(t, kept, free_node);
+
+    // the nodes are collected without hazard_collect.
+    for (int i = 1; i <= 1000; i++) {
+        hazard_retire(t, new_node(i), free_node);
+        if (i - atomic_load(&g_nfreed) > 64)
+            bounded = 0;
+    }
+    CU_ASSERT(bounded);
+    CU_ASSERT(atomic_load(&g_nfreed) > 900);
+    CU_ASSERT(kept->magic == NODE_MAGIC);
+
+    // the protected node is freed with the domain.
+    hazard_unregister(t);
+    hazard_destroy(hazard);
+    CU_ASSERT(atomic_load(&g_nfreed) == 1001);
+}
+
+struct Shared {
+    Hazard_t            hazard;
+    _Atomic(Node*)      node;
+    atomic_int          stop;
+    atomic_int          errors;
+};
+
+static void* hazard_reader(void* arg)
+{
+    struct Shared* shared = arg;
+    HazardThread_t t = hazard_register(shared->hazard);
+
+    while (!atomic_load(&shared->stop)) {
+        Node* node;
+        do {
+            node = atomic_load(&shared->node);
+            hazard_set(t, 0, node);
+        } while (node != atomic_load(&shared->node));
+        if (node->magic != NODE_MAGIC)
+            atomic_fetch_add(&shared->errors, 1);
+        hazard_clear(t, 0);
+    }
+    hazard_unregister(t);
+    return NULL;
+}
+
+static void* hazard_writer(void* arg)
+{
+    struct Shared* shared = arg;
+    HazardThread_t t = hazard_register(shared->hazard);
+
+    for (int i = 0; i < 20000; i++) {
+        Node* old = atomic_exchange(&shared->node, new_node(i));
+        hazard_retire(t, old, free_node);
+    }
+    hazard_unregister(t);
+    return NULL;
+}
+
+void threads_hazard()
+{
+    struct Shared shared;
+    pthread_t readers[3], writers[2];
+
+    shared.hazard = hazard_create(1);
+    atomic_init(&shared.node, new_node(-1));
+    atomic_init(&shared.stop, 0);
+    atomic_init(&shared.errors, 0);
+    atomic_store(&g_nfreed, 0);
+
+    for (int i = 0; i < 3; i++)
+        pthread_create(&readers[i], NULL, hazard_reader, &shared);
+    for (int i = 0; i < 2; i++)
+        pthread_create(&writers[i], NULL, hazard_writer, &shared);
+    for (int i = 0; i < 2; i++)
+        pthread_join(writers[i], NULL);
+    atomic_store(&shared.stop, 1);
+    for (int i = 0; i < 3; i++)
+        pthread_join(readers[i], NULL);
+
+    CU_ASSERT(atomic_load(&shared.errors) == 0);
+    hazard_destroy(shared.hazard);
+    CU_ASSERT(atomic_load(&g_nfreed) == 40000);
+    free_node(atomic_load(&shared.node));
+}
+
+/* * Tests  registration * */
+
+int add_hazard_suite()
+{
+    CU_pSuite suite = CU_add_suite("hazard-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create hazard suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "protect", protect_hazard);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create hazard test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "bounded", bounded_hazard);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create hazard test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "threads", threads_hazard);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create hazard test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,183 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <string.h>
+#include "../src/ilist.h"
+
+typedef struct Item {
+    int         value;
+    IListLink   link;
+} Item;
+
+static int values_equal(const IList* list, const int* expected, size_t n)
+{
+    size_t i = 0;
+    for (IListLink* l = ilist_begin(list); l; l = ilist_next(list, l), i++)
+        if (i >= n || ilist_entry(l, Item, link)->value != expected[i])
+            return 0;
+    if (i != n)
+        return 0;
+
+    // and backwards
+    for (IListLink* l = ilist_last(list); l; l = ilist_prev(list, l))
+        if (ilist_entry(l, Item, link)->value != expected[--i])
+            return 0;
+    return i == 0 && ilist_size(list) == n;
+}
+
+static int item_cmp(const IListLink* link, const void* value)
+{
+    return ilist_entry(link, Item, link)->value - *(const int*) value;
+}
+
+static void count_visit(IListLink* link, void* arg)
+{
+    (void) link;
+    (*(int*) arg)++;
+}
+
+/* * Tests * */
+
+void link_ilist()
+{
+    Item items[6];
+    IList list;
+
+    memset(items, 0, sizeof(items));
+    for (int i = 0; i < 6; i++)
+        items[i].value = i;
+
+    ilist_init(&list);
+    CU_ASSERT(ilist_size(&list) == 0);
+    CU_ASSERT(ilist_begin(&list) == NULL);
+    CU_ASSERT(ilist_last(&list) == NULL);
+    CU_ASSERT(!ilist_is_linked(&items[0].link));
+
+    ilist_append(&list, &items[2].link);
+    ilist_prepend(&list, &items[0].link);
+    ilist_insert(&list, &items[2].link, &items[1].link);
+    ilist_insert(&list, NULL, &items[4].link);
+    ilist_insert_after(&list, &items[2].link, &items[3].link);
+    ilist_insert_after(&list, &items[4].link, &items[5].link);
+    CU_ASSERT(ilist_is_linked(&items[0].link));
+    CU_ASSERT(values_equal(&list, (int[]){0, 1, 2, 3, 4, 5}, 6));
+
+    ilist_remove(&list, &items[0].link);
+    ilist_remove(&list, &items[3].link);
+    ilist_remove(&list, &items[5].link);
+    CU_ASSERT(!ilist_is_linked(&items[3].link));
+    CU_ASSERT(values_equal(&list, (int[]){1, 2, 4}, 3));
+
+    // an unlinked item may be linked again.
+    ilist_prepend(&list, &items[3].link);
+    CU_ASSERT(values_equal(&list, (int[]){3, 1, 2, 4}, 4));
+
+    int count = 0;
+    ilist_clear(&list, count_visit, &count);
+    CU_ASSERT(count == 4);
+    CU_ASSERT(ilist_size(&list) == 0);
+    CU_ASSERT(ilist_begin(&list) == NULL);
+    CU_ASSERT(!ilist_is_linked(&items[1].link));
+}
+
+void find_ilist()
+{
+    Item items[10] = {{0}};
+    IList list;
+    int value = 7, missing = 10;
+
+    ilist_init(&list);
+    for (int i = 0; i < 10; i++) {
+        items[i].value = i;
+        ilist_append(&list, &items[i].link);
+    }
+
+    IListLink* found = ilist_find(&list, &value, item_cmp);
+    CU_ASSERT(found == &items[7].link);
+    CU_ASSERT(ilist_entry(found, Item, link) == &items[7]);
+    CU_ASSERT(ilist_find(&list, &missing, item_cmp) == NULL);
+}
+
+void reverse_ilist()
+{
+    Item items[5] = {{0}};
+    IList list;
+
+    ilist_init(&list);
+    ilist_reverse(&list);
+    CU_ASSERT(ilist_size(&list) == 0);
+    CU_ASSERT(ilist_begin(&list) == NULL);
+
+    for (int i = 0; i < 5; i++) {
+        items[i].value = i;
+        ilist_append(&list, &items[i].link);
+    }
+    ilist_reverse(&list);
+    CU_ASSERT(values_equal(&list, (int[]){4, 3, 2, 1, 0}, 5));
+
+    // the list remains usable after reversal.
+    ilist_remove(&list, &items[4].link);
+    ilist_append(&list, &items[4].link);
+    CU_ASSERT(values_equal(&list, (int[]){3, 2, 1, 0, 4}, 5));
+}
+
+/* * Tests  registration * */
+
+int add_ilist_suite()
+{
+    CU_pSuite suite = CU_add_suite("ilist-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create ilist suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "link", link_ilist);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create ilist test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "find", find_ilist);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create ilist test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "reverse", reverse_ilist);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create ilist test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -20,6 +20,7 @@
 #include <CUnit/CUnit.h>
 #include <stdio.h>
 #include "../src/list.h"
+#include "../src/memtrace.h"
 
 /********************* utility functions ****************/
 
@@ -145,6 +146,422 @@ void remove_list()
     list_destroy(list);
 }
 
+/******************** tests for unrolled list *******************/
+
+static size_t g_freed;
+
+static void count_free(void* element)
+{
+    (void) element;
+    g_freed++;
+}
+
+static ListNode* node_at(List_t list, size_t i)
+{
+    ListNode* n = list_begin(list);
+    while (i--)
+        n = n->next;
+    return n;
+}
+
+void unrolled_list()
+{
+    const int n = 1000;
+    List_t list = list_create_unrolled(sizeof(int), count_free, NULL);
+    ListNode* node;
+    int i, correct = 1;
+
+    g_freed = 0;
+    CU_ASSERT(list != NULL);
+    CU_ASSERT(list_size(list) == 0);
+    CU_ASSERT(list_begin(list) == NULL);
+
+    for (i = n - 1; i >= 0; i--)
+        list_prepend(list, &i);
+    CU_ASSERT(list_size(list) == (size_t) n);
+
+    // the nodes span many chunks.
+    for (i = 0, node = list_begin(list); node; node = node->next, i++)
+        if (*(int*) node->data != i)
+            correct = 0;
+    CU_ASSERT(correct);
+    CU_ASSERT(i == n);
+
+    i = 567;
+    node = list_find(list, &i, int_cmp_func);
+    CU_ASSERT(node != NULL && *(int*) node->data == 567);
+    i = n;
+    CU_ASSERT(list_find(list, &i, int_cmp_func) == NULL);
+
+    list_remove_range(list, node_at(list, 10), node_at(list, 990));
+    CU_ASSERT(list_size(list) == 20);
+    CU_ASSERT(g_freed == 980);
+    CU_ASSERT(*(int*) node_at(list, 9)->data == 9);
+    CU_ASSERT(*(int*) node_at(list, 10)->data == 990);
+
+    list_reverse(list);
+    CU_ASSERT(*(int*) list_begin(list)->data == 999);
+    CU_ASSERT(*(int*) node_at(list, 19)->data == 0);
+    CU_ASSERT(node_at(list, 19)->next == NULL);
+
+    list_destroy(list);
+    CU_ASSERT(g_freed == 1000);
+
+    // free, the default free func of list_create, leaves the chunks alone.
+    list = list_create_unrolled(sizeof(int), free, NULL);
+    for (i = 0; i < 100; i++)
+        list_prepend(list, &i);
+    list_remove(list, list_begin(list));
+    CU_ASSERT(list_size(list) == 99);
+    list_destroy(list);
+}
+
+void unrolled_equals_list()
+{
+    List_t plain = list_create(sizeof(int), NULL, NULL);
+    List_t unrolled = list_create_unrolled(sizeof(int), NULL, NULL);
+    unsigned state = 1;
+    int correct = 1;
+
+    for (int round = 0; round < 3000; round++) {
+        size_t size = list_size(plain);
+        state = state * 1103515245u + 12345u;
+        size_t i = size ? (state >> 8) % size : 0;
+        int op = (state >> 4) % 6;
+
+        if (size == 0 || op < 2) {
+            ListNode* p = size ? node_at(plain, i) : NULL;
+            ListNode* u = size ? node_at(unrolled, i) : NULL;
+            ListNode* r1 = list_insert(plain, p, &round);
+            ListNode* r2 = list_insert(unrolled, u, &round);
+            if (*(int*) r1->data != round || *(int*) r2->data != round)
+                correct = 0;
+        }
+        else if (op == 2) {
+            list_insert_after(plain, node_at(plain, i), &round);
+            list_insert_after(unrolled, node_at(unrolled, i), &round);
+        }
+        else if (op == 3) {
+            list_append(plain, list_begin(plain), &round);
+            list_append(unrolled, list_begin(unrolled), &round);
+        }
+        else if (op == 4) {
+            list_remove(plain, node_at(plain, i));
+            list_remove(unrolled, node_at(unrolled, i));
+        }
+        else {
+            size_t j = i + (state >> 20) % 40;
+            ListNode* pe = j < size ? node_at(plain, j) : NULL;
+            ListNode* ue = j < size ? node_at(unrolled, j) : NULL;
+            list_remove_range(plain, node_at(plain, i), pe);
+            list_remove_range(unrolled, node_at(unrolled, i), ue);
+        }
+        if (round % 100 == 0 && list_compare(plain, unrolled, int_cmp_func))
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(list_compare(plain, unrolled, int_cmp_func) == 0);
+    CU_ASSERT(list_size(unrolled) == list_size(plain));
+
+    list_reverse(plain);
+    list_reverse(unrolled);
+    CU_ASSERT(list_compare(unrolled, plain, int_cmp_func) == 0);
+
+    list_destroy(plain);
+    list_destroy(unrolled);
+}
+
+/******************** tests for list compaction *******************/
+
+static void count_and_free(void* element)
+{
+    g_freed++;
+    free(element);
+}
+
+static int values_in_order(List_t list, const int* expected, size_t n)
+{
+    size_t i = 0;
+    for (ListNode* node = list_begin(list); node; node = node->next, i++)
+        if (i >= n || *(int*) node->data != expected[i])
+            return 0;
+    return i == n;
+}
+
+static size_t fill_scattered(List_t list, int* expected)
+{
+    // inserting before every other node interleaves two runs of nodes.
+    size_t n = 0;
+    for (int i = 0; i < 500; i++)
+        list_append(list, list_begin(list), &i);
+    ListNode* node = list_begin(list);
+    for (int i = 0; node; i++) {
+        int v = 1000 + i;
+        list_insert_after(list, node, &v);
+        node = node->next->next;
+    }
+    for (ListNode* node = list_begin(list); node; node = node->next)
+        expected[n++] = *(int*) node->data;
+    return n;
+}
+
+void compact_list()
+{
+    static int expected[1000];
+    List_t list = list_create(sizeof(int), NULL, NULL);
+    size_t n = fill_scattered(list, expected);
+    int consecutive = 1;
+
+    CU_ASSERT(n == 1000);
+    CU_ASSERT(list_fragmentation(list) == 1.0);
+    CU_ASSERT(list_compact(list) == 0);
+    CU_ASSERT(list_fragmentation(list) == 0.0);
+    CU_ASSERT(values_in_order(list, expected, n));
+
+    // the nodes and elements are laid out in list order.
+    for (ListNode* node = list_begin(list); node->next; node = node->next)
+        if (node->next != node + 1 ||
+            (char*) node->next->data != (char*) node->data + sizeof(int))
+            consecutive = 0;
+    CU_ASSERT(consecutive);
+
+    // removals leave holes, insertions add scattered nodes.
+    list_remove_range(list, list_begin(list), list_begin(list)->next->next);
+    list_prepend(list, &expected[0]);
+    CU_ASSERT(list_fragmentation(list) > 0.0);
+    CU_ASSERT(list_size(list) == 999);
+
+    // compacting again releases the old block.
+    CU_ASSERT(list_compact(list) == 0);
+    expected[1] = expected[0];
+    CU_ASSERT(values_in_order(list, expected + 1, n - 1));
+
+    list_remove_range(list, list_begin(list), NULL);
+    CU_ASSERT(list_size(list) == 0);
+    CU_ASSERT(list_compact(list) == 0);
+    list_destroy(list);
+}
+
+void compact_nodes_list()
+{
+    static int expected[1000];
+    List_t list = list_create(sizeof(int), count_and_free, NULL);
+    size_t n = fill_scattered(list, expected);
+
+    // with a free func only the nodes move, the free func still frees.
+    g_freed = 0;
+    CU_ASSERT(list_compact(list) == 0);
+    CU_ASSERT(g_freed == 0);
+    CU_ASSERT(values_in_order(list, expected, n));
+    list_remove(list, list_begin(list));
+    CU_ASSERT(g_freed == 1);
+    list_destroy(list);
+    CU_ASSERT(g_freed == n);
+}
+
+void auto_compact_list()
+{
+    List_t list = list_create(sizeof(int), NULL, NULL);
+    ListNode* node = NULL;
+    int correct = 1;
+
+    list_set_auto_compact(list, 0.5);
+    for (int i = 0; i < 1000; i++) {
+        node = node ? list_insert_after(list, node, &i) : list_prepend(list, &i);
+        if (*(int*) node->data != i)
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(list_fragmentation(list) <= 0.5);
+
+    int i = 0;
+    for (node = list_begin(list); node; node = node->next, i++)
+        if (*(int*) node->data != i)
+            correct = 0;
+    CU_ASSERT(correct);
+    CU_ASSERT(i == 1000);
+
+    list_destroy(list);
+}
+
+void compact_unrolled_list()
+{
+    List_t list = list_create_unrolled(sizeof(int), NULL, NULL);
+    ListNode* node;
+    int i;
+
+    // removing every other element leaves the chunks half full.
+    for (i = 0; i < 1000; i++)
+        list_append(list, NULL, &i);
+    // a removal may move the nodes around it, so find the node again.
+    for (size_t pos = 1; pos < list_size(list); pos++) {
+        node = list_begin(list);
+        for (size_t j = 0; j < pos; j++)
+            node = node->next;
+        list_remove(list, node);
+    }
+    CU_ASSERT(list_size(list) == 500);
+    CU_ASSERT(list_fragmentation(list) > 0.2);
+
+    CU_ASSERT(list_compact(list) == 0);
+    CU_ASSERT(list_fragmentation(list) < 0.1);
+    for (i = 0, node = list_begin(list); node; node = node->next, i += 2)
+        if (*(int*) node->data != i)
+            break;
+    CU_ASSERT(i == 1000);
+
+    list_destroy(list);
+}
+
+/**************** tests for moving nodes between lists ***************/
+
+void from_array_list()
+{
+    int values[300];
+    int correct = 1, i;
+    for (i = 0; i < 300; i++)
+        values[i] = i * 3;
+
+    List_t list = list_from_array(sizeof(int), NULL, NULL, values, 300);
+    CU_ASSERT(list_size(list) == 300);
+    CU_ASSERT(list_fragmentation(list) == 0.0);
+    CU_ASSERT(values_in_order(list, values, 300));
+
+    // the nodes are in one block, in order.
+    for (ListNode* node = list_begin(list); node->next; node = node->next)
+        if (node->next != node + 1)
+            correct = 0;
+    CU_ASSERT(correct);
+
+    // the list behaves as any other list.
+    list_remove(list, list_begin(list)->next);
+    list_prepend(list, &values[1]);
+    CU_ASSERT(list_size(list) == 300);
+    list_destroy(list);
+
+    g_freed = 0;
+    list = list_from_array(sizeof(int), count_and_free, NULL, values, 300);
+    CU_ASSERT(values_in_order(list, values, 300));
+    list_destroy(list);
+    CU_ASSERT(g_freed == 300);
+
+    // free is the default free func, the elements are stored in the block.
+    list = list_from_array(sizeof(int), free, NULL, values, 300);
+    ListNode* head = list_begin(list);
+    CU_ASSERT((int*) head->next->data == (int*) head->data + 1);
+    list_remove(list, head->next);
+    CU_ASSERT(list_compact(list) == 0);
+    CU_ASSERT(list_size(list) == 299);
+    CU_ASSERT(*(int*) list_begin(list)->next->data == 6);
+    list_destroy(list);
+
+    list = list_from_array(sizeof(int), NULL, NULL, values, 0);
+    CU_ASSERT(list_size(list) == 0);
+    CU_ASSERT(list_begin(list) == NULL);
+    list_destroy(list);
+}
+
+void splice_list()
+{
+    int values[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    List_t src = list_from_array(sizeof(int), NULL, NULL, values, 10);
+    List_t dest = list_create(sizeof(int), NULL, NULL);
+    int a = 100, b = 200;
+    ListNode* after = list_append(dest, NULL, &a);
+    list_append(dest, after, &b);
+
+    // move 3, 4, 5 between 100 and 200.
+    ListNode* prev = list_begin(src)->next->next;
+    ListNode* last = prev->next->next->next;
+    ListNode* first = prev->next;
+    CU_ASSERT(list_splice(dest, after, src, prev, last) == 0);
+    CU_ASSERT(after->next == first);
+    CU_ASSERT(values_in_order(dest, (int[]){100, 3, 4, 5, 200}, 5));
+    CU_ASSERT(values_in_order(src, (int[]){0, 1, 2, 6, 7, 8, 9}, 7));
+    CU_ASSERT(list_size(dest) == 5 && list_size(src) == 7);
+
+    // move the head of dest to the start of src.
+    CU_ASSERT(list_splice(src, NULL, dest, NULL, list_begin(dest)) == 0);
+    CU_ASSERT(values_in_order(src, (int[]){100, 0, 1, 2, 6, 7, 8, 9}, 8));
+    CU_ASSERT(values_in_order(dest, (int[]){3, 4, 5, 200}, 4));
+
+    // the nodes from the block of src outlive src.
+    list_destroy(src);
+    CU_ASSERT(values_in_order(dest, (int[]){3, 4, 5, 200}, 4));
+    list_remove(dest, list_begin(dest));
+    CU_ASSERT(values_in_order(dest, (int[]){4, 5, 200}, 3));
+
+    // lists with other elements can't exchange nodes.
+    List_t other = list_create(sizeof(double), NULL, NULL);
+    double d = 1.0;
+    list_append(other, NULL, &d);
+    CU_ASSERT(list_splice(dest, NULL, other, NULL, list_begin(other)) != 0);
+    CU_ASSERT(list_size(other) == 1 && list_size(dest) == 3);
+
+    list_destroy(other);
+    list_destroy(dest);
+}
+
+void splice_accounting_list()
+{
+    int values[100];
+    for (int i = 0; i < 100; i++)
+        values[i] = i;
+
+    const char* prev_site = clib_mem_set_site("list-splice-a");
+    List_t a = list_from_array(sizeof(int), count_and_free, NULL, values, 100);
+    list_prepend(a, &values[0]);
+    clib_mem_set_site("list-splice-b");
+    List_t b = list_create(sizeof(int), count_and_free, NULL);
+    clib_mem_set_site(prev_site);
+
+    // the separately allocated elements are accounted to their new list.
+    size_t before = clib_mem_site_live_bytes(CLIB_MEM_LIST, "list-splice-b");
+    ListNode* last = list_begin(a);
+    for (int i = 0; i < 50; i++)
+        last = last->next;
+    CU_ASSERT(list_splice(b, NULL, a, NULL, last) == 0);
+    CU_ASSERT(list_size(a) == 50 && list_size(b) == 51);
+#ifndef CLIB_NO_MEMTRACE
+    CU_ASSERT(clib_mem_site_live_bytes(CLIB_MEM_LIST, "list-splice-b") >
+              before + 51 * sizeof(int));
+#else
+    (void) before;
+#endif
+
+    g_freed = 0;
+    list_destroy(a);
+    list_destroy(b);
+    CU_ASSERT(g_freed == 101);
+    CU_ASSERT(clib_mem_site_live_bytes(CLIB_MEM_LIST, "list-splice-a") == 0);
+    CU_ASSERT(clib_mem_site_live_bytes(CLIB_MEM_LIST, "list-splice-b") == 0);
+}
+
+void split_list()
+{
+    int values[20];
+    for (int i = 0; i < 20; i++)
+        values[i] = i;
+
+    List_t list = list_from_array(sizeof(int), NULL, NULL, values, 20);
+    List_t tail = list_split_at(list, 8);
+    CU_ASSERT(values_in_order(list, values, 8));
+    CU_ASSERT(values_in_order(tail, values + 8, 12));
+
+    List_t empty = list_split_at(tail, 12);
+    CU_ASSERT(list_size(empty) == 0);
+    CU_ASSERT(list_split_at(tail, 13) == NULL);
+
+    List_t all = list_split_at(list, 0);
+    CU_ASSERT(list_size(list) == 0);
+    CU_ASSERT(values_in_order(all, values, 8));
+
+    list_destroy(list);
+    list_destroy(tail);
+    list_destroy(empty);
+    list_destroy(all);
+}
+
 int add_list_suite()
 {
     CU_pSuite suite = CU_add_suite("list-test", NULL, NULL);
@@ -205,5 +622,105 @@ int add_list_suite()
         return CU_get_error();
     }
 
+    test = CU_add_test(suite, "unrolled", unrolled_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "unrolled_equals", unrolled_equals_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "compact", compact_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "compact_nodes", compact_nodes_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "auto_compact", auto_compact_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "compact_unrolled", compact_unrolled_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "from_array", from_array_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "splice", splice_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "splice_accounting", splice_accounting_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "split", split_list);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create list test: %s\n",
+                CU_get_error_msg()
+               );
+
+        return CU_get_error();
+    }
+
     return CU_get_error();
 }
@@ -0,0 +1,197 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "../src/memtrace.h"
+#include "../src/darray.h"
+#include "../src/list.h"
+#include "../src/stack.h"
+
+/* * utilities * */
+
+static size_t g_hook_allocs = 0;
+static size_t g_hook_frees  = 0;
+
+static void
+count_alloc(ClibMemType type, const char* site, void* p, size_t n, void* d)
+{
+    if (type == CLIB_MEM_LIST && d == &g_hook_allocs)
+        g_hook_allocs++;
+}
+
+static void
+count_free(ClibMemType type, const char* site, void* p, size_t n, void* d)
+{
+    if (type == CLIB_MEM_LIST && d == &g_hook_allocs)
+        g_hook_frees++;
+}
+
+static void*
+thread_allocs(void* arg)
+{
+    DArray_t* out = arg;
+    int i = 0;
+    clib_mem_set_site("memtrace-thread");
+    // outlives the thread, the main thread destroys it.
+    *out = darray_create_capacity(sizeof(int), NULL, NULL, 1000);
+    darray_append(*out, &i);
+    return NULL;
+}
+
+/* * Tests * */
+
+void memtrace_darray()
+{
+    ClibMemStats before, during, after;
+    clib_mem_stats(CLIB_MEM_DARRAY, &before);
+
+    DArray_t array = darray_create_capacity(sizeof(int), NULL, NULL, 1024);
+    clib_mem_stats(CLIB_MEM_DARRAY, &during);
+    CU_ASSERT(during.live_bytes >= before.live_bytes + 1024 * sizeof(int));
+    CU_ASSERT(during.peak_bytes >= during.live_bytes);
+    CU_ASSERT(during.nallocs == before.nallocs + 2);
+    CU_ASSERT(during.histogram[12] == before.histogram[12] + 1);
+
+    darray_destroy(array);
+    clib_mem_stats(CLIB_MEM_DARRAY, &after);
+    CU_ASSERT(after.live_bytes == before.live_bytes);
+    CU_ASSERT(after.nfrees == before.nfrees + 2);
+    CU_ASSERT(after.peak_bytes >= during.live_bytes);
+}
+
+void memtrace_sites()
+{
+    const char* prev = clib_mem_set_site("memtrace-test");
+    size_t before = clib_mem_site_live_bytes(CLIB_MEM_STACK, "memtrace-test");
+    int i = 10;
+
+    Stack_t stack = stack_create(sizeof(int), NULL, NULL);
+    stack_push(stack, &i);
+    clib_mem_set_site(prev);
+
+    CU_ASSERT(clib_mem_site_live_bytes(CLIB_MEM_STACK, "memtrace-test") >
+              before);
+    CU_ASSERT(clib_mem_site_live_bytes(CLIB_MEM_LIST, "memtrace-test") == 0);
+
+    const char* sites[CLIB_MEM_MAX_SITES];
+    size_t n = clib_mem_sites(sites, CLIB_MEM_MAX_SITES), found = 0;
+    for (size_t s = 0; s < n; s++)
+        if (sites[s] && strcmp(sites[s], "memtrace-test") == 0)
+            found++;
+    CU_ASSERT(found == 1);
+
+    stack_destroy(stack);
+    CU_ASSERT(clib_mem_site_live_bytes(CLIB_MEM_STACK, "memtrace-test") ==
+              before);
+}
+
+void memtrace_hooks()
+{
+    List_t list = list_create(sizeof(int), NULL, NULL);
+    clib_mem_set_hooks(count_alloc, count_free, &g_hook_allocs);
+    for (int i = 0; i < 10; i++)
+        list_prepend(list, &i);
+    list_remove(list, list_begin(list));
+    clib_mem_set_hooks(NULL, NULL, NULL);
+
+    CU_ASSERT(g_hook_allocs == 20);
+    CU_ASSERT(g_hook_frees == 2);
+    list_destroy(list);
+    CU_ASSERT(g_hook_frees == 2);
+}
+
+void memtrace_threads()
+{
+    ClibMemStats before, after;
+    pthread_t threads[4];
+    DArray_t arrays[4];
+
+    clib_mem_stats(CLIB_MEM_DARRAY, &before);
+    for (size_t i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, thread_allocs, &arrays[i]);
+    for (size_t i = 0; i < 4; i++)
+        pthread_join(threads[i], NULL);
+    clib_mem_stats(CLIB_MEM_DARRAY, &after);
+
+    // the threads have exited, their counters must have been kept.
+    CU_ASSERT(after.nallocs == before.nallocs + 8);
+    CU_ASSERT(after.live_bytes >= before.live_bytes + 4 * 1000 * sizeof(int));
+    CU_ASSERT(clib_mem_site_live_bytes(CLIB_MEM_DARRAY, "memtrace-thread") >=
+              4 * 1000 * sizeof(int));
+
+    for (size_t i = 0; i < 4; i++)
+        darray_destroy(arrays[i]);
+    CU_ASSERT(clib_mem_site_live_bytes(CLIB_MEM_DARRAY, "memtrace-thread") ==
+              0);
+}
+
+/* * Tests  registration * */
+
+int add_memtrace_suite()
+{
+    CU_pSuite suite = CU_add_suite("memtrace-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create memtrace suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "darray", memtrace_darray);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create memtrace test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "sites", memtrace_sites);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create memtrace test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "hooks", memtrace_hooks);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create memtrace test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "threads", memtrace_threads);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create memtrace test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,201 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../src/mpmcqueue.h"
+
+/* * utilities * */
+
+#define MPMC_N_THREADS  4
+#define MPMC_N_ITEMS    20000
+
+struct MpmcConsumer {
+    MpmcQueue_t queue;
+    size_t      sum;
+    size_t      count;
+};
+
+static void*
+mpmc_producer(void* arg)
+{
+    MpmcQueue_t q = arg;
+    for (size_t i = 1; i <= MPMC_N_ITEMS; i++)
+        mpmc_queue_push(q, &i);
+    return NULL;
+}
+
+static void*
+mpmc_consumer(void* arg)
+{
+    struct MpmcConsumer* c = arg;
+    size_t v;
+    while (mpmc_queue_pop(c->queue, &v) == MPMC_QUEUE_OK) {
+        c->sum += v;
+        c->count++;
+    }
+    return NULL;
+}
+
+/* the elements are char* that own a copy of a string. */
+static void*
+mpmc_copy_str(void* dest, const void* src, size_t n)
+{
+    (void) n;
+    const char* str = *(char* const*) src;
+    char* copy = malloc(strlen(str) + 1);
+    strcpy(copy, str);
+    *(char**) dest = copy;
+    return dest;
+}
+
+static void
+mpmc_free_str(void* element)
+{
+    free(*(char**) element);
+}
+
+/* * Tests * */
+
+void try_mpmc_queue()
+{
+    MpmcQueue_t q = mpmc_queue_create(sizeof(int), NULL, NULL, 3);
+    int v, ordered = 1;
+
+    CU_ASSERT(mpmc_queue_capacity(q) == 4);
+    CU_ASSERT(mpmc_queue_try_pop(q, &v) == MPMC_QUEUE_EMPTY);
+    for (int i = 0; i < 4; i++)
+        CU_ASSERT(mpmc_queue_try_push(q, &i) == MPMC_QUEUE_OK);
+    CU_ASSERT(mpmc_queue_try_push(q, &v) == MPMC_QUEUE_FULL);
+    CU_ASSERT(mpmc_queue_size(q) == 4);
+
+    for (int i = 4; i < 50; i++) {
+        mpmc_queue_try_pop(q, &v);
+        if (v != i - 4)
+            ordered = 0;
+        mpmc_queue_try_push(q, &i);
+    }
+    CU_ASSERT(ordered);
+    mpmc_queue_destroy(q);
+
+    CU_ASSERT(mpmc_queue_create(sizeof(int), NULL, NULL, SIZE_MAX) == NULL);
+
+    // popped elements move to the caller, it frees them.
+    const char* word = "word";
+    char* out;
+    q = mpmc_queue_create(sizeof(char*), mpmc_free_str, mpmc_copy_str, 4);
+    CU_ASSERT(mpmc_queue_try_push(q, &word) == MPMC_QUEUE_OK);
+    CU_ASSERT(mpmc_queue_try_push(q, &word) == MPMC_QUEUE_OK);
+    CU_ASSERT(mpmc_queue_try_pop(q, &out) == MPMC_QUEUE_OK);
+    CU_ASSERT(strcmp(out, "word") == 0 && out != word);
+    free(out);
+    CU_ASSERT(mpmc_queue_pop(q, &out) == MPMC_QUEUE_OK);
+    free(out);
+    CU_ASSERT(mpmc_queue_try_push(q, &word) == MPMC_QUEUE_OK);
+    mpmc_queue_destroy(q);
+}
+
+void close_mpmc_queue()
+{
+    MpmcQueue_t q = mpmc_queue_create(sizeof(int), NULL, NULL, 4);
+    int v = 1;
+
+    mpmc_queue_push(q, &v);
+    mpmc_queue_close(q);
+    CU_ASSERT(mpmc_queue_try_push(q, &v) == MPMC_QUEUE_CLOSED);
+    CU_ASSERT(mpmc_queue_push(q, &v) == MPMC_QUEUE_CLOSED);
+    CU_ASSERT(mpmc_queue_pop(q, &v) == MPMC_QUEUE_OK);
+    CU_ASSERT(mpmc_queue_pop(q, &v) == MPMC_QUEUE_CLOSED);
+    mpmc_queue_destroy(q);
+}
+
+void threads_mpmc_queue()
+{
+    MpmcQueue_t q = mpmc_queue_create(sizeof(size_t), NULL, NULL, 8);
+    pthread_t producers[MPMC_N_THREADS], consumers[MPMC_N_THREADS];
+    struct MpmcConsumer results[MPMC_N_THREADS];
+    size_t sum = 0, count = 0;
+
+    for (size_t i = 0; i < MPMC_N_THREADS; i++) {
+        results[i].queue = q;
+        results[i].sum = results[i].count = 0;
+        pthread_create(&consumers[i], NULL, mpmc_consumer, &results[i]);
+        pthread_create(&producers[i], NULL, mpmc_producer, q);
+    }
+    for (size_t i = 0; i < MPMC_N_THREADS; i++)
+        pthread_join(producers[i], NULL);
+    mpmc_queue_close(q);
+    for (size_t i = 0; i < MPMC_N_THREADS; i++) {
+        pthread_join(consumers[i], NULL);
+        sum += results[i].sum;
+        count += results[i].count;
+    }
+
+    CU_ASSERT(count == MPMC_N_THREADS * MPMC_N_ITEMS);
+    CU_ASSERT(sum == MPMC_N_THREADS *
+                     ((size_t) MPMC_N_ITEMS * (MPMC_N_ITEMS + 1) / 2));
+    mpmc_queue_destroy(q);
+}
+
+/* * Tests  registration * */
+
+int add_mpmc_queue_suite()
+{
+    CU_pSuite suite = CU_add_suite("mpmc-queue-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create mpmc queue suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "try", try_mpmc_queue);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create mpmc queue test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "close", close_mpmc_queue);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create mpmc queue test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "threads", threads_mpmc_queue);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create mpmc queue test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
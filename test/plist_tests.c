@@ -0,0 +1,155 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include "../src/plist.h"
+#include "../src/memtrace.h"
+
+static int g_nfreed;
+
+static void count_free(void* element)
+{
+    (void) element;
+    g_nfreed++;
+}
+
+/* * Tests * */
+
+void prepend_plist()
+{
+    PList_t empty = plist_create(sizeof(int), NULL);
+    PList_t list = plist_retain(empty);
+    int correct = 1;
+
+    CU_ASSERT(plist_size(empty) == 0);
+    CU_ASSERT(plist_head(empty) == NULL);
+    CU_ASSERT(plist_tail(empty) == empty);
+
+    for (int i = 0; i < 100; i++) {
+        PList_t next = plist_prepend(list, &i);
+        plist_release(list);
+        list = next;
+    }
+    CU_ASSERT(plist_size(list) == 100);
+
+    int expected = 99;
+    for (PList_t l = list; plist_size(l); l = plist_tail(l), expected--)
+        if (*(const int*) plist_head(l) != expected)
+            correct = 0;
+    CU_ASSERT(correct);
+    CU_ASSERT(expected == -1);
+
+    // the empty version is unchanged.
+    CU_ASSERT(plist_size(empty) == 0);
+
+    plist_release(list);
+    plist_release(empty);
+}
+
+void share_plist()
+{
+    ClibMemStats before, after;
+    clib_mem_stats(CLIB_MEM_PLIST, &before);
+
+    PList_t base = plist_create(sizeof(int), count_free);
+    int values[] = {1, 2, 3};
+    PList_t l1 = plist_prepend(base, &values[0]);
+    PList_t l2 = plist_prepend(l1, &values[1]);
+    PList_t l3 = plist_prepend(l1, &values[2]);
+
+    // l2 and l3 share l1 as their tail.
+    CU_ASSERT(plist_tail(l2) == l1);
+    CU_ASSERT(plist_tail(l3) == l1);
+    CU_ASSERT(plist_size(l2) == 2 && plist_size(l3) == 2);
+
+    // a snapshot keeps a version alive after its owner released it.
+    PList_t snapshot = plist_retain(l2);
+    g_nfreed = 0;
+    plist_release(base);
+    plist_release(l1);
+    plist_release(l2);
+    CU_ASSERT(g_nfreed == 0);
+    CU_ASSERT(*(const int*) plist_head(snapshot) == 2);
+    CU_ASSERT(*(const int*) plist_head(plist_tail(snapshot)) == 1);
+
+    plist_release(snapshot);
+    CU_ASSERT(g_nfreed == 1);
+    plist_release(l3);
+    CU_ASSERT(g_nfreed == 3);
+
+    clib_mem_stats(CLIB_MEM_PLIST, &after);
+    CU_ASSERT(after.live_bytes == before.live_bytes);
+}
+
+void long_plist()
+{
+    // releasing a long list doesn't recurse.
+    PList_t list = plist_create(sizeof(int), NULL);
+    for (int i = 0; i < 1000000; i++) {
+        PList_t next = plist_prepend(list, &i);
+        plist_release(list);
+        list = next;
+    }
+    CU_ASSERT(plist_size(list) == 1000000);
+    plist_release(list);
+}
+
+/* * Tests  registration * */
+
+int add_plist_suite()
+{
+    CU_pSuite suite = CU_add_suite("plist-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create plist suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "prepend", prepend_plist);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create plist test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "share", share_plist);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create plist test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "long", long_plist);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create plist test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
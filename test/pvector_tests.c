@@ -0,0 +1,291 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../src/pvector.h"
+#include "../src/memtrace.h"
+
+/*
+ * Builds a vector with the values first, first + 1, ... by pushing.
+ */
+static PVector_t build(int first, int n)
+{
+    PVector_t vec = pvector_create(sizeof(int));
+    for (int i = 0; i < n; i++) {
+        int value = first + i;
+        PVector_t next = pvector_push_back(vec, &value);
+        pvector_release(vec);
+        vec = next;
+    }
+    return vec;
+}
+
+static int equals(const PVector_t vec, const int* expected, size_t n)
+{
+    if (pvector_size(vec) != n)
+        return 0;
+    for (size_t i = 0; i < n; i++)
+        if (*(const int*) pvector_get(vec, i) != expected[i])
+            return 0;
+    return 1;
+}
+
+static int counts_up(const PVector_t vec, size_t n)
+{
+    if (pvector_size(vec) != n)
+        return 0;
+    for (size_t i = 0; i < n; i++)
+        if (*(const int*) pvector_get(vec, i) != (int) i)
+            return 0;
+    return 1;
+}
+
+/* * Tests * */
+
+void push_pvector()
+{
+    ClibMemStats before, after;
+    clib_mem_stats(CLIB_MEM_PVECTOR, &before);
+
+    PVector_t vec = pvector_create(sizeof(int)), v100 = NULL, v1024 = NULL;
+    CU_ASSERT(pvector_size(vec) == 0);
+
+    for (int i = 0; i < 40000; i++) {
+        PVector_t next = pvector_push_back(vec, &i);
+        pvector_release(vec);
+        vec = next;
+        if (i == 99)
+            v100 = pvector_retain(vec);
+        if (i == 1023)
+            v1024 = pvector_retain(vec);
+    }
+    CU_ASSERT(counts_up(vec, 40000));
+    CU_ASSERT(counts_up(v100, 100));
+    CU_ASSERT(counts_up(v1024, 1024));
+
+    pvector_release(vec);
+    pvector_release(v100);
+    pvector_release(v1024);
+
+    clib_mem_stats(CLIB_MEM_PVECTOR, &after);
+    CU_ASSERT(after.live_bytes == before.live_bytes);
+}
+
+void set_pvector()
+{
+    PVector_t vec = build(0, 5000);
+    PVector_t changed = pvector_retain(vec);
+    int correct = 1;
+
+    for (int i = 0; i < 5000; i += 7) {
+        int value = -i;
+        PVector_t next = pvector_set(changed, i, &value);
+        pvector_release(changed);
+        changed = next;
+    }
+    for (int i = 0; i < 5000; i++) {
+        int expected = i % 7 ? i : -i;
+        if (*(const int*) pvector_get(changed, i) != expected)
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+    CU_ASSERT(counts_up(vec, 5000));
+
+    pvector_release(vec);
+    pvector_release(changed);
+}
+
+void concat_pvector()
+{
+    const int sizes[] = {0, 1, 5, 31, 32, 33, 100, 1023, 1024, 1025, 3000, 33000};
+    const size_t nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    int correct = 1;
+
+    for (size_t a = 0; a < nsizes; a++) {
+        for (size_t b = 0; b < nsizes; b++) {
+            PVector_t left = build(0, sizes[a]);
+            PVector_t right = build(sizes[a], sizes[b]);
+            PVector_t both = pvector_concat(left, right);
+            if (!counts_up(both, sizes[a] + sizes[b]) ||
+                !counts_up(left, sizes[a]) ||
+                pvector_size(right) != (size_t) sizes[b])
+                correct = 0;
+            pvector_release(left);
+            pvector_release(right);
+            pvector_release(both);
+        }
+    }
+    CU_ASSERT(correct);
+}
+
+void relaxed_pvector()
+{
+    const int n = 40000;
+    int* expected = malloc(n * sizeof(int));
+    PVector_t vec = pvector_create(sizeof(int));
+    int size = 0;
+
+    // concatenating many small vectors leaves relaxed nodes everywhere.
+    srand(45);
+    while (size < n) {
+        int k = 1 + rand() % 70;
+        if (k > n - size)
+            k = n - size;
+        PVector_t part = build(size, k), next;
+        if (rand() % 2) {
+            next = pvector_concat(vec, part);
+            for (int i = 0; i < k; i++)
+                expected[size + i] = size + i;
+        }
+        else {
+            next = pvector_concat(part, vec);
+            memmove(expected + k, expected, size * sizeof(int));
+            for (int i = 0; i < k; i++)
+                expected[i] = size + i;
+        }
+        pvector_release(vec);
+        pvector_release(part);
+        vec = next;
+        size += k;
+    }
+    CU_ASSERT(equals(vec, expected, n));
+
+    // updates and appends work on the relaxed tree.
+    for (int i = 0; i < n; i += 13) {
+        int value = -i;
+        PVector_t next = pvector_set(vec, i, &value);
+        pvector_release(vec);
+        vec = next;
+        expected[i] = -i;
+    }
+    PVector_t longer = pvector_retain(vec);
+    for (int i = 0; i < 2000; i++) {
+        PVector_t next = pvector_push_back(longer, &i);
+        pvector_release(longer);
+        longer = next;
+    }
+    CU_ASSERT(equals(vec, expected, n));
+    CU_ASSERT(pvector_size(longer) == (size_t) n + 2000);
+    CU_ASSERT(*(const int*) pvector_get(longer, n + 1999) == 1999);
+
+    pvector_release(vec);
+    pvector_release(longer);
+    free(expected);
+}
+
+static void* read_snapshot(void* arg)
+{
+    PVector_t snapshot = arg;
+    size_t sum = 0;
+
+    for (int round = 0; round < 20; round++)
+        for (size_t i = 0; i < pvector_size(snapshot); i++)
+            sum += *(const int*) pvector_get(snapshot, i);
+    pvector_release(snapshot);
+    return (void*) sum;
+}
+
+void snapshot_pvector()
+{
+    PVector_t vec = build(0, 10000);
+    pthread_t readers[4];
+    void* sums[4];
+
+    // readers get a reference, the writer carries on with new versions.
+    for (int t = 0; t < 4; t++)
+        pthread_create(&readers[t], NULL, read_snapshot, pvector_retain(vec));
+    for (int i = 0; i < 10000; i++) {
+        int value = 0;
+        PVector_t next = pvector_set(vec, i, &value);
+        pvector_release(vec);
+        vec = next;
+    }
+    for (int t = 0; t < 4; t++)
+        pthread_join(readers[t], &sums[t]);
+
+    for (int t = 0; t < 4; t++)
+        CU_ASSERT((size_t) sums[t] == 20 * (size_t) 9999 * 10000 / 2);
+    CU_ASSERT(*(const int*) pvector_get(vec, 9999) == 0);
+    pvector_release(vec);
+}
+
+/* * Tests  registration * */
+
+int add_pvector_suite()
+{
+    CU_pSuite suite = CU_add_suite("pvector-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create pvector suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "push_back", push_pvector);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create pvector test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "set", set_pvector);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create pvector test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "concat", concat_pvector);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create pvector test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "relaxed", relaxed_pvector);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create pvector test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "snapshot", snapshot_pvector);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create pvector test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,198 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../src/slotmap.h"
+
+/* * utilities * */
+
+static int g_freed;
+
+static void
+count_free(void* element)
+{
+    (void) element;
+    g_freed++;
+}
+
+/* * Tests * */
+
+void insert_slotmap()
+{
+    SlotMap_t map = slotmap_create(sizeof(int), NULL, NULL);
+    SlotHandle handles[100];
+
+    CU_ASSERT(slotmap_size(map) == 0);
+    CU_ASSERT(slotmap_data(map) == NULL);
+    CU_ASSERT(slotmap_get(map, SLOT_HANDLE_NULL) == NULL);
+
+    for (int i = 0; i < 100; i++) {
+        handles[i] = slotmap_insert(map, &i);
+        CU_ASSERT(handles[i] != SLOT_HANDLE_NULL);
+    }
+    CU_ASSERT(slotmap_size(map) == 100);
+
+    int ok = 1;
+    for (int i = 0; i < 100; i++) {
+        int* v = slotmap_get(map, handles[i]);
+        ok = ok && v && *v == i;
+        ok = ok && slotmap_handle_at(map, (size_t) i) == handles[i];
+    }
+    CU_ASSERT(ok);
+    CU_ASSERT(((int*) slotmap_data(map))[42] == 42);
+    CU_ASSERT(!slotmap_contains(map, SLOT_HANDLE_NULL));
+
+    slotmap_destroy(map);
+}
+
+void erase_slotmap()
+{
+    SlotMap_t map = slotmap_create(sizeof(int), count_free, NULL);
+    SlotHandle handles[10];
+    g_freed = 0;
+
+    for (int i = 0; i < 10; i++)
+        handles[i] = slotmap_insert(map, &i);
+
+    // the last element moves into the hole, the data stays packed.
+    CU_ASSERT(slotmap_erase(map, handles[3]) == 0);
+    CU_ASSERT(g_freed == 1);
+    CU_ASSERT(slotmap_size(map) == 9);
+    CU_ASSERT(((int*) slotmap_data(map))[3] == 9);
+    CU_ASSERT(slotmap_handle_at(map, 3) == handles[9]);
+    CU_ASSERT(*(int*) slotmap_get(map, handles[9]) == 9);
+
+    // a stale handle neither erases nor finds the element in its slot.
+    CU_ASSERT(slotmap_get(map, handles[3]) == NULL);
+    CU_ASSERT(slotmap_erase(map, handles[3]) != 0);
+    int value = 100;
+    SlotHandle reused = slotmap_insert(map, &value);
+    CU_ASSERT((uint32_t) reused == (uint32_t) handles[3]);
+    CU_ASSERT(reused != handles[3]);
+    CU_ASSERT(slotmap_get(map, handles[3]) == NULL);
+    CU_ASSERT(*(int*) slotmap_get(map, reused) == 100);
+
+    // erase the last element.
+    CU_ASSERT(slotmap_erase(map, reused) == 0);
+    CU_ASSERT(slotmap_size(map) == 9);
+
+    int sum = 0, ok = 1;
+    for (size_t i = 0; i < slotmap_size(map); i++) {
+        sum += ((int*) slotmap_data(map))[i];
+        int* v = slotmap_get(map, slotmap_handle_at(map, i));
+        ok = ok && v == (int*) slotmap_data(map) + i;
+    }
+    CU_ASSERT(ok);
+    CU_ASSERT(sum == 45 - 3);
+
+    slotmap_clear(map);
+    CU_ASSERT(g_freed == 11);
+    CU_ASSERT(slotmap_size(map) == 0);
+    CU_ASSERT(slotmap_get(map, handles[0]) == NULL);
+    CU_ASSERT(slotmap_insert(map, &value) != handles[0]);
+
+    slotmap_destroy(map);
+    CU_ASSERT(g_freed == 12);
+}
+
+void churn_slotmap()
+{
+    SlotMap_t map = slotmap_create(sizeof(uint32_t), NULL, NULL);
+    SlotHandle handles[256] = {0};
+    uint32_t values[256] = {0};
+    uint32_t rng = 12345;
+    int ok = 1;
+
+    CU_ASSERT(slotmap_reserve(map, 256) == 0);
+    void* data = NULL;
+    for (int n = 0; n < 20000; n++) {
+        rng = rng * 1103515245 + 12345;
+        size_t k = (rng >> 16) % 256;
+        if (handles[k]) {
+            ok = ok && *(uint32_t*) slotmap_get(map, handles[k]) == values[k];
+            ok = ok && slotmap_erase(map, handles[k]) == 0;
+            ok = ok && !slotmap_contains(map, handles[k]);
+            handles[k] = SLOT_HANDLE_NULL;
+        }
+        else {
+            values[k] = rng;
+            handles[k] = slotmap_insert(map, &rng);
+            data = data ? data : slotmap_data(map);
+        }
+    }
+    // the reserved capacity was never exceeded.
+    CU_ASSERT(slotmap_data(map) == data);
+
+    size_t live = 0;
+    for (size_t k = 0; k < 256; k++) {
+        if (!handles[k])
+            continue;
+        live++;
+        ok = ok && *(uint32_t*) slotmap_get(map, handles[k]) == values[k];
+    }
+    CU_ASSERT(ok);
+    CU_ASSERT(slotmap_size(map) == live);
+
+    slotmap_destroy(map);
+}
+
+/* * Tests  registration * */
+
+int add_slotmap_suite()
+{
+    CU_pSuite suite = CU_add_suite("slotmap-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create slotmap suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "insert", insert_slotmap);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create slotmap test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "erase", erase_slotmap);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create slotmap test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "churn", churn_slotmap);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create slotmap test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
@@ -0,0 +1,190 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "../src/soaarray.h"
+
+/* * utilities * */
+
+struct Trade {
+    int32_t id;
+    double  price;
+    char    tag[3];
+};
+
+static const size_t g_trade_sizes[] = {
+    sizeof(int32_t), sizeof(double), 3
+};
+static const size_t g_trade_offsets[] = {
+    offsetof(struct Trade, id),
+    offsetof(struct Trade, price),
+    offsetof(struct Trade, tag)
+};
+
+static struct Trade
+make_trade(int32_t i)
+{
+    struct Trade t = {i, i * 1.5, {'a' + i % 26, 'b', 'c'}};
+    return t;
+}
+
+static int
+columns_aligned(SoaArray_t a)
+{
+    for (size_t f = 0; f < soa_array_nfields(a); f++)
+        if ((uintptr_t) soa_array_column(a, f) % 64)
+            return 0;
+    return 1;
+}
+
+/* * Tests * */
+
+void append_soa_array()
+{
+    SoaArray_t a = soa_array_create(3, g_trade_sizes);
+    struct Trade trades[1000];
+    int correct = 1;
+
+    CU_ASSERT(soa_array_size(a) == 0);
+    CU_ASSERT(soa_array_nfields(a) == 3);
+    CU_ASSERT(soa_array_field_size(a, 2) == 3);
+
+    for (int32_t i = 0; i < 1000; i++)
+        trades[i] = make_trade(i);
+    CU_ASSERT(soa_array_append_records(a, trades, sizeof(struct Trade),
+                                       g_trade_offsets, 1000) == SOA_ARRAY_OK);
+    CU_ASSERT(soa_array_size(a) == 1000);
+    CU_ASSERT(soa_array_capacity(a) >= 1000);
+    CU_ASSERT(columns_aligned(a));
+
+    const int32_t* ids = soa_array_column(a, 0);
+    const double* prices = soa_array_column(a, 1);
+    for (int32_t i = 0; i < 1000; i++) {
+        struct Trade t;
+        soa_array_get_record(a, i, &t, g_trade_offsets);
+        if (ids[i] != i || prices[i] != i * 1.5 || t.tag[0] != 'a' + i % 26)
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+
+    int32_t more_ids[] = {-1, -2};
+    double more_prices[] = {0.25, 0.5};
+    char more_tags[] = "xyzuvw";
+    const void* columns[] = {more_ids, more_prices, more_tags};
+    CU_ASSERT(soa_array_append_columns(a, columns, 2) == SOA_ARRAY_OK);
+    CU_ASSERT(soa_array_size(a) == 1002);
+    CU_ASSERT(*(int32_t*) soa_array_get(a, 0, 1001) == -2);
+    CU_ASSERT(*(double*) soa_array_get(a, 1, 1000) == 0.25);
+    CU_ASSERT(*(char*) soa_array_get(a, 2, 1001) == 'u');
+
+    soa_array_destroy(a);
+}
+
+void resize_soa_array()
+{
+    SoaArray_t a = soa_array_create(3, g_trade_sizes);
+    struct Trade t = make_trade(7);
+
+    soa_array_append_records(a, &t, sizeof(t), g_trade_offsets, 1);
+    CU_ASSERT(soa_array_reserve_capacity(a, 100) == SOA_ARRAY_OK);
+    CU_ASSERT(soa_array_capacity(a) == 100);
+    CU_ASSERT(columns_aligned(a));
+    CU_ASSERT(*(int32_t*) soa_array_get(a, 0, 0) == 7);
+
+    CU_ASSERT(soa_array_resize(a, 300) == SOA_ARRAY_OK);
+    CU_ASSERT(soa_array_size(a) == 300);
+    CU_ASSERT(*(int32_t*) soa_array_get(a, 0, 0) == 7);
+    CU_ASSERT(*(double*) soa_array_get(a, 1, 299) == 0.0);
+    CU_ASSERT(*(char*) soa_array_get(a, 2, 150) == 0);
+
+    CU_ASSERT(soa_array_resize(a, 1) == SOA_ARRAY_OK);
+    CU_ASSERT(soa_array_size(a) == 1);
+    soa_array_destroy(a);
+}
+
+void permute_soa_array()
+{
+    SoaArray_t a = soa_array_create(3, g_trade_sizes);
+    size_t perm[500];
+    int correct = 1;
+
+    for (int32_t i = 0; i < 500; i++) {
+        struct Trade t = make_trade(i);
+        soa_array_append_records(a, &t, sizeof(t), g_trade_offsets, 1);
+        perm[i] = 499 - i;
+    }
+
+    // reverse all records
+    CU_ASSERT(soa_array_permute(a, perm) == SOA_ARRAY_OK);
+    for (int32_t i = 0; i < 500; i++) {
+        struct Trade t;
+        soa_array_get_record(a, i, &t, g_trade_offsets);
+        if (t.id != 499 - i || t.price != (499 - i) * 1.5 ||
+            t.tag[0] != 'a' + (499 - i) % 26)
+            correct = 0;
+    }
+    CU_ASSERT(correct);
+    soa_array_destroy(a);
+}
+
+/* * Tests  registration * */
+
+int add_soa_array_suite()
+{
+    CU_pSuite suite = CU_add_suite("soa-array-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create soa array suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "append", append_soa_array);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create soa array test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "resize", resize_soa_array);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create soa array test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "permute", permute_soa_array);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create soa array test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
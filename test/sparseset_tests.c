@@ -0,0 +1,167 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../src/sparseset.h"
+#include "../src/memtrace.h"
+
+/* * Tests * */
+
+void insert_sparseset()
+{
+    SparseSet_t set = sparseset_create();
+
+    CU_ASSERT(sparseset_size(set) == 0);
+    CU_ASSERT(!sparseset_contains(set, 0));
+    CU_ASSERT(!sparseset_contains(set, UINT32_MAX));
+
+    for (uint32_t id = 0; id < 1000; id += 3)
+        CU_ASSERT(sparseset_insert(set, id) == 0);
+    CU_ASSERT(sparseset_insert(set, 3) == 0);
+    CU_ASSERT(sparseset_size(set) == 334);
+
+    int ok = 1;
+    for (uint32_t id = 0; id < 1000; id++)
+        ok = ok && !sparseset_contains(set, id) == !!(id % 3);
+    CU_ASSERT(ok);
+
+    const uint32_t* members = sparseset_members(set);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < sparseset_size(set); i++)
+        sum += members[i];
+    CU_ASSERT(sum == 3 * (333 * 334 / 2));
+
+    CU_ASSERT(sparseset_erase(set, 4) != 0);
+    CU_ASSERT(sparseset_erase(set, 0) == 0);
+    CU_ASSERT(sparseset_erase(set, 0) != 0);
+    CU_ASSERT(!sparseset_contains(set, 0));
+    CU_ASSERT(sparseset_contains(set, 999));
+    CU_ASSERT(sparseset_size(set) == 333);
+
+    sparseset_clear(set);
+    CU_ASSERT(sparseset_size(set) == 0);
+    CU_ASSERT(!sparseset_contains(set, 999));
+    CU_ASSERT(sparseset_insert(set, 6) == 0);
+    CU_ASSERT(sparseset_contains(set, 6));
+    CU_ASSERT(!sparseset_contains(set, 3));
+
+    sparseset_destroy(set);
+}
+
+void paged_sparseset()
+{
+    ClibMemStats before, after;
+    clib_mem_stats(CLIB_MEM_SPARSESET, &before);
+
+    SparseSet_t set = sparseset_create();
+    CU_ASSERT(sparseset_insert(set, 7) == 0);
+    CU_ASSERT(sparseset_insert(set, UINT32_MAX) == 0);
+    CU_ASSERT(sparseset_insert(set, 1u << 31) == 0);
+    CU_ASSERT(sparseset_contains(set, UINT32_MAX));
+    CU_ASSERT(sparseset_contains(set, 1u << 31));
+    CU_ASSERT(!sparseset_contains(set, UINT32_MAX - 1));
+    CU_ASSERT(!sparseset_contains(set, 8));
+
+    // three pages and the page table, not 16 GiB for every id.
+    clib_mem_stats(CLIB_MEM_SPARSESET, &after);
+    CU_ASSERT(after.live_bytes - before.live_bytes < 64 * 1024 * 1024);
+
+    CU_ASSERT(sparseset_erase(set, 7) == 0);
+    CU_ASSERT(sparseset_size(set) == 2);
+    CU_ASSERT(sparseset_contains(set, UINT32_MAX));
+
+    sparseset_destroy(set);
+}
+
+void intersect_sparseset()
+{
+    SparseSet_t a = sparseset_create();
+    SparseSet_t b = sparseset_create();
+    SparseSet_t c = sparseset_create();
+
+    for (uint32_t id = 0; id < 10000; id += 2)
+        sparseset_insert(a, id);
+    for (uint32_t id = 0; id < 300; id += 3)
+        sparseset_insert(b, id);
+    sparseset_insert(c, 12345);
+
+    CU_ASSERT(sparseset_intersect(c, a, b) == 0);
+    CU_ASSERT(sparseset_size(c) == 50);
+    CU_ASSERT(!sparseset_contains(c, 12345));
+    int ok = 1;
+    for (uint32_t id = 0; id < 300; id++)
+        ok = ok && !sparseset_contains(c, id) == !!(id % 6);
+    CU_ASSERT(ok);
+
+    CU_ASSERT(sparseset_intersect(c, b, a) == 0);
+    CU_ASSERT(sparseset_size(c) == 50);
+
+    sparseset_clear(b);
+    CU_ASSERT(sparseset_intersect(c, a, b) == 0);
+    CU_ASSERT(sparseset_size(c) == 0);
+
+    sparseset_destroy(a);
+    sparseset_destroy(b);
+    sparseset_destroy(c);
+}
+
+/* * Tests  registration * */
+
+int add_sparseset_suite()
+{
+    CU_pSuite suite = CU_add_suite("sparseset-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create sparseset suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "insert", insert_sparseset);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create sparseset test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "paged", paged_sparseset);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create sparseset test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "intersect", intersect_sparseset);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create sparseset test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
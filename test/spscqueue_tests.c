@@ -0,0 +1,224 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../src/spscqueue.h"
+
+/* * utilities * */
+
+static const size_t n_transfers = 1000000;
+
+static void*
+spsc_producer(void* arg)
+{
+    SpscQueue_t q = arg;
+    size_t batch[16];
+    size_t next = 0;
+
+    while (next < n_transfers) {
+        size_t n = 0;
+        while (n < 16 && next + n < n_transfers) {
+            batch[n] = next + n;
+            n++;
+        }
+        next += spsc_queue_push_n(q, batch, n);
+    }
+    return NULL;
+}
+
+/* the elements are char* that own a copy of a string. */
+static void*
+spsc_copy_str(void* dest, const void* src, size_t n)
+{
+    (void) n;
+    const char* str = *(char* const*) src;
+    char* copy = malloc(strlen(str) + 1);
+    strcpy(copy, str);
+    *(char**) dest = copy;
+    return dest;
+}
+
+static void
+spsc_free_str(void* element)
+{
+    free(*(char**) element);
+}
+
+/* * Tests * */
+
+void create_spsc_queue()
+{
+    SpscQueue_t q = spsc_queue_create(sizeof(int), NULL, NULL, 10);
+    CU_ASSERT(q != NULL);
+    CU_ASSERT(spsc_queue_capacity(q) == 16);
+    CU_ASSERT(spsc_queue_size(q) == 0);
+    spsc_queue_destroy(q);
+
+    CU_ASSERT(spsc_queue_create(sizeof(int), NULL, NULL, SIZE_MAX) == NULL);
+}
+
+void full_empty_spsc_queue()
+{
+    SpscQueue_t q = spsc_queue_create(sizeof(int), NULL, NULL, 4);
+    int v, ordered = 1;
+
+    CU_ASSERT(spsc_queue_pop(q, &v) == SPSC_QUEUE_EMPTY);
+    for (int i = 0; i < 4; i++)
+        CU_ASSERT(spsc_queue_push(q, &i) == SPSC_QUEUE_OK);
+    CU_ASSERT(spsc_queue_push(q, &v) == SPSC_QUEUE_FULL);
+    CU_ASSERT(spsc_queue_size(q) == 4);
+
+    // wrap around a number of times.
+    for (int i = 4; i < 100; i++) {
+        spsc_queue_pop(q, &v);
+        if (v != i - 4)
+            ordered = 0;
+        spsc_queue_push(q, &i);
+    }
+    CU_ASSERT(ordered);
+    spsc_queue_destroy(q);
+}
+
+void batch_spsc_queue()
+{
+    SpscQueue_t q = spsc_queue_create(sizeof(int), NULL, NULL, 8);
+    int in[16], out[16], ordered = 1;
+    for (int i = 0; i < 16; i++)
+        in[i] = i;
+
+    CU_ASSERT(spsc_queue_push_n(q, in, 5) == 5);
+    CU_ASSERT(spsc_queue_pop_n(q, out, 3) == 3);
+    // only 6 slots are free, and they wrap.
+    CU_ASSERT(spsc_queue_push_n(q, in + 5, 8) == 6);
+    CU_ASSERT(spsc_queue_pop_n(q, out + 3, 16) == 8);
+    for (int i = 0; i < 11; i++)
+        if (out[i] != i)
+            ordered = 0;
+    CU_ASSERT(ordered);
+    spsc_queue_destroy(q);
+}
+
+void owned_spsc_queue()
+{
+    SpscQueue_t q = spsc_queue_create(
+            sizeof(char*), spsc_free_str, spsc_copy_str, 4
+            );
+    const char* words[] = {"one", "two", "three"};
+    char* out[3];
+
+    // popped elements move to the caller, it frees them.
+    CU_ASSERT(spsc_queue_push_n(q, words, 3) == 3);
+    CU_ASSERT(spsc_queue_pop(q, &out[0]) == SPSC_QUEUE_OK);
+    CU_ASSERT(strcmp(out[0], "one") == 0 && out[0] != words[0]);
+    CU_ASSERT(spsc_queue_pop_n(q, out + 1, 2) == 2);
+    CU_ASSERT(strcmp(out[2], "three") == 0);
+    for (int i = 0; i < 3; i++)
+        free(out[i]);
+
+    // the ones left are freed with the queue.
+    CU_ASSERT(spsc_queue_push(q, &words[0]) == SPSC_QUEUE_OK);
+    spsc_queue_destroy(q);
+}
+
+void threads_spsc_queue()
+{
+    SpscQueue_t q = spsc_queue_create(sizeof(size_t), NULL, NULL, 1024);
+    pthread_t producer;
+    size_t expected = 0, buf[32];
+    int ordered = 1;
+
+    pthread_create(&producer, NULL, spsc_producer, q);
+    while (expected < n_transfers) {
+        size_t n = spsc_queue_pop_n(q, buf, 32);
+        for (size_t i = 0; i < n; i++)
+            if (buf[i] != expected++)
+                ordered = 0;
+    }
+    pthread_join(producer, NULL);
+
+    CU_ASSERT(ordered);
+    CU_ASSERT(spsc_queue_size(q) == 0);
+    spsc_queue_destroy(q);
+}
+
+/* * Tests  registration * */
+
+int add_spsc_queue_suite()
+{
+    CU_pSuite suite = CU_add_suite("spsc-queue-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create spsc queue suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "create", create_spsc_queue);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create spsc queue test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "full_empty", full_empty_spsc_queue);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create spsc queue test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "batch", batch_spsc_queue);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create spsc queue test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "owned", owned_spsc_queue);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create spsc queue test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "threads", threads_spsc_queue);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create spsc queue test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
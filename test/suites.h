@@ -22,5 +22,29 @@
  * All available test suites.
  */
 int add_array_suite();
+int add_art_suite();
+int add_bitset_suite();
+int add_bloom_suite();
+int add_btree_suite();
+int add_cache_suite();
+int add_darray_parallel_suite();
+int add_darray_rcu_suite();
+int add_darray_simd_suite();
+int add_darray_slice_suite();
+int add_darray_sort_suite();
+int add_deque_suite();
+int add_dstring_suite();
+int add_ebr_suite();
+int add_hazard_suite();
+int add_ilist_suite();
 int add_list_suite();
+int add_memtrace_suite();
+int add_mpmc_queue_suite();
+int add_plist_suite();
+int add_pvector_suite();
+int add_slotmap_suite();
+int add_soa_array_suite();
+int add_sparseset_suite();
+int add_spsc_queue_suite();
 int add_stack_suite();
+int add_threadpool_suite();
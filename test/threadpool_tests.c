@@ -0,0 +1,185 @@
+/*
+ * This file is part of c-lib
+ *
+ * Copyright © 2017 Maarten Duijndam
+ *
+ * c-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser General Public License as published by
+ * the Free Software Foundation, either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * c-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the Lesser General Public License
+ * along with c-lib.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "../src/threadpool.h"
+
+/* * utilities * */
+
+static ThreadPool_t g_pool;
+static atomic_size_t g_detached_count;
+
+static void*
+square(void* arg)
+{
+    uintptr_t v = (uintptr_t) arg;
+    return (void*) (v * v);
+}
+
+static void*
+count_detached(void* arg)
+{
+    atomic_fetch_add(&g_detached_count, 1);
+    return NULL;
+}
+
+/* computes fibonacci numbers with nested tasks that join each other. */
+static void*
+fib(void* arg)
+{
+    uintptr_t n = (uintptr_t) arg;
+    ThreadFuture_t f;
+
+    if (n < 2)
+        return arg;
+    threadpool_submit(g_pool, fib, (void*) (n - 1), &f);
+    uintptr_t b = (uintptr_t) fib((void*) (n - 2));
+    uintptr_t a = (uintptr_t) threadpool_join(f);
+    return (void*) (a + b);
+}
+
+static void
+sum_range(size_t begin, size_t end, void* arg)
+{
+    atomic_size_t* sum = arg;
+    size_t local = 0;
+    for (size_t i = begin; i < end; i++)
+        local += i;
+    atomic_fetch_add(sum, local);
+}
+
+/* * Tests * */
+
+void submit_threadpool()
+{
+    ThreadFuture_t futures[100];
+    int correct = 1;
+
+    g_pool = threadpool_create(4);
+    CU_ASSERT(g_pool != NULL);
+    CU_ASSERT(threadpool_size(g_pool) == 4);
+
+    for (uintptr_t i = 0; i < 100; i++)
+        CU_ASSERT(threadpool_submit(g_pool, square, (void*) i, &futures[i]) ==
+                  THREADPOOL_OK);
+    for (uintptr_t i = 0; i < 100; i++)
+        if ((uintptr_t) threadpool_join(futures[i]) != i * i)
+            correct = 0;
+    CU_ASSERT(correct);
+
+    threadpool_destroy(g_pool);
+}
+
+void detached_threadpool()
+{
+    atomic_init(&g_detached_count, 0);
+    g_pool = threadpool_create(3);
+    for (size_t i = 0; i < 1000; i++)
+        threadpool_submit(g_pool, count_detached, NULL, NULL);
+    // destroy waits for all tasks.
+    threadpool_destroy(g_pool);
+    CU_ASSERT(atomic_load(&g_detached_count) == 1000);
+}
+
+void nested_threadpool()
+{
+    ThreadFuture_t f;
+
+    g_pool = threadpool_create(4);
+    threadpool_submit(g_pool, fib, (void*) 18, &f);
+    CU_ASSERT((uintptr_t) threadpool_join(f) == 2584);
+    threadpool_destroy(g_pool);
+}
+
+void parallel_for_threadpool()
+{
+    const size_t n = 1000000;
+    atomic_size_t sum;
+
+    g_pool = threadpool_create(4);
+
+    atomic_init(&sum, 0);
+    threadpool_parallel_for(g_pool, 0, n, 0, sum_range, &sum);
+    CU_ASSERT(atomic_load(&sum) == n * (n - 1) / 2);
+
+    atomic_init(&sum, 0);
+    threadpool_parallel_for(g_pool, 10, 20, 1, sum_range, &sum);
+    CU_ASSERT(atomic_load(&sum) == 145);
+
+    atomic_init(&sum, 0);
+    threadpool_parallel_for(threadpool_default(), 0, n, 1000, sum_range, &sum);
+    CU_ASSERT(atomic_load(&sum) == n * (n - 1) / 2);
+
+    threadpool_destroy(g_pool);
+}
+
+/* * Tests  registration * */
+
+int add_threadpool_suite()
+{
+    CU_pSuite suite = CU_add_suite("threadpool-test", NULL, NULL);
+    if (!suite) {
+        fprintf(stderr,
+                "unable to create threadpool suite: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    CU_pTest test = CU_add_test(suite, "submit", submit_threadpool);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create threadpool test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "detached", detached_threadpool);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create threadpool test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "nested", nested_threadpool);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create threadpool test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    test = CU_add_test(suite, "parallel_for", parallel_for_threadpool);
+    if (!test) {
+        fprintf(stderr,
+                "unable to create threadpool test: %s\n",
+                CU_get_error_msg()
+               );
+        return CU_get_error();
+    }
+
+    return CU_get_error();
+}
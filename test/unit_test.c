@@ -39,6 +39,10 @@ int add_suites()
     if (res)
         return res;
     
+    res = add_deque_suite();
+    if (res)
+        return res;
+
     res = add_list_suite();
     if (res)
         return res;
@@ -47,6 +51,101 @@ int add_suites()
     if (res)
         return res;
 
+    res = add_threadpool_suite();
+    if (res)
+        return res;
+
+#ifndef CLIB_NO_MEMTRACE
+    // the accounting is compiled out with CLIB_MEMTRACE=OFF.
+    res = add_memtrace_suite();
+    if (res)
+        return res;
+#endif
+
+    res = add_spsc_queue_suite();
+    if (res)
+        return res;
+
+    res = add_mpmc_queue_suite();
+    if (res)
+        return res;
+
+    res = add_darray_parallel_suite();
+    if (res)
+        return res;
+
+    res = add_darray_sort_suite();
+    if (res)
+        return res;
+
+    res = add_darray_simd_suite();
+    if (res)
+        return res;
+
+    res = add_soa_array_suite();
+    if (res)
+        return res;
+
+    res = add_darray_slice_suite();
+    if (res)
+        return res;
+
+    res = add_bitset_suite();
+    if (res)
+        return res;
+
+    res = add_bloom_suite();
+    if (res)
+        return res;
+
+    res = add_cache_suite();
+    if (res)
+        return res;
+
+    res = add_btree_suite();
+    if (res)
+        return res;
+
+    res = add_art_suite();
+    if (res)
+        return res;
+
+    res = add_ilist_suite();
+    if (res)
+        return res;
+
+    res = add_plist_suite();
+    if (res)
+        return res;
+
+    res = add_pvector_suite();
+    if (res)
+        return res;
+
+    res = add_ebr_suite();
+    if (res)
+        return res;
+
+    res = add_hazard_suite();
+    if (res)
+        return res;
+
+    res = add_darray_rcu_suite();
+    if (res)
+        return res;
+
+    res = add_slotmap_suite();
+    if (res)
+        return res;
+
+    res = add_sparseset_suite();
+    if (res)
+        return res;
+
+    res = add_dstring_suite();
+    if (res)
+        return res;
+
     return res;
 }
 